@@ -0,0 +1,786 @@
+// Filename: cache.cpp
+// Author: Himanshu Narayana
+// This file is the compile cache (--cache). The result of each successful compile is kept in a directory, under a hash of everything
+// that goes into it: the source, the compiler itself, the sizes the generated C is built with, and the options. When the same program
+// is compiled again its C is taken from the cache without scanning or parsing, and so is the executable built from it (--executable).
+//
+// Each entry is one file, written under a temporary name and renamed into place, so any number of compiles can share a cache directory:
+// a reader either finds a whole entry or none. Using an entry touches its modification time, and once the cache grows past its size limit
+// the entries used longest ago are removed. The counts of hits, misses and evictions are kept in the directory's statistics file.
+//
+// A program that missed is compiled incrementally: the code of each of its top-level procedures is kept under the name of the file
+// (see procedures.cpp), and the next compile of the file takes the procedures that haven't changed from there.
+
+#include "compiler.h"
+
+#include <atomic>
+#include <cerrno>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifndef _WIN32
+#include <dirent.h>
+#include <sys/file.h>
+#endif
+
+using namespace std;
+
+// Define data structure for the start of a cache entry. The payload follows it.
+struct CacheEntryHeader
+{
+	unsigned int magic; // CACHE_ENTRY_MAGIC
+	unsigned int kind; // CacheEntryKind
+	CacheKey key;
+	unsigned long long payloadLength;
+	unsigned long long checksum; // First half of the hash of the payload, to catch an entry damaged on disk
+};
+
+// Define data structure for the counts kept in the statistics file
+struct CacheStatistics
+{
+	unsigned long long hits;
+	unsigned long long misses;
+	unsigned long long stores;
+	unsigned long long evictions;
+	unsigned long long bytes; // Size of the entries, as far as the compiles that stored and evicted them know
+	unsigned long long reused; // Top-level procedures taken from the last compile of their file, and compiled again
+	unsigned long long recompiled;
+};
+
+// Define enumeration type to encapsulate the kinds of cache entries
+enum CacheEntryKind { CACHE_RESULT = 1, CACHE_FILE = 2, CACHE_PROCEDURES = 3 };
+
+#define CACHE_ENTRY_MAGIC 0x3143524E
+
+static unsigned long long mixBits( unsigned long long bits );
+static const CacheKey& compilerIdentity( void );
+static string entryPath( const CacheKey& key, const char* extension );
+static bool readEntry( const string& path, const CacheKey& key, const unsigned int kind, string& payload );
+static bool writeEntry( const string& path, const CacheKey& key, const unsigned int kind, const string& payload );
+static bool writeFileAtomically( const string& path, const string& contents, const int mode );
+static bool readWholeFile( const string& path, string& contents );
+static void appendNumber( string& payload, const unsigned long long number );
+static void appendText( string& payload, const string& text );
+static bool takeNumber( const string& payload, size_t& position, unsigned long long& number );
+static bool takeText( const string& payload, size_t& position, string& text );
+template <typename T> static void appendArray( string& payload, const vector<T>& items );
+template <typename T> static bool takeArray( const string& payload, size_t& position, vector<T>& items );
+static bool fingerprintLess( const ProcedureFragment& first, const ProcedureFragment& second );
+static void updateStatistics( const CacheStatistics& change, const bool evict );
+static void readStatistics( const int descriptor, CacheStatistics& statistics );
+static void evictEntries( CacheStatistics& statistics );
+static void markEntryUsed( const string& path );
+
+static string cacheDirectory; // Empty unless --cache was given
+static unsigned long long cacheSizeLimit = CACHE_SIZE_LIMIT;
+static atomic<unsigned int> temporaryCount( 0 ); // Tells apart the temporary files of the threads of one process
+static int fileModeMask = 022; // The process's umask, for the permissions of the files the cache writes
+
+// Starts using the cache in the specified directory, making the directory if it isn't there, with entries of at most sizeLimit bytes in all.
+// Returns false if the directory couldn't be made.
+bool openCache( const char* directory, const unsigned long long sizeLimit )
+{
+#ifndef _WIN32
+	if( mkdir( directory, 0777 ) != 0 && errno != EEXIST )
+	{
+		return false;
+	}
+	
+	cacheDirectory = directory;
+	cacheSizeLimit = sizeLimit;
+	fileModeMask = umask( 0 );
+	umask( fileModeMask );
+	
+	// Work out who the compiler is now, before any threads need it
+	compilerIdentity();
+	
+	return true;
+#else
+	return false;
+#endif
+}
+
+// Tells whether a cache is in use
+bool cacheOpen( void )
+{
+	return cacheDirectory.empty() == false;
+}
+
+// Returns the key of a compile: the hash of the source, the compiler, the sizes of the runtime environment and the options
+CacheKey compileCacheKey( const char* source, const size_t length, const CompileOptions& options )
+{
+	CacheKey sourceKey = hashBytes( source, length, 0 );
+	unsigned long long material[] =
+	{
+		CACHE_FORMAT_VERSION, compilerIdentity().hash[0], compilerIdentity().hash[1], REGISTER_SIZE, MEMORY_SIZE,
+		static_cast<unsigned long long>( options.nestingLimit ), options.emitIr ? 1ULL : 0ULL, length, sourceKey.hash[0], sourceKey.hash[1]
+	};
+	
+	return hashBytes( reinterpret_cast<const char*>( material ), sizeof( material ), CACHE_RESULT );
+}
+
+// Returns the key of a file built from the specified inputs (for the executable: the C, runtime.c and the command that builds it)
+CacheKey fileCacheKey( const string& first, const string& second, const string& third )
+{
+	CacheKey keys[3] = { hashBytes( first.data(), first.size(), 1 ), hashBytes( second.data(), second.size(), 2 ), hashBytes( third.data(), third.size(), 3 ) };
+	
+	return hashBytes( reinterpret_cast<const char*>( keys ), sizeof( keys ), CACHE_FILE );
+}
+
+// Looks up the result of a compile. Returns false, and counts a miss, if it isn't in the cache.
+bool findCachedResult( const CacheKey& key, CompileResult& result )
+{
+	CacheStatistics change = CacheStatistics();
+	unsigned long long counts[3];
+	string payload;
+	size_t position = 0;
+	bool found;
+	
+	found = readEntry( entryPath( key, ".cache" ), key, CACHE_RESULT, payload );
+	
+	for( int i = 0; i < 3 && found; i++ )
+	{
+		found = takeNumber( payload, position, counts[i] );
+	}
+	
+	found = found && takeText( payload, position, result.code ) && takeText( payload, position, result.ir ) && takeText( payload, position, result.diagnostics );
+	
+	if( found )
+	{
+		result.succeeded = true;
+		result.lineCount = counts[0];
+		result.warningCount = counts[1];
+		result.errorCount = counts[2];
+		change.hits = 1;
+	}
+	else
+	{
+		change.misses = 1;
+	}
+	
+	updateStatistics( change, false );
+	return found;
+}
+
+// Keeps the result of a successful compile in the cache
+void storeCachedResult( const CacheKey& key, const CompileResult& result )
+{
+	string payload;
+	
+	payload.reserve( result.code.size() + result.ir.size() + result.diagnostics.size() + 64 );
+	appendNumber( payload, result.lineCount );
+	appendNumber( payload, result.warningCount );
+	appendNumber( payload, result.errorCount );
+	appendText( payload, result.code );
+	appendText( payload, result.ir );
+	appendText( payload, result.diagnostics );
+	
+	writeEntry( entryPath( key, ".cache" ), key, CACHE_RESULT, payload );
+}
+
+// Looks up a file built before and copies it to filename, with the specified permissions.
+// Returns false, and counts a miss, if it isn't in the cache or couldn't be copied.
+bool findCachedFile( const CacheKey& key, const char* filename, const int mode )
+{
+	CacheStatistics change = CacheStatistics();
+	string payload;
+	bool found;
+	
+	found = readEntry( entryPath( key, ".file" ), key, CACHE_FILE, payload ) && writeFileAtomically( filename, payload, mode );
+	
+	if( found )
+	{
+		change.hits = 1;
+	}
+	else
+	{
+		change.misses = 1;
+	}
+	
+	updateStatistics( change, false );
+	return found;
+}
+
+// Keeps a copy of a file that was built in the cache
+void storeCachedFile( const CacheKey& key, const char* filename )
+{
+	string payload;
+	
+	if( readWholeFile( filename, payload ) )
+	{
+		writeEntry( entryPath( key, ".file" ), key, CACHE_FILE, payload );
+	}
+}
+
+// Returns the key of the procedures kept for a file: the hash of its name, the compiler, the sizes of the runtime environment and the options
+CacheKey procedureCacheKey( const char* filename, const CompileOptions& options )
+{
+	string name = filename;
+	CacheKey nameKey;
+
+#ifndef _WIN32
+	// The same file is the same file whichever directory it is compiled from
+	char* fullName = realpath( filename, NULL );
+	
+	if( fullName != NULL )
+	{
+		name = fullName;
+		free( fullName );
+	}
+#endif
+	
+	nameKey = hashBytes( name.data(), name.size(), 0 );
+	
+	unsigned long long material[] =
+	{
+		CACHE_FORMAT_VERSION, compilerIdentity().hash[0], compilerIdentity().hash[1], REGISTER_SIZE, MEMORY_SIZE,
+		static_cast<unsigned long long>( options.nestingLimit ), nameKey.hash[0], nameKey.hash[1]
+	};
+	
+	return hashBytes( reinterpret_cast<const char*>( material ), sizeof( material ), CACHE_PROCEDURES );
+}
+
+// Reads the procedures kept from the last compile of a file into the cache's fragments, in order of fingerprint.
+// Returns false if there weren't any. The lookup isn't counted as a hit or a miss: the compile it is for already missed.
+bool findCachedProcedures( const CacheKey& key, ProcedureCache& procedures )
+{
+	unsigned long long count;
+	unsigned long long numbers[5];
+	string payload;
+	size_t position = 0;
+	bool found;
+	
+	procedures.fragments.clear();
+	found = readEntry( entryPath( key, ".procedures" ), key, CACHE_PROCEDURES, payload ) && takeNumber( payload, position, count );
+	
+	for( unsigned long long i = 0; found && i < count; i++ )
+	{
+		ProcedureFragment fragment;
+		
+		for( int j = 0; j < 5 && found; j++ )
+		{
+			found = takeNumber( payload, position, numbers[j] );
+		}
+		
+		found = found && takeArray( payload, position, fragment.code ) && takeArray( payload, position, fragment.setupCode ) &&
+			takeArray( payload, position, fragment.literals );
+		
+		if( found )
+		{
+			fragment.fingerprint.hash[0] = numbers[0];
+			fragment.fingerprint.hash[1] = numbers[1];
+			fragment.memoryUsed = numbers[2];
+			fragment.slotsUsed = numbers[3];
+			fragment.runtimeCalls = numbers[4];
+			procedures.fragments.push_back( fragment );
+		}
+	}
+	
+	if( found == false )
+	{
+		procedures.fragments.clear();
+		return false;
+	}
+	
+	sort( procedures.fragments.begin(), procedures.fragments.end(), fingerprintLess );
+	return true;
+}
+
+// Keeps the procedures of a compile for the next one, unless they are all the ones that were kept already,
+// and counts how many of them were reused
+void storeCachedProcedures( const CacheKey& key, const ProcedureCache& procedures )
+{
+	CacheStatistics change = CacheStatistics();
+	string payload;
+	
+	if( procedures.compiledCount > 0 || procedures.compiled.size() != procedures.fragments.size() )
+	{
+		appendNumber( payload, procedures.compiled.size() );
+		
+		for( size_t i = 0; i < procedures.compiled.size(); i++ )
+		{
+			const ProcedureFragment& fragment = procedures.compiled[i];
+			
+			appendNumber( payload, fragment.fingerprint.hash[0] );
+			appendNumber( payload, fragment.fingerprint.hash[1] );
+			appendNumber( payload, fragment.memoryUsed );
+			appendNumber( payload, fragment.slotsUsed );
+			appendNumber( payload, fragment.runtimeCalls );
+			appendArray( payload, fragment.code );
+			appendArray( payload, fragment.setupCode );
+			appendArray( payload, fragment.literals );
+		}
+		
+		writeEntry( entryPath( key, ".procedures" ), key, CACHE_PROCEDURES, payload );
+	}
+	
+	change.reused = procedures.reusedCount;
+	change.recompiled = procedures.compiledCount;
+	updateStatistics( change, false );
+}
+
+// Prints the counts from the statistics file, and how much the cache holds
+void printCacheStatistics( ostream& out )
+{
+	CacheStatistics statistics = CacheStatistics();
+
+#ifndef _WIN32
+	int descriptor = open( ( cacheDirectory + "/statistics" ).c_str(), O_RDONLY );
+	
+	if( descriptor >= 0 )
+	{
+		flock( descriptor, LOCK_SH );
+		readStatistics( descriptor, statistics );
+		close( descriptor );
+	}
+#endif
+	
+	out << "Cache" << endl;
+	out << "=====" << endl;
+	out << "Directory: " << cacheDirectory << endl;
+	out << "Hits: " << statistics.hits << endl;
+	out << "Misses: " << statistics.misses << endl;
+	out << "Hit Rate: " << ( statistics.hits + statistics.misses > 0 ? 100 * statistics.hits / ( statistics.hits + statistics.misses ) : 0 ) << "%" << endl;
+	out << "Stores: " << statistics.stores << endl;
+	out << "Evictions: " << statistics.evictions << endl;
+	out << "Size: " << statistics.bytes << " of " << cacheSizeLimit << " bytes" << endl;
+	out << "Procedures Reused: " << statistics.reused << endl;
+	out << "Procedures Recompiled: " << statistics.recompiled << endl;
+}
+
+// Hashes bytes to 128 bits (MurmurHash3, x64 128-bit variant)
+CacheKey hashBytes( const char* data, const size_t length, const unsigned long long seed )
+{
+	const unsigned long long c1 = 0x87C37B91114253D5ULL;
+	const unsigned long long c2 = 0x4CF5AD432745937FULL;
+	const size_t blockCount = length / 16;
+	unsigned long long h1 = seed;
+	unsigned long long h2 = seed;
+	unsigned long long k1;
+	unsigned long long k2;
+	const unsigned char* tail = reinterpret_cast<const unsigned char*>( data ) + blockCount * 16;
+	CacheKey key;
+	
+	for( size_t block = 0; block < blockCount; block++ )
+	{
+		memcpy( &k1, data + block * 16, 8 );
+		memcpy( &k2, data + block * 16 + 8, 8 );
+		
+		k1 *= c1;
+		k1 = ( k1 << 31 ) | ( k1 >> 33 );
+		k1 *= c2;
+		h1 ^= k1;
+		h1 = ( h1 << 27 ) | ( h1 >> 37 );
+		h1 += h2;
+		h1 = h1 * 5 + 0x52DCE729;
+		
+		k2 *= c2;
+		k2 = ( k2 << 33 ) | ( k2 >> 31 );
+		k2 *= c1;
+		h2 ^= k2;
+		h2 = ( h2 << 31 ) | ( h2 >> 33 );
+		h2 += h1;
+		h2 = h2 * 5 + 0x38495AB5;
+	}
+	
+	// The last 0 to 15 bytes
+	k1 = 0;
+	k2 = 0;
+	
+	for( int i = static_cast<int>( length & 15 ) - 1; i >= 8; i-- )
+	{
+		k2 = ( k2 << 8 ) | tail[i];
+	}
+	
+	for( int i = min( static_cast<int>( length & 15 ), 8 ) - 1; i >= 0; i-- )
+	{
+		k1 = ( k1 << 8 ) | tail[i];
+	}
+	
+	k2 *= c2;
+	k2 = ( k2 << 33 ) | ( k2 >> 31 );
+	k2 *= c1;
+	h2 ^= k2;
+	
+	k1 *= c1;
+	k1 = ( k1 << 31 ) | ( k1 >> 33 );
+	k1 *= c2;
+	h1 ^= k1;
+	
+	h1 ^= length;
+	h2 ^= length;
+	h1 += h2;
+	h2 += h1;
+	h1 = mixBits( h1 );
+	h2 = mixBits( h2 );
+	h1 += h2;
+	h2 += h1;
+	
+	key.hash[0] = h1;
+	key.hash[1] = h2;
+	
+	return key;
+}
+
+// Final mix of MurmurHash3, so every bit of the input changes about half of the bits of the hash
+unsigned long long mixBits( unsigned long long bits )
+{
+	bits ^= bits >> 33;
+	bits *= 0xFF51AFD7ED558CCDULL;
+	bits ^= bits >> 33;
+	bits *= 0xC4CEB9FE1A85EC53ULL;
+	bits ^= bits >> 33;
+	
+	return bits;
+}
+
+// Returns the hash of the running compiler's executable, so a rebuilt compiler never uses the entries of an older one.
+// If the executable can't be read, the time this file was compiled stands in for it.
+const CacheKey& compilerIdentity( void )
+{
+	static CacheKey identity;
+	static bool known = false;
+	string executable;
+	
+	if( known == false )
+	{
+		if( readWholeFile( "/proc/self/exe", executable ) == false )
+		{
+			executable = __DATE__ " " __TIME__;
+		}
+		
+		identity = hashBytes( executable.data(), executable.size(), CACHE_FORMAT_VERSION );
+		known = true;
+	}
+	
+	return identity;
+}
+
+// Returns the path of the entry with the specified key
+string entryPath( const CacheKey& key, const char* extension )
+{
+	char name[40];
+	
+	snprintf( name, sizeof( name ), "/%016llx%016llx", key.hash[0], key.hash[1] );
+	
+	return cacheDirectory + name + extension;
+}
+
+// Reads the payload of an entry, and marks the entry as just used. Returns false if there is no such entry or it isn't whole.
+// A damaged entry is removed.
+bool readEntry( const string& path, const CacheKey& key, const unsigned int kind, string& payload )
+{
+	string contents;
+	CacheEntryHeader header;
+	
+	if( readWholeFile( path, contents ) == false || contents.size() < sizeof( header ) )
+	{
+		return false;
+	}
+	
+	memcpy( &header, contents.data(), sizeof( header ) );
+	
+	if( header.magic != CACHE_ENTRY_MAGIC || header.kind != kind || header.key.hash[0] != key.hash[0] || header.key.hash[1] != key.hash[1] ||
+		header.payloadLength != contents.size() - sizeof( header ) ||
+		hashBytes( contents.data() + sizeof( header ), header.payloadLength, kind ).hash[0] != header.checksum )
+	{
+		remove( path.c_str() );
+		return false;
+	}
+	
+	payload.assign( contents, sizeof( header ), string::npos );
+	
+	markEntryUsed( path );
+	
+	return true;
+}
+
+// Writes an entry and adds it to the statistics, removing the entries used longest ago if the cache has grown too large
+bool writeEntry( const string& path, const CacheKey& key, const unsigned int kind, const string& payload )
+{
+	CacheEntryHeader header = CacheEntryHeader();
+	CacheStatistics change = CacheStatistics();
+	string contents;
+	
+	header.magic = CACHE_ENTRY_MAGIC;
+	header.kind = kind;
+	header.key = key;
+	header.payloadLength = payload.size();
+	header.checksum = hashBytes( payload.data(), payload.size(), kind ).hash[0];
+	
+	contents.reserve( sizeof( header ) + payload.size() );
+	contents.append( reinterpret_cast<const char*>( &header ), sizeof( header ) );
+	contents.append( payload );
+	
+	if( writeFileAtomically( path, contents, 0666 ) == false )
+	{
+		return false;
+	}
+	
+	markEntryUsed( path );
+	change.stores = 1;
+	change.bytes = contents.size();
+	updateStatistics( change, true );
+	
+	return true;
+}
+
+// Writes a file under a temporary name in the same directory, then renames it into place, so nobody ever sees it half written
+bool writeFileAtomically( const string& path, const string& contents, const int mode )
+{
+	char suffix[64];
+	string temporaryPath;
+	bool written;
+	
+	snprintf( suffix, sizeof( suffix ), ".tmp-%d-%u", static_cast<int>( getpid() ), temporaryCount++ );
+	temporaryPath = path + suffix;
+	
+	written = writeOutputText( temporaryPath.c_str(), contents );
+
+#ifndef _WIN32
+	written = written && chmod( temporaryPath.c_str(), mode & ~fileModeMask ) == 0;
+#endif
+	
+	if( written == false || rename( temporaryPath.c_str(), path.c_str() ) != 0 )
+	{
+		remove( temporaryPath.c_str() );
+		return false;
+	}
+	
+	return true;
+}
+
+// Reads the whole of a file into contents. Returns false if it couldn't be read.
+bool readWholeFile( const string& path, string& contents )
+{
+	int descriptor = open( path.c_str(), O_RDONLY );
+	char block[65536];
+	ssize_t readLength;
+	
+	if( descriptor < 0 )
+	{
+		return false;
+	}
+	
+	contents.clear();
+	
+	while( ( readLength = read( descriptor, block, sizeof( block ) ) ) != 0 )
+	{
+		if( readLength < 0 )
+		{
+			if( errno == EINTR )
+			{
+				continue;
+			}
+			
+			break;
+		}
+		
+		contents.append( block, readLength );
+	}
+	
+	close( descriptor );
+	return readLength == 0;
+}
+
+void appendNumber( string& payload, const unsigned long long number )
+{
+	payload.append( reinterpret_cast<const char*>( &number ), sizeof( number ) );
+}
+
+void appendText( string& payload, const string& text )
+{
+	appendNumber( payload, text.size() );
+	payload.append( text );
+}
+
+bool takeNumber( const string& payload, size_t& position, unsigned long long& number )
+{
+	if( payload.size() - position < sizeof( number ) )
+	{
+		return false;
+	}
+	
+	memcpy( &number, payload.data() + position, sizeof( number ) );
+	position += sizeof( number );
+	
+	return true;
+}
+
+bool takeText( const string& payload, size_t& position, string& text )
+{
+	unsigned long long length;
+	
+	if( takeNumber( payload, position, length ) == false || payload.size() - position < length )
+	{
+		return false;
+	}
+	
+	text.assign( payload, position, length );
+	position += length;
+	
+	return true;
+}
+
+// Appends the bytes of the items, after their count. Only for items that are nothing but bytes (no pointers that mean anything).
+template <typename T> void appendArray( string& payload, const vector<T>& items )
+{
+	appendNumber( payload, items.size() );
+	payload.append( reinterpret_cast<const char*>( items.data() ), items.size() * sizeof( T ) );
+}
+
+template <typename T> bool takeArray( const string& payload, size_t& position, vector<T>& items )
+{
+	unsigned long long count;
+	
+	if( takeNumber( payload, position, count ) == false || ( payload.size() - position ) / sizeof( T ) < count )
+	{
+		return false;
+	}
+	
+	items.resize( count );
+	
+	if( count > 0 )
+	{
+		memcpy( items.data(), payload.data() + position, count * sizeof( T ) );
+		position += count * sizeof( T );
+	}
+	
+	return true;
+}
+
+// Orders fragments by fingerprint, for findFragment()
+bool fingerprintLess( const ProcedureFragment& first, const ProcedureFragment& second )
+{
+	return first.fingerprint.hash[0] < second.fingerprint.hash[0] ||
+		( first.fingerprint.hash[0] == second.fingerprint.hash[0] && first.fingerprint.hash[1] < second.fingerprint.hash[1] );
+}
+
+// Adds to the counts in the statistics file, which is locked while it is read and written so concurrent compiles don't lose counts.
+// If evict is set and the cache has grown past its limit, the entries used longest ago are removed while the lock is held.
+void updateStatistics( const CacheStatistics& change, const bool evict )
+{
+#ifndef _WIN32
+	CacheStatistics statistics = CacheStatistics();
+	int descriptor = open( ( cacheDirectory + "/statistics" ).c_str(), O_RDWR | O_CREAT, 0666 );
+	char text[512];
+	int length;
+	
+	if( descriptor < 0 )
+	{
+		return;
+	}
+	
+	flock( descriptor, LOCK_EX );
+	readStatistics( descriptor, statistics );
+	
+	statistics.hits += change.hits;
+	statistics.misses += change.misses;
+	statistics.stores += change.stores;
+	statistics.bytes += change.bytes;
+	statistics.reused += change.reused;
+	statistics.recompiled += change.recompiled;
+	
+	if( evict && statistics.bytes > cacheSizeLimit )
+	{
+		evictEntries( statistics );
+	}
+	
+	length = snprintf( text, sizeof( text ), "hits %llu\nmisses %llu\nstores %llu\nevictions %llu\nbytes %llu\nreused %llu\nrecompiled %llu\n",
+		statistics.hits, statistics.misses, statistics.stores, statistics.evictions, statistics.bytes, statistics.reused, statistics.recompiled );
+	
+	if( ftruncate( descriptor, 0 ) == 0 && pwrite( descriptor, text, length, 0 ) != length )
+	{
+		ftruncate( descriptor, 0 );
+	}
+	
+	close( descriptor ); // Lets go of the lock
+#endif
+}
+
+// Reads the counts from the statistics file. Counts it doesn't have are left as they are.
+void readStatistics( const int descriptor, CacheStatistics& statistics )
+{
+#ifndef _WIN32
+	char text[512];
+	ssize_t length = pread( descriptor, text, sizeof( text ) - 1, 0 );
+	
+	if( length > 0 )
+	{
+		text[length] = '\0';
+		sscanf( text, "hits %llu misses %llu stores %llu evictions %llu bytes %llu reused %llu recompiled %llu",
+			&statistics.hits, &statistics.misses, &statistics.stores, &statistics.evictions, &statistics.bytes, &statistics.reused, &statistics.recompiled );
+	}
+#endif
+}
+
+// Removes the entries used longest ago until the cache is down to CACHE_EVICTION_PERCENT of its limit, and counts what is left.
+// Temporary files more than an hour old were left by compiles that died, so they go too.
+void evictEntries( CacheStatistics& statistics )
+{
+#ifndef _WIN32
+	vector<pair<long long, pair<string, unsigned long long> > > entries; // Last use (in nanoseconds), path and size of each entry
+	DIR* directory = opendir( cacheDirectory.c_str() );
+	struct dirent* file;
+	struct stat status;
+	string path;
+	unsigned long long total = 0;
+	time_t now = time( NULL );
+	
+	if( directory == NULL )
+	{
+		return;
+	}
+	
+	while( ( file = readdir( directory ) ) != NULL )
+	{
+		path = cacheDirectory + "/" + file->d_name;
+		
+		if( file->d_name[0] == '.' || stat( path.c_str(), &status ) != 0 || S_ISREG( status.st_mode ) == false )
+		{
+			continue;
+		}
+		
+		if( strstr( file->d_name, ".tmp-" ) != NULL )
+		{
+			if( now - status.st_mtime > 3600 )
+			{
+				remove( path.c_str() );
+			}
+		}
+		else if( strstr( file->d_name, ".cache" ) != NULL || strstr( file->d_name, ".file" ) != NULL || strstr( file->d_name, ".procedures" ) != NULL )
+		{
+			entries.push_back( make_pair( status.st_mtim.tv_sec * 1000000000LL + status.st_mtim.tv_nsec, make_pair( path, static_cast<unsigned long long>( status.st_size ) ) ) );
+			total += status.st_size;
+		}
+	}
+	
+	closedir( directory );
+	sort( entries.begin(), entries.end() );
+	
+	for( size_t entry = 0; entry < entries.size() && total > cacheSizeLimit / 100 * CACHE_EVICTION_PERCENT; entry++ )
+	{
+		if( remove( entries[entry].second.first.c_str() ) == 0 )
+		{
+			total -= entries[entry].second.second;
+			statistics.evictions++;
+		}
+	}
+	
+	statistics.bytes = total;
+#endif
+}
+
+// Sets the modification time of an entry, which is when it was last used, for eviction. It is set from the clock to the nanosecond,
+// rather than left to the file system, whose times only move on every few milliseconds, so entries used one after the other don't tie.
+void markEntryUsed( const string& path )
+{
+#ifndef _WIN32
+	struct timespec times[2];
+	
+	clock_gettime( CLOCK_REALTIME, &times[0] );
+	times[1] = times[0];
+	utimensat( AT_FDCWD, path.c_str(), times, 0 );
+#endif
+}
@@ -0,0 +1,487 @@
+// Filename: client.cpp
+// Author: Himanshu Narayana
+// This file is the client of the compile server (narcomp --server, see server.cpp). It sends a program to the server and writes out
+// what comes back just as narcomp would. With --benchmark it measures how many compiles a second the server answers,
+// and how many narcomp manages when it is started as a new process for each one.
+
+#include "compiler.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Define data structure for what the server sends back for a request
+struct ServerReply
+{
+	ServerReplyHeader header;
+	string code;
+	string ir;
+	string diagnostics;
+};
+
+static int connectServer( const char* socketPath );
+static bool requestCompile( const int connection, const string& source, const int nestingLimit, const bool emitIr, ServerReply& reply );
+static bool sendAll( const int connection, const char* data, size_t length );
+static bool receiveAll( const int connection, char* data, size_t length );
+static bool receiveText( const int connection, string& text, const unsigned long long length );
+static bool readSource( const char* filename, string& source );
+static bool writeText( const char* filename, const string& text );
+static void removeSplitOutput( void );
+static int compileFile( const char* socketPath, const char* filename, const int nestingLimit, const bool emitIr );
+static int runBenchmark( const char* socketPath, const char* filename, const int requests, const int connections, const char* compiler );
+static void runServerRequests( const char* socketPath, const string* source, atomic<int>* nextRequest, const int requests, atomic<int>* failures );
+static void runCompilerProcesses( const char* compiler, const char* filename, const char* directory, atomic<int>* nextRequest, const int requests, atomic<int>* failures );
+
+int main( int argc, char** argv )
+{
+	int nestingLimit = NESTING_LIMIT; // Set by --nesting to change how deeply blocks may be nested
+	bool emitIr = false; // Set by --emit-ir to have the intermediate representation written out as well
+	int requests = 0; // Set by --benchmark to the number of compiles to time
+	int connections = 1; // Set by --connections to the number of compiles to keep going at once while benchmarking
+	const char* compiler = "./narcomp"; // Set by --compiler to the narcomp the server is compared with
+	int argument = 1;
+	
+	// Read the command line options in front of the socket
+	while( argument < argc && strncmp( argv[argument], "--", 2 ) == 0 )
+	{
+		if( strncmp( argv[argument], "--nesting=", 10 ) == 0 && atoi( argv[argument] + 10 ) > 0 )
+		{
+			nestingLimit = atoi( argv[argument] + 10 );
+		}
+		else if( strcmp( argv[argument], "--emit-ir" ) == 0 )
+		{
+			emitIr = true;
+		}
+		else if( strncmp( argv[argument], "--benchmark=", 12 ) == 0 && atoi( argv[argument] + 12 ) > 0 )
+		{
+			requests = atoi( argv[argument] + 12 );
+		}
+		else if( strncmp( argv[argument], "--connections=", 14 ) == 0 && atoi( argv[argument] + 14 ) > 0 )
+		{
+			connections = atoi( argv[argument] + 14 );
+		}
+		else if( strncmp( argv[argument], "--compiler=", 11 ) == 0 )
+		{
+			compiler = argv[argument] + 11;
+		}
+		else
+		{
+			cerr << "Unknown option: " << argv[argument] << endl;
+			argument = argc;
+			break;
+		}
+		
+		argument++;
+	}
+	
+	// Give usage information if the socket and filename weren't both given
+	if( argument + 2 != argc )
+	{
+		cerr << "Usage: " << argv[0] << " [--nesting=depth] [--emit-ir] socket filename" << endl;
+		cerr << "       " << argv[0] << " --benchmark=requests [--connections=count] [--compiler=narcomp] socket filename" << endl;
+		return 0;
+	}
+	
+	if( requests > 0 )
+	{
+		return runBenchmark( argv[argument], argv[argument + 1], requests, connections, compiler );
+	}
+	
+	return compileFile( argv[argument], argv[argument + 1], nestingLimit, emitIr );
+}
+
+// Has the server compile a file, then writes out the C and reports as narcomp does
+int compileFile( const char* socketPath, const char* filename, const int nestingLimit, const bool emitIr )
+{
+	ServerReply reply;
+	string source;
+	int connection;
+	
+	if( readSource( filename, source ) == false )
+	{
+		cerr << "Error opening input file." << endl;
+		return 0;
+	}
+	
+	connection = connectServer( socketPath );
+	
+	if( connection < 0 )
+	{
+		cerr << "Error connecting to the compile server at " << socketPath << ": " << strerror( errno ) << endl;
+		return 1;
+	}
+	
+	if( requestCompile( connection, source, nestingLimit, emitIr, reply ) == false )
+	{
+		cerr << "The compile server closed the connection." << endl;
+		close( connection );
+		return 1;
+	}
+	
+	close( connection );
+	
+	if( reply.header.succeeded )
+	{
+		if( writeText( "narcomp_output.c", reply.code ) == false || ( emitIr && writeText( "narcomp_output.ir", reply.ir ) == false ) )
+		{
+			reply.diagnostics += "Error writing file for output.\n";
+		}
+	}
+	else
+	{
+		// Don't leave the C of an earlier compile behind to be built by mistake
+		remove( "narcomp_output.c" );
+	}
+	
+	removeSplitOutput();
+	cerr << reply.diagnostics;
+	
+	// If there were warnings and/or errors, leave a blank line before printing the summary.
+	if( reply.header.warningCount > 0 || reply.header.errorCount > 0 )
+	{
+		cerr << endl;
+	}
+	
+	cout << "Summary" << endl;
+	cout << "=======" << endl;
+	cout << "Lines Read: " << reply.header.lineCount << endl;
+	cout << "Errors: " << reply.header.errorCount << endl;
+	cout << "Warnings: " << reply.header.warningCount << endl;
+	
+	return 0;
+}
+
+// Compiles the file the specified number of times through the server, then as many times again by starting the compiler for each,
+// with the specified number of compiles going at once both times, and prints how many compiles a second each managed
+int runBenchmark( const char* socketPath, const char* filename, const int requests, const int connections, const char* compiler )
+{
+	string source;
+	char absolutePath[PATH_MAX];
+	char compilerPath[PATH_MAX];
+	char directoryTemplate[] = "/tmp/narclientXXXXXX";
+	vector<string> directories;
+	vector<thread> workers;
+	atomic<int> nextRequest;
+	atomic<int> failures;
+	chrono::steady_clock::time_point start;
+	double serverSeconds;
+	double processSeconds;
+	
+	if( readSource( filename, source ) == false || realpath( filename, absolutePath ) == NULL )
+	{
+		cerr << "Error opening input file." << endl;
+		return 1;
+	}
+	
+	// The compiler runs in a directory of its own, so it needs the full paths
+	if( realpath( compiler, compilerPath ) == NULL )
+	{
+		cerr << "Error finding the compiler " << compiler << ": " << strerror( errno ) << endl;
+		return 1;
+	}
+	
+	// Through the server, one connection for each compile going at once
+	nextRequest = 0;
+	failures = 0;
+	start = chrono::steady_clock::now();
+	
+	for( int i = 0; i < connections; i++ )
+	{
+		workers.push_back( thread( runServerRequests, socketPath, &source, &nextRequest, requests, &failures ) );
+	}
+	
+	for( int i = 0; i < connections; i++ )
+	{
+		workers[i].join();
+	}
+	
+	serverSeconds = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+	
+	if( failures > 0 )
+	{
+		cerr << failures << " requests to the compile server at " << socketPath << " failed" << endl;
+		return 1;
+	}
+	
+	// A new process for each compile. Each one writes narcomp_output.c where it runs, so the ones going at once run in directories of their own.
+	for( int i = 0; i < connections; i++ )
+	{
+		strcpy( directoryTemplate, "/tmp/narclientXXXXXX" );
+		
+		if( mkdtemp( directoryTemplate ) == NULL )
+		{
+			cerr << "Error making a directory to run the compiler in: " << strerror( errno ) << endl;
+			return 1;
+		}
+		
+		directories.push_back( directoryTemplate );
+	}
+	
+	workers.clear();
+	nextRequest = 0;
+	start = chrono::steady_clock::now();
+	
+	for( int i = 0; i < connections; i++ )
+	{
+		workers.push_back( thread( runCompilerProcesses, compilerPath, absolutePath, directories[i].c_str(), &nextRequest, requests, &failures ) );
+	}
+	
+	for( int i = 0; i < connections; i++ )
+	{
+		workers[i].join();
+	}
+	
+	processSeconds = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+	
+	for( int i = 0; i < connections; i++ )
+	{
+		remove( ( directories[i] + "/narcomp_output.c" ).c_str() );
+		rmdir( directories[i].c_str() );
+	}
+	
+	if( failures > 0 )
+	{
+		cerr << failures << " runs of " << compiler << " failed" << endl;
+		return 1;
+	}
+	
+	cout << "Benchmark" << endl;
+	cout << "=========" << endl;
+	cout << "Requests: " << requests << " (" << connections << " at a time)" << endl;
+	cout << "Server: " << requests / serverSeconds << " requests/second, " << serverSeconds * 1000000 / requests * connections << " us each" << endl;
+	cout << "Fork/exec: " << requests / processSeconds << " requests/second, " << processSeconds * 1000000 / requests * connections << " us each" << endl;
+	cout << "Speedup: " << processSeconds / serverSeconds << "x" << endl;
+	
+	return 0;
+}
+
+// Body of a benchmark thread for the server. Sends requests over one connection until there are none left.
+void runServerRequests( const char* socketPath, const string* source, atomic<int>* nextRequest, const int requests, atomic<int>* failures )
+{
+	ServerReply reply;
+	int connection = connectServer( socketPath );
+	
+	while( ( *nextRequest )++ < requests )
+	{
+		if( connection < 0 || requestCompile( connection, *source, NESTING_LIMIT, false, reply ) == false )
+		{
+			( *failures )++;
+		}
+	}
+	
+	if( connection >= 0 )
+	{
+		close( connection );
+	}
+}
+
+// Body of a benchmark thread for new processes. Runs the compiler in its directory, one process after another, until there are no requests left.
+void runCompilerProcesses( const char* compiler, const char* filename, const char* directory, atomic<int>* nextRequest, const int requests, atomic<int>* failures )
+{
+	pid_t child;
+	int status;
+	
+	while( ( *nextRequest )++ < requests )
+	{
+		child = fork();
+		
+		if( child == 0 )
+		{
+			// Throw away what the compiler prints, as the server's replies are
+			int nullDescriptor = open( "/dev/null", O_WRONLY );
+			
+			dup2( nullDescriptor, STDOUT_FILENO );
+			dup2( nullDescriptor, STDERR_FILENO );
+			
+			if( chdir( directory ) == 0 )
+			{
+				execl( compiler, compiler, filename, static_cast<char*>( NULL ) );
+			}
+			
+			_exit( 127 );
+		}
+		
+		if( child < 0 || waitpid( child, &status, 0 ) != child || WIFEXITED( status ) == false || WEXITSTATUS( status ) != 0 )
+		{
+			( *failures )++;
+		}
+	}
+}
+
+// Connects to the server. Returns the connection, or -1 if the server couldn't be reached.
+int connectServer( const char* socketPath )
+{
+	sockaddr_un address = sockaddr_un();
+	int connection;
+	
+	if( strlen( socketPath ) >= sizeof( address.sun_path ) )
+	{
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	
+	address.sun_family = AF_UNIX;
+	strcpy( address.sun_path, socketPath );
+	connection = socket( AF_UNIX, SOCK_STREAM, 0 );
+	
+	if( connection >= 0 && connect( connection, reinterpret_cast<sockaddr*>( &address ), sizeof( address ) ) != 0 )
+	{
+		close( connection );
+		return -1;
+	}
+	
+	return connection;
+}
+
+// Sends a program to the server and waits for its reply. Returns false if the connection failed.
+bool requestCompile( const int connection, const string& source, const int nestingLimit, const bool emitIr, ServerReply& reply )
+{
+	ServerRequestHeader request = ServerRequestHeader();
+	
+	request.magic = SERVER_REQUEST_MAGIC;
+	request.nestingLimit = nestingLimit;
+	request.emitIr = emitIr ? 1 : 0;
+	request.sourceLength = source.size();
+	
+	if( sendAll( connection, reinterpret_cast<const char*>( &request ), sizeof( request ) ) == false || sendAll( connection, source.data(), source.size() ) == false )
+	{
+		return false;
+	}
+	
+	if( receiveAll( connection, reinterpret_cast<char*>( &reply.header ), sizeof( reply.header ) ) == false || reply.header.magic != SERVER_REPLY_MAGIC )
+	{
+		return false;
+	}
+	
+	return receiveText( connection, reply.code, reply.header.codeLength ) && receiveText( connection, reply.ir, reply.header.irLength ) &&
+		receiveText( connection, reply.diagnostics, reply.header.diagnosticsLength );
+}
+
+// Writes all length bytes to the connection. Returns false if it failed first.
+bool sendAll( const int connection, const char* data, size_t length )
+{
+	ssize_t sentLength;
+	
+	while( length > 0 )
+	{
+		sentLength = send( connection, data, length, MSG_NOSIGNAL );
+		
+		if( sentLength < 0 && errno == EINTR )
+		{
+			continue;
+		}
+		
+		if( sentLength <= 0 )
+		{
+			return false;
+		}
+		
+		data += sentLength;
+		length -= sentLength;
+	}
+	
+	return true;
+}
+
+// Reads exactly length bytes from the connection. Returns false if it closed or failed first.
+bool receiveAll( const int connection, char* data, size_t length )
+{
+	ssize_t receivedLength;
+	
+	while( length > 0 )
+	{
+		receivedLength = read( connection, data, length );
+		
+		if( receivedLength < 0 && errno == EINTR )
+		{
+			continue;
+		}
+		
+		if( receivedLength <= 0 )
+		{
+			return false;
+		}
+		
+		data += receivedLength;
+		length -= receivedLength;
+	}
+	
+	return true;
+}
+
+// Reads a text of the specified length from the connection into text
+bool receiveText( const int connection, string& text, const unsigned long long length )
+{
+	text.resize( length );
+	
+	return length == 0 || receiveAll( connection, &text[0], length );
+}
+
+// Reads the whole of a file ("-" for standard input) into source. Returns false if it couldn't be read.
+bool readSource( const char* filename, string& source )
+{
+	int descriptor = strcmp( filename, "-" ) == 0 ? STDIN_FILENO : open( filename, O_RDONLY );
+	char block[65536];
+	ssize_t readLength;
+	
+	if( descriptor < 0 )
+	{
+		return false;
+	}
+	
+	source.clear();
+	
+	while( ( readLength = read( descriptor, block, sizeof( block ) ) ) != 0 )
+	{
+		if( readLength < 0 )
+		{
+			if( errno == EINTR )
+			{
+				continue;
+			}
+			
+			break;
+		}
+		
+		source.append( block, readLength );
+	}
+	
+	if( descriptor != STDIN_FILENO )
+	{
+		close( descriptor );
+	}
+	
+	return readLength == 0;
+}
+
+// Writes text to the specified file, replacing what the file held. Returns false if the file couldn't be opened or written.
+bool writeText( const char* filename, const string& text )
+{
+	ofstream output( filename, ios::out | ios::binary | ios::trunc );
+	
+	output.write( text.data(), text.size() );
+	output.close();
+	
+	return output.good();
+}
+
+// Removes narcomp_output.h and the files narcomp_output_N.c that an earlier compile with narcomp --split wrote.
+// The server's C is all in narcomp_output.c, so they would be built with it by mistake.
+void removeSplitOutput( void )
+{
+	remove( "narcomp_output.h" );
+	
+	for( int part = 1; remove( ( "narcomp_output_" + to_string( part ) + ".c" ).c_str() ) == 0; part++ )
+	{
+	}
+}
@@ -5,54 +5,308 @@
 
 #include "compiler.h"
 
-using namespace std;
-
-int lineNumber;  // To keep track of the scanner's current line number
-int warningCount; // To keep track of number of warnings found
-int errorCount; // To keep track of number of errors found
+#include <atomic>
+#include <cerrno>
+#include <iterator>
+#include <thread>
 
-SymbolTable globalSymbolTable;
-vector<SymbolTable> localSymbolTable;
+using namespace std;
 
-int currentScope;
+thread_local CompilerContext* context = NULL; // Context of the compile running on this thread
 
-ifstream inFile; // file handler for input file to tokenize
-ofstream outFile; // file handler for output file
+// Define data structure for the files of a --batch compile, shared by the threads that compile them.
+// Each thread takes the next file by bumping nextFile, and only writes to that file's result.
+struct BatchJob
+{
+	char** filenames;
+	int fileCount;
+	CompileOptions options;
+	atomic<int> nextFile;
+	vector<CompileResult> results;
+	vector<string> failures; // Why a file couldn't be read or its output couldn't be written, if it couldn't
+};
 
-static void initializeOutput();
+static int compileBatch( char** filenames, const int fileCount, const int threads, const CompileOptions& options );
+static void runBatchWorker( BatchJob* job );
+static int compileCached( const char* filename, const CompileOptions& options, const char* executable );
+static CompileResult compileThroughCache( CompilerContext& compilerContext, const char* filename, const string& source, const CompileOptions& options );
+static void startScanning( const int parallelThreads, const bool pipeline );
+static bool buildExecutable( const char* executable, const string& code );
+static bool buildSplitExecutable( const char* executable, const int partCount );
+static void runPartCompile( const string command, int* status );
+static void removeSplitParts( const int firstPart );
+static string splitPartName( const int part, const char* extension );
+static void printSummary( const int lineCount, const int errorCount, const int warningCount );
+static bool readSourceFile( const char* filename, string& source );
+static string batchOutputName( const string& filename, const char* extension );
+static int findSymbolSlot( const int nameID );
+static SymbolSlot& claimSymbolSlot( const int nameID );
+static void logShadowedSymbol( const int nameID, const int symbol, const int scope, const int logScope );
+static int newSymbol( const SymbolKind newKind, const TokenType newTokenType, const int newNameID, const bool newGlobal, const bool newParameter );
 
+// NARCOMP_LIBRARY leaves main() out, for the programs that link the compiler to call into it (see the Makefile)
+#ifndef NARCOMP_LIBRARY
 int main( int argc, char** argv )
 {
+	bool inputOpened;
+	bool forceScalar = false; // Set by --scalar to turn off the vector scanning kernels
+	bool pipeline = false; // Set by --pipeline to scan in a separate thread
+	int parallelThreads = -1; // Set by --parallel to scan in chunks with this many threads (0 for one per core)
+	int nestingLimit = NESTING_LIMIT; // Set by --nesting to change how deeply blocks may be nested
+	int jobThreads = -1; // Set by --jobs to generate the code of the top-level procedures with this many threads (0 for one per core)
+	bool compiled = false; // Set once the program has been read with --jobs
+	bool emitIr = false; // Set by --emit-ir to write out the intermediate representation as well
+	int batchThreads = -1; // Set by --batch to compile every file given, with this many threads (0 for one per core)
+	int serverThreads = -1; // Set by --server to serve compile requests on the socket named in place of the filename, with this many threads
+	const char* cacheDirectory = NULL; // Set by --cache to keep the results of compiles in this directory
+	unsigned long long cacheSize = CACHE_SIZE_LIMIT; // Set by --cache-size to limit the size of the cache
+	bool cacheStatistics = false; // Set by --cache-stats to print the cache's hits and misses instead of compiling
+	const char* executable = NULL; // Set by --executable to build the C into an executable with this name
+	int splitFiles = 0; // Set by --split to write the procedures' C to this many files besides the one with main()
+	vector<string> parts; // The procedures' C with --split, a file's worth each
+	CompileOptions options;
+	CompilerContext compilerContext;
+	int argument = 1;
+	
+	context = &compilerContext;
+	
 	try
 	{
-		// Give usage information if no command line arguments were given
-		if( argc == 1 )
+		// Read the command line options in front of the filename
+		while( argument < argc && strncmp( argv[argument], "--", 2 ) == 0 )
 		{
-			cerr << "Usage: " << argv[0] << " [filename]" << endl;
+			if( strcmp( argv[argument], "--scalar" ) == 0 )
+			{
+				forceScalar = true;
+			}
+			else if( strcmp( argv[argument], "--pipeline" ) == 0 )
+			{
+				pipeline = true;
+			}
+			else if( strcmp( argv[argument], "--parallel" ) == 0 )
+			{
+				parallelThreads = 0;
+			}
+			else if( strncmp( argv[argument], "--parallel=", 11 ) == 0 && atoi( argv[argument] + 11 ) > 0 )
+			{
+				parallelThreads = atoi( argv[argument] + 11 );
+			}
+			else if( strcmp( argv[argument], "--jobs" ) == 0 )
+			{
+				jobThreads = 0;
+			}
+			else if( strncmp( argv[argument], "--jobs=", 7 ) == 0 && atoi( argv[argument] + 7 ) > 0 )
+			{
+				jobThreads = atoi( argv[argument] + 7 );
+			}
+			else if( strncmp( argv[argument], "--nesting=", 10 ) == 0 && atoi( argv[argument] + 10 ) > 0 )
+			{
+				nestingLimit = atoi( argv[argument] + 10 );
+			}
+			else if( strcmp( argv[argument], "--emit-ir" ) == 0 )
+			{
+				emitIr = true;
+			}
+			else if( strcmp( argv[argument], "--batch" ) == 0 )
+			{
+				batchThreads = 0;
+			}
+			else if( strncmp( argv[argument], "--batch=", 8 ) == 0 && atoi( argv[argument] + 8 ) > 0 )
+			{
+				batchThreads = atoi( argv[argument] + 8 );
+			}
+			else if( strcmp( argv[argument], "--server" ) == 0 )
+			{
+				serverThreads = 0;
+			}
+			else if( strncmp( argv[argument], "--server=", 9 ) == 0 && atoi( argv[argument] + 9 ) > 0 )
+			{
+				serverThreads = atoi( argv[argument] + 9 );
+			}
+			else if( strncmp( argv[argument], "--cache=", 8 ) == 0 && argv[argument][8] != '\0' )
+			{
+				cacheDirectory = argv[argument] + 8;
+			}
+			else if( strncmp( argv[argument], "--cache-size=", 13 ) == 0 && atoi( argv[argument] + 13 ) > 0 )
+			{
+				cacheSize = strtoull( argv[argument] + 13, NULL, 10 ) * 1048576;
+			}
+			else if( strcmp( argv[argument], "--cache-stats" ) == 0 )
+			{
+				cacheStatistics = true;
+			}
+			else if( strcmp( argv[argument], "--split" ) == 0 )
+			{
+				splitFiles = SPLIT_FILES;
+			}
+			else if( strncmp( argv[argument], "--split=", 8 ) == 0 && atoi( argv[argument] + 8 ) > 0 )
+			{
+				splitFiles = atoi( argv[argument] + 8 );
+			}
+			else if( strcmp( argv[argument], "--executable" ) == 0 )
+			{
+				executable = "final";
+			}
+			else if( strncmp( argv[argument], "--executable=", 13 ) == 0 && argv[argument][13] != '\0' )
+			{
+				executable = argv[argument] + 13;
+			}
+			else
+			{
+				cerr << "Unknown option: " << argv[argument] << endl;
+				argument = argc;
+				break;
+			}
+			
+			argument++;
+		}
+		
+		// Give usage information if no input filename was given
+		if( argument >= argc && ( cacheStatistics == false || cacheDirectory == NULL ) )
+		{
+			cerr << "Usage: " << argv[0] << " [--scalar] [--pipeline] [--parallel[=threads]] [--jobs[=threads]] [--nesting=depth] [--emit-ir] [--split[=files]] [cache options] [--executable[=name]] [filename | -]" << endl;
+			cerr << "       " << argv[0] << " --batch[=threads] [--scalar] [--nesting=depth] [--emit-ir] [cache options] filename..." << endl;
+			cerr << "       " << argv[0] << " --server[=threads] [--scalar] socket" << endl;
+			cerr << "       " << argv[0] << " --cache=directory --cache-stats" << endl;
+			cerr << "Cache options: --cache=directory [--cache-size=megabytes]" << endl;
 			return 0;
 		}
 		
-		// pass input filename to the initialization function
-		initializeScanner( argv[1] );
+		// Use the cache, or just report on it
+		if( cacheDirectory != NULL && openCache( cacheDirectory, cacheSize ) == false )
+		{
+			cerr << "Error opening cache directory " << cacheDirectory << ": " << strerror( errno ) << endl;
+			return 1;
+		}
+		
+		if( cacheStatistics )
+		{
+			printCacheStatistics( cout );
+			return 0;
+		}
+		
+		// Choose the scanning kernels for this processor
+		selectScanKernels( forceScalar );
+		
+		// Compile what clients send until stopped
+		if( serverThreads >= 0 )
+		{
+			return runServer( argv[argument], serverThreads );
+		}
+		
+		// Compile every file given on a pool of threads
+		if( batchThreads >= 0 )
+		{
+			options.nestingLimit = nestingLimit;
+			options.emitIr = emitIr;
+			
+			return compileBatch( argv + argument, argc - argument, batchThreads, options );
+		}
 		
-		// Prepare output file
-		initializeOutput();
+		// With a cache, the whole source is read first to look it up, so it is compiled from memory (without --pipeline or --parallel)
+		if( cacheOpen() )
+		{
+			options.nestingLimit = nestingLimit;
+			options.emitIr = emitIr;
+			
+			return compileCached( argv[argument], options, executable );
+		}
 		
-		// Check status of input and output files
-		if( inFile.good() == false )
+		// pass input filename to the initialization function
+		inputOpened = initializeScanner( argv[argument] );
+		
+		// Check status of input file
+		if( inputOpened == false )
 		{
 			cerr << "Error opening input file." << endl;
 			return 0;
 		}
-		if( outFile.good() == false )
+		
+		startScanning( parallelThreads, pipeline );
+		
+		// Generate the code of the top-level procedures on worker threads. The input has to be a file that can be read again,
+		// because a compile that gives a diagnostic (or that the workers can't do) is done again without them, to report it.
+		if( jobThreads >= 0 && mappedInput() )
 		{
-			cerr << "Error opening file for output." << endl;
+			compiled = readProgramInParallel( nestingLimit, jobThreads );
 			
-			inFile.close();
-			return 0;
+			if( compiled == false )
+			{
+				initializeScanner( argv[argument] );
+				startScanning( parallelThreads, pipeline );
+			}
+		}
+		
+		if( compiled == false )
+		{
+			readProgram( nestingLimit );
 		}
 		
-		readProgram();
+		// Lower the program to C if it compiled, and write out its IR if asked to.
+		// The output is built in memory and only written to the files here, so a failed compile writes nothing.
+		if( context->errorCount == 0 )
+		{
+			resetOutput();
+			
+			// With --split, main() and the runtime go to narcomp_output.c, the declarations they share to narcomp_output.h,
+			// and the procedures to narcomp_output_1.c on. A program whose control flow can't be split is written to one file.
+			if( splitFiles > 0 && emitSplitProgram( splitFiles, parts ) )
+			{
+				bool written = writeOutput( "narcomp_output.c", PROLOGUE_SECTION, RUNTIME_SECTION ) && writeOutput( "narcomp_output.h", HEADER_SECTION, HEADER_SECTION );
+				
+				for( size_t i = 0; i < parts.size() && written; i++ )
+				{
+					written = writeOutputText( splitPartName( i + 1, ".c" ).c_str(), parts[i] );
+				}
+				
+				if( written == false )
+				{
+					cerr << "Error writing file for output." << endl;
+				}
+			}
+			else
+			{
+				if( splitFiles > 0 )
+				{
+					cerr << "The program can't be split into functions, so its C is written to one file." << endl;
+				}
+				
+				parts.clear();
+				emitProgram();
+				
+				if( writeOutput( "narcomp_output.c", PROLOGUE_SECTION, RUNTIME_SECTION ) == false )
+				{
+					cerr << "Error writing file for output." << endl;
+				}
+				
+				remove( "narcomp_output.h" );
+			}
+			
+			// Don't leave the parts of an earlier compile behind to be built with this one
+			removeSplitParts( parts.size() + 1 );
+			
+			if( emitIr )
+			{
+				dumpIr( outputSection( IR_SECTION ) );
+				
+				if( writeOutput( "narcomp_output.ir", IR_SECTION, IR_SECTION ) == false )
+				{
+					cerr << "Error writing file for output." << endl;
+				}
+			}
+			
+			if( executable != NULL && parts.empty() == false )
+			{
+				buildSplitExecutable( executable, parts.size() );
+			}
+			else if( executable != NULL )
+			{
+				string code;
+				
+				copyOutput( code, PROLOGUE_SECTION, RUNTIME_SECTION );
+				buildExecutable( executable, code );
+			}
+		}
 	}
 	catch( exception& e )
 	{
@@ -60,143 +314,922 @@ int main( int argc, char** argv )
 	}
 	
 	// If there were warnings and/or errors, leave a blank line before printing the summary.
-	if( warningCount > 0 || errorCount > 0 )
+	if( context->warningCount > 0 || context->errorCount > 0 )
 	{
 		cerr << endl;
 	}
 	
-	// Output summary of number of lines read, number of errors, and number of warnings
+	printSummary( context->lineNumber, context->errorCount, context->warningCount );
+	
+	closeScanner();
+	
+	// Don't leave the C of an earlier compile behind to be built by mistake
+	if( context->errorCount > 0 )
+	{
+		remove( "narcomp_output.c" );
+		remove( "narcomp_output.h" );
+		removeSplitParts( 1 );
+	}
+	
+	// Empty Symbol Tables
+	resetSymbolStore();
+	
+	return 0;
+}
+#endif
+
+// Starts scanning ahead of the parser, with --parallel or --pipeline. Only a memory-mapped input can be scanned in chunks,
+// so otherwise --parallel falls back on the pipeline (if asked for) or plain scanning.
+void startScanning( const int parallelThreads, const bool pipeline )
+{
+	if( parallelThreads >= 0 && startParallelScan( parallelThreads ) )
+	{
+		return;
+	}
+	
+	// Start scanning ahead in a separate thread
+	if( pipeline )
+	{
+		startPipeline();
+	}
+}
+
+// Compiles a file through the cache. On a hit the C (and the executable, if asked for) comes from the cache without scanning or parsing;
+// on a miss the file is compiled and the result is kept. Either way the files written and everything printed are as without the cache.
+int compileCached( const char* filename, const CompileOptions& options, const char* executable )
+{
+	CompilerContext* mainContext = context;
+	CompileResult result;
+	string source;
+	
+	if( readSourceFile( filename, source ) == false )
+	{
+		cerr << "Error opening input file." << endl;
+		return 0;
+	}
+	
+	result = compileThroughCache( *mainContext, filename, source, options );
+	cerr << result.diagnostics;
+	
+	// The C is all in narcomp_output.c, so the files of an earlier compile with --split would be built with it by mistake
+	remove( "narcomp_output.h" );
+	removeSplitParts( 1 );
+	
+	if( result.succeeded )
+	{
+		if( writeOutputText( "narcomp_output.c", result.code ) == false || ( options.emitIr && writeOutputText( "narcomp_output.ir", result.ir ) == false ) )
+		{
+			cerr << "Error writing file for output." << endl;
+		}
+		
+		if( executable != NULL )
+		{
+			buildExecutable( executable, result.code );
+		}
+	}
+	else
+	{
+		// Don't leave the C of an earlier compile behind to be built by mistake
+		remove( "narcomp_output.c" );
+	}
+	
+	// If there were warnings and/or errors, leave a blank line before printing the summary.
+	if( result.warningCount > 0 || result.errorCount > 0 )
+	{
+		cerr << endl;
+	}
+	
+	printSummary( result.lineCount, result.errorCount, result.warningCount );
+	return 0;
+}
+
+// Returns the result of compiling the source of a file from the cache. On a miss the file is compiled in the context given,
+// taking the top-level procedures that haven't changed since its last compile from the cache, and the result and procedures are kept.
+CompileResult compileThroughCache( CompilerContext& compilerContext, const char* filename, const string& source, const CompileOptions& options )
+{
+	CacheKey key = compileCacheKey( source.data(), source.size(), options );
+	CacheKey proceduresKey;
+	ProcedureCache procedures;
+	CompileOptions procedureOptions = options;
+	CompileResult result;
+	
+	if( findCachedResult( key, result ) )
+	{
+		return result;
+	}
+	
+	proceduresKey = procedureCacheKey( filename, options );
+	findCachedProcedures( proceduresKey, procedures );
+	procedureOptions.procedures = &procedures;
+	result = compile( compilerContext, source.data(), source.size(), procedureOptions );
+	
+	if( result.succeeded )
+	{
+		storeCachedResult( key, result );
+	}
+	
+	storeCachedProcedures( proceduresKey, procedures );
+	return result;
+}
+
+// Builds narcomp_output.c (which holds code) into an executable with the C compiler named by $CC (gcc if it isn't set),
+// as "make final" would. With a cache, an executable built before from the same C, runtime.c and command is used instead.
+// Returns false if the build failed.
+bool buildExecutable( const char* executable, const string& code )
+{
+	const char* compilerName = getenv( "CC" );
+	string command = string( compilerName != NULL && compilerName[0] != '\0' ? compilerName : "gcc" ) + " -o \"" + executable + "\" narcomp_output.c";
+	string runtime;
+	CacheKey key;
+	
+	if( cacheOpen() )
+	{
+		readSourceFile( "runtime.c", runtime );
+		key = fileCacheKey( code, runtime, command );
+		
+		if( findCachedFile( key, executable, 0777 ) )
+		{
+			return true;
+		}
+	}
+	
+	cout.flush();
+	
+	if( system( command.c_str() ) != 0 )
+	{
+		cerr << "Error building executable." << endl;
+		return false;
+	}
+	
+	if( cacheOpen() )
+	{
+		storeCachedFile( key, executable );
+	}
+	
+	return true;
+}
+
+// Builds the C written with --split into an executable, as "make -j final" would: each file is compiled on a thread of its own
+// with the C compiler named by $CC (gcc if it isn't set), and the objects are linked. Returns false if the build failed.
+bool buildSplitExecutable( const char* executable, const int partCount )
+{
+	const char* compilerName = getenv( "CC" );
+	string compilerCommand = string( compilerName != NULL && compilerName[0] != '\0' ? compilerName : "gcc" );
+	string linkCommand = compilerCommand + " -o \"" + executable + "\" narcomp_output.o";
+	vector<int> statuses( partCount + 1, 0 );
+	vector<thread> compiles;
+	bool built = true;
+	
+	cout.flush();
+	compiles.push_back( thread( runPartCompile, compilerCommand + " -c -o narcomp_output.o narcomp_output.c", &statuses[0] ) );
+	
+	for( int part = 1; part <= partCount; part++ )
+	{
+		compiles.push_back( thread( runPartCompile, compilerCommand + " -c -o " + splitPartName( part, ".o" ) + " " + splitPartName( part, ".c" ), &statuses[part] ) );
+		linkCommand += " " + splitPartName( part, ".o" );
+	}
+	
+	for( size_t i = 0; i < compiles.size(); i++ )
+	{
+		compiles[i].join();
+		built = built && statuses[i] == 0;
+	}
+	
+	if( built == false || system( linkCommand.c_str() ) != 0 )
+	{
+		cerr << "Error building executable." << endl;
+		return false;
+	}
+	
+	return true;
+}
+
+// Body of a thread of buildSplitExecutable(). Runs the command, and sets status to what it returned.
+void runPartCompile( const string command, int* status )
+{
+	*status = system( command.c_str() );
+}
+
+// Removes the files narcomp_output_N.c, from N = firstPart on, that an earlier compile with --split wrote
+void removeSplitParts( const int firstPart )
+{
+	for( int part = firstPart; remove( splitPartName( part, ".c" ).c_str() ) == 0; part++ )
+	{
+	}
+}
+
+// Returns the name of a file of the procedures' C with --split, or of its object file
+string splitPartName( const int part, const char* extension )
+{
+	return "narcomp_output_" + to_string( part ) + extension;
+}
+
+// Outputs the summary of number of lines read, number of errors, and number of warnings
+void printSummary( const int lineCount, const int errorCount, const int warningCount )
+{
 	cout << "Summary" << endl;
 	cout << "=======" << endl;
-	cout << "Lines Read: " << lineNumber << endl;
+	cout << "Lines Read: " << lineCount << endl;
 	cout << "Errors: " << errorCount << endl;
 	cout << "Warnings: " << warningCount << endl;
+}
+
+// Makes a context with its own scanner, parser and output, for a compile
+CompilerContext::CompilerContext( void ) : lineNumber( 0 ), warningCount( 0 ), errorCount( 0 ), currentScope( 0 ), diagnostics( &cerr ),
+	scanner( newScannerState() ), parser( newParserState() ), output( newOutputState() )
+{
+}
+
+CompilerContext::~CompilerContext( void )
+{
+	deleteScannerState( scanner );
+	deleteParserState( parser );
+	deleteOutputState( output );
+}
+
+// Compiles the program in the length bytes at source, on the calling thread, and returns the C and the diagnostics.
+// The compile gets a context of its own for as long as it runs, so compiles on different threads don't share anything.
+CompileResult compile( const char* source, const size_t length, const CompileOptions& options )
+{
+	CompilerContext compilerContext;
 	
-	inFile.close();
-	outFile.close();
+	return compile( compilerContext, source, length, options );
+}
+
+// Compiles the program in the context given, which keeps its buffers and tables from one compile to the next.
+// Nothing of the last compile is left in the context once the next one starts.
+CompileResult compile( CompilerContext& compilerContext, const char* source, const size_t length, const CompileOptions& options )
+{
+	CompilerContext* callerContext = context;
+	ostream* callerDiagnostics = compilerContext.diagnostics;
+	ostringstream diagnostics;
+	CompileResult result;
+	bool interrupted = false; // Set if something other than a compiler error stopped the compile
+	
+	context = &compilerContext;
+	compilerContext.diagnostics = &diagnostics;
 	
-	if( errorCount > 0 )
+	try
 	{
-		remove( "narcomp_output.c" );
+		initializeScannerSource( source, length );
+		
+		// Find the top-level procedures, for taking the ones that haven't changed from the last compile
+		if( options.procedures != NULL )
+		{
+			findTopProcedures( source, length, options.procedures->regions );
+		}
+		
+		readProgram( options.nestingLimit, options.procedures );
+		
+		if( compilerContext.errorCount == 0 )
+		{
+			resetOutput();
+			emitProgram();
+			copyOutput( result.code, PROLOGUE_SECTION, RUNTIME_SECTION );
+			
+			if( options.emitIr )
+			{
+				dumpIr( outputSection( IR_SECTION ) );
+				copyOutput( result.ir, IR_SECTION, IR_SECTION );
+			}
+		}
+	}
+	catch( exception& e )
+	{
+		diagnostics << e.what() << endl;
+		interrupted = true;
 	}
 	
-	// Empty Symbol Tables
-	// Global Symbol Table Entries
-	for( SymbolTable::iterator janitor = globalSymbolTable.begin(); janitor != globalSymbolTable.end(); janitor++ )
+	closeScanner();
+	
+	result.succeeded = compilerContext.errorCount == 0 && interrupted == false;
+	result.diagnostics = diagnostics.str();
+	result.lineCount = compilerContext.lineNumber;
+	result.warningCount = compilerContext.warningCount;
+	result.errorCount = compilerContext.errorCount;
+	
+	if( result.succeeded == false )
 	{
-		delete janitor->second;
+		result.code.clear();
+		result.ir.clear();
 	}
-	globalSymbolTable.clear();
 	
-	// Local Symbol Table Entries
-	for( int i = 0; i < localSymbolTable.size(); i++ )
+	compilerContext.diagnostics = callerDiagnostics;
+	context = callerContext;
+	return result;
+}
+
+// Compiles each of the files on a pool of threads (0 for one per core), writing the C for "name.txt" to "name.c"
+// (and its IR to "name.ir" for --emit-ir). The diagnostics are printed file by file, in the order the files were given.
+int compileBatch( char** filenames, const int fileCount, const int threads, const CompileOptions& options )
+{
+	BatchJob job;
+	vector<thread> workers;
+	int threadCount = threads > 0 ? threads : thread::hardware_concurrency();
+	int compiledCount = 0;
+	int lineCount = 0;
+	int warningCount = 0;
+	int errorCount = 0;
+	
+	job.filenames = filenames;
+	job.fileCount = fileCount;
+	job.options = options;
+	job.nextFile = 0;
+	job.results.resize( fileCount );
+	job.failures.resize( fileCount );
+	
+	threadCount = max( 1, min( threadCount, fileCount ) );
+	
+	for( int i = 0; i < threadCount; i++ )
+	{
+		workers.push_back( thread( runBatchWorker, &job ) );
+	}
+	
+	for( int i = 0; i < threadCount; i++ )
 	{
-		for( SymbolTable::iterator janitor = localSymbolTable[i].begin(); janitor != localSymbolTable[i].end(); janitor++ )
+		workers[i].join();
+	}
+	
+	// Print what each file had to say, then add the files up
+	for( int i = 0; i < fileCount; i++ )
+	{
+		const CompileResult& result = job.results[i];
+		
+		if( result.diagnostics.empty() == false || job.failures[i].empty() == false )
 		{
-			delete janitor->second;
+			cerr << filenames[i] << ":" << endl;
+			cerr << result.diagnostics << job.failures[i];
 		}
+		
+		compiledCount += result.succeeded && job.failures[i].empty() ? 1 : 0;
+		lineCount += result.lineCount;
+		warningCount += result.warningCount;
+		errorCount += result.errorCount;
+	}
+	
+	if( compiledCount < fileCount || warningCount > 0 )
+	{
+		cerr << endl;
 	}
-	localSymbolTable.clear();
+	
+	cout << "Summary" << endl;
+	cout << "=======" << endl;
+	cout << "Files: " << fileCount << endl;
+	cout << "Compiled: " << compiledCount << endl;
+	cout << "Lines Read: " << lineCount << endl;
+	cout << "Errors: " << errorCount << endl;
+	cout << "Warnings: " << warningCount << endl;
 	
 	return 0;
 }
 
+// Body of a --batch thread. Compiles files until there are none left, all in the same context.
+void runBatchWorker( BatchJob* job )
+{
+	CompilerContext workerContext;
+	string source;
+	string outputName;
+	int file;
+	
+	while( ( file = job->nextFile++ ) < job->fileCount )
+	{
+		CompileResult& result = job->results[file];
+		
+		if( readSourceFile( job->filenames[file], source ) == false )
+		{
+			result.succeeded = false;
+			result.lineCount = 0;
+			result.warningCount = 0;
+			result.errorCount = 0;
+			job->failures[file] = "Error opening input file.\n";
+			continue;
+		}
+		
+		// Take the result from the cache if it is there
+		if( cacheOpen() == false )
+		{
+			result = compile( workerContext, source.data(), source.size(), job->options );
+		}
+		else
+		{
+			result = compileThroughCache( workerContext, job->filenames[file], source, job->options );
+		}
+		
+		outputName = batchOutputName( job->filenames[file], ".c" );
+		
+		// As with a single file, a failed compile writes nothing and doesn't leave older C behind
+		if( result.succeeded == false )
+		{
+			remove( outputName.c_str() );
+			continue;
+		}
+		
+		if( writeOutputText( outputName.c_str(), result.code ) == false ||
+			( job->options.emitIr && writeOutputText( batchOutputName( job->filenames[file], ".ir" ).c_str(), result.ir ) == false ) )
+		{
+			job->failures[file] = "Error writing file for output.\n";
+		}
+		
+		// The code has been written, so don't hold on to it until the batch is over
+		string().swap( result.code );
+		string().swap( result.ir );
+	}
+}
+
+// Reads the whole of a file into source. Returns false if it couldn't be read.
+bool readSourceFile( const char* filename, string& source )
+{
+	ifstream input( filename, ios::in | ios::binary );
+	streamoff length;
+	
+	// "-" means standard input, which can only be read to its end
+	if( strcmp( filename, "-" ) == 0 )
+	{
+		source.assign( istreambuf_iterator<char>( cin ), istreambuf_iterator<char>() );
+		return cin.bad() == false;
+	}
+	
+	if( input.good() == false )
+	{
+		return false;
+	}
+	
+	input.seekg( 0, ios::end );
+	length = input.tellg();
+	input.seekg( 0, ios::beg );
+	
+	if( length < 0 )
+	{
+		return false;
+	}
+	
+	source.resize( length );
+	input.read( &source[0], length );
+	
+	return input.gcount() == length;
+}
+
+// Returns the name of an output file of a --batch compile: the input's name with its extension (if it has one) replaced
+string batchOutputName( const string& filename, const char* extension )
+{
+	size_t dot = filename.find_last_of( '.' );
+	size_t slash = filename.find_last_of( '/' );
+	
+	if( dot == string::npos || ( slash != string::npos && dot < slash ) || filename.compare( dot, string::npos, extension ) == 0 )
+	{
+		return filename + extension;
+	}
+	
+	return filename.substr( 0, dot ) + extension;
+}
+
 // This function adds an entry to the symbol table with the specified token type
-void addSymbolEntry( Token* newToken )
+void addSymbolEntry( const int newSymbol )
 {
-	if( newToken->getGlobal() )
+	if( symbolGlobal( newSymbol ) )
 	{
-		globalSymbolTable[newToken->getName()] = newToken;
+		setGlobalSymbol( context->symbolStore.records[newSymbol].nameID, newSymbol );
 	}
 	else
 	{
-		localSymbolTable[currentScope][newToken->getName()] = newToken;
+		setLocalSymbol( context->symbolStore.records[newSymbol].nameID, newSymbol );
 	}
 }
 
 // This function searches the symbol table for the specified entry.
-// It modifies the token passed with the token's type (IDENTIFIER, RESERVE, or STRING) if it exists.
+// It modifies the token passed with the token's type (IDENTIFIER, RESERVE, or STRING) and symbol table entry if it exists.
 // The token passed gets a type of NONE if it is not found in the symbol table
 void findSymbolEntry( TokenFrame& newToken )
 {
 	
-	SymbolTable::iterator result;
-	
-	// get a pointer to the symbol table entry with the specified key
-	// search the local scope first
-	result = localSymbolTable[currentScope].find( newToken.name );
+	int result = NO_SYMBOL;
+	const SymbolSlot* slot;
 	
-	// If not found in local scope
-	if( result == localSymbolTable[currentScope].end() )
+	if( context->symbolTable.count > 0 )
 	{
-		// search the global scope
-		result = globalSymbolTable.find( newToken.name );
+		slot = &context->symbolTable.slots[findSymbolSlot( newToken.nameID )];
 		
-		// If not found in global scope either
-		if( result == globalSymbolTable.end() )
+		// A local symbol is only visible in the scope it was declared in, and it hides a global symbol with the same name
+		if( slot->scope == context->currentScope )
 		{
-			newToken.tokenType = NONE;
+			result = slot->symbol;
+			newToken.isGlobal = false;
 		}
-		else // If found in global scope
+		else if( slot->globalSymbol != NO_SYMBOL )
 		{
-			newToken.tokenType = result->second->getTokenType();
+			result = slot->globalSymbol;
 			newToken.isGlobal = true;
 		}
 	}
-	else // If found in local scope
+	
+	// If not found in either scope
+	if( result == NO_SYMBOL )
+	{
+		newToken.tokenType = NONE;
+	}
+	else
 	{
-		newToken.tokenType = result->second->getTokenType();
-		newToken.isGlobal = false;
+		newToken.tokenType = context->symbolStore.records[result].tokenType;
 	}
+	
+	newToken.symbol = result;
 }
 
-// Reports warnings by printing line number and message to stderr
+// Returns the global symbol with the specified intern id, or NO_SYMBOL if there isn't one
+int lookupGlobalSymbol( const int nameID )
+{
+	if( context->symbolTable.count == 0 )
+	{
+		return NO_SYMBOL;
+	}
+	
+	return context->symbolTable.slots[findSymbolSlot( nameID )].globalSymbol;
+}
+
+// Returns the symbol with the specified intern id declared in the current scope, or NO_SYMBOL if there isn't one
+int lookupLocalSymbol( const int nameID )
+{
+	const SymbolSlot* slot;
+	
+	if( context->symbolTable.count == 0 )
+	{
+		return NO_SYMBOL;
+	}
+	
+	slot = &context->symbolTable.slots[findSymbolSlot( nameID )];
+	
+	return ( slot->scope == context->currentScope ) ? slot->symbol : NO_SYMBOL;
+}
+
+// Returns the slot of the symbol table that holds the name with the specified intern id, or the empty slot where it would go.
+// The table must have at least one empty slot.
+int findSymbolSlot( const int nameID )
+{
+	// Intern ids are handed out in order. Multiplying by an odd constant keeps consecutive ids in different slots
+	// and spreads them over the table.
+	unsigned int mask = context->symbolTable.slots.size() - 1;
+	unsigned int slot = ( static_cast<unsigned int>( nameID ) * 2654435769u ) & mask;
+	
+	while( context->symbolTable.slots[slot].nameID != nameID && context->symbolTable.slots[slot].nameID != -1 )
+	{
+		slot = ( slot + 1 ) & mask;
+	}
+	
+	return slot;
+}
+
+// Returns the slot of the symbol table for the name with the specified intern id, giving the name a slot if it doesn't have one.
+// A name keeps its slot for the rest of the compile, even when its scope is left.
+SymbolSlot& claimSymbolSlot( const int nameID )
+{
+	vector<SymbolSlot> oldSlots;
+	int slot;
+	
+	// Double the number of slots when the table would become more than half full
+	if( ( context->symbolTable.count + 1 ) * 2 > context->symbolTable.slots.size() )
+	{
+		SymbolSlot emptySlot = { -1, NO_SYMBOL, -1, NO_SYMBOL };
+		
+		oldSlots.swap( context->symbolTable.slots );
+		context->symbolTable.slots.assign( oldSlots.empty() ? 16 : oldSlots.size() * 2, emptySlot );
+		
+		for( int i = 0; i < oldSlots.size(); i++ )
+		{
+			if( oldSlots[i].nameID != -1 )
+			{
+				context->symbolTable.slots[findSymbolSlot( oldSlots[i].nameID )] = oldSlots[i];
+			}
+		}
+	}
+	
+	slot = findSymbolSlot( nameID );
+	
+	if( context->symbolTable.slots[slot].nameID == -1 )
+	{
+		context->symbolTable.slots[slot].nameID = nameID;
+		context->symbolTable.count++;
+	}
+	
+	return context->symbolTable.slots[slot];
+}
+
+// Logs the local symbol a name had so it is put back when the parse leaves the specified scope.
+// Only the current scope and the one enclosing it ever log anything. The log for the current scope is at the end of the undo log,
+// so an entry for the enclosing scope is swapped in front of it. The order of the entries for one scope doesn't matter
+// because a scope logs each name at most once.
+void logShadowedSymbol( const int nameID, const int symbol, const int scope, const int logScope )
+{
+	ShadowedSymbol entry = { nameID, symbol, scope };
+	int mark;
+	
+	context->symbolTable.undoLog.push_back( entry );
+	
+	if( logScope < context->currentScope )
+	{
+		mark = context->symbolTable.scopeMarks[context->currentScope];
+		swap( context->symbolTable.undoLog[mark], context->symbolTable.undoLog.back() );
+		context->symbolTable.scopeMarks[context->currentScope]++;
+	}
+}
+
+// Returns the innermost symbol with the specified intern id that was declared in a procedure enclosing the current scope,
+// or NO_SYMBOL if there isn't one. Such a symbol can't be referred to from the current scope.
+int lookupEnclosingSymbol( const int nameID )
+{
+	const SymbolSlot* slot;
+	
+	if( context->symbolTable.count == 0 )
+	{
+		return NO_SYMBOL;
+	}
+	
+	// The slot holds the innermost local symbol, so it is the one wanted unless it was declared in the current scope.
+	// Then the one it shadows is in the current scope's part of the undo log.
+	slot = &context->symbolTable.slots[findSymbolSlot( nameID )];
+	
+	if( slot->scope < context->currentScope )
+	{
+		return slot->symbol;
+	}
+	
+	for( int i = context->symbolTable.scopeMarks[context->currentScope]; i < context->symbolTable.undoLog.size(); i++ )
+	{
+		if( context->symbolTable.undoLog[i].nameID == nameID )
+		{
+			return context->symbolTable.undoLog[i].symbol;
+		}
+	}
+	
+	return NO_SYMBOL;
+}
+
+// Declares the symbol under the name with the specified intern id in the global scope, replacing any global symbol already there
+void setGlobalSymbol( const int nameID, const int symbol )
+{
+	claimSymbolSlot( nameID ).globalSymbol = symbol;
+}
+
+// Declares the symbol under the name with the specified intern id in the current scope, replacing any symbol it already has there
+void setLocalSymbol( const int nameID, const int symbol )
+{
+	SymbolSlot& slot = claimSymbolSlot( nameID );
+	
+	// Log the symbol being shadowed, unless it was declared in this scope too and is simply being replaced
+	if( slot.scope != context->currentScope )
+	{
+		logShadowedSymbol( nameID, slot.symbol, slot.scope, context->currentScope );
+		slot.scope = context->currentScope;
+	}
+	
+	slot.symbol = symbol;
+}
+
+// Declares the symbol under the name with the specified intern id in the scope that encloses the current one
+void setEnclosingSymbol( const int nameID, const int symbol )
+{
+	SymbolSlot& slot = claimSymbolSlot( nameID );
+	int enclosingScope = context->currentScope - 1;
+	ShadowedSymbol* entry = NULL;
+	
+	// If the current scope declared the name too, the enclosing scope's symbol is the one in the current scope's log,
+	// which is put back when the current scope is left. A procedure's header only declares the procedure and its parameters,
+	// so that part of the log is short.
+	if( slot.scope == context->currentScope )
+	{
+		for( int i = context->symbolTable.scopeMarks[context->currentScope]; i < context->symbolTable.undoLog.size(); i++ )
+		{
+			if( context->symbolTable.undoLog[i].nameID == nameID )
+			{
+				entry = &context->symbolTable.undoLog[i];
+				break;
+			}
+		}
+		
+		if( entry->scope != enclosingScope )
+		{
+			int shadowedSymbol = entry->symbol;
+			int shadowedScope = entry->scope;
+			
+			entry->symbol = symbol;
+			entry->scope = enclosingScope;
+			logShadowedSymbol( nameID, shadowedSymbol, shadowedScope, enclosingScope );
+		}
+		else
+		{
+			entry->symbol = symbol;
+		}
+	}
+	else
+	{
+		if( slot.scope != enclosingScope )
+		{
+			logShadowedSymbol( nameID, slot.symbol, slot.scope, enclosingScope );
+			slot.scope = enclosingScope;
+		}
+		
+		slot.symbol = symbol;
+	}
+}
+
+// Enters a new scope, one deeper than the current scope
+void enterScope( void )
+{
+	context->currentScope++;
+	context->symbolTable.scopeMarks.push_back( context->symbolTable.undoLog.size() );
+}
+
+// Leaves the current scope, putting back the symbols its declarations shadowed
+void leaveScope( void )
+{
+	int mark = context->symbolTable.scopeMarks.back();
+	
+	// Each name in the log already has a slot, so putting its symbol back never grows the table
+	while( context->symbolTable.undoLog.size() > mark )
+	{
+		const ShadowedSymbol& entry = context->symbolTable.undoLog.back();
+		SymbolSlot& slot = context->symbolTable.slots[findSymbolSlot( entry.nameID )];
+		
+		slot.symbol = entry.symbol;
+		slot.scope = entry.scope;
+		context->symbolTable.undoLog.pop_back();
+	}
+	
+	context->symbolTable.scopeMarks.pop_back();
+	context->currentScope--;
+}
+
+// Empties the symbol store and the symbol table, which leaves the parse in the main program block.
+// Everything is emptied in place, so a context that is used for one compile after another (by a --server or --batch worker) keeps the room
+// its columns and slots have grown to, and declaring the runtime functions again doesn't allocate.
+void resetSymbolStore( void )
+{
+	SymbolStore& store = context->symbolStore;
+	SymbolTable& table = context->symbolTable;
+	const SymbolSlot emptySlot = { -1, NO_SYMBOL, -1, NO_SYMBOL };
+	
+	store.records.clear();
+	store.dataTypes.clear();
+	store.addresses.clear();
+	store.arraySizes.clear();
+	store.parameterAddresses.clear();
+	store.localAddresses.clear();
+	store.returnAddresses.clear();
+	store.firstParameters.clear();
+	store.parameterCounts.clear();
+	store.firstDirections.clear();
+	store.directionCounts.clear();
+	store.nestedNumbers.clear();
+	store.parameterTypes.clear();
+	store.parameterDirections.clear();
+	
+	// The table keeps its number of slots, so it is only doubled again by a compile with more names than the biggest before it
+	fill( table.slots.begin(), table.slots.end(), emptySlot );
+	table.count = 0;
+	table.undoLog.clear();
+	table.scopeMarks.assign( 1, 0 );
+	context->currentScope = 0;
+}
+
+// Adds a record for a symbol to the symbol store (with room in the columns for variables and arrays) and returns its id
+int newSymbol( const SymbolKind newKind, const TokenType newTokenType, const int newNameID, const bool newGlobal, const bool newParameter )
+{
+	SymbolRecord record = { newKind, newTokenType, newNameID, newGlobal, newParameter, -1 };
+	
+	context->symbolStore.records.push_back( record );
+	context->symbolStore.dataTypes.push_back( INVALID );
+	context->symbolStore.addresses.push_back( 0 );
+	context->symbolStore.arraySizes.push_back( 0 );
+	
+	return context->symbolStore.records.size() - 1;
+}
+
+// Adds a name with nothing more to it (the program name) to the symbol store and returns its id
+int newNameSymbol( const TokenType newTokenType, const int newNameID, const bool newGlobal )
+{
+	return newSymbol( NAME_SYMBOL, newTokenType, newNameID, newGlobal, false );
+}
+
+// Adds a variable to the symbol store and returns its id
+int newVariableSymbol( const TokenType newTokenType, const int newNameID, const DataType newDataType, const bool newGlobal, const int newAddress, const bool newParameter )
+{
+	int variable = newSymbol( VARIABLE_SYMBOL, newTokenType, newNameID, newGlobal, newParameter );
+	
+	context->symbolStore.dataTypes[variable] = newDataType;
+	context->symbolStore.addresses[variable] = newAddress;
+	
+	return variable;
+}
+
+// Adds an array to the symbol store and returns its id
+int newArraySymbol( const TokenType newTokenType, const int newNameID, const DataType newDataType, const int newArraySize, const bool newGlobal, const int newAddress, const bool newParameter )
+{
+	int array = newSymbol( ARRAY_SYMBOL, newTokenType, newNameID, newGlobal, newParameter );
+	
+	context->symbolStore.dataTypes[array] = newDataType;
+	context->symbolStore.addresses[array] = newAddress;
+	context->symbolStore.arraySizes[array] = newArraySize;
+	
+	return array;
+}
+
+// Adds a procedure, with an empty parameter list, to the symbol store and returns its id
+int newProcedureSymbol( const TokenType newTokenType, const int newNameID, const bool newGlobal )
+{
+	int procedure = newSymbol( PROCEDURE_SYMBOL, newTokenType, newNameID, newGlobal, false );
+	
+	context->symbolStore.records[procedure].procedure = context->symbolStore.parameterAddresses.size();
+	context->symbolStore.parameterAddresses.push_back( 0 );
+	context->symbolStore.localAddresses.push_back( 0 );
+	context->symbolStore.returnAddresses.push_back( 0 );
+	context->symbolStore.firstParameters.push_back( context->symbolStore.parameterTypes.size() );
+	context->symbolStore.parameterCounts.push_back( 0 );
+	context->symbolStore.firstDirections.push_back( context->symbolStore.parameterDirections.size() );
+	context->symbolStore.directionCounts.push_back( 0 );
+	context->symbolStore.nestedNumbers.push_back( -1 );
+	
+	return procedure;
+}
+
+// Adds a parameter of the specified data type to the end of the procedure's parameter list
+void addParameter( const int procedure, const DataType newDataType )
+{
+	context->symbolStore.parameterTypes.push_back( newDataType );
+	context->symbolStore.parameterCounts[context->symbolStore.records[procedure].procedure]++;
+}
+
+// Adds a direction (true = in, false = out) to the end of the procedure's list of parameter directions
+void addDirection( const int procedure, const bool newDirection )
+{
+	context->symbolStore.parameterDirections.push_back( newDirection );
+	context->symbolStore.directionCounts[context->symbolStore.records[procedure].procedure]++;
+}
+
+// Copies everything about a symbol out of the symbol store, so it can be declared in another compile
+void copySymbol( const int symbol, SymbolCopy& copy )
+{
+	const SymbolStore& store = context->symbolStore;
+	int index;
+	
+	copy.record = store.records[symbol];
+	copy.dataType = store.dataTypes[symbol];
+	copy.address = store.addresses[symbol];
+	copy.arraySize = store.arraySizes[symbol];
+	copy.parameterTypes.clear();
+	copy.parameterDirections.clear();
+	
+	if( copy.record.kind == PROCEDURE_SYMBOL )
+	{
+		index = copy.record.procedure;
+		copy.parameterAddress = store.parameterAddresses[index];
+		copy.localAddress = store.localAddresses[index];
+		copy.returnAddress = store.returnAddresses[index];
+		copy.nestedNumber = store.nestedNumbers[index];
+		copy.parameterTypes.assign( store.parameterTypes.begin() + store.firstParameters[index],
+			store.parameterTypes.begin() + store.firstParameters[index] + store.parameterCounts[index] );
+		copy.parameterDirections.assign( store.parameterDirections.begin() + store.firstDirections[index],
+			store.parameterDirections.begin() + store.firstDirections[index] + store.directionCounts[index] );
+	}
+}
+
+// Declares a symbol copied out of another compile's store in the current scope (or globally, if it is global), and returns its id
+int declareSymbolCopy( const SymbolCopy& copy )
+{
+	int symbol = newSymbol( copy.record.kind, copy.record.tokenType, copy.record.nameID, copy.record.isGlobal, copy.record.isParameter );
+	
+	context->symbolStore.dataTypes[symbol] = copy.dataType;
+	context->symbolStore.addresses[symbol] = copy.address;
+	context->symbolStore.arraySizes[symbol] = copy.arraySize;
+	
+	if( copy.record.kind == PROCEDURE_SYMBOL )
+	{
+		context->symbolStore.records[symbol].procedure = context->symbolStore.parameterAddresses.size();
+		context->symbolStore.parameterAddresses.push_back( copy.parameterAddress );
+		context->symbolStore.localAddresses.push_back( copy.localAddress );
+		context->symbolStore.returnAddresses.push_back( copy.returnAddress );
+		context->symbolStore.firstParameters.push_back( context->symbolStore.parameterTypes.size() );
+		context->symbolStore.parameterCounts.push_back( copy.parameterTypes.size() );
+		context->symbolStore.firstDirections.push_back( context->symbolStore.parameterDirections.size() );
+		context->symbolStore.directionCounts.push_back( copy.parameterDirections.size() );
+		context->symbolStore.nestedNumbers.push_back( copy.nestedNumber );
+		context->symbolStore.parameterTypes.insert( context->symbolStore.parameterTypes.end(), copy.parameterTypes.begin(), copy.parameterTypes.end() );
+		context->symbolStore.parameterDirections.insert( context->symbolStore.parameterDirections.end(), copy.parameterDirections.begin(), copy.parameterDirections.end() );
+	}
+	
+	addSymbolEntry( symbol );
+	
+	return symbol;
+}
+
+// Reports warnings by printing line number and message to the context's diagnostics
 void reportWarning( const string& message )
 {
-	warningCount++;
-	cerr << "Warning: Line " << lineNumber << ": " << message << endl;
+	context->warningCount++;
+	*context->diagnostics << "Warning: Line " << context->lineNumber << ": " << message << endl;
 }
 
-// Reports errors by printing line number and message to stderr
+// Reports errors by printing line number and message to the context's diagnostics
 void reportError( const string& message )
 {
-	errorCount++;
-	cerr << "Error: Line " << lineNumber << ": " << message << endl;
-}
-
-void initializeOutput()
-{
-	outFile.open( "narcomp_output.c", ios::out | ios::trunc );
-	
-	if( outFile.good() == true )
-	{
-		// Prepare the beginning of the output
-		outFile << "typedef union" << endl;
-		outFile << "{" << endl;
-		outFile << "\tchar charVal;" << endl;
-		outFile << "\tint intVal;" << endl;
-		outFile << "\tfloat floatVal;" << endl;
-		outFile << "\tint stringPointer;" << endl;
-		outFile << "\tvoid* jumpTarget;" << endl;
-		outFile << "} MemoryFrame;" << endl;
-		outFile << endl;
-		outFile << "static MemoryFrame R[" << REGISTER_SIZE << "];" << endl;
-		outFile << "static MemoryFrame MM[" << MEMORY_SIZE << "];" << endl;
-		outFile << "static void* jumpRegister;" << endl;
-		outFile << endl;
-		outFile << "int getBool( void );" << endl;
-		outFile << "int getInteger( void );" << endl;
-		outFile << "float getFloat( void );" << endl;
-		outFile << "int getString( void );" << endl;
-		outFile << "int putBool( int oldBool );" << endl;
-		outFile << "int putInteger( int oldInteger );" << endl;
-		outFile << "int putFloat( float oldFloat );" << endl;
-		outFile << "int putString( int oldString );" << endl;
-		outFile << endl;
-		outFile << "int main( int argc, char** argv )" << endl;
-		outFile << "{" << endl;
-		outFile << "\tR[0].intVal = " << MEMORY_SIZE << ";" << endl;
-		outFile << "\tgoto programsetup;" << endl;
-		outFile << endl;
-	}
+	context->errorCount++;
+	*context->diagnostics << "Error: Line " << context->lineNumber << ": " << message << endl;
 }
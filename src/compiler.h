@@ -2,21 +2,44 @@
 #define COMPILER_H
 
 #include <iostream>
+#include <algorithm>
 #include <cctype>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <exception>
 #include <fstream>
 #include <limits>
-#include <map>
 #include <sstream>
 #include <string>
-#include <typeinfo>
 #include <vector>
 
 using namespace std;
 
 #define REGISTER_SIZE 256
 #define MEMORY_SIZE 8388608
+#define INPUT_BLOCK_SIZE 1048576
+#define LOOKAHEAD_SIZE 4
+#define PIPELINE_QUEUE_SIZE 65536
+#define SCAN_CHUNK_SIZE 1048576
+#define NESTING_LIMIT 10000
+#define PARENTHESIS_LIMIT 2000
+#define IR_CHUNK_SIZE 65536
+#define IR_NO_BASE -1
+#define IR_NO_NAME -1
+#define OUTPUT_CHUNK_SIZE 65536
+#define OUTPUT_CHUNK_LIMIT 16777216
+#define SPLIT_FILES 8
+#define SERVER_BACKLOG 64
+#define SERVER_SOURCE_LIMIT 1073741824
+#define SERVER_TIMEOUT_SECONDS 10
+#define SERVER_RECEIVE_BLOCK 65536
+#define SERVER_REQUEST_MAGIC 0x3152414E
+#define SERVER_REPLY_MAGIC 0x3252414E
+#define CACHE_FORMAT_VERSION 1
+#define CACHE_SIZE_LIMIT 268435456
+#define CACHE_EVICTION_PERCENT 90
+#define NO_SYMBOL -1
 
 // Define enumeration type to encapsulate the character classes
 enum CharacterClass { DIGIT, ILLEGAL, LETTER, PUNCTUATION};
@@ -24,240 +47,142 @@ enum CharacterClass { DIGIT, ILLEGAL, LETTER, PUNCTUATION};
 // Define enumeration type to encapsulate the token types
 enum TokenType { IDENTIFIER, NONE, NUMBER, OPERATOR, RESERVE, STRING, UNKNOWN };
 
+// Define enumeration type to encapsulate the kinds of tokens the parser tells apart
+// Every reserved word and operator is a kind of its own, numbered like the id of its spelling in the intern pool
+// (the reserved words in the order of reservedWords in scanner.cpp, then the empty spelling, then the operators in the order
+// resetInternPool() interns them). There are at most 64 kinds, so a set of kinds fits in a TokenSet.
+enum TokenKind
+{
+	AND_TOKEN, BEGIN_TOKEN, BOOL_TOKEN, CASE_TOKEN, ELSE_TOKEN, END_TOKEN, FALSE_TOKEN, FLOAT_TOKEN, FOR_TOKEN, GLOBAL_TOKEN, IF_TOKEN, IN_TOKEN,
+	INTEGER_TOKEN, IS_TOKEN, NOT_TOKEN, OR_TOKEN, OUT_TOKEN, PROCEDURE_TOKEN, PROGRAM_TOKEN, RETURN_TOKEN, STRING_TOKEN, THEN_TOKEN, TRUE_TOKEN,
+	END_OF_INPUT_TOKEN,
+	COLON_TOKEN, SEMICOLON_TOKEN, COMMA_TOKEN, PLUS_TOKEN, MINUS_TOKEN, MULTIPLY_TOKEN, DIVIDE_TOKEN, LEFT_PAREN_TOKEN, RIGHT_PAREN_TOKEN,
+	LESS_TOKEN, LESS_EQUAL_TOKEN, GREATER_TOKEN, GREATER_EQUAL_TOKEN, NOT_EQUAL_TOKEN, EQUAL_TOKEN, ASSIGN_TOKEN,
+	LEFT_BRACE_TOKEN, RIGHT_BRACE_TOKEN, AND_OPERATOR_TOKEN, OR_OPERATOR_TOKEN, LEFT_BRACKET_TOKEN, RIGHT_BRACKET_TOKEN,
+	NAME_TOKEN, NUMBER_TOKEN, STRING_LITERAL_TOKEN,
+	TOKEN_KIND_COUNT
+};
+
+// Define data type for a set of token kinds, with one bit for each kind
+typedef unsigned long long TokenSet;
+
+// Returns the set holding just the specified kind. The sets the parser uses are built from these at compile time.
+constexpr TokenSet tokenBit( const TokenKind kind )
+{
+	return 1ULL << kind;
+}
+
+static_assert( TOKEN_KIND_COUNT <= 64, "Too many token kinds for a TokenSet" );
+
 // Define enumeration type to encapsulate data types for type checker
 enum DataType { INVALID, STRINGT, BOOL, INTEGER, FLOAT };
 
+// Define enumeration type to encapsulate the kinds of symbol table entries
+// A NAME_SYMBOL is a name with nothing more to it (the program name)
+enum SymbolKind { NAME_SYMBOL, VARIABLE_SYMBOL, ARRAY_SYMBOL, PROCEDURE_SYMBOL };
+
+// Define enumeration type to encapsulate the sets of scanning kernels
+enum ScanKernelSet { SCALAR_KERNELS, SSE2_KERNELS, AVX2_KERNELS };
+
+// Location: scanner.cpp
+// Returns the spelling of an interned identifier, literal or operator.
+// The reference stays valid until the scanner is initialized again.
+extern const string& internedName( const int id );
+
 // Define data structure for a basic token generated by the scanner
+// The spelling is interned by the scanner, so tokens are small plain records that copy without allocating.
+// Numbers also carry their value, so the parser never has to read it back out of the spelling.
 struct TokenFrame
 {
 	TokenType tokenType;
-	string name;
+	TokenKind kind; // Which reserved word or operator the token is, or what else it is
+	int nameID; // Index of the token's spelling in the intern pool
+	int line; // Line the scanner was on when it finished reading the token
 	bool isGlobal;
+	int symbol; // Symbol table entry of a name, set by findSymbolEntry (NO_SYMBOL if the name wasn't found)
+	DataType numberType; // INTEGER or FLOAT for a number, INVALID for any other token
+	
+	// Value of a number, converted by the scanner
+	union
+	{
+		int intValue;
+		float floatValue;
+	};
+	
+	// Returns the spelling of the token
+	const string& getName( void ) const
+	{
+		return internedName( nameID );
+	}
+	
+	// Tells whether the token's kind is in the specified set
+	bool isIn( const TokenSet set ) const
+	{
+		return ( set >> kind ) & 1;
+	}
 };
 
-// Base Token class
-// Reserve Words and Operators will use this class
-class Token
+// Define data structure for a token (or scanner warning) of a ScannedBuffer, with the bytes of the text it covers
+struct BufferEntry
 {
-	public:
-		// Constructors
-		// Initialize Constructor
-		Token( const TokenType& newTokenType, const string& newName, const bool& newGlobal ) : m_tokenType( newTokenType ), m_name( newName ), m_isGlobal( newGlobal )
-		{
-		}
-		
-		// Destructor (virtual to cover for polymorphism)
-		virtual ~Token( void )
-		{
-		}
-		
-		// Accessor Methods
-		TokenType getTokenType( void ) const
-		{
-			return m_tokenType;
-		}
-		
-		string getName( void ) const
-		{
-			return m_name;
-		}
-		
-		bool getGlobal( void ) const
-		{
-			return m_isGlobal;
-		}
-		
-	protected:
-		TokenType m_tokenType;
-		string m_name;
-		bool m_isGlobal;
+	TokenFrame token; // Names that aren't reserved words have type NONE. For a warning only token.line is used.
+	int start; // Offset of the token's first byte (for a warning, where it was found)
+	int end; // Offset just past the token, where the scanner stopped after it (for a warning, where it was found)
+	const char* warning; // Message of a scanner warning, or NULL for a token
 };
 
-// Variable Token class (inherits Token)
-class Variable : public Token
+// Define data structure for a source text that is kept scanned while it is edited (for an editor)
+// The entries are kept in a gap buffer. Entries before the gap hold their real offsets and lines, and entries after the gap hold
+// offsets from the end of the text and lines counted from lastLine, so an edit only has to touch the entries between it and the last edit.
+// Use the functions in scanner.cpp to get at the entries.
+struct ScannedBuffer
 {
-	public:
-		// Constructors
-		// Initialize Constructor
-		Variable( const TokenType& newTokenType, const string& newName, const DataType& newDataType, const bool& newGlobal, const int& newAddress, const bool& newParameter ) : Token( newTokenType, newName, newGlobal ), m_dataType( newDataType ), m_address( newAddress ), m_isParameter( newParameter )
-		{
-		}
-		
-		// Destructor (virtual to cover polymorphism)
-		virtual ~Variable( void )
-		{
-		}
-		
-		// Accessor Methods
-		DataType getDataType( void ) const
-		{
-			return m_dataType;
-		}
-		
-		int getAddress( void ) const
-		{
-			return m_address;
-		}
-		
-		bool getParameter( void ) const
-		{
-			return m_isParameter;
-		}
-		
-	protected:
-		DataType m_dataType;
-		int m_address;
-		bool m_isParameter;
+	string text;
+	vector<BufferEntry> entries;
+	int gapStart; // Index of the first unused slot in entries
+	int gapEnd; // Index of the first entry after the gap
+	int lastLine; // Line of the end-of-input token
 };
 
-// Array Token class (inherits Variable)
-class Array : public Variable
+// Define data structure for the record of a symbol table entry
+// A symbol is known by its id, the index of its record in the symbol store. The record tells what kind of symbol it is,
+// and everything else about the symbol is kept in the columns of the store (see SymbolStore).
+struct SymbolRecord
 {
-	public:
-		// Constructors
-		// Initialize Constructor
-		Array( const TokenType& newTokenType, const string& newName, const DataType& newDataType, const int& newArraySize, const bool& newGlobal, const int& newAddress, const bool& newParameter ) : Variable( newTokenType, newName, newDataType, newGlobal, newAddress, newParameter ), m_arraySize( newArraySize )
-		{
-		}
-		
-		// Destructor (virtual to cover polymorphism)
-		virtual ~Array( void )
-		{
-		}
-		
-		// Accessor Methods
-		int getArraySize( void ) const
-		{
-			return m_arraySize;
-		}
-		
-	protected:
-		int m_arraySize;
+	SymbolKind kind;
+	TokenType tokenType; // RESERVE for the program name, STRING for a string literal and IDENTIFIER for anything else
+	int nameID; // Intern id of the name
+	bool isGlobal;
+	bool isParameter; // Set for a variable or array that is a parameter of a procedure
+	int procedure; // For a procedure, its index in the procedure columns of the store
 };
 
-// Procedure Token class (inherits Token)
-class Procedure : public Token
+// Define data structure for the store that holds every symbol of a compile
+// Every symbol gets a record, and each fact about a symbol is kept in a column of its own (a structure of arrays),
+// so checking what a name is only touches its record, and code generation only touches the columns it reads.
+// The store only grows during a compile, so symbol ids stay valid until it is reset by initializeScanner().
+struct SymbolStore
 {
-	public:
-		// Constructors
-		// Initialize Constructor
-		Procedure( const TokenType& newTokenType, const string& newName, const bool& newGlobal ) : Token( newTokenType, newName, newGlobal ), m_localAddress( 0 ), m_parameterAddress( 0 ), m_returnAddress( 0 )
-		{
-			m_parameterList.clear();
-			m_directionList.clear();
-		}
-		
-		// Destructor (virtual to cover polymorphism)
-		virtual ~Procedure( void )
-		{
-			for( int i = 0; i < m_parameterList.size(); i++ )
-			{
-				delete m_parameterList[i];
-			}
-		}
-		
-		// Accessor Methods
-		// Returns the number of parameters in the parameter list
-		int getParameterListSize( void ) const
-		{
-			return m_parameterList.size();
-		}
-		
-		// Returns the type of the specified parameter. The first one is numbered at 0.
-		DataType getParameterType( const int& n ) const
-		{
-			if( n >= 0 && n < m_parameterList.size() )
-			{
-				return m_parameterList[n]->getDataType();
-			}
-			else
-			{
-				return INVALID;
-			}
-		}
-		
-		// Returns the symbol table entry for the specified parameter
-		Variable* getParameter( const int& n ) const
-		{
-			if( n >= 0 && n < m_parameterList.size() )
-			{
-				return m_parameterList[n];
-			}
-			else
-			{
-				return NULL;
-			}
-		}
-		
-		// Returns the direction of the specified parameter. The first one is numbered at 0.
-		bool getDirection( const int& n ) const
-		{
-			if( n >= 0 && n < m_directionList.size() )
-			{
-				return m_directionList[n];
-			}
-			else
-			{
-				return true;
-			}
-		}
-		
-		// Returns the next available parameter address
-		int getParameterAddress( void ) const
-		{
-			return m_parameterAddress;
-		}
-		
-		// Returns the next available local scope address
-		int getLocalAddress( void ) const
-		{
-			return m_localAddress;
-		}
-		
-		// Returns the next available return address
-		int getReturnAddress( void ) const
-		{
-			return m_returnAddress;
-		}
-		
-		// Mutator Methods
-		// Adds the specified variable to the parameter list
-		void addParameter( Variable* newParameter )
-		{
-			m_parameterList.push_back( newParameter );
-		}
-		
-		// Adds a boolean value to the list of parameter directions
-		// true = in, false = out
-		void addDirection( const bool& newDirection )
-		{
-			m_directionList.push_back( newDirection );
-		}
-		
-		// Increase the pointer to next available parameter address by one unit
-		void advanceParameterAddress( void )
-		{
-			m_parameterAddress++;
-		}
-		
-		// Increase the pointer to next available local address by one unit
-		void advanceLocalAddress( void )
-		{
-			m_localAddress++;
-		}
-		
-		// Increase the pointer to next available return address
-		void advanceReturnAddress( void )
-		{
-			m_returnAddress++;
-		}
-		
-	protected:
-		vector<Variable*> m_parameterList;
-		vector<bool> m_directionList;
-		int m_parameterAddress; // Keeps track of the next available address for procedure parameters
-		int m_localAddress; // Keeps track of the next available address for local variables
-		int m_returnAddress; // Keeps track of the next available return address for the procedure
+	vector<SymbolRecord> records;
+	
+	// Columns for variables and arrays, indexed by symbol id
+	vector<DataType> dataTypes;
+	vector<int> addresses;
+	vector<int> arraySizes;
+	
+	// Columns for procedures, indexed by SymbolRecord::procedure
+	vector<int> parameterAddresses; // Next available address for procedure parameters
+	vector<int> localAddresses; // Next available address for local variables
+	vector<int> returnAddresses; // Next available return address
+	vector<int> firstParameters; // Index of the procedure's first parameter in parameterTypes
+	vector<int> parameterCounts;
+	vector<int> firstDirections; // Index of the procedure's first parameter in parameterDirections
+	vector<int> directionCounts;
+	vector<int> nestedNumbers; // Number of a procedure among those in its top-level procedure, which it is labeled by (-1 for a top-level one)
+	
+	// Procedure signatures. A procedure's parameters are all read before the next procedure is declared, so they are side by side.
+	vector<DataType> parameterTypes;
+	vector<bool> parameterDirections; // true = in, false = out
 };
 
 // Used for throwing exceptions for unexpected EOF
@@ -293,6 +218,8 @@ class CompileErrorException : public exception
 				printed = true;
 				return message.c_str();
 			}
+			
+			return "";
 		}
 	
 	private:
@@ -300,69 +227,861 @@ class CompileErrorException : public exception
 		bool printed; // tells whether the message has already been displayed
 };
 
-typedef map<string, Token*> SymbolTable;
+// Define data structure for a slot of the symbol table
+// A slot holds everything a name means at the current point of the parse, so one probe answers a lookup.
+struct SymbolSlot
+{
+	int nameID; // Intern id of the symbol's name, or -1 for an empty slot
+	int symbol; // Innermost local symbol with this name, or NO_SYMBOL
+	int scope; // Scope that symbol was declared in, or -1 if there is none
+	int globalSymbol; // Global symbol with this name, or NO_SYMBOL
+};
+
+// Define data structure for an entry of the symbol table's undo log
+// It holds the local symbol a name had before a scope declared the name again, so that it can be put back when the scope is left.
+struct ShadowedSymbol
+{
+	int nameID;
+	int symbol;
+	int scope;
+};
+
+// Define data structure for the symbol table
+// One table serves every scope. Names are interned, so it is keyed by intern id: a flat open-addressing hash table
+// (with linear probing) that never has to compare or hash a string. The number of slots is a power of two and at least
+// twice the number of names.
+// Declaring a name in a scope logs the local symbol it shadows. Entering a scope only marks the log, and leaving it
+// puts the shadowed symbols back, so the cost of a scope is one log entry per name it declares.
+// Global symbols live for the whole compile, so they are kept beside the local ones and never logged.
+// Use the functions in compiler.cpp to get at the symbols.
+struct SymbolTable
+{
+	vector<SymbolSlot> slots;
+	int count; // Number of slots in use
+	vector<ShadowedSymbol> undoLog;
+	vector<int> scopeMarks; // Size of the undo log when each scope was entered, indexed by scope
+	
+	SymbolTable( void ) : count( 0 )
+	{
+	}
+};
+
+// Define enumeration type to encapsulate the operations of the intermediate representation (IR)
+// The parser turns the program into instructions of three-address form (result, left and right operands), kept in basic blocks,
+// and emitter.cpp lowers them to C. The operands an instruction uses are:
+enum IrOpcode
+{
+	IR_LABEL, // Starts a basic block: the label left
+	IR_MOVE, // result = left
+	IR_NEGATE, // result = -left
+	IR_NOT, // result = !left
+	IR_ADD, IR_SUBTRACT, IR_MULTIPLY, IR_DIVIDE, IR_AND, IR_OR, // result = left op right
+	IR_LESS, IR_LESS_EQUAL, IR_GREATER, IR_GREATER_EQUAL, IR_NOT_EQUAL, // result = left op right, giving 0 or 1
+	IR_CHECK_BOOL, // Stops the program with a runtime error unless left is 0 or 1
+	IR_JUMP, // Ends a block: goes to the label left
+	IR_BRANCH, // Ends a block: goes to the label right if left is 1, and to the label result if it isn't
+	IR_CALL, // Ends a block: calls the procedure starting at the label left, whose parameters take right frames of the stack,
+		// and has it come back to the label result
+	IR_RETURN, // Ends a block: goes back to the return address in left
+	IR_EXIT // Ends a block: ends the program
+};
+
+// Define enumeration type to encapsulate the kinds of operands of an IR instruction
+enum IrOperandKind { IR_NO_OPERAND, IR_REGISTER, IR_MEMORY, IR_CONSTANT, IR_LABEL_OPERAND };
 
-// To keep track of the scanner's current line number
-extern int lineNumber;
+// Define enumeration type to encapsulate the field of a MemoryFrame (see the generated C) an operand reads or writes
+// IR_FRAME is the whole frame, which is copied without looking at its type.
+enum IrType { IR_FRAME, IR_INTEGER, IR_FLOAT, IR_CHARACTER, IR_STRING, IR_ADDRESS };
 
-// To keep track of the number of warnings found
-extern int warningCount;
+// Define enumeration type to encapsulate the kinds of labels. A label is its kind, a name (the intern id of a procedure's name) and a number.
+// The labels of a top-level procedure's blocks and calls are named after it and numbered from 0 in it, so they don't change
+// when the rest of the program does. The program body's have no name (IR_NO_NAME).
+enum IrLabelKind
+{
+	PROGRAM_BODY_LABEL, PROGRAM_SETUP_LABEL,
+	PROCEDURE_START_LABEL, // For a top-level procedure's name
+	NESTED_START_LABEL, // For a procedure in a top-level procedure: the top-level procedure's name, numbered by the procedure in it
+	PROCEDURE_RETURN_LABEL, // For a call in the program body: the called procedure's name, numbered by the call to it
+	CALL_RETURN_LABEL, // For a call in a procedure: the top-level procedure's name, numbered by the call in it
+	IF_START_LABEL, ELSE_START_LABEL, END_IF_LABEL, // For an if block ID
+	LOOP_CHECK_LABEL, LOOP_START_LABEL, END_LOOP_LABEL // For a loop block ID
+};
 
-// To keep track of the number of errors found
-extern int errorCount;
+// Define enumeration type to encapsulate what the value of an operand is relative to, so a procedure's code can be moved
+// to where its memory is in another compile. IR_STATIC_ADDRESS is an address in static memory (of a variable, array or string literal),
+// and IR_INDEX_SLOT is one of the slots array indexes are kept in across a call. Anything else is IR_FIXED.
+enum IrRelocation { IR_FIXED, IR_STATIC_ADDRESS, IR_INDEX_SLOT };
 
-// Stores the symbol table for the global scope
-extern SymbolTable globalSymbolTable;
+// Define data structure for an operand of an IR instruction
+struct IrOperand
+{
+	unsigned char kind; // IrOperandKind
+	unsigned char type; // IrType, or IrLabelKind for a label
+	unsigned char relocation; // IrRelocation
+	int base; // Register holding the base address of a memory operand (IR_NO_BASE for none), or the name of a label
+	
+	union
+	{
+		int value; // Register number, address (offset from the base), integer or character constant, or number of a label
+		float floatValue; // Float constant
+	};
+};
+
+// Define data structure for an IR instruction
+struct IrInstruction
+{
+	unsigned char opcode; // IrOpcode
+	bool blankLine; // Set to leave a blank line after the instruction's C, between the statements of the program
+	IrOperand result;
+	IrOperand left;
+	IrOperand right;
+	IrInstruction* next; // Next instruction of the basic block
+};
+
+// Define data structure for a basic block: instructions that run one after the other, the last of them the only one that can
+// go somewhere else. A block starts at a label, or after an instruction that ends a block.
+struct IrBlock
+{
+	IrInstruction* first; // A labeled block starts with its IR_LABEL
+	IrInstruction* last;
+	IrBlock* next; // Next block in the layout of the program
+};
 
-// Stores the chain of local symbol tables
-// The 0th element is for the main program block, so this vector will always have at least one element
-extern vector<SymbolTable> localSymbolTable;
+// Define data structure for the IR of the program being compiled
+// Instructions and blocks are allocated from an arena of IR_CHUNK_SIZE byte chunks, and all of them are freed at once
+// by resetIr(). The chunks are kept for the next program, and given back with the IrProgram.
+struct IrProgram
+{
+	vector<char*> chunks;
+	int chunkCount; // Number of chunks in use
+	size_t chunkUsed; // Bytes used of the last chunk in use
+	IrBlock* firstBlock;
+	IrBlock* lastBlock;
+	int blockCount;
+	int instructionCount;
+	
+	IrProgram( void ) : chunkCount( 0 ), chunkUsed( IR_CHUNK_SIZE ), firstBlock( NULL ), lastBlock( NULL ), blockCount( 0 ), instructionCount( 0 )
+	{
+	}
+	
+	~IrProgram( void )
+	{
+		for( size_t i = 0; i < chunks.size(); i++ )
+		{
+			delete[] chunks[i];
+		}
+	}
+	
+	private:
+		// The chunks belong to one IrProgram, so it can't be copied
+		IrProgram( const IrProgram& );
+		IrProgram& operator=( const IrProgram& );
+};
 
-// To keep track of the current scope of the parse
-// Scope -1 is global
-// Scope 0 is the main program block
-// This value increases by one every time the parse enters a procedure and subsequent nested procedures.
-// This value decreases by one every time the parse leaves a scope.
-extern int currentScope;
+// Define data structure for a place in the IR: the last instruction appended, and its block (both NULL before the first one)
+struct IrPosition
+{
+	IrBlock* block;
+	IrInstruction* instruction;
+};
 
-// File handler for the input file to be compiled
-extern ifstream inFile;
+// Define enumeration type to encapsulate the sections of the output files, in the order they are written out
+// The first four make up the C file (the declarations and start of main(), the program, the setup of the string literals,
+// and the runtime functions). IR_SECTION is the file written for --emit-ir, and HEADER_SECTION the header of the C split with --split.
+enum OutputSection { PROLOGUE_SECTION, BODY_SECTION, LITERAL_SECTION, RUNTIME_SECTION, IR_SECTION, HEADER_SECTION, OUTPUT_SECTION_COUNT };
 
-// File handler for the output file of the compiler
-extern ofstream outFile;
+// The parts of a CompilerContext that belong to one file. Only that file knows what is in them.
+struct ScannerState; // Location: scanner.cpp
+struct ParserState; // Location: parser.cpp
+struct OutputState; // Location: output.cpp
+struct ProcedureCache; // Defined with the compile cache, below
+
+// Define data structure for everything one compile keeps track of
+// Every compile has a context of its own, and nothing else the compiler changes is shared, so any number of compiles can run
+// at once on different threads. The compiler's functions work on the context of the thread they are called on (see context below).
+struct CompilerContext
+{
+	// To keep track of the scanner's current line number
+	int lineNumber;
+	
+	// To keep track of the number of warnings found
+	int warningCount;
+	
+	// To keep track of the number of errors found
+	int errorCount;
+	
+	// Stores every symbol of the compile, for the symbol tables to refer to
+	SymbolStore symbolStore;
+	
+	// Stores the symbol table for every scope
+	SymbolTable symbolTable;
+	
+	// To keep track of the current scope of the parse
+	// Scope -1 is global
+	// Scope 0 is the main program block
+	// This value increases by one every time the parse enters a procedure and subsequent nested procedures.
+	// This value decreases by one every time the parse leaves a scope.
+	int currentScope;
+	
+	// The IR of the program being compiled
+	IrProgram irProgram;
+	
+	// Where warnings and errors are reported
+	ostream* diagnostics;
+	
+	ScannerState* scanner;
+	ParserState* parser;
+	OutputState* output;
+	
+	// Location: compiler.cpp
+	CompilerContext( void );
+	~CompilerContext( void );
+	
+	private:
+		CompilerContext( const CompilerContext& );
+		CompilerContext& operator=( const CompilerContext& );
+};
+
+// Define data structure for the options of a compile with compile()
+struct CompileOptions
+{
+	int nestingLimit; // How deeply procedures, if statements and loops may be nested
+	bool emitIr; // Set to get the IR in readable form as well
+	ProcedureCache* procedures; // If set, top-level procedures that haven't changed since the last compile aren't compiled again
+	
+	CompileOptions( void ) : nestingLimit( NESTING_LIMIT ), emitIr( false ), procedures( NULL )
+	{
+	}
+};
+
+// Define data structure for the result of a compile with compile()
+struct CompileResult
+{
+	bool succeeded; // Set if there were no errors
+	string code; // The program as C, if it compiled
+	string ir; // The IR in readable form, if it compiled and CompileOptions::emitIr was set
+	string diagnostics; // The warnings and errors, one to a line, as the command line compiler prints them
+	int lineCount;
+	int warningCount;
+	int errorCount;
+};
+
+// Context of the compile running on this thread. main() and compile() set it, and so do the threads the scanner starts.
+extern thread_local CompilerContext* context;
+
+// Location: compiler.cpp
+// Compiles the program in the length bytes at source, on the calling thread, and returns the C and the diagnostics.
+// Compiles on different threads don't share anything, so they can run at the same time.
+// Call selectScanKernels() once before the first compile.
+extern CompileResult compile( const char* source, const size_t length, const CompileOptions& options );
+
+// Define data structure for the key of a cache entry, a 128-bit hash of everything that went into it (see cache.cpp)
+struct CacheKey
+{
+	unsigned long long hash[2];
+};
+
+// Define data structure for a top-level procedure of the program being compiled, as findTopProcedures() finds it before the parse
+struct ProcedureRegion
+{
+	int line; // Line of its "procedure", to check that the parser is at the procedure it thinks it is
+	CacheKey tokens; // Hash of the spellings of its tokens, from "procedure" to "end procedure"
+	vector<int> names; // Intern ids of the names and string literals in it, each once, in the order they first appear
+};
+
+// Define data structure for the code of a top-level procedure, kept from one compile to the next
+// It is the IR after the procedure's header. Labels refer to names by their index in the procedure's ProcedureRegion::names,
+// and static addresses and index slots are relative to where the procedure's started, so the code can be spliced into a compile
+// where the procedure's names have other intern ids and the procedures before it take more or less memory.
+struct ProcedureFragment
+{
+	CacheKey fingerprint; // Hash of the procedure's tokens and of everything outside it that they refer to (see procedureFingerprint())
+	int memoryUsed; // Static memory the procedure takes, its header's included
+	int slotsUsed; // Index slots it takes
+	unsigned int runtimeCalls; // Runtime functions it calls, a bit for each in the order the parser flags them
+	vector<IrInstruction> code;
+	vector<IrInstruction> setupCode; // Its part of the program setup code, which stores its string literals
+	vector<int> literals; // Name index and address of each string literal it adds to the symbol table, in pairs
+};
+
+// Define data structure for the top-level procedures of a program, from the compile before and for the compile after
+struct ProcedureCache
+{
+	vector<ProcedureFragment> fragments; // Kept from the last compile, in order of fingerprint
+	vector<ProcedureFragment> compiled; // Every top-level procedure of this compile that had no errors or warnings, in the order of the program
+	vector<ProcedureRegion> regions; // Top-level procedures of this compile, in the order of the program
+	int reusedCount; // Number of procedures taken from fragments
+	int compiledCount; // Number of procedures that weren't
+	
+	ProcedureCache( void ) : reusedCount( 0 ), compiledCount( 0 )
+	{
+	}
+};
+
+// Define data structure for a symbol copied out of the symbol store of one compile, to be declared in another's
+struct SymbolCopy
+{
+	SymbolRecord record;
+	DataType dataType;
+	int address;
+	int arraySize;
+	int parameterAddress; // The procedure columns, for a procedure
+	int localAddress;
+	int returnAddress;
+	int nestedNumber;
+	vector<DataType> parameterTypes;
+	vector<bool> parameterDirections;
+};
+
+// Define data structure for a top-level procedure whose code is generated on a worker thread, with --jobs (see parallel.cpp)
+// The parse of the program only reads the procedure's header. It skims the rest, taking the static memory and string literals
+// the procedure takes, and hands the procedure's tokens to a worker. The worker's code is spliced in where the header's ends.
+struct ProcedureJob
+{
+	vector<TokenFrame> tokens; // Its tokens as the scanner gave them, from "global" or "procedure" up to the token after its "end procedure"
+	vector<SymbolCopy> symbols; // The global symbols and the symbols of the program's own scope its names refer to when it starts
+	int memoryStart; // Static memory the procedure starts at and, as the skim found, ends at
+	int memoryEnd;
+	vector<int> literals; // Intern id and address of each string literal the skim declared for it, in pairs
+	int slotStart; // Index slot the parse was at when it started. The worker counts the procedure's index slots from 0.
+	IrPosition codeStart; // Last instruction of its header in the program's IR
+	size_t literalStart; // Its first instruction in the program's string literal storage
+	bool compiled; // Set by the worker if the procedure compiled without a diagnostic, the way the skim expected
+	ProcedureFragment fragment; // Its code and literal storage, as the worker generated it. Intern ids are the program's.
+};
+
+// The workers of a compile with --jobs and the jobs handed to them. Only parallel.cpp knows what is in it.
+struct ProcedureJobs;
+
+// Define data structure for the start of a request to the compile server (see server.cpp)
+// The source follows it, sourceLength bytes. Requests and replies only go between processes on one machine, so they are in its byte order.
+struct ServerRequestHeader
+{
+	unsigned int magic; // SERVER_REQUEST_MAGIC
+	int nestingLimit;
+	unsigned int emitIr;
+	unsigned int reserved;
+	unsigned long long sourceLength; // At most SERVER_SOURCE_LIMIT
+};
+
+// Define data structure for the start of a reply from the compile server
+// The C, the IR and the diagnostics follow it, in that order.
+struct ServerReplyHeader
+{
+	unsigned int magic; // SERVER_REPLY_MAGIC
+	unsigned int succeeded;
+	int lineCount;
+	int warningCount;
+	int errorCount;
+	unsigned int reserved;
+	unsigned long long codeLength;
+	unsigned long long irLength;
+	unsigned long long diagnosticsLength;
+};
+
+// Location: compiler.cpp
+// Compiles the program in a context kept from one compile to the next (one per thread), so its buffers and tables are already made.
+// Nothing of one compile is left in the context for the next.
+extern CompileResult compile( CompilerContext& compilerContext, const char* source, const size_t length, const CompileOptions& options );
 
 // Location: compiler.cpp
 // This function adds an entry to the symbol table with the specified token type
-extern void addSymbolEntry( Token* newToken );
+extern void addSymbolEntry( const int newSymbol );
 
 // Location: compiler.cpp
 // This function searches the symbol table for the specified entry.
 // If the entry modifies the token passed with the token's type (IDENTIFIER or RESERVE)
-// It also provides the data type of the token was already used in a declaration
+// It also gives the token its symbol table entry, so the parser doesn't have to look the name up again
 extern void findSymbolEntry( TokenFrame& newToken );
 
 // Location: compiler.cpp
-// Reports warnings by printing line number and message to stderr
+// Returns the innermost symbol with the specified intern id that was declared in a procedure enclosing the current scope,
+// or NO_SYMBOL if there isn't one. Such a symbol can't be referred to from the current scope.
+extern int lookupEnclosingSymbol( const int nameID );
+
+// Location: compiler.cpp
+// Returns the global symbol with the specified intern id, or the one declared in the current scope, or NO_SYMBOL if there isn't one
+extern int lookupGlobalSymbol( const int nameID );
+extern int lookupLocalSymbol( const int nameID );
+
+// Location: compiler.cpp
+// Declares the symbol under the name with the specified intern id in the global scope, replacing any global symbol already there
+extern void setGlobalSymbol( const int nameID, const int symbol );
+
+// Location: compiler.cpp
+// Declares the symbol under the name with the specified intern id in the current scope, replacing any symbol it already has there
+extern void setLocalSymbol( const int nameID, const int symbol );
+
+// Location: compiler.cpp
+// Declares the symbol under the name with the specified intern id in the scope that encloses the current one
+// A procedure is declared this way once its header has been read, so that the scope it was declared in can call it.
+extern void setEnclosingSymbol( const int nameID, const int symbol );
+
+// Location: compiler.cpp
+// Enters a new scope, one deeper than the current scope
+extern void enterScope( void );
+
+// Location: compiler.cpp
+// Leaves the current scope, putting back the symbols its declarations shadowed
+extern void leaveScope( void );
+
+// Location: compiler.cpp
+// Empties the symbol store and the symbol table, which leaves the parse in the main program block
+extern void resetSymbolStore( void );
+
+// Location: compiler.cpp
+// Adds a name with nothing more to it (the program name) to the symbol store and returns its id
+extern int newNameSymbol( const TokenType newTokenType, const int newNameID, const bool newGlobal );
+
+// Location: compiler.cpp
+// Adds a variable to the symbol store and returns its id
+extern int newVariableSymbol( const TokenType newTokenType, const int newNameID, const DataType newDataType, const bool newGlobal, const int newAddress, const bool newParameter );
+
+// Location: compiler.cpp
+// Adds an array to the symbol store and returns its id
+extern int newArraySymbol( const TokenType newTokenType, const int newNameID, const DataType newDataType, const int newArraySize, const bool newGlobal, const int newAddress, const bool newParameter );
+
+// Location: compiler.cpp
+// Adds a procedure, with an empty parameter list, to the symbol store and returns its id
+extern int newProcedureSymbol( const TokenType newTokenType, const int newNameID, const bool newGlobal );
+
+// Location: compiler.cpp
+// Adds a parameter of the specified data type to the end of the procedure's parameter list.
+// Parameters have to be added to a procedure before the next procedure is added to the store.
+extern void addParameter( const int procedure, const DataType newDataType );
+
+// Location: compiler.cpp
+// Adds a direction (true = in, false = out) to the end of the procedure's list of parameter directions
+extern void addDirection( const int procedure, const bool newDirection );
+
+// Location: compiler.cpp
+// Copies everything about a symbol out of the symbol store, and declares a copy from another compile's store
+// in the current scope (or globally, if it is global). declareSymbolCopy() returns the id of the new symbol.
+extern void copySymbol( const int symbol, SymbolCopy& copy );
+extern int declareSymbolCopy( const SymbolCopy& copy );
+
+// Accessors for symbols. The symbol must be one of the kinds that has the fact asked for.
+inline SymbolKind symbolKind( const int symbol )
+{
+	return context->symbolStore.records[symbol].kind;
+}
+
+inline const string& symbolName( const int symbol )
+{
+	return internedName( context->symbolStore.records[symbol].nameID );
+}
+
+// Returns the intern id of the symbol's name
+inline int symbolNameID( const int symbol )
+{
+	return context->symbolStore.records[symbol].nameID;
+}
+
+inline bool symbolGlobal( const int symbol )
+{
+	return context->symbolStore.records[symbol].isGlobal;
+}
+
+// Tells whether the symbol is a variable or an array
+inline bool isVariableSymbol( const int symbol )
+{
+	return context->symbolStore.records[symbol].kind == VARIABLE_SYMBOL || context->symbolStore.records[symbol].kind == ARRAY_SYMBOL;
+}
+
+inline bool symbolParameter( const int variable )
+{
+	return context->symbolStore.records[variable].isParameter;
+}
+
+inline DataType symbolDataType( const int variable )
+{
+	return context->symbolStore.dataTypes[variable];
+}
+
+inline int symbolAddress( const int variable )
+{
+	return context->symbolStore.addresses[variable];
+}
+
+// Returns the number of parameters in the procedure's parameter list
+inline int parameterCount( const int procedure )
+{
+	return context->symbolStore.parameterCounts[context->symbolStore.records[procedure].procedure];
+}
+
+// Returns the type of the specified parameter of the procedure. The first one is numbered at 0.
+inline DataType parameterType( const int procedure, const int n )
+{
+	int index = context->symbolStore.records[procedure].procedure;
+	
+	if( n >= 0 && n < context->symbolStore.parameterCounts[index] )
+	{
+		return context->symbolStore.parameterTypes[context->symbolStore.firstParameters[index] + n];
+	}
+	else
+	{
+		return INVALID;
+	}
+}
+
+// Returns the direction of the specified parameter of the procedure. The first one is numbered at 0.
+inline bool parameterDirection( const int procedure, const int n )
+{
+	int index = context->symbolStore.records[procedure].procedure;
+	
+	if( n >= 0 && n < context->symbolStore.directionCounts[index] )
+	{
+		return context->symbolStore.parameterDirections[context->symbolStore.firstDirections[index] + n];
+	}
+	else
+	{
+		return true;
+	}
+}
+
+// Returns the next available parameter address of the procedure (as a reference, so it can be advanced)
+inline int& parameterAddress( const int procedure )
+{
+	return context->symbolStore.parameterAddresses[context->symbolStore.records[procedure].procedure];
+}
+
+// Returns the next available local scope address of the procedure (as a reference, so it can be advanced)
+inline int& localAddress( const int procedure )
+{
+	return context->symbolStore.localAddresses[context->symbolStore.records[procedure].procedure];
+}
+
+// Returns the next available return address of the procedure (as a reference, so it can be advanced)
+inline int& returnAddress( const int procedure )
+{
+	return context->symbolStore.returnAddresses[context->symbolStore.records[procedure].procedure];
+}
+
+// Returns the number of the procedure among those in its top-level procedure (as a reference, so it can be set), or -1 for a top-level one
+inline int& nestedNumber( const int procedure )
+{
+	return context->symbolStore.nestedNumbers[context->symbolStore.records[procedure].procedure];
+}
+
+// Location: compiler.cpp
+// Reports warnings by printing line number and message to the context's diagnostics
 extern void reportWarning( const string& message );
 
 // Location: compiler.cpp
-// Reports errors by printing line number and message to stderr
+// Reports errors by printing line number and message to the context's diagnostics
 extern void reportError( const string& message );
 
 // Location: scanner.cpp
-// This function initializes global counters and sets up file I/O for the scanner
-extern void initializeScanner( const char* inputFile );
+// Makes and frees the scanner's part of a CompilerContext
+extern ScannerState* newScannerState( void );
+extern void deleteScannerState( ScannerState* state );
+
+// Location: scanner.cpp
+// This function initializes the context's counters and sets up file I/O for the scanner
+// Returns false if the input file could not be opened
+extern bool initializeScanner( const char* inputFile );
+
+// Location: scanner.cpp
+// Sets the scanner up like initializeScanner() does, to scan the length bytes at source instead of a file.
+// The source has to stay where it is until the scanner is closed.
+extern void initializeScannerSource( const char* source, const size_t length );
+
+// Location: scanner.cpp
+// Sets the scanner up to hand out the tokens of a --jobs worker's procedure, which were scanned by the compile in owner
+// and refer to spellings in its intern pool. An end-of-input token follows the last of them.
+// The tokens and the owner's intern pool have to stay where they are until the scanner is initialized again.
+extern void initializeScannerTokens( const vector<TokenFrame>& tokens, const CompilerContext& owner );
+
+// Location: scanner.cpp
+// Tells whether the whole input is in memory (a mapped file or a source), so it can be scanned again
+extern bool mappedInput( void );
+
+// Location: scanner.cpp
+// This function tells whether the scanner has not yet run into the end of the input file
+// (as of the last token the parser has taken)
+extern bool moreInput( void );
+
+// Location: scanner.cpp
+// This function stops the scanner thread, releases the input buffer and closes the input file
+extern void closeScanner( void );
 
 // Location: scanner.cpp
 // This function retrieves the next token from the input file ( already open by initializeScanner() ) and returns it to the calling function
+// Names that aren't reserved words come back with type NONE. They are looked up in the symbol table when the parser takes them.
 extern TokenFrame getToken( void );
 
+// Location: scanner.cpp
+// Starts a second thread that scans ahead of the parser. Called after initializeScanner() for --pipeline.
+extern void startPipeline( void );
+
+// Location: scanner.cpp
+// Scans the rest of the input in chunks, in parallel, with the specified number of threads (0 for one per core).
+// Called after initializeScanner() for --parallel. Returns false, leaving the scanner as it was, if the input isn't memory-mapped.
+extern bool startParallelScan( const int threads );
+
+// Location: scanner.cpp
+// Returns the token distance tokens ahead of the parser's current token (distance 0 is the current token itself).
+// Tokens are scanned only when first asked for, and distance must be less than LOOKAHEAD_SIZE.
+// The reference stays valid until the token has been consumed and LOOKAHEAD_SIZE more tokens have been read.
+extern TokenFrame& lookaheadToken( const int distance );
+
+// Location: scanner.cpp
+// Moves the parser on to the next token in the lookahead ring
+extern void consumeToken( void );
+
+// Location: scanner.cpp
+// Scans text into the buffer, replacing whatever the buffer held.
+// Spellings of the tokens are interned, so they stay valid until the scanner is initialized again.
+extern void scanBuffer( ScannedBuffer& buffer, const string& text );
+
+// Location: scanner.cpp
+// Replaces removedLength bytes of the buffer's text at offset with insertedText, and scans again only the tokens the edit can have changed.
+// Returns the number of entries that were scanned again, or -1 (leaving the buffer alone) if the edit doesn't fit in the text.
+extern int editBuffer( ScannedBuffer& buffer, const int offset, const int removedLength, const string& insertedText );
+
+// Location: scanner.cpp
+// Returns the number of entries (tokens and warnings, ending with the end-of-input token) in the buffer
+extern int bufferEntryCount( const ScannedBuffer& buffer );
+
+// Location: scanner.cpp
+// Returns the entry with the specified index in the buffer, with its real offsets and line
+extern BufferEntry bufferEntry( const ScannedBuffer& buffer, const int index );
+
 // Location: scanner.cpp
 // This function determines the character class of the specified character
 extern CharacterClass getCharacterClass( const char& ch );
 
+// Location: kernels.cpp
+// Returns the first character at or after start that is not white space, counting the newlines skipped over
+extern const char* (*skipWhitespace)( const char* start, const char* end, int& newlines );
+
+// Location: kernels.cpp
+// Returns the first character at or after start that can't be part of an identifier (letters, digits and underscores)
+extern const char* (*scanIdentifier)( const char* start, const char* end );
+
+// Location: kernels.cpp
+// Returns the first character at or after start that can't be part of the digits of a number (digits and underscores)
+extern const char* (*scanDigits)( const char* start, const char* end );
+
+// Location: kernels.cpp
+// Returns the first newline at or after start, or end if there isn't one
+extern const char* (*findNewline)( const char* start, const char* end );
+
+// Location: kernels.cpp
+// This function points the scanner at the fastest kernels the processor supports.
+// The scalar kernels are used if forceScalar is set (for checking the vector kernels against them).
+extern ScanKernelSet selectScanKernels( const bool forceScalar );
+
+// Location: ir.cpp
+// Frees the IR of the last compile, so the parser can start building a new one
+extern void resetIr( void );
+
+// Location: ir.cpp
+// These functions make operands: a register, a memory frame at an offset from a base register (IR_NO_BASE for none),
+// constants, and a label. irNone is the operand an instruction doesn't use.
+extern IrOperand irRegister( const int number, const IrType type );
+extern IrOperand irMemory( const int base, const int offset, const IrType type );
+extern IrOperand irInteger( const int value );
+extern IrOperand irFloat( const float value );
+extern IrOperand irCharacter( const char value );
+extern IrOperand irLabel( const IrLabelKind kind, const int name, const int number );
+extern const IrOperand irNone;
+
+// Location: ir.cpp
+// These functions make operands whose values move with a procedure's memory when its code is kept (see IrRelocation):
+// memory at a static address (as an offset from a base register, or IR_NO_BASE for none), an index slot, and a static address as a constant
+extern IrOperand irStaticMemory( const int base, const int address, const IrType type );
+extern IrOperand irIndexSlot( const int slot );
+extern IrOperand irStaticAddress( const int address );
+
+// Location: ir.cpp
+// Makes an instruction, for holding on to until it is appended
+extern IrInstruction irInstruction( const IrOpcode opcode, const IrOperand& result, const IrOperand& left, const IrOperand& right = irNone );
+
+// Location: ir.cpp
+// Appends an instruction to the program, starting a new basic block if it is a label or the last instruction ended a block.
+// Returns the appended instruction.
+extern IrInstruction& irAppend( const IrInstruction& instruction );
+extern IrInstruction& irAppend( const IrOpcode opcode, const IrOperand& result, const IrOperand& left, const IrOperand& right = irNone );
+
+// Location: ir.cpp
+// Leaves a blank line after the C of the last instruction appended
+extern void irBlankLine( void );
+
+// Location: ir.cpp
+// Returns the position of the last instruction appended, and copies the instructions appended after a position
+extern IrPosition irPosition( void );
+extern void copyIr( const IrPosition& position, vector<IrInstruction>& instructions );
+
+// Location: ir.cpp
+// Inserts instructions after a position, in the basic blocks appending them there would have made.
+// Returns false (leaving the IR alone) if that would change the blocks of the instructions after the position.
+extern bool insertIr( const IrPosition& position, const vector<IrInstruction>& instructions );
+
+// Location: ir.cpp
+// Writes out the name of a label, as the C spells it
+extern void writeIrLabel( ostream& out, const IrOperand& label );
+
+// Location: ir.cpp
+// Returns a float constant written as a C literal
+extern string irFloatText( const float value );
+
+// Location: ir.cpp
+// Writes the IR out in a readable form (for --emit-ir)
+extern void dumpIr( ostream& out );
+
+// Location: emitter.cpp
+// Writes out the program as C, from its IR, to the sections of the C file
+extern void emitProgram( void );
+
+// Location: emitter.cpp
+// Writes out the program as C split into files that can be compiled separately (--split): each procedure becomes a function,
+// in one of at most fileCount parts, and the rest of the program stays in main(). The C file's sections get main() and the runtime,
+// HEADER_SECTION the header every file includes, and parts the text of each part. Returns false, writing nothing,
+// if the program's control flow can't be split into functions (then emitProgram() has to be used).
+extern bool emitSplitProgram( const int fileCount, vector<string>& parts );
+
+// Location: server.cpp
+// Serves compile requests on a Unix domain socket at socketPath until the process is stopped, with the specified number of threads
+// (0 for one per core), each taking one connection at a time. Returns the exit status if the socket couldn't be set up.
+extern int runServer( const char* socketPath, const int threads );
+
+// Location: cache.cpp
+// Hashes bytes to 128 bits, starting from seed
+extern CacheKey hashBytes( const char* data, const size_t length, const unsigned long long seed );
+
+// Location: cache.cpp
+// Starts using the cache in the specified directory, making the directory if it isn't there, with entries of at most sizeLimit bytes in all.
+// Returns false if the directory couldn't be made.
+extern bool openCache( const char* directory, const unsigned long long sizeLimit );
+
+// Location: cache.cpp
+// Tells whether a cache is in use
+extern bool cacheOpen( void );
+
+// Location: cache.cpp
+// Returns the key of a compile: the hash of the source, the compiler, the sizes of the runtime environment and the options
+extern CacheKey compileCacheKey( const char* source, const size_t length, const CompileOptions& options );
+
+// Location: cache.cpp
+// Returns the key of a file built from the specified inputs (for the executable: the C, runtime.c and the command that builds it)
+extern CacheKey fileCacheKey( const string& first, const string& second, const string& third );
+
+// Location: cache.cpp
+// Looks up the result of a compile. Returns false, and counts a miss, if it isn't in the cache.
+extern bool findCachedResult( const CacheKey& key, CompileResult& result );
+
+// Location: cache.cpp
+// Keeps the result of a successful compile in the cache
+extern void storeCachedResult( const CacheKey& key, const CompileResult& result );
+
+// Location: cache.cpp
+// Looks up a file built before and copies it to filename, with the specified permissions.
+// Returns false, and counts a miss, if it isn't in the cache or couldn't be copied.
+extern bool findCachedFile( const CacheKey& key, const char* filename, const int mode );
+
+// Location: cache.cpp
+// Keeps a copy of a file that was built in the cache
+extern void storeCachedFile( const CacheKey& key, const char* filename );
+
+// Location: cache.cpp
+// Returns the key of the procedures kept for a file: the hash of its name, the compiler, the sizes of the runtime environment and the options
+extern CacheKey procedureCacheKey( const char* filename, const CompileOptions& options );
+
+// Location: cache.cpp
+// Reads the procedures kept from the last compile of a file into the cache's fragments. Returns false if there weren't any.
+extern bool findCachedProcedures( const CacheKey& key, ProcedureCache& procedures );
+
+// Location: cache.cpp
+// Keeps the procedures of a compile for the next one, and counts how many of them were reused
+extern void storeCachedProcedures( const CacheKey& key, const ProcedureCache& procedures );
+
+// Location: cache.cpp
+// Prints the counts of hits, misses and evictions, and how much the cache holds
+extern void printCacheStatistics( ostream& out );
+
+// Location: procedures.cpp
+// Finds the top-level procedures of the program in the length bytes at source, and hashes their tokens.
+// The spellings are interned, so call this after the scanner is initialized.
+extern void findTopProcedures( const char* source, const size_t length, vector<ProcedureRegion>& regions );
+
+// Location: procedures.cpp
+// Returns the fingerprint of a top-level procedure that is about to be parsed, from its tokens and the symbols its names refer to
+extern CacheKey procedureFingerprint( const ProcedureRegion& region, const bool isGlobal );
+
+// Location: procedures.cpp
+// Returns the fragment with the specified fingerprint kept from the last compile, or NULL if there isn't one
+extern const ProcedureFragment* findFragment( const ProcedureCache& cache, const CacheKey& fingerprint );
+
+// Location: procedures.cpp
+// Makes the code of a procedure independent of where it was compiled, for keeping it, and fits kept code to the compile
+// where it is used. The procedure's static memory starts at memoryStart and its index slots at slotStart.
+// Each returns false if the fragment doesn't go with the region.
+extern bool packFragment( ProcedureFragment& fragment, const ProcedureRegion& region, const int memoryStart, const int slotStart );
+extern bool unpackFragment( ProcedureFragment& fragment, const ProcedureRegion& region, const int memoryStart, const int slotStart );
+
+// Location: output.cpp
+// Makes and frees the output's part of a CompilerContext
+extern OutputState* newOutputState( void );
+extern void deleteOutputState( OutputState* state );
+
+// Location: output.cpp
+// Returns the stream that writes to the specified section. Nothing is written to a file until writeOutput() is called.
+extern ostream& outputSection( const OutputSection section );
+
+// Location: output.cpp
+// Empties every section, for a new compile
+extern void resetOutput( void );
+
+// Location: output.cpp
+// Writes the sections from firstSection to lastSection, in order, to the specified file, replacing what the file held.
+// Returns false if the file couldn't be opened or written.
+extern bool writeOutput( const char* filename, const OutputSection firstSection, const OutputSection lastSection );
+
+// Location: output.cpp
+// Writes text to the specified file, replacing what the file held. Returns false if the file couldn't be opened or written.
+extern bool writeOutputText( const char* filename, const string& text );
+
+// Location: output.cpp
+// Copies the sections from firstSection to lastSection, in order, into text
+extern void copyOutput( string& text, const OutputSection firstSection, const OutputSection lastSection );
+
+// Location: parser.cpp
+// Makes and frees the parser's part of a CompilerContext
+extern ParserState* newParserState( void );
+extern void deleteParserState( ParserState* state );
+
 // Location: parser.cpp
 // This function begins parsing of the grammar/syntax with the first grammar rule
-extern void readProgram( void );
+// Procedures, if statements and loops may be nested at most newNestingLimit deep. If procedures is set, its regions have to have been found,
+// and top-level procedures that are in its fragments are taken from there instead of being parsed.
+// If jobs is set, the code of the top-level procedures is generated by its workers instead.
+extern void readProgram( const int newNestingLimit, ProcedureCache* procedures = NULL, ProcedureJobs* jobs = NULL );
+
+// Location: parser.cpp
+// Reads the top-level procedure of a --jobs worker, whose scanner hands out its tokens and whose symbol table holds the symbols
+// it can see from outside, and leaves the code after its header in the job's fragment
+extern void readJobProcedure( ProcedureJob& job, const int newNestingLimit );
+
+// Location: parallel.cpp
+// Reads the program with the code of its top-level procedures generated on worker threads, workerCount of them (0 for one per core)
+// counting the calling thread, or as many as make's jobserver has job slots for. The output is the same as readProgram()'s.
+// Returns false, and the compile has to be done again without workers, if it gave a diagnostic (which isn't reported)
+// or a procedure didn't compile the way the parse of the program expected.
+extern bool readProgramInParallel( const int newNestingLimit, const int workerCount );
+
+// Location: parallel.cpp
+// Hands a job to the workers, which own it from then on
+extern void addProcedureJob( ProcedureJobs* jobs, ProcedureJob* job );
+
+// Location: parallel.cpp
+// Works on the jobs no worker has taken yet and waits for the workers to finish the rest.
+// Returns true if every job compiled the way the parse expected. Calling it again returns the same.
+extern bool finishProcedureJobs( ProcedureJobs* jobs );
+
+// Location: parallel.cpp
+// Returns the number of jobs handed out, and the job with the specified index (in the order of the program)
+extern int procedureJobCount( const ProcedureJobs* jobs );
+extern ProcedureJob& procedureJob( ProcedureJobs* jobs, const int index );
 
 #endif
@@ -0,0 +1,164 @@
+// Filename: edittest.cpp
+// Author: Himanshu Narayana
+// This file checks the incremental re-scanning of edited buffers (editBuffer() in scanner.cpp) for make check. It scans random texts,
+// gives each one random edits, and after every edit compares the buffer with a fresh scanBuffer() of the edited text.
+
+#include "compiler.h"
+
+#include <random>
+
+using namespace std;
+
+static string randomText( mt19937& generator, const int pieces );
+static bool sameEntries( const ScannedBuffer& edited, const ScannedBuffer& scanned, string& difference );
+static string describeEntry( const BufferEntry& entry );
+
+// Pieces the random texts are made of, chosen to start and end every kind of token, comment and warning next to each other
+static const char* const textPieces[] =
+{
+	" ", "  ", "\t", "\n", "\r\n", "a", "x1", "name_", "Begin", "end", "if", "then", "procedure", "0", "12", "3_4", "5.", ".6", "1.5",
+	"99999999999", "\"", "\"text\"", "\"a b.c\"", "/", "//", "// note\n", ":", ":=", "=", "<", "<=", ">", "!=", "!", ";", ",", "(", ")",
+	"+", "-", "*", "&", "|", "[", "]", "@", "#", "\xe9", "_"
+};
+static const int textPieceCount = sizeof( textPieces ) / sizeof( textPieces[0] );
+
+int main( int argc, char** argv )
+{
+	int texts = 1000; // Set by --texts to the number of random texts
+	int edits = 30; // Set by --edits to the number of edits given to each text
+	unsigned int seed = 1; // Set by --seed to start the random texts somewhere else
+	CompilerContext testContext;
+	ostream discarded( NULL );
+	long long rescanned = 0;
+	int argument = 1;
+	
+	context = &testContext;
+	testContext.diagnostics = &discarded;
+	
+	// Read the command line options
+	while( argument < argc )
+	{
+		if( strncmp( argv[argument], "--texts=", 8 ) == 0 && atoi( argv[argument] + 8 ) > 0 )
+		{
+			texts = atoi( argv[argument] + 8 );
+		}
+		else if( strncmp( argv[argument], "--edits=", 8 ) == 0 && atoi( argv[argument] + 8 ) > 0 )
+		{
+			edits = atoi( argv[argument] + 8 );
+		}
+		else if( strncmp( argv[argument], "--seed=", 7 ) == 0 )
+		{
+			seed = strtoul( argv[argument] + 7, NULL, 10 );
+		}
+		else
+		{
+			cerr << "Usage: " << argv[0] << " [--texts=count] [--edits=count] [--seed=number]" << endl;
+			return 1;
+		}
+		
+		argument++;
+	}
+	
+	mt19937 generator( seed );
+	
+	for( int text = 0; text < texts; text++ )
+	{
+		ScannedBuffer edited;
+		ScannedBuffer scanned;
+		string expected = randomText( generator, generator() % 60 );
+		string difference;
+		
+		// Start each text with a fresh intern pool, so the pool doesn't fill up
+		initializeScannerSource( "", 0 );
+		scanBuffer( edited, expected );
+		
+		for( int edit = 0; edit < edits; edit++ )
+		{
+			const int offset = generator() % ( expected.size() + 1 );
+			const int removedLength = generator() % ( min<int>( expected.size() - offset, 12 ) + 1 );
+			const string inserted = randomText( generator, generator() % 4 );
+			const string before = expected;
+			int scannedAgain;
+			
+			expected.replace( offset, removedLength, inserted );
+			scannedAgain = editBuffer( edited, offset, removedLength, inserted );
+			scanBuffer( scanned, expected );
+			
+			if( scannedAgain < 0 || edited.text != expected || sameEntries( edited, scanned, difference ) == false )
+			{
+				cerr << "Text " << text << ", edit " << edit << ": replacing " << removedLength << " bytes at " << offset << " with \"" << inserted << "\"" << endl;
+				cerr << "in \"" << before << "\"" << endl;
+				cerr << ( scannedAgain < 0 ? "The edit was refused." : difference ) << endl;
+				return 1;
+			}
+			
+			rescanned += scannedAgain;
+		}
+	}
+	
+	closeScanner();
+	cout << texts << " texts with " << edits << " edits each scanned the same as from scratch (" << rescanned << " entries scanned again)" << endl;
+	
+	return 0;
+}
+
+// Returns a text made of the specified number of random pieces
+string randomText( mt19937& generator, const int pieces )
+{
+	string text;
+	
+	for( int i = 0; i < pieces; i++ )
+	{
+		text += textPieces[generator() % textPieceCount];
+	}
+	
+	return text;
+}
+
+// Tells whether two buffers have the same entries. If they don't, difference says where.
+bool sameEntries( const ScannedBuffer& edited, const ScannedBuffer& scanned, string& difference )
+{
+	const int count = max( bufferEntryCount( edited ), bufferEntryCount( scanned ) );
+	
+	for( int i = 0; i < count; i++ )
+	{
+		string editedEntry = ( i < bufferEntryCount( edited ) ) ? describeEntry( bufferEntry( edited, i ) ) : "nothing";
+		string scannedEntry = ( i < bufferEntryCount( scanned ) ) ? describeEntry( bufferEntry( scanned, i ) ) : "nothing";
+		
+		if( editedEntry != scannedEntry )
+		{
+			difference = "Entry " + to_string( i ) + " is " + editedEntry + " after the edit, but " + scannedEntry + " scanned from scratch";
+			return false;
+		}
+	}
+	
+	return true;
+}
+
+// Returns everything about an entry that has to be the same however it was scanned
+string describeEntry( const BufferEntry& entry )
+{
+	ostringstream text;
+	
+	text << "[" << entry.start << ", " << entry.end << ") line " << entry.token.line;
+	
+	if( entry.warning != NULL )
+	{
+		text << " warning \"" << entry.warning << "\"";
+	}
+	else
+	{
+		text << " type " << entry.token.tokenType << " kind " << entry.token.kind << " \"" << entry.token.getName() << "\"";
+		
+		if( entry.token.numberType == INTEGER )
+		{
+			text << " = " << entry.token.intValue;
+		}
+		else if( entry.token.numberType == FLOAT )
+		{
+			text << " = " << entry.token.floatValue;
+		}
+	}
+	
+	return text.str();
+}
@@ -0,0 +1,593 @@
+// Filename: emitter.cpp
+// Author: Himanshu Narayana
+// This file is the code generator's back end. It lowers the IR the parser built (see ir.cpp) to C for the runtime environment:
+// registers R[], main memory MM[] with the stack at the top of it (R[0] is the stack pointer), and computed gotos for returns.
+// With --split, each procedure becomes a function of its own instead, and calls and returns are C's.
+
+#include "compiler.h"
+
+#include <set>
+
+using namespace std;
+
+static void emitPrologue( ostream& out );
+static void emitDeclarations( ostream& out, const bool shared );
+static void emitInstruction( ostream& out, const IrInstruction& instruction );
+static void emitOperand( ostream& out, const IrOperand& operand );
+static void emitRuntime( ostream& out );
+static bool splitFits( const vector<IrBlock*>& blocks, const vector<int>& functions, const vector<string>& names );
+static bool endsFunction( const int opcode );
+static void emitSplitHeader( ostream& out, const vector<string>& names );
+static void emitSplitInstruction( ostream& out, const IrInstruction& instruction );
+static void emitSplitRuntime( ostream& out );
+static string labelText( const IrOperand& label );
+
+// C operators of the binary operations, in the order of IrOpcode from IR_ADD
+static const char* const operatorTexts[] = { "+", "-", "*", "/", "&", "|", "<", "<=", ">", ">=", "!=" };
+
+// Fields of a MemoryFrame, in the order of IrType
+static const char* const fieldTexts[] = { "", ".intVal", ".floatVal", ".charVal", ".stringPointer", ".jumpTarget" };
+
+// The runtime functions the program calls like procedures, and the C that calls each one with its argument on the stack
+static const int runtimeCount = 8;
+static const char* const runtimeEntries[runtimeCount][2] =
+{
+	{ "getBool", "MM[R[0].intVal].intVal = getBool();" },
+	{ "getInteger", "MM[R[0].intVal].intVal = getInteger();" },
+	{ "getFloat", "MM[R[0].intVal].floatVal = getFloat();" },
+	{ "getString", "MM[R[0].intVal].stringPointer = getString();" },
+	{ "putBool", "putBool( MM[R[0].intVal].intVal );" },
+	{ "putInteger", "putInteger( MM[R[0].intVal].intVal );" },
+	{ "putFloat", "putFloat( MM[R[0].intVal].floatVal );" },
+	{ "putString", "putString( MM[R[0].intVal].stringPointer );" }
+};
+
+// Writes out the program as C, from its IR, to the sections of the C file.
+// The blocks from the program setup on (the setup of the string literals) go in a section of their own.
+void emitProgram( void )
+{
+	OutputSection section = BODY_SECTION;
+	
+	emitPrologue( outputSection( PROLOGUE_SECTION ) );
+	
+	for( IrBlock* block = context->irProgram.firstBlock; block != NULL; block = block->next )
+	{
+		if( block->first->opcode == IR_LABEL && block->first->left.type == PROGRAM_SETUP_LABEL )
+		{
+			section = LITERAL_SECTION;
+		}
+		
+		for( IrInstruction* instruction = block->first; instruction != NULL; instruction = instruction->next )
+		{
+			emitInstruction( outputSection( section ), *instruction );
+		}
+	}
+	
+	emitRuntime( outputSection( RUNTIME_SECTION ) );
+}
+
+// Writes out the declarations of the runtime environment and the start of main()
+void emitPrologue( ostream& out )
+{
+	emitDeclarations( out, false );
+	out << "int main( int argc, char** argv )" << endl;
+	out << "{" << endl;
+}
+
+// Writes out the declarations of the memory frame, the registers and memory, and the runtime functions.
+// With shared set, the registers and memory are declared for the files of --split to share, and there is no jump register.
+void emitDeclarations( ostream& out, const bool shared )
+{
+	const char* storage = shared ? "extern" : "static";
+	
+	out << "typedef union" << endl;
+	out << "{" << endl;
+	out << "\tchar charVal;" << endl;
+	out << "\tint intVal;" << endl;
+	out << "\tfloat floatVal;" << endl;
+	out << "\tint stringPointer;" << endl;
+	out << "\tvoid* jumpTarget;" << endl;
+	out << "} MemoryFrame;" << endl;
+	out << endl;
+	out << storage << " MemoryFrame R[" << REGISTER_SIZE << "];" << endl;
+	out << storage << " MemoryFrame MM[" << MEMORY_SIZE << "];" << endl;
+	
+	if( shared == false )
+	{
+		out << "static void* jumpRegister;" << endl;
+	}
+	
+	out << endl;
+	out << "int getBool( void );" << endl;
+	out << "int getInteger( void );" << endl;
+	out << "float getFloat( void );" << endl;
+	out << "int getString( void );" << endl;
+	out << "int putBool( int oldBool );" << endl;
+	out << "int putInteger( int oldInteger );" << endl;
+	out << "int putFloat( float oldFloat );" << endl;
+	out << "int putString( int oldString );" << endl;
+	out << endl;
+}
+
+void emitInstruction( ostream& out, const IrInstruction& instruction )
+{
+	switch( instruction.opcode )
+	{
+		case IR_LABEL:
+			out << "\t";
+			writeIrLabel( out, instruction.left );
+			out << ":" << endl;
+			break;
+		
+		case IR_MOVE:
+			out << "\t";
+			emitOperand( out, instruction.result );
+			out << " = ";
+			emitOperand( out, instruction.left );
+			out << ";" << endl;
+			break;
+		
+		case IR_NEGATE:
+			out << "\t";
+			emitOperand( out, instruction.result );
+			out << " = -1 * ";
+			emitOperand( out, instruction.left );
+			out << ";" << endl;
+			break;
+		
+		case IR_NOT:
+			out << "\t";
+			emitOperand( out, instruction.result );
+			out << " = !";
+			emitOperand( out, instruction.left );
+			out << ";" << endl;
+			break;
+		
+		case IR_CHECK_BOOL:
+			// Written out as it always has been. It doesn't name the register, and its labels are the same every time.
+			out << "\tif( R[resultRegister] != 0 ) goto secondcheck;" << endl;
+			out << "\tgoto endcheck;" << endl;
+			out << "\tsecondcheck:" << endl;
+			out << "\tif( R[resultRegister] != 1 ) goto runtimeerror;" << endl;
+			out << "endcheck:" << endl;
+			break;
+		
+		case IR_JUMP:
+			out << "\tgoto ";
+			writeIrLabel( out, instruction.left );
+			out << ";" << endl;
+			break;
+		
+		case IR_BRANCH:
+			out << "\tif( ";
+			emitOperand( out, instruction.left );
+			out << " == 1 ) goto ";
+			writeIrLabel( out, instruction.right );
+			out << ";" << endl;
+			out << "\tgoto ";
+			writeIrLabel( out, instruction.result );
+			out << ";" << endl;
+			break;
+		
+		case IR_CALL:
+			// Push the return address, then make room for the parameters
+			out << "\tR[0].intVal = R[0].intVal - 1;" << endl;
+			out << "\tMM[R[0].intVal].jumpTarget = &&";
+			writeIrLabel( out, instruction.result );
+			out << ";" << endl;
+			out << "\tR[0].intVal = R[0].intVal - " << instruction.right.value << ";" << endl;
+			out << "\tgoto ";
+			writeIrLabel( out, instruction.left );
+			out << ";" << endl;
+			break;
+		
+		case IR_RETURN:
+			out << "\tjumpRegister = ";
+			emitOperand( out, instruction.left );
+			out << ";" << endl;
+			out << "\tgoto *jumpRegister;" << endl;
+			break;
+		
+		case IR_EXIT:
+			out << "\treturn 0;" << endl;
+			break;
+		
+		default: // A binary operation
+			out << "\t";
+			emitOperand( out, instruction.result );
+			out << " = ";
+			emitOperand( out, instruction.left );
+			out << " " << operatorTexts[instruction.opcode - IR_ADD] << " ";
+			emitOperand( out, instruction.right );
+			out << ";" << endl;
+			break;
+	}
+	
+	if( instruction.blankLine )
+	{
+		out << endl;
+	}
+}
+
+void emitOperand( ostream& out, const IrOperand& operand )
+{
+	switch( operand.kind )
+	{
+		case IR_REGISTER:
+			out << "R[" << operand.value << "]" << fieldTexts[operand.type];
+			break;
+		
+		case IR_MEMORY:
+			if( operand.base == IR_NO_BASE )
+			{
+				out << "MM[" << operand.value << "]";
+			}
+			else
+			{
+				out << "MM[R[" << operand.base << "].intVal + " << operand.value << "]";
+			}
+			
+			out << fieldTexts[operand.type];
+			break;
+		
+		case IR_CONSTANT:
+			if( operand.type == IR_FLOAT )
+			{
+				out << irFloatText( operand.floatValue );
+			}
+			else if( operand.type == IR_CHARACTER )
+			{
+				switch( operand.value )
+				{
+					case '\'':
+						out << "\'\\\'\'";
+						break;
+					
+					case '\"':
+						out << "\'\\\"\'";
+						break;
+					
+					case '\0':
+						out << "\'\\0\'";
+						break;
+					
+					default:
+						out << "\'" << static_cast<char>( operand.value ) << "\'";
+						break;
+				}
+			}
+			else
+			{
+				out << operand.value;
+			}
+			break;
+		
+		case IR_LABEL_OPERAND:
+			// The address of a label, for a return address
+			out << "&&";
+			writeIrLabel( out, operand );
+			break;
+	}
+}
+
+// Writes out the runtime functions for the program to call, and the end of main()
+void emitRuntime( ostream& out )
+{
+	for( int i = 0; i < runtimeCount; i++ )
+	{
+		out << "\t" << runtimeEntries[i][0] << "_start:" << endl;
+		out << "\t" << runtimeEntries[i][1] << endl;
+		out << "\tjumpRegister = MM[R[0].intVal + 1].jumpTarget;" << endl;
+		out << "\tgoto *jumpRegister;" << endl << endl;
+	}
+	
+	out << "\truntimeerror:" << endl;
+	out << "\tputString( 0 );" << endl;
+	
+	out << "}" << endl << endl;
+	
+	out << "#include \"runtime.c\"" << endl;
+	out << endl;
+}
+
+// Writes out the program as C split into functions. The blocks of each procedure, from its start label up to the next procedure's
+// (or the program body), make up its function: a procedure nested in another one comes between the start of the other one and its body,
+// so the body of the outer procedure goes with the last procedure nested in it, as the goto C runs it. The functions are put
+// in the parts in order, the parts taking about the same number of instructions.
+bool emitSplitProgram( const int fileCount, vector<string>& parts )
+{
+	vector<IrBlock*> blocks;
+	vector<int> functions; // Function each block is in: 0 for main(), and the procedures' from 1 on
+	vector<string> names; // Name of each procedure's function, which is its start label
+	vector<size_t> sizes; // Instructions in each procedure's function
+	OutputSection section = BODY_SECTION;
+	ostringstream part;
+	size_t partSize = 0; // Instructions in the part being written
+	size_t sizeLeft = 0; // Instructions in the functions not yet in a finished part
+	int partsLeft = max( fileCount, 1 );
+	int function = 0;
+	bool inBody = false; // Set once the program body has started
+	
+	for( IrBlock* block = context->irProgram.firstBlock; block != NULL; block = block->next )
+	{
+		if( block->first->opcode == IR_LABEL && block->first->left.type == PROGRAM_BODY_LABEL )
+		{
+			inBody = true;
+			function = 0;
+		}
+		else if( inBody == false && block->first->opcode == IR_LABEL && ( block->first->left.type == PROCEDURE_START_LABEL || block->first->left.type == NESTED_START_LABEL ) )
+		{
+			names.push_back( labelText( block->first->left ) );
+			sizes.push_back( 0 );
+			function = names.size();
+		}
+		
+		blocks.push_back( block );
+		functions.push_back( function );
+		
+		for( IrInstruction* instruction = block->first; instruction != NULL && function > 0; instruction = instruction->next )
+		{
+			sizes[function - 1]++;
+			sizeLeft++;
+		}
+	}
+	
+	if( inBody == false || splitFits( blocks, functions, names ) == false )
+	{
+		return false;
+	}
+	
+	// The header, and the C file with main() and the runtime
+	emitSplitHeader( outputSection( HEADER_SECTION ), names );
+	
+	outputSection( PROLOGUE_SECTION ) << "#include \"narcomp_output.h\"" << endl << endl;
+	outputSection( PROLOGUE_SECTION ) << "MemoryFrame R[" << REGISTER_SIZE << "];" << endl;
+	outputSection( PROLOGUE_SECTION ) << "MemoryFrame MM[" << MEMORY_SIZE << "];" << endl << endl;
+	outputSection( PROLOGUE_SECTION ) << "int main( int argc, char** argv )" << endl;
+	outputSection( PROLOGUE_SECTION ) << "{" << endl;
+	
+	for( size_t i = 0; i < blocks.size(); i++ )
+	{
+		if( functions[i] != 0 )
+		{
+			continue;
+		}
+		
+		if( blocks[i]->first->opcode == IR_LABEL && blocks[i]->first->left.type == PROGRAM_SETUP_LABEL )
+		{
+			section = LITERAL_SECTION;
+		}
+		
+		for( IrInstruction* instruction = blocks[i]->first; instruction != NULL; instruction = instruction->next )
+		{
+			emitSplitInstruction( outputSection( section ), *instruction );
+		}
+	}
+	
+	emitSplitRuntime( outputSection( RUNTIME_SECTION ) );
+	
+	// The procedures' functions
+	parts.clear();
+	
+	for( size_t i = 0; i < blocks.size(); i++ )
+	{
+		function = functions[i];
+		
+		if( function == 0 )
+		{
+			continue;
+		}
+		
+		if( i == 0 || functions[i - 1] != function )
+		{
+			// Start the next part once this one has its share of what is left
+			if( partSize > 0 && partSize * partsLeft >= sizeLeft )
+			{
+				parts.push_back( part.str() );
+				part.str( "" );
+				sizeLeft -= partSize;
+				partSize = 0;
+				partsLeft--;
+			}
+			
+			if( partSize == 0 )
+			{
+				part << "#include \"narcomp_output.h\"" << endl << endl;
+			}
+			
+			part << "void " << names[function - 1] << "( void )" << endl;
+			part << "{" << endl;
+			partSize += sizes[function - 1];
+		}
+		
+		for( IrInstruction* instruction = blocks[i]->first; instruction != NULL; instruction = instruction->next )
+		{
+			emitSplitInstruction( part, *instruction );
+		}
+		
+		if( i + 1 == blocks.size() || functions[i + 1] != function )
+		{
+			// A procedure that runs on into the next one calls it, and returns when it does
+			if( endsFunction( blocks[i]->last->opcode ) == false )
+			{
+				part << "\t" << names[function] << "();" << endl;
+			}
+			
+			part << "}" << endl << endl;
+		}
+	}
+	
+	if( partSize > 0 )
+	{
+		parts.push_back( part.str() );
+	}
+	
+	return true;
+}
+
+// Tells whether the control flow of the program stays inside the functions emitSplitProgram() would make of it:
+// every label that is jumped to (or whose address is taken) is in the same function, every call is to a procedure or a runtime function,
+// only procedures return, only main() exits or checks for a runtime error, and a procedure only runs on into another procedure
+bool splitFits( const vector<IrBlock*>& blocks, const vector<int>& functions, const vector<string>& names )
+{
+	vector<set<string> > defined( names.size() + 1 ); // Labels in each function
+	vector<pair<int, string> > used; // Labels each function uses
+	set<string> callable( names.begin(), names.end() );
+	
+	for( int i = 0; i < runtimeCount; i++ )
+	{
+		callable.insert( string( runtimeEntries[i][0] ) + "_start" );
+	}
+	
+	for( size_t i = 0; i < blocks.size(); i++ )
+	{
+		const int function = functions[i];
+		
+		for( IrInstruction* instruction = blocks[i]->first; instruction != NULL; instruction = instruction->next )
+		{
+			switch( instruction->opcode )
+			{
+				case IR_LABEL:
+					defined[function].insert( labelText( instruction->left ) );
+					break;
+				
+				case IR_CALL:
+					if( callable.count( labelText( instruction->left ) ) == 0 )
+					{
+						return false;
+					}
+					
+					used.push_back( make_pair( function, labelText( instruction->result ) ) );
+					break;
+				
+				case IR_RETURN:
+					if( function == 0 )
+					{
+						return false;
+					}
+					break;
+				
+				case IR_EXIT:
+				case IR_CHECK_BOOL:
+					if( function != 0 )
+					{
+						return false;
+					}
+					break;
+				
+				default:
+					const IrOperand* operands[3] = { &instruction->result, &instruction->left, &instruction->right };
+					
+					for( int j = 0; j < 3; j++ )
+					{
+						if( operands[j]->kind == IR_LABEL_OPERAND )
+						{
+							used.push_back( make_pair( function, labelText( *operands[j] ) ) );
+						}
+					}
+					break;
+			}
+		}
+		
+		if( function > 0 && ( i + 1 == blocks.size() || functions[i + 1] == 0 ) && endsFunction( blocks[i]->last->opcode ) == false )
+		{
+			return false;
+		}
+	}
+	
+	for( size_t i = 0; i < used.size(); i++ )
+	{
+		if( defined[used[i].first].count( used[i].second ) == 0 )
+		{
+			return false;
+		}
+	}
+	
+	return true;
+}
+
+// Tells whether C doesn't carry on after an instruction with the specified opcode
+bool endsFunction( const int opcode )
+{
+	return opcode == IR_JUMP || opcode == IR_BRANCH || opcode == IR_RETURN || opcode == IR_EXIT;
+}
+
+// Writes out the header every file of the split C includes
+void emitSplitHeader( ostream& out, const vector<string>& names )
+{
+	emitDeclarations( out, true );
+	
+	for( int i = 0; i < runtimeCount; i++ )
+	{
+		out << "void " << runtimeEntries[i][0] << "_start( void );" << endl;
+	}
+	
+	out << endl;
+	
+	for( size_t i = 0; i < names.size(); i++ )
+	{
+		out << "void " << names[i] << "( void );" << endl;
+	}
+	
+	out << endl;
+}
+
+// Writes out an instruction of the split C. A call pushes its return address as emitInstruction() has it do,
+// so the stack is laid out the same, but the procedure is called as a function, and returns as one.
+void emitSplitInstruction( ostream& out, const IrInstruction& instruction )
+{
+	switch( instruction.opcode )
+	{
+		case IR_CALL:
+			out << "\tR[0].intVal = R[0].intVal - 1;" << endl;
+			out << "\tMM[R[0].intVal].jumpTarget = &&";
+			writeIrLabel( out, instruction.result );
+			out << ";" << endl;
+			out << "\tR[0].intVal = R[0].intVal - " << instruction.right.value << ";" << endl;
+			out << "\t";
+			writeIrLabel( out, instruction.left );
+			out << "();" << endl;
+			break;
+		
+		case IR_RETURN:
+			out << "\treturn;" << endl;
+			break;
+		
+		default:
+			emitInstruction( out, instruction );
+			return;
+	}
+	
+	if( instruction.blankLine )
+	{
+		out << endl;
+	}
+}
+
+// Writes out the end of main(), and the runtime functions as functions for the procedures to call
+void emitSplitRuntime( ostream& out )
+{
+	out << "\truntimeerror:" << endl;
+	out << "\tputString( 0 );" << endl;
+	out << "}" << endl << endl;
+	
+	for( int i = 0; i < runtimeCount; i++ )
+	{
+		out << "void " << runtimeEntries[i][0] << "_start( void )" << endl;
+		out << "{" << endl;
+		out << "\t" << runtimeEntries[i][1] << endl;
+		out << "}" << endl << endl;
+	}
+	
+	out << "#include \"runtime.c\"" << endl;
+	out << endl;
+}
+
+// Returns the name of a label, as the C spells it
+string labelText( const IrOperand& label )
+{
+	ostringstream text;
+	
+	writeIrLabel( text, label );
+	return text.str();
+}
@@ -0,0 +1,216 @@
+// Filename: generate.cpp
+// Author: Himanshu Narayana
+// This file writes out generated programs for the checks and benchmarks in the Makefile. The program goes to standard output,
+// and what it looks like depends on the option given.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+static void writeScanProgram( const long long byteCount );
+static void writeStrideInput( void );
+static void writeDeepProgram( const int depth );
+static void writeLongProgram( const int length );
+static void writeParenthesizedProgram( const int depth );
+static string run( const char* characters, const int length, const int offset );
+
+int main( int argc, char** argv )
+{
+	if( argc == 2 && strncmp( argv[1], "--scan=", 7 ) == 0 && atoi( argv[1] + 7 ) > 0 )
+	{
+		writeScanProgram( atoll( argv[1] + 7 ) * 1048576 );
+		return 0;
+	}
+	
+	if( argc == 2 && strcmp( argv[1], "--strides" ) == 0 )
+	{
+		writeStrideInput();
+		return 0;
+	}
+	
+	if( argc == 2 && strncmp( argv[1], "--deep=", 7 ) == 0 && atoi( argv[1] + 7 ) > 1 )
+	{
+		writeDeepProgram( atoi( argv[1] + 7 ) );
+		return 0;
+	}
+	
+	if( argc == 2 && strncmp( argv[1], "--long=", 7 ) == 0 && atoi( argv[1] + 7 ) > 0 )
+	{
+		writeLongProgram( atoi( argv[1] + 7 ) );
+		return 0;
+	}
+	
+	if( argc == 2 && strncmp( argv[1], "--parentheses=", 14 ) == 0 && atoi( argv[1] + 14 ) > 0 )
+	{
+		writeParenthesizedProgram( atoi( argv[1] + 14 ) );
+		return 0;
+	}
+	
+	cerr << "Usage: " << argv[0] << " --scan=megabytes | --strides | --deep=blocks | --long=length | --parentheses=depth" << endl;
+	return 1;
+}
+
+// Writes out a correct program of about byteCount bytes for the scanner benchmark, with the mix of names, numbers, operators,
+// strings, comments and indentation a hand-written one has
+void writeScanProgram( const long long byteCount )
+{
+	long long written = 0;
+	char line[256];
+	
+	cout << "program scanned is" << endl;
+	cout << "global integer total;" << endl;
+	cout << "global float scale;" << endl;
+	
+	for( int procedure = 0; written < byteCount; procedure++ )
+	{
+		written += snprintf( line, sizeof( line ), "procedure step_%d (integer count_%d in, float ratio out)\n", procedure, procedure );
+		cout << line;
+		written += snprintf( line, sizeof( line ), "\tinteger index;\n\tinteger values[%d];\n\tstring label;\n", 8 + procedure % 8 );
+		cout << line;
+		written += snprintf( line, sizeof( line ), "begin\n\t// Fill the values, then add them up\n\tlabel := \"step %d\";\n", procedure );
+		cout << line;
+		written += snprintf( line, sizeof( line ), "\tfor (index := 0; index < %d)\n\t\tvalues[index] := index * %d + count_%d;\n", 8, procedure % 97 + 1, procedure );
+		cout << line;
+		written += snprintf( line, sizeof( line ), "\t\tif (values[index] >= 1_000) then\n\t\t\ttotal := total - values[index];\n\t\telse\n" );
+		cout << line;
+		written += snprintf( line, sizeof( line ), "\t\t\ttotal := total + values[index]; // Small enough to keep\n\t\tend if;\n\t\tindex := index + 1;\n\tend for;\n" );
+		cout << line;
+		written += snprintf( line, sizeof( line ), "\tratio := %d.%d * scale / (total + 1);\n\tputString(label);\nend procedure;\n\n", procedure % 1000, procedure % 7 );
+		cout << line;
+	}
+	
+	cout << "begin" << endl;
+	cout << "\ttotal := 0;" << endl;
+	cout << "\tscale := 1.5;" << endl;
+	cout << "end program" << endl;
+}
+
+// Writes out input for comparing the scalar scanner with the vector kernels. Runs of white space, name and number characters,
+// and comments, of every length up to three times the 32-byte stride, start at every offset from the start of the file,
+// and end in each of the characters that stop them. It is a sequence of tokens rather than a program.
+void writeStrideInput( void )
+{
+	static const char* const stoppers[] = { ";", "@", "\xe9", ":=", "\"", "\n", " " }; // Characters that end a run
+	static const char* const spaces = " \t\n\r\v\f";
+	static const char* const letters = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_0123456789";
+	static const char* const digits = "0123456789_";
+	string text;
+	
+	for( int length = 1; length <= 96; length++ )
+	{
+		for( int stopper = 0; stopper < 7; stopper++ )
+		{
+			text += run( spaces, length, text.size() ) + stoppers[stopper];
+			text += "n" + run( letters, length, text.size() ) + stoppers[stopper] + " ";
+			text += run( digits, length, text.size() ) + stoppers[stopper] + " ";
+			text += run( digits, length, text.size() ) + "." + run( digits, length % 40, text.size() ) + stoppers[stopper] + " ";
+			text += "//" + run( letters, length, text.size() ) + "\n";
+			text += "\"" + run( letters, length, text.size() ) + "\" ";
+		}
+	}
+	
+	cout << text;
+}
+
+// Writes out a correct program whose blocks nest depth deep: half of them procedures declared inside each other,
+// and in the body of the innermost one, the rest if statements and loops by turns
+void writeDeepProgram( const int depth )
+{
+	const int procedures = depth / 2;
+	
+	cout << "program deep is" << endl;
+	cout << "global integer total;" << endl;
+	
+	for( int i = 0; i < procedures; i++ )
+	{
+		cout << "procedure nested_" << i << " (integer count_" << i << " in)" << endl;
+	}
+	
+	cout << "begin" << endl;
+	
+	for( int i = procedures; i < depth; i++ )
+	{
+		cout << ( ( i % 2 == 0 ) ? "if (total < 10) then" : "for (total := total; total < 10)" ) << endl;
+	}
+	
+	cout << "total := total + count_" << procedures - 1 << ";" << endl;
+	
+	for( int i = depth - 1; i >= procedures; i-- )
+	{
+		cout << ( ( i % 2 == 0 ) ? "end if;" : "end for;" ) << endl;
+	}
+	
+	for( int i = procedures - 1; i >= 0; i-- )
+	{
+		cout << ( ( i < procedures - 1 ) ? "begin\nnested_" + to_string( i + 1 ) + "(count_" + to_string( i ) + ");\n" : "" );
+		cout << "end procedure;" << endl;
+	}
+	
+	cout << "begin" << endl;
+	cout << "total := 0;" << endl;
+	cout << "nested_0(1);" << endl;
+	cout << "end program" << endl;
+}
+
+// Writes out a correct program with a procedure of length parameters, a call to it with as many arguments,
+// and length statements in the program body
+void writeLongProgram( const int length )
+{
+	cout << "program long is" << endl;
+	cout << "global integer total;" << endl;
+	cout << "procedure add (";
+	
+	for( int i = 0; i < length; i++ )
+	{
+		cout << ( ( i > 0 ) ? ", " : "" ) << "integer value_" << i << " in";
+	}
+	
+	cout << ")" << endl;
+	cout << "begin" << endl;
+	cout << "total := total + value_" << length - 1 << ";" << endl;
+	cout << "end procedure;" << endl;
+	cout << "begin" << endl;
+	cout << "add(";
+	
+	for( int i = 0; i < length; i++ )
+	{
+		cout << ( ( i > 0 ) ? ", " : "" ) << i;
+	}
+	
+	cout << ");" << endl;
+	
+	for( int i = 0; i < length; i++ )
+	{
+		cout << "total := total + " << i << ";" << endl;
+	}
+	
+	cout << "end program" << endl;
+}
+
+// Writes out a correct program with an expression in parentheses nested depth deep
+void writeParenthesizedProgram( const int depth )
+{
+	cout << "program parenthesized is" << endl;
+	cout << "global integer total;" << endl;
+	cout << "begin" << endl;
+	cout << "total := " << string( depth, '(' ) << "1" << string( depth, ')' ) << ";" << endl;
+	cout << "end program" << endl;
+}
+
+// Returns length characters chosen from characters, differently for each offset
+string run( const char* characters, const int length, const int offset )
+{
+	const int count = strlen( characters );
+	string text;
+	
+	for( int i = 0; i < length; i++ )
+	{
+		text += characters[( i * 5 + offset ) % count];
+	}
+	
+	return text;
+}
@@ -0,0 +1,509 @@
+// Filename: ir.cpp
+// Author: Himanshu Narayana
+// This file holds the intermediate representation (IR) the parser builds of the program: typed three-address instructions,
+// kept in basic blocks and allocated from an arena. emitter.cpp lowers the IR to C, and dumpIr() writes it out for --emit-ir.
+
+#include "compiler.h"
+
+using namespace std;
+
+const IrOperand irNone = IrOperand();
+
+static void* allocateIr( const size_t size );
+static bool endsBlock( const int opcode );
+static void dumpOperand( ostream& out, const IrOperand& operand );
+
+// Names of the operations in the dump, in the order of IrOpcode
+static const char* const opcodeNames[] =
+{
+	"label", "move", "neg", "not", "add", "sub", "mul", "div", "and", "or", "lt", "le", "gt", "ge", "ne",
+	"checkbool", "jump", "branch", "call", "return", "exit"
+};
+
+// Suffixes of the fields in the dump, in the order of IrType
+static const char* const typeSuffixes[] = { "", ".int", ".float", ".char", ".string", ".address" };
+
+// Takes memory for an instruction or block from the arena
+void* allocateIr( const size_t size )
+{
+	// Keep everything aligned for the pointers in the instructions and blocks
+	const size_t alignedSize = ( size + 7 ) & ~static_cast<size_t>( 7 );
+	void* memory;
+	
+	// Move on to the next chunk when this one is full, allocating it the first time it is needed
+	if( context->irProgram.chunkUsed + alignedSize > IR_CHUNK_SIZE )
+	{
+		if( context->irProgram.chunkCount == static_cast<int>( context->irProgram.chunks.size() ) )
+		{
+			context->irProgram.chunks.push_back( new char[IR_CHUNK_SIZE] );
+		}
+		
+		context->irProgram.chunkCount++;
+		context->irProgram.chunkUsed = 0;
+	}
+	
+	memory = context->irProgram.chunks[context->irProgram.chunkCount - 1] + context->irProgram.chunkUsed;
+	context->irProgram.chunkUsed += alignedSize;
+	
+	return memory;
+}
+
+// Frees the IR of the last compile, so the parser can start building a new one
+void resetIr( void )
+{
+	context->irProgram.chunkCount = 0;
+	context->irProgram.chunkUsed = IR_CHUNK_SIZE;
+	context->irProgram.firstBlock = NULL;
+	context->irProgram.lastBlock = NULL;
+	context->irProgram.blockCount = 0;
+	context->irProgram.instructionCount = 0;
+}
+
+IrOperand irRegister( const int number, const IrType type )
+{
+	IrOperand operand = IrOperand();
+	
+	operand.kind = IR_REGISTER;
+	operand.type = type;
+	operand.value = number;
+	
+	return operand;
+}
+
+IrOperand irMemory( const int base, const int offset, const IrType type )
+{
+	IrOperand operand = IrOperand();
+	
+	operand.kind = IR_MEMORY;
+	operand.type = type;
+	operand.base = base;
+	operand.value = offset;
+	
+	return operand;
+}
+
+// Makes a memory operand at a static address (of a variable, array or string literal), as an offset from a base register (IR_NO_BASE for none)
+IrOperand irStaticMemory( const int base, const int address, const IrType type )
+{
+	IrOperand operand = irMemory( base, address, type );
+	
+	operand.relocation = IR_STATIC_ADDRESS;
+	
+	return operand;
+}
+
+// Makes the memory operand of an index slot, which keeps an array index across a call
+IrOperand irIndexSlot( const int slot )
+{
+	IrOperand operand = irMemory( IR_NO_BASE, slot, IR_INTEGER );
+	
+	operand.relocation = IR_INDEX_SLOT;
+	
+	return operand;
+}
+
+IrOperand irInteger( const int value )
+{
+	IrOperand operand = IrOperand();
+	
+	operand.kind = IR_CONSTANT;
+	operand.type = IR_INTEGER;
+	operand.value = value;
+	
+	return operand;
+}
+
+// Makes a constant that is a static address (of a string literal)
+IrOperand irStaticAddress( const int address )
+{
+	IrOperand operand = irInteger( address );
+	
+	operand.relocation = IR_STATIC_ADDRESS;
+	
+	return operand;
+}
+
+IrOperand irFloat( const float value )
+{
+	IrOperand operand = IrOperand();
+	
+	operand.kind = IR_CONSTANT;
+	operand.type = IR_FLOAT;
+	operand.floatValue = value;
+	
+	return operand;
+}
+
+IrOperand irCharacter( const char value )
+{
+	IrOperand operand = IrOperand();
+	
+	operand.kind = IR_CONSTANT;
+	operand.type = IR_CHARACTER;
+	operand.value = value;
+	
+	return operand;
+}
+
+IrOperand irLabel( const IrLabelKind kind, const int name, const int number )
+{
+	IrOperand operand = IrOperand();
+	
+	operand.kind = IR_LABEL_OPERAND;
+	operand.type = kind;
+	operand.base = name;
+	operand.value = number;
+	
+	return operand;
+}
+
+// Makes an instruction, for holding on to until it is appended
+IrInstruction irInstruction( const IrOpcode opcode, const IrOperand& result, const IrOperand& left, const IrOperand& right )
+{
+	IrInstruction instruction;
+	
+	instruction.opcode = opcode;
+	instruction.blankLine = false;
+	instruction.result = result;
+	instruction.left = left;
+	instruction.right = right;
+	instruction.next = NULL;
+	
+	return instruction;
+}
+
+// Tells whether an instruction ends its basic block. Those instructions come last in IrOpcode.
+bool endsBlock( const int opcode )
+{
+	return opcode >= IR_JUMP;
+}
+
+// Appends an instruction to the program, starting a new basic block if it is a label or the last instruction ended a block
+IrInstruction& irAppend( const IrInstruction& instruction )
+{
+	IrInstruction* newInstruction = static_cast<IrInstruction*>( allocateIr( sizeof( IrInstruction ) ) );
+	IrBlock* newBlock;
+	
+	*newInstruction = instruction;
+	newInstruction->next = NULL;
+	
+	if( context->irProgram.lastBlock == NULL || instruction.opcode == IR_LABEL || endsBlock( context->irProgram.lastBlock->last->opcode ) )
+	{
+		newBlock = static_cast<IrBlock*>( allocateIr( sizeof( IrBlock ) ) );
+		newBlock->first = newInstruction;
+		newBlock->last = newInstruction;
+		newBlock->next = NULL;
+		
+		if( context->irProgram.lastBlock == NULL )
+		{
+			context->irProgram.firstBlock = newBlock;
+		}
+		else
+		{
+			context->irProgram.lastBlock->next = newBlock;
+		}
+		
+		context->irProgram.lastBlock = newBlock;
+		context->irProgram.blockCount++;
+	}
+	else
+	{
+		context->irProgram.lastBlock->last->next = newInstruction;
+		context->irProgram.lastBlock->last = newInstruction;
+	}
+	
+	context->irProgram.instructionCount++;
+	return *newInstruction;
+}
+
+IrInstruction& irAppend( const IrOpcode opcode, const IrOperand& result, const IrOperand& left, const IrOperand& right )
+{
+	return irAppend( irInstruction( opcode, result, left, right ) );
+}
+
+// Leaves a blank line after the C of the last instruction appended
+void irBlankLine( void )
+{
+	if( context->irProgram.lastBlock != NULL )
+	{
+		context->irProgram.lastBlock->last->blankLine = true;
+	}
+}
+
+// Returns the position of the last instruction appended, for copyIr()
+IrPosition irPosition( void )
+{
+	IrPosition position;
+	
+	position.block = context->irProgram.lastBlock;
+	position.instruction = ( position.block != NULL ) ? position.block->last : NULL;
+	
+	return position;
+}
+
+// Copies the instructions appended after the position to the end of instructions
+void copyIr( const IrPosition& position, vector<IrInstruction>& instructions )
+{
+	IrBlock* block = ( position.block != NULL ) ? position.block : context->irProgram.firstBlock;
+	IrInstruction* instruction = ( position.instruction != NULL ) ? position.instruction->next : ( block != NULL ? block->first : NULL );
+	
+	while( block != NULL )
+	{
+		for( ; instruction != NULL; instruction = instruction->next )
+		{
+			instructions.push_back( *instruction );
+		}
+		
+		block = block->next;
+		instruction = ( block != NULL ) ? block->first : NULL;
+	}
+}
+
+// Inserts instructions after a position, appending them there as if they had been appended right after it.
+// The blocks after the position stay as they are, so that has to be what appending the instructions would have left them as:
+// the position has to be the last instruction of its block, and the block after it has to start with a label or after an instruction that ends a block.
+bool insertIr( const IrPosition& position, const vector<IrInstruction>& instructions )
+{
+	IrBlock* lastBlock = context->irProgram.lastBlock;
+	IrBlock* followingBlock;
+	
+	if( position.block == NULL || position.instruction != position.block->last )
+	{
+		return false;
+	}
+	
+	followingBlock = position.block->next;
+	
+	if( followingBlock != NULL && instructions.empty() == false && followingBlock->first->opcode != IR_LABEL && endsBlock( instructions.back().opcode ) == false )
+	{
+		return false;
+	}
+	
+	// Append after the position, then hang the blocks that followed it after the new ones
+	context->irProgram.lastBlock = position.block;
+	
+	for( size_t i = 0; i < instructions.size(); i++ )
+	{
+		irAppend( instructions[i] );
+	}
+	
+	context->irProgram.lastBlock->next = followingBlock;
+	
+	if( followingBlock != NULL )
+	{
+		context->irProgram.lastBlock = lastBlock;
+	}
+	
+	return true;
+}
+
+// Writes out the name of a label, as the C spells it.
+// Labels made from a procedure's name start with the name and end in "_start", or "_nested", "_return" or "_call" and a number, so no two are the same.
+// Block labels start with '_', which no name does, and the blocks of a top-level procedure end in '_' and its name,
+// so a procedure's name can't make them the same as another label however it is spelled.
+void writeIrLabel( ostream& out, const IrOperand& label )
+{
+	if( label.type >= IF_START_LABEL )
+	{
+		out << "_";
+	}
+	
+	switch( label.type )
+	{
+		case PROGRAM_BODY_LABEL:
+			out << "programbody";
+			break;
+		
+		case PROGRAM_SETUP_LABEL:
+			out << "programsetup";
+			break;
+		
+		case PROCEDURE_START_LABEL:
+			out << internedName( label.base ) << "_start";
+			break;
+		
+		case NESTED_START_LABEL:
+			out << internedName( label.base ) << "_nested" << label.value;
+			break;
+		
+		case PROCEDURE_RETURN_LABEL:
+			out << internedName( label.base ) << "_return" << label.value;
+			break;
+		
+		case CALL_RETURN_LABEL:
+			out << internedName( label.base ) << "_call" << label.value;
+			break;
+		
+		case IF_START_LABEL:
+			out << "if" << label.value << "_start";
+			break;
+		
+		case ELSE_START_LABEL:
+			out << "else" << label.value << "_start";
+			break;
+		
+		case END_IF_LABEL:
+			out << "endif" << label.value;
+			break;
+		
+		case LOOP_CHECK_LABEL:
+			out << "loop" << label.value << "_check";
+			break;
+		
+		case LOOP_START_LABEL:
+			out << "loop" << label.value << "_start";
+			break;
+		
+		case END_LOOP_LABEL:
+			out << "endloop" << label.value;
+			break;
+	}
+	
+	// The blocks of a top-level procedure are named after it
+	if( label.type >= IF_START_LABEL && label.base != IR_NO_NAME )
+	{
+		out << "_" << internedName( label.base );
+	}
+}
+
+// Returns a float constant written as a C literal.
+// It gets the fewest digits (at most nine) that still read back as exactly the same float.
+string irFloatText( const float value )
+{
+	ostringstream text;
+	
+	for( int digits = 1; digits <= 9; digits++ )
+	{
+		text.str( "" );
+		text.precision( digits );
+		text << value;
+		
+		if( strtof( text.str().c_str(), NULL ) == value )
+		{
+			break;
+		}
+	}
+	
+	// Keep a decimal point in whole numbers so the literal still reads as a float
+	if( text.str().find_first_of( ".e" ) == string::npos )
+	{
+		text << ".0";
+	}
+	
+	return text.str();
+}
+
+// Writes an operand out for the dump
+void dumpOperand( ostream& out, const IrOperand& operand )
+{
+	switch( operand.kind )
+	{
+		case IR_REGISTER:
+			out << "R" << operand.value << typeSuffixes[operand.type];
+			break;
+		
+		case IR_MEMORY:
+			if( operand.base == IR_NO_BASE )
+			{
+				out << "MM[" << operand.value << "]";
+			}
+			else
+			{
+				out << "MM[R" << operand.base << " + " << operand.value << "]";
+			}
+			
+			out << typeSuffixes[operand.type];
+			break;
+		
+		case IR_CONSTANT:
+			if( operand.type == IR_FLOAT )
+			{
+				out << irFloatText( operand.floatValue );
+			}
+			else if( operand.type == IR_CHARACTER )
+			{
+				if( operand.value == '\0' )
+				{
+					out << "'\\0'";
+				}
+				else
+				{
+					out << "'" << static_cast<char>( operand.value ) << "'";
+				}
+			}
+			else
+			{
+				out << operand.value;
+			}
+			break;
+		
+		case IR_LABEL_OPERAND:
+			writeIrLabel( out, operand );
+			break;
+	}
+}
+
+// Writes the IR out in a readable form (for --emit-ir).
+// Each block starts with its label, or its number if it has none, and each instruction is written as "result = operation operands".
+void dumpIr( ostream& out )
+{
+	int blockNumber = 0;
+	
+	out << "; " << context->irProgram.blockCount << " blocks, " << context->irProgram.instructionCount << " instructions" << endl;
+	
+	for( IrBlock* block = context->irProgram.firstBlock; block != NULL; block = block->next )
+	{
+		out << endl;
+		
+		if( block->first->opcode == IR_LABEL )
+		{
+			writeIrLabel( out, block->first->left );
+			out << ":" << endl;
+		}
+		else
+		{
+			out << "(block " << blockNumber << ")" << endl;
+		}
+		
+		for( IrInstruction* instruction = block->first; instruction != NULL; instruction = instruction->next )
+		{
+			if( instruction->opcode == IR_LABEL )
+			{
+				continue;
+			}
+			
+			out << "\t";
+			
+			if( instruction->result.kind != IR_NO_OPERAND && !endsBlock( instruction->opcode ) )
+			{
+				dumpOperand( out, instruction->result );
+				out << " = ";
+			}
+			
+			out << opcodeNames[instruction->opcode];
+			
+			if( instruction->left.kind != IR_NO_OPERAND )
+			{
+				out << " ";
+				dumpOperand( out, instruction->left );
+			}
+			
+			if( instruction->right.kind != IR_NO_OPERAND )
+			{
+				out << ", ";
+				dumpOperand( out, instruction->right );
+			}
+			
+			// A branch or call names the block it goes on to last
+			if( instruction->result.kind != IR_NO_OPERAND && endsBlock( instruction->opcode ) )
+			{
+				out << ", ";
+				dumpOperand( out, instruction->result );
+			}
+			
+			out << endl;
+		}
+		
+		blockNumber++;
+	}
+}
@@ -0,0 +1,305 @@
+// Filename: kernels.cpp
+// Author: Himanshu Narayana
+// This file holds the scanning kernels used by the Scanner to skip over runs of characters.
+// Each kernel has a scalar version and, on x86 processors, SSE2 and AVX2 versions that look at 16 or 32 bytes at a time.
+// selectScanKernels() picks the versions to use when the scanner starts, based on what the processor supports.
+
+#include "compiler.h"
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#define VECTOR_KERNELS
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+static const char* skipWhitespaceScalar( const char* start, const char* end, int& newlines );
+static const char* scanIdentifierScalar( const char* start, const char* end );
+static const char* scanDigitsScalar( const char* start, const char* end );
+static const char* findNewlineScalar( const char* start, const char* end );
+
+// Kernels currently in use by the scanner
+const char* (*skipWhitespace)( const char* start, const char* end, int& newlines ) = skipWhitespaceScalar;
+const char* (*scanIdentifier)( const char* start, const char* end ) = scanIdentifierScalar;
+const char* (*scanDigits)( const char* start, const char* end ) = scanDigitsScalar;
+const char* (*findNewline)( const char* start, const char* end ) = findNewlineScalar;
+
+// Scalar Kernels
+// These define the exact behavior that the vector kernels have to reproduce.
+
+// Returns the first character at or after start that is not white space, counting the newlines skipped over
+const char* skipWhitespaceScalar( const char* start, const char* end, int& newlines )
+{
+	while( start < end && isspace( static_cast<unsigned char>( *start ) ) )
+	{
+		if( *start == '\n' )
+		{
+			newlines++;
+		}
+		
+		start++;
+	}
+	
+	return start;
+}
+
+// Returns the first character at or after start that can't be part of an identifier (letters, digits and underscores)
+const char* scanIdentifierScalar( const char* start, const char* end )
+{
+	while( start < end && ( isalnum( static_cast<unsigned char>( *start ) ) || *start == '_' ) )
+	{
+		start++;
+	}
+	
+	return start;
+}
+
+// Returns the first character at or after start that can't be part of the digits of a number (digits and underscores)
+const char* scanDigitsScalar( const char* start, const char* end )
+{
+	while( start < end && ( isdigit( static_cast<unsigned char>( *start ) ) || *start == '_' ) )
+	{
+		start++;
+	}
+	
+	return start;
+}
+
+// Returns the first newline at or after start, or end if there isn't one
+const char* findNewlineScalar( const char* start, const char* end )
+{
+	while( start < end && *start != '\n' )
+	{
+		start++;
+	}
+	
+	return start;
+}
+
+#ifdef VECTOR_KERNELS
+
+// SSE2 Kernels
+// Every x86-64 processor has SSE2. Bytes are compared as signed values, so bytes 0x80 to 0xFF never fall in the ranges tested.
+
+// Returns a mask with the bytes of block that are in the range [low, high] set to all ones
+static inline __m128i rangeMask128( const __m128i block, const char low, const char high )
+{
+	return _mm_and_si128( _mm_cmpgt_epi8( block, _mm_set1_epi8( low - 1 ) ), _mm_cmplt_epi8( block, _mm_set1_epi8( high + 1 ) ) );
+}
+
+static const char* skipWhitespaceSSE2( const char* start, const char* end, int& newlines )
+{
+	while( end - start >= 16 )
+	{
+		__m128i block = _mm_loadu_si128( reinterpret_cast<const __m128i*>( start ) );
+		__m128i space = _mm_or_si128( _mm_cmpeq_epi8( block, _mm_set1_epi8( ' ' ) ), rangeMask128( block, '\t', '\r' ) );
+		unsigned int lineMask = _mm_movemask_epi8( _mm_cmpeq_epi8( block, _mm_set1_epi8( '\n' ) ) );
+		unsigned int stopMask = ~_mm_movemask_epi8( space ) & 0xFFFF;
+		
+		if( stopMask != 0 )
+		{
+			int length = __builtin_ctz( stopMask );
+			
+			newlines += __builtin_popcount( lineMask & ( ( 1u << length ) - 1 ) );
+			return start + length;
+		}
+		
+		newlines += __builtin_popcount( lineMask );
+		start += 16;
+	}
+	
+	return skipWhitespaceScalar( start, end, newlines );
+}
+
+static const char* scanIdentifierSSE2( const char* start, const char* end )
+{
+	while( end - start >= 16 )
+	{
+		__m128i block = _mm_loadu_si128( reinterpret_cast<const __m128i*>( start ) );
+		__m128i letter = rangeMask128( _mm_or_si128( block, _mm_set1_epi8( 0x20 ) ), 'a', 'z' );
+		__m128i digit = rangeMask128( block, '0', '9' );
+		__m128i underscore = _mm_cmpeq_epi8( block, _mm_set1_epi8( '_' ) );
+		unsigned int stopMask = ~_mm_movemask_epi8( _mm_or_si128( _mm_or_si128( letter, digit ), underscore ) ) & 0xFFFF;
+		
+		if( stopMask != 0 )
+		{
+			return start + __builtin_ctz( stopMask );
+		}
+		
+		start += 16;
+	}
+	
+	return scanIdentifierScalar( start, end );
+}
+
+static const char* scanDigitsSSE2( const char* start, const char* end )
+{
+	while( end - start >= 16 )
+	{
+		__m128i block = _mm_loadu_si128( reinterpret_cast<const __m128i*>( start ) );
+		__m128i digit = rangeMask128( block, '0', '9' );
+		__m128i underscore = _mm_cmpeq_epi8( block, _mm_set1_epi8( '_' ) );
+		unsigned int stopMask = ~_mm_movemask_epi8( _mm_or_si128( digit, underscore ) ) & 0xFFFF;
+		
+		if( stopMask != 0 )
+		{
+			return start + __builtin_ctz( stopMask );
+		}
+		
+		start += 16;
+	}
+	
+	return scanDigitsScalar( start, end );
+}
+
+static const char* findNewlineSSE2( const char* start, const char* end )
+{
+	while( end - start >= 16 )
+	{
+		__m128i block = _mm_loadu_si128( reinterpret_cast<const __m128i*>( start ) );
+		unsigned int lineMask = _mm_movemask_epi8( _mm_cmpeq_epi8( block, _mm_set1_epi8( '\n' ) ) );
+		
+		if( lineMask != 0 )
+		{
+			return start + __builtin_ctz( lineMask );
+		}
+		
+		start += 16;
+	}
+	
+	return findNewlineScalar( start, end );
+}
+
+// AVX2 Kernels
+// These are compiled for AVX2 on their own, so the rest of the compiler still runs on processors without it.
+
+__attribute__(( target( "avx2" ) )) static inline __m256i rangeMask256( const __m256i block, const char low, const char high )
+{
+	return _mm256_and_si256( _mm256_cmpgt_epi8( block, _mm256_set1_epi8( low - 1 ) ), _mm256_cmpgt_epi8( _mm256_set1_epi8( high + 1 ), block ) );
+}
+
+__attribute__(( target( "avx2" ) )) static const char* skipWhitespaceAVX2( const char* start, const char* end, int& newlines )
+{
+	while( end - start >= 32 )
+	{
+		__m256i block = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( start ) );
+		__m256i space = _mm256_or_si256( _mm256_cmpeq_epi8( block, _mm256_set1_epi8( ' ' ) ), rangeMask256( block, '\t', '\r' ) );
+		unsigned int lineMask = _mm256_movemask_epi8( _mm256_cmpeq_epi8( block, _mm256_set1_epi8( '\n' ) ) );
+		unsigned int stopMask = ~static_cast<unsigned int>( _mm256_movemask_epi8( space ) );
+		
+		if( stopMask != 0 )
+		{
+			int length = __builtin_ctz( stopMask );
+			
+			newlines += __builtin_popcount( lineMask & ( ( 1u << length ) - 1 ) );
+			return start + length;
+		}
+		
+		newlines += __builtin_popcount( lineMask );
+		start += 32;
+	}
+	
+	return skipWhitespaceSSE2( start, end, newlines );
+}
+
+__attribute__(( target( "avx2" ) )) static const char* scanIdentifierAVX2( const char* start, const char* end )
+{
+	while( end - start >= 32 )
+	{
+		__m256i block = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( start ) );
+		__m256i letter = rangeMask256( _mm256_or_si256( block, _mm256_set1_epi8( 0x20 ) ), 'a', 'z' );
+		__m256i digit = rangeMask256( block, '0', '9' );
+		__m256i underscore = _mm256_cmpeq_epi8( block, _mm256_set1_epi8( '_' ) );
+		unsigned int stopMask = ~static_cast<unsigned int>( _mm256_movemask_epi8( _mm256_or_si256( _mm256_or_si256( letter, digit ), underscore ) ) );
+		
+		if( stopMask != 0 )
+		{
+			return start + __builtin_ctz( stopMask );
+		}
+		
+		start += 32;
+	}
+	
+	return scanIdentifierSSE2( start, end );
+}
+
+__attribute__(( target( "avx2" ) )) static const char* scanDigitsAVX2( const char* start, const char* end )
+{
+	while( end - start >= 32 )
+	{
+		__m256i block = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( start ) );
+		__m256i digit = rangeMask256( block, '0', '9' );
+		__m256i underscore = _mm256_cmpeq_epi8( block, _mm256_set1_epi8( '_' ) );
+		unsigned int stopMask = ~static_cast<unsigned int>( _mm256_movemask_epi8( _mm256_or_si256( digit, underscore ) ) );
+		
+		if( stopMask != 0 )
+		{
+			return start + __builtin_ctz( stopMask );
+		}
+		
+		start += 32;
+	}
+	
+	return scanDigitsSSE2( start, end );
+}
+
+__attribute__(( target( "avx2" ) )) static const char* findNewlineAVX2( const char* start, const char* end )
+{
+	while( end - start >= 32 )
+	{
+		__m256i block = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( start ) );
+		unsigned int lineMask = _mm256_movemask_epi8( _mm256_cmpeq_epi8( block, _mm256_set1_epi8( '\n' ) ) );
+		
+		if( lineMask != 0 )
+		{
+			return start + __builtin_ctz( lineMask );
+		}
+		
+		start += 32;
+	}
+	
+	return findNewlineSSE2( start, end );
+}
+
+#endif
+
+// This function points the scanner at the fastest kernels the processor supports.
+// The scalar kernels are used if forceScalar is set (for checking the vector kernels against them).
+ScanKernelSet selectScanKernels( const bool forceScalar )
+{
+	skipWhitespace = skipWhitespaceScalar;
+	scanIdentifier = scanIdentifierScalar;
+	scanDigits = scanDigitsScalar;
+	findNewline = findNewlineScalar;
+	
+	if( forceScalar )
+	{
+		return SCALAR_KERNELS;
+	}
+	
+#ifdef VECTOR_KERNELS
+	__builtin_cpu_init();
+	
+	if( __builtin_cpu_supports( "avx2" ) )
+	{
+		skipWhitespace = skipWhitespaceAVX2;
+		scanIdentifier = scanIdentifierAVX2;
+		scanDigits = scanDigitsAVX2;
+		findNewline = findNewlineAVX2;
+		
+		return AVX2_KERNELS;
+	}
+	
+	if( __builtin_cpu_supports( "sse2" ) )
+	{
+		skipWhitespace = skipWhitespaceSSE2;
+		scanIdentifier = scanIdentifierSSE2;
+		scanDigits = scanDigitsSSE2;
+		findNewline = findNewlineSSE2;
+		
+		return SSE2_KERNELS;
+	}
+#endif
+	
+	return SCALAR_KERNELS;
+}
@@ -0,0 +1,296 @@
+// Filename: output.cpp
+// Author: Himanshu Narayana
+// This file holds the output of the compiler while it is being built. Each section of an output file is kept in memory,
+// and the file is written in one go (a single writev() for all of its sections) once the compile has succeeded.
+
+#include "compiler.h"
+
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <unistd.h>
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
+
+using namespace std;
+
+// A piece of memory holding part of a section
+struct OutputChunk
+{
+	char* text;
+	size_t size; // Bytes the chunk can hold
+	size_t length; // Bytes of the chunk in use, once the section has moved on to the next chunk
+};
+
+// Stream buffer for a section of an output file
+// Text goes straight into the current chunk. When it is full a new chunk is started, twice the size of the last one
+// (up to OUTPUT_CHUNK_LIMIT), so text is never copied to make room and even a large section is only a few dozen chunks.
+// The chunks are kept when the section is emptied, for the next compile to use.
+// Flushing does nothing: nothing is written until writeOutput() is called.
+class OutputBuffer : public streambuf
+{
+	public:
+		OutputBuffer() : streambuf(), chunkCount( 0 )
+		{
+		}
+		
+		virtual ~OutputBuffer()
+		{
+			for( size_t chunk = 0; chunk < chunks.size(); chunk++ )
+			{
+				delete[] chunks[chunk].text;
+			}
+		}
+		
+		// Empties the section
+		void empty( void )
+		{
+			chunkCount = 0;
+			setp( NULL, NULL );
+		}
+		
+		// Adds the pieces of memory holding the section, in order, to pieces
+		void gather( vector<OutputChunk>& pieces )
+		{
+			for( int chunk = 0; chunk < chunkCount; chunk++ )
+			{
+				OutputChunk piece = chunks[chunk];
+				
+				if( chunk == chunkCount - 1 )
+				{
+					piece.length = pptr() - pbase();
+				}
+				
+				if( piece.length > 0 )
+				{
+					pieces.push_back( piece );
+				}
+			}
+		}
+	
+	protected:
+		// Moves on to the next chunk when the current one is full
+		virtual int_type overflow( int_type ch )
+		{
+			if( chunkCount > 0 )
+			{
+				chunks[chunkCount - 1].length = pptr() - pbase();
+			}
+			
+			if( chunkCount == static_cast<int>( chunks.size() ) )
+			{
+				OutputChunk newChunk;
+				
+				newChunk.size = chunks.empty() ? OUTPUT_CHUNK_SIZE : min( chunks.back().size * 2, static_cast<size_t>( OUTPUT_CHUNK_LIMIT ) );
+				newChunk.text = new char[newChunk.size];
+				newChunk.length = 0;
+				chunks.push_back( newChunk );
+			}
+			
+			setp( chunks[chunkCount].text, chunks[chunkCount].text + chunks[chunkCount].size );
+			chunkCount++;
+			
+			if( traits_type::eq_int_type( ch, traits_type::eof() ) == false )
+			{
+				*pptr() = traits_type::to_char_type( ch );
+				pbump( 1 );
+			}
+			
+			return traits_type::not_eof( ch );
+		}
+		
+		virtual int sync()
+		{
+			return 0;
+		}
+	
+	private:
+		vector<OutputChunk> chunks;
+		int chunkCount; // Number of chunks the section is using
+};
+
+// A section and the stream that writes to it
+struct OutputSectionStream
+{
+	OutputBuffer buffer;
+	ostream stream;
+	
+	OutputSectionStream() : buffer(), stream( &buffer )
+	{
+	}
+};
+
+// Sections of the output of a compile
+struct OutputState
+{
+	OutputSectionStream sections[OUTPUT_SECTION_COUNT];
+	vector<OutputChunk> pieces; // The pieces copyOutput() gathers. It is kept from one compile to the next so it keeps its room.
+};
+
+static bool writeFile( const char* filename, const vector<OutputChunk>& pieces );
+static bool writePieces( const int descriptor, const vector<OutputChunk>& pieces );
+
+// Makes the output of a new context, with every section empty
+OutputState* newOutputState( void )
+{
+	return new OutputState();
+}
+
+void deleteOutputState( OutputState* state )
+{
+	delete state;
+}
+
+// Returns the stream that writes to the specified section
+ostream& outputSection( const OutputSection section )
+{
+	OutputState& output = *context->output;
+	
+	return output.sections[section].stream;
+}
+
+// Empties every section, for a new compile
+void resetOutput( void )
+{
+	OutputState& output = *context->output;
+	
+	for( int section = 0; section < OUTPUT_SECTION_COUNT; section++ )
+	{
+		output.sections[section].buffer.empty();
+		output.sections[section].stream.clear();
+	}
+}
+
+// Writes the sections from firstSection to lastSection, in order, to the specified file, replacing what the file held.
+// Returns false if the file couldn't be opened or written.
+bool writeOutput( const char* filename, const OutputSection firstSection, const OutputSection lastSection )
+{
+	OutputState& output = *context->output;
+	vector<OutputChunk> pieces;
+	
+	for( int section = firstSection; section <= lastSection; section++ )
+	{
+		output.sections[section].buffer.gather( pieces );
+	}
+	
+	return writeFile( filename, pieces );
+}
+
+// Writes text to the specified file, replacing what the file held (for the output of compile(), which isn't in sections).
+// Returns false if the file couldn't be opened or written.
+bool writeOutputText( const char* filename, const string& text )
+{
+	vector<OutputChunk> pieces;
+	
+	if( text.empty() == false )
+	{
+		OutputChunk piece;
+		
+		piece.text = const_cast<char*>( text.data() );
+		piece.size = text.size();
+		piece.length = text.size();
+		pieces.push_back( piece );
+	}
+	
+	return writeFile( filename, pieces );
+}
+
+// Copies the sections from firstSection to lastSection, in order, into text
+void copyOutput( string& text, const OutputSection firstSection, const OutputSection lastSection )
+{
+	OutputState& output = *context->output;
+	vector<OutputChunk>& pieces = output.pieces;
+	size_t length = 0;
+	
+	pieces.clear();
+	
+	for( int section = firstSection; section <= lastSection; section++ )
+	{
+		output.sections[section].buffer.gather( pieces );
+	}
+	
+	for( size_t piece = 0; piece < pieces.size(); piece++ )
+	{
+		length += pieces[piece].length;
+	}
+	
+	text.clear();
+	text.reserve( length );
+	
+	for( size_t piece = 0; piece < pieces.size(); piece++ )
+	{
+		text.append( pieces[piece].text, pieces[piece].length );
+	}
+}
+
+// Writes the pieces, in order, to the specified file, replacing what the file held
+bool writeFile( const char* filename, const vector<OutputChunk>& pieces )
+{
+	int descriptor;
+	bool written;
+	
+	descriptor = open( filename, O_WRONLY | O_CREAT | O_TRUNC, 0666 );
+	
+	if( descriptor < 0 )
+	{
+		return false;
+	}
+	
+	written = writePieces( descriptor, pieces );
+	
+	if( close( descriptor ) != 0 )
+	{
+		written = false;
+	}
+	
+	return written;
+}
+
+// Writes the pieces to the file, all in one system call unless there are more than IOV_MAX of them or the write comes up short
+bool writePieces( const int descriptor, const vector<OutputChunk>& pieces )
+{
+	size_t piece = 0;
+	size_t offset = 0; // Bytes of the piece already written
+	
+	while( piece < pieces.size() )
+	{
+#ifndef _WIN32
+		struct iovec vectors[IOV_MAX];
+		int vectorCount = 0;
+		ssize_t writtenLength;
+		
+		for( size_t next = piece; next < pieces.size() && vectorCount < IOV_MAX; next++ )
+		{
+			vectors[vectorCount].iov_base = pieces[next].text + ( next == piece ? offset : 0 );
+			vectors[vectorCount].iov_len = pieces[next].length - ( next == piece ? offset : 0 );
+			vectorCount++;
+		}
+		
+		writtenLength = writev( descriptor, vectors, vectorCount );
+#else
+		int writtenLength = write( descriptor, pieces[piece].text + offset, pieces[piece].length - offset );
+#endif
+		
+		if( writtenLength < 0 )
+		{
+			if( errno == EINTR )
+			{
+				continue;
+			}
+			
+			return false;
+		}
+		
+		// Move past what was written
+		offset += writtenLength;
+		
+		while( piece < pieces.size() && offset >= pieces[piece].length )
+		{
+			offset -= pieces[piece].length;
+			piece++;
+		}
+	}
+	
+	return true;
+}
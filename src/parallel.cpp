@@ -0,0 +1,339 @@
+// Filename: parallel.cpp
+// Author: Himanshu Narayana
+// This file generates the code of the top-level procedures of a program on worker threads (--jobs). The parse of the program
+// reads each top-level procedure's header and skims the rest of it (see the parser's skimTopProcedure()), and hands its tokens,
+// and copies of the symbols outside of it that its names can refer to, to the workers as a job. Each worker reads its procedures
+// in a context of its own, and the parse of the program splices their code in once it has read its declarations.
+//
+// When make runs the compiler with a jobserver (make -j, with the recipe marked "+"), the workers are only started for
+// the job slots the jobserver has free, so a parallel build doesn't run more threads than make was asked for.
+
+#include "compiler.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// The workers of a compile with --jobs and the jobs handed to them
+struct ProcedureJobs
+{
+	vector<unique_ptr<ProcedureJob> > jobs; // In the order of the program
+	int nextJob; // First job no thread has taken
+	bool closed; // Set once no more jobs will be handed out
+	bool finished; // Set once every job has been read and the workers have stopped
+	mutex lock; // Guards jobs, nextJob and closed
+	condition_variable jobAdded;
+	vector<thread> workers;
+	const CompilerContext* owner; // Context of the compile the jobs are from
+	int nestingLimit;
+	
+	ProcedureJobs( void ) : nextJob( 0 ), closed( false ), finished( false ), owner( NULL ), nestingLimit( NESTING_LIMIT )
+	{
+	}
+};
+
+// Job slots taken from make's jobserver, to be given back when the compile is done
+struct JobSlots
+{
+	int readDescriptor; // Where the slots are read from and written back to (-1 if there is no jobserver)
+	int writeDescriptor;
+	bool ownDescriptors; // Set if the descriptors were opened here, and have to be closed
+	string tokens; // The bytes read from the jobserver, one for each slot
+	
+	JobSlots( void ) : readDescriptor( -1 ), writeDescriptor( -1 ), ownDescriptors( false )
+	{
+	}
+};
+
+static void runProcedureWorker( ProcedureJobs* jobs );
+static ProcedureJob* takeProcedureJob( ProcedureJobs& jobs );
+static void readProcedureJob( ProcedureJob& job, const ProcedureJobs& jobs );
+static int takeJobSlots( const int wanted, JobSlots& slots );
+static void giveBackJobSlots( JobSlots& slots );
+
+// Reads the program with the code of its top-level procedures generated on worker threads
+bool readProgramInParallel( const int newNestingLimit, const int workerCount )
+{
+	ostream* callerDiagnostics = context->diagnostics;
+	ostringstream diagnostics; // Only looked at to tell whether there were any
+	ProcedureJobs jobs;
+	JobSlots slots;
+	int workersWanted = ( workerCount > 0 ) ? workerCount - 1 : static_cast<int>( thread::hardware_concurrency() ) - 1;
+	int workersStarted;
+	bool compiled;
+	
+	// The calling thread holds a job slot of its own
+	workersStarted = takeJobSlots( max( workersWanted, 0 ), slots );
+	
+	if( workersStarted == 0 )
+	{
+		readProgram( newNestingLimit );
+		return true;
+	}
+	
+	jobs.owner = context;
+	jobs.nestingLimit = newNestingLimit;
+	context->diagnostics = &diagnostics;
+	
+	for( int i = 0; i < workersStarted; i++ )
+	{
+		jobs.workers.push_back( thread( runProcedureWorker, &jobs ) );
+	}
+	
+	try
+	{
+		readProgram( newNestingLimit, NULL, &jobs );
+	}
+	catch( exception& e )
+	{
+		finishProcedureJobs( &jobs );
+		context->diagnostics = callerDiagnostics;
+		giveBackJobSlots( slots );
+		throw;
+	}
+	
+	// The jobs have been spliced in if the parse got as far as the program's "begin", but not if it stopped before
+	compiled = finishProcedureJobs( &jobs ) && context->warningCount == 0 && context->errorCount == 0;
+	
+	context->diagnostics = callerDiagnostics;
+	giveBackJobSlots( slots );
+	
+	return compiled;
+}
+
+// Hands a job to the workers
+void addProcedureJob( ProcedureJobs* jobs, ProcedureJob* job )
+{
+	{
+		lock_guard<mutex> guard( jobs->lock );
+		jobs->jobs.push_back( unique_ptr<ProcedureJob>( job ) );
+	}
+	
+	jobs->jobAdded.notify_one();
+}
+
+// Works on the jobs no worker has taken yet, in a context of its own, and waits for the workers to finish the rest
+bool finishProcedureJobs( ProcedureJobs* jobs )
+{
+	CompilerContext* callerContext = context;
+	ProcedureJob* job;
+	
+	if( jobs->finished == false )
+	{
+		{
+			lock_guard<mutex> guard( jobs->lock );
+			jobs->closed = true;
+		}
+		
+		jobs->jobAdded.notify_all();
+		
+		if( ( job = takeProcedureJob( *jobs ) ) != NULL )
+		{
+			CompilerContext helperContext;
+			ostream discarded( NULL );
+			
+			context = &helperContext;
+			helperContext.diagnostics = &discarded;
+			
+			do
+			{
+				readProcedureJob( *job, *jobs );
+			}
+			while( ( job = takeProcedureJob( *jobs ) ) != NULL );
+			
+			context = callerContext;
+		}
+		
+		for( size_t i = 0; i < jobs->workers.size(); i++ )
+		{
+			jobs->workers[i].join();
+		}
+		
+		jobs->workers.clear();
+		jobs->finished = true;
+	}
+	
+	for( size_t i = 0; i < jobs->jobs.size(); i++ )
+	{
+		if( jobs->jobs[i]->compiled == false )
+		{
+			return false;
+		}
+	}
+	
+	return true;
+}
+
+int procedureJobCount( const ProcedureJobs* jobs )
+{
+	return jobs->jobs.size();
+}
+
+ProcedureJob& procedureJob( ProcedureJobs* jobs, const int index )
+{
+	return *jobs->jobs[index];
+}
+
+// Body of a --jobs thread. Reads procedures until there are none left, all in the same context.
+// Diagnostics aren't kept: a procedure that gives one makes the compile fall back to one without workers, which reports it.
+void runProcedureWorker( ProcedureJobs* jobs )
+{
+	CompilerContext workerContext;
+	ostream discarded( NULL );
+	ProcedureJob* job;
+	
+	context = &workerContext;
+	workerContext.diagnostics = &discarded;
+	
+	while( ( job = takeProcedureJob( *jobs ) ) != NULL )
+	{
+		readProcedureJob( *job, *jobs );
+	}
+}
+
+// Returns the next job no thread has taken, waiting for one to be handed out, or NULL once there are no more
+ProcedureJob* takeProcedureJob( ProcedureJobs& jobs )
+{
+	unique_lock<mutex> guard( jobs.lock );
+	
+	while( jobs.nextJob >= static_cast<int>( jobs.jobs.size() ) && jobs.closed == false )
+	{
+		jobs.jobAdded.wait( guard );
+	}
+	
+	if( jobs.nextJob < static_cast<int>( jobs.jobs.size() ) )
+	{
+		return jobs.jobs[jobs.nextJob++].get();
+	}
+	
+	return NULL;
+}
+
+// Reads the procedure of a job in the calling thread's context, starting from the symbols the job was given
+void readProcedureJob( ProcedureJob& job, const ProcedureJobs& jobs )
+{
+	try
+	{
+		initializeScannerTokens( job.tokens, *jobs.owner );
+		
+		for( size_t i = 0; i < job.symbols.size(); i++ )
+		{
+			declareSymbolCopy( job.symbols[i] );
+		}
+		
+		readJobProcedure( job, jobs.nestingLimit );
+	}
+	catch( exception& e )
+	{
+		job.compiled = false;
+	}
+}
+
+// Takes up to wanted job slots from make's jobserver, without waiting for any, and returns how many it took.
+// Outside of make, wanted is returned even if MAKEFLAGS is exported. Under make without a jobserver (no -j), or with one that can't be used,
+// none are taken. MAKELEVEL tells whether this is run by make.
+int takeJobSlots( const int wanted, JobSlots& slots )
+{
+#ifndef _WIN32
+	const char* makeFlags = getenv( "MAKEFLAGS" );
+	const char* authorization;
+	string fifoPath;
+	char descriptorPath[64];
+	int readDescriptor;
+	int writeDescriptor;
+	ssize_t readLength;
+	
+	// The jobserver is "--jobserver-auth=R,W" with a pipe's descriptors (make 4.2 and 4.3), "--jobserver-auth=fifo:PATH" (make 4.4),
+	// or "--jobserver-fds=R,W" (older versions). The last one given is the one that counts.
+	authorization = NULL;
+	
+	for( const char* found = ( makeFlags != NULL ) ? strstr( makeFlags, "--jobserver-" ) : NULL; found != NULL; found = strstr( found + 1, "--jobserver-" ) )
+	{
+		if( strncmp( found, "--jobserver-auth=", 17 ) == 0 )
+		{
+			authorization = found + 17;
+		}
+		else if( strncmp( found, "--jobserver-fds=", 16 ) == 0 )
+		{
+			authorization = found + 16;
+		}
+	}
+	
+	if( authorization == NULL )
+	{
+		return getenv( "MAKELEVEL" ) != NULL ? 0 : wanted;
+	}
+	
+	if( wanted <= 0 )
+	{
+		return 0;
+	}
+	
+	if( strncmp( authorization, "fifo:", 5 ) == 0 )
+	{
+		fifoPath.assign( authorization + 5, strcspn( authorization + 5, " " ) );
+		slots.readDescriptor = open( fifoPath.c_str(), O_RDONLY | O_NONBLOCK );
+		slots.writeDescriptor = open( fifoPath.c_str(), O_WRONLY | O_NONBLOCK );
+	}
+	else if( sscanf( authorization, "%d,%d", &readDescriptor, &writeDescriptor ) == 2 && fcntl( writeDescriptor, F_GETFD ) != -1 )
+	{
+		// Make only passes the pipe to recipes marked "+". Reading it through a descriptor of its own keeps make's blocking.
+		snprintf( descriptorPath, sizeof( descriptorPath ), "/proc/self/fd/%d", readDescriptor );
+		slots.readDescriptor = fcntl( readDescriptor, F_GETFD ) != -1 ? open( descriptorPath, O_RDONLY | O_NONBLOCK ) : -1;
+		slots.writeDescriptor = dup( writeDescriptor );
+	}
+	
+	slots.ownDescriptors = true;
+	
+	if( slots.readDescriptor < 0 || slots.writeDescriptor < 0 )
+	{
+		giveBackJobSlots( slots );
+		return 0;
+	}
+	
+	slots.tokens.resize( wanted );
+	readLength = read( slots.readDescriptor, &slots.tokens[0], wanted );
+	slots.tokens.resize( readLength > 0 ? readLength : 0 );
+	
+	return slots.tokens.size();
+#else
+	return wanted;
+#endif
+}
+
+// Gives the job slots taken back to make's jobserver
+void giveBackJobSlots( JobSlots& slots )
+{
+#ifndef _WIN32
+	if( slots.tokens.empty() == false && slots.writeDescriptor >= 0 )
+	{
+		while( write( slots.writeDescriptor, slots.tokens.data(), slots.tokens.size() ) < 0 && errno == EINTR )
+		{
+		}
+	}
+	
+	if( slots.ownDescriptors )
+	{
+		if( slots.readDescriptor >= 0 )
+		{
+			close( slots.readDescriptor );
+		}
+		
+		if( slots.writeDescriptor >= 0 )
+		{
+			close( slots.writeDescriptor );
+		}
+	}
+	
+	slots.tokens.clear();
+	slots.readDescriptor = slots.writeDescriptor = -1;
+	slots.ownDescriptors = false;
+#endif
+}
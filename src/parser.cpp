@@ -7,85 +7,254 @@
 
 using namespace std;
 
-static TokenFrame currentToken;
-static TokenFrame nextToken;
+// Define data structure for a block the parser is inside of: a procedure declaration, an if statement or a loop
+// kind is PROCEDURE_TOKEN, IF_TOKEN (ELSE_TOKEN once the "else" has been read) or FOR_TOKEN.
+// id is the procedure's symbol, or the ID number of the if or loop block.
+struct ParseFrame
+{
+	TokenKind kind;
+	int id;
+};
+
+// Steps of reading a list of declarations or statements
+// READ_ITEM reads the next one, END_ITEM finishes one that was read, and END_LIST finishes the block whose list has ended.
+enum ParseStep { READ_ITEM, END_ITEM, END_LIST };
+
+// Define data structure for where the top-level procedure being read started, so its code can be kept for the next compile
+// (see finishTopProcedure()) or taken from the last one (see reuseTopProcedure())
+struct TopProcedure
+{
+	const ProcedureRegion* region; // What findTopProcedures() found of it, or NULL if its code can't be kept
+	CacheKey fingerprint;
+	int memoryStart; // Static memory and index slot the procedure's own start at
+	int slotStart;
+	IrPosition codeStart; // Last instruction of its header
+	size_t literalStart; // Its first instruction in the string literal storage
+	int symbolCount; // Symbols in the store before it
+	int warningCount; // Diagnostics before it
+	int errorCount;
+	unsigned int runtimeCalls; // Runtime functions called before it, which are flagged again once it is done
+	vector<int> literals; // Intern id and address of each string literal it adds, in pairs
+};
 
-static int registerPointer = 2; // Keeps track of the next available register
-static int memoryPointer = 1; // Keeps track of first address of available memory for global variables for the runtime environment.
-static int localMemoryPointer = 0; // Keeps track of next available address for local variables in the top-level scope
+// Define data structure for everything the parser keeps track of during a compile (its part of the CompilerContext)
+// readProgram() starts it over for each compile.
+struct ParserState
+{
+	// The parser's view of the lookahead ring: the token being parsed and the one after it
+	TokenFrame* currentToken;
+	TokenFrame* nextToken;
+	
+	int registerPointer; // Keeps track of the next available register
+	int memoryPointer; // Keeps track of first address of available memory for global variables for the runtime environment.
+	int localMemoryPointer; // Keeps track of next available address for local variables in the top-level scope
+	
+	// Stored CODEGEN for string literal storage in memory, appended to the program setup code at the end
+	vector<IrInstruction> literalStorage;
+	
+	// Stores information for the code generator when processing procedure call arguments
+	bool isArgument;
+	int argumentName;
+	int argumentOperands;
+	int arrayIndexPointer;
+	
+	// Keeps track of next available IF block ID number
+	int ifID;
+	
+	// Keeps track of next available LOOP block ID number
+	int loopID;
+	
+	// Intern id of the name of the top-level procedure being read (IR_NO_NAME outside of one), which the labels in it are named after,
+	// and the next available numbers for a label of a call in it and for a procedure nested in it. IF and LOOP block ID numbers start over in each top-level procedure.
+	int labelName;
+	int callID;
+	int nestedID;
+	
+	// Top-level procedures found before the parse, and the code kept from the last compile (NULL if there isn't a cache)
+	ProcedureCache* procedures;
+	int procedureCount; // Number of top-level procedures started so far
+	TopProcedure topProcedure;
+	
+	// With --jobs, the workers that generate the code of the top-level procedures (NULL without), the job of the top-level procedure
+	// being read, which gets the tokens the parser takes (NULL outside of one), and the number of the last job each intern id was seen in
+	ProcedureJobs* jobs;
+	ProcedureJob* job;
+	vector<int> jobNames;
+	
+	// Blocks the parser is inside of, innermost last. Lists and nested blocks are read by loops that keep their place here,
+	// so neither the number of statements nor how deeply blocks are nested uses up the native stack.
+	vector<ParseFrame> parseStack;
+	
+	// Number of blocks of each kind on the parse stack (an if statement counts as IF_TOKEN after its "else" too),
+	// so error recovery can tell in constant time whether an "end" closes a block enclosing the one it is skipping
+	int openBlocks[TOKEN_KIND_COUNT];
+	
+	// How deeply blocks may be nested
+	int nestingLimit;
+	
+	// How deeply the parser is inside parentheses. Expressions are read by recursion, so this is kept below PARENTHESIS_LIMIT.
+	int parenthesisDepth;
+	
+	// Flags to determine which runtime functions to add to the program
+	bool getBool;
+	bool getInteger;
+	bool getFloat;
+	bool getString;
+	bool putBool;
+	bool putInteger;
+	bool putFloat;
+	bool putString;
+	
+	ParserState( void ) : currentToken( NULL ), nextToken( NULL ), registerPointer( 2 ), memoryPointer( 1 ), localMemoryPointer( 0 ), isArgument( false ),
+		argumentName( 0 ), argumentOperands( 0 ), arrayIndexPointer( 6000000 ), ifID( 0 ), loopID( 0 ), labelName( IR_NO_NAME ), callID( 0 ), nestedID( 0 ),
+		procedures( NULL ), procedureCount( 0 ), jobs( NULL ), job( NULL ), nestingLimit( NESTING_LIMIT ), parenthesisDepth( 0 ),
+		getBool( false ), getInteger( false ), getFloat( false ), getString( false ), putBool( false ), putInteger( false ), putFloat( false ), putString( false )
+	{
+		fill( openBlocks, openBlocks + TOKEN_KIND_COUNT, 0 );
+	}
+};
+
+// FIRST and FOLLOW sets of the grammar, so that each decision the parser makes is one bit test on the kind of a token.
+// Reserved words and operators are told apart by kind. Whether a name can start a statement or an expression depends on what
+// the symbol table says it is, so those decisions also look at the token's type.
+static constexpr TokenSet typeMarks = tokenBit( INTEGER_TOKEN ) | tokenBit( FLOAT_TOKEN ) | tokenBit( BOOL_TOKEN ) | tokenBit( STRING_TOKEN );
+static constexpr TokenSet declarationFirst = tokenBit( GLOBAL_TOKEN ) | tokenBit( PROCEDURE_TOKEN ) | typeMarks;
+static constexpr TokenSet programBodyFirst = declarationFirst | tokenBit( BEGIN_TOKEN );
+static constexpr TokenSet variableDeclarationResync = tokenBit( GLOBAL_TOKEN ) | typeMarks | tokenBit( BEGIN_TOKEN ); // Where a declaration missing its ";" is noticed
+static constexpr TokenSet parameterDirections = tokenBit( IN_TOKEN ) | tokenBit( OUT_TOKEN );
+static constexpr TokenSet parameterFollow = tokenBit( COMMA_TOKEN ) | tokenBit( RIGHT_PAREN_TOKEN );
+static constexpr TokenSet statementKeywords = tokenBit( IF_TOKEN ) | tokenBit( FOR_TOKEN ) | tokenBit( RETURN_TOKEN ); // FIRST(statement) apart from names
+static constexpr TokenSet destinationFollow = tokenBit( ASSIGN_TOKEN ) | tokenBit( LEFT_BRACKET_TOKEN ); // Tells an assignment from a procedure call
+static constexpr TokenSet expressionFirst = tokenBit( LEFT_PAREN_TOKEN ) | tokenBit( MINUS_TOKEN ) | tokenBit( NUMBER_TOKEN ) | tokenBit( STRING_LITERAL_TOKEN ) | tokenBit( TRUE_TOKEN ) | tokenBit( FALSE_TOKEN ); // Apart from names
+static constexpr TokenSet expressionOperators = tokenBit( AND_OPERATOR_TOKEN ) | tokenBit( OR_OPERATOR_TOKEN );
+static constexpr TokenSet addingOperators = tokenBit( PLUS_TOKEN ) | tokenBit( MINUS_TOKEN );
+static constexpr TokenSet relationalOperators = tokenBit( LESS_TOKEN ) | tokenBit( GREATER_EQUAL_TOKEN ) | tokenBit( LESS_EQUAL_TOKEN ) | tokenBit( GREATER_TOKEN ) | tokenBit( NOT_EQUAL_TOKEN );
+static constexpr TokenSet multiplyingOperators = tokenBit( MULTIPLY_TOKEN ) | tokenBit( DIVIDE_TOKEN );
 
-// Stored CODEGEN for string literal storage in memory
-static string literalStorage;
+// Synchronization sets for error recovery, and the tokens that open and close blocks
+static constexpr TokenSet statementSync = tokenBit( SEMICOLON_TOKEN ) | tokenBit( END_TOKEN ) | tokenBit( ELSE_TOKEN ); // Follow(statement) and the ends of blocks
+static constexpr TokenSet destinationSync = tokenBit( ASSIGN_TOKEN ) | statementSync;
+static constexpr TokenSet variableDeclarationSync = tokenBit( SEMICOLON_TOKEN ) | variableDeclarationResync;
+static constexpr TokenSet parameterSync = parameterDirections | parameterFollow;
+static constexpr TokenSet blockOpeners = tokenBit( IF_TOKEN ) | tokenBit( FOR_TOKEN ) | tokenBit( PROCEDURE_TOKEN );
+static constexpr TokenSet blockClosers = blockOpeners | tokenBit( PROGRAM_TOKEN ); // What can follow "end"
 
-// Stores information for the code generator when processing procedure call arguments
-static bool isArgument = false;
-static Variable* argumentName;
-static int argumentOperands = 0;
-static int arrayIndexPointer = 6000000;
+// Binding powers of the binary operators, for reading expressions by precedence climbing.
+// An operator with more power binds its operands tighter. In this language's grammar the relational operators bind tighter than "+" and "-".
+enum BindingPower { NO_POWER, LOGICAL_POWER, ADDING_POWER, RELATIONAL_POWER, MULTIPLYING_POWER };
 
-// Keeps track of next available IF block ID number
-static int ifID = 0;
+// Returns the binding power of a token kind, or NO_POWER if it isn't a binary operator
+static constexpr unsigned char operatorPower( const int kind )
+{
+	return ( ( expressionOperators >> kind ) & 1 ) ? LOGICAL_POWER :
+		( ( addingOperators >> kind ) & 1 ) ? ADDING_POWER :
+		( ( relationalOperators >> kind ) & 1 ) ? RELATIONAL_POWER :
+		( ( multiplyingOperators >> kind ) & 1 ) ? MULTIPLYING_POWER : NO_POWER;
+}
 
-// Keeps track of next available LOOP block ID number
-static int loopID = 0;
+#define POWER_4( k ) operatorPower( k ), operatorPower( k + 1 ), operatorPower( k + 2 ), operatorPower( k + 3 )
+#define POWER_16( k ) POWER_4( k ), POWER_4( k + 4 ), POWER_4( k + 8 ), POWER_4( k + 12 )
 
-// Flags to determine which runtime functions to add to the program
-static bool getBool = false;
-static bool getInteger = false;
-static bool getFloat = false;
-static bool getString = false;
-static bool putBool = false;
-static bool putInteger = false;
-static bool putFloat = false;
-static bool putString = false;
+// Binding power of each token kind, built at compile time
+static constexpr unsigned char bindingPowers[64] = { POWER_16( 0 ), POWER_16( 16 ), POWER_16( 32 ), POWER_16( 48 ) };
 
-static void generateRuntime( void );
+#undef POWER_4
+#undef POWER_16
+
+static void advanceToken( void );
 
 // Functions for different stages of the parser. Declared static because they don't need to be visible outside of this file.
 // readProgram() is declared extern in compiler.h because it is called from the main function in a different file.
+static void startParse( const int newNestingLimit, ProcedureCache* procedures, ProcedureJobs* jobs );
 static void readProgramHeader( void );
 static void readProgramBody( void );
-static void readDeclarations( Procedure*& currentProcedure );
-static void readProcedureDeclaration( const bool isGlobal );
-static void readProcedureHeader( Procedure*& currentProcedure, const bool isGlobal );
-static void readParameterList( Procedure*& currentProcedure );
-static void readParameter( Procedure*& currentProcedure );
-static void readProcedureBody( Procedure*& currentProcedure );
-static void readVariableDeclaration( Procedure*& currentProcedure, const bool isGlobal, const bool isParameter );
-static void readStatements( Procedure*& currentProcedure );
-static void readProcedureCall( Procedure*& currentProcedure );
-static void readArgumentList( Procedure*& currentProcedure, Procedure*& myProcedure, int parameterNumber, int& argumentCount, string& returnCode );
-static void readAssignment( Procedure*& currentProcedure );
-static DataType readDestination( Procedure*& currentProcedure, Variable*& myVariable, string& destinationCode );
-static void readIf( Procedure*& currentProcedure );
-static void readLoop( Procedure*& currentProcedure ); // ****
-static DataType readExpression( Procedure*& currentProcedure, int& resultRegister );
-static DataType readArithOp( Procedure*& currentProcedure, int& resultRegister );
-static DataType readRelation( Procedure*& currentProcedure, int& resultRegister ); // ****
-static DataType readTerm( Procedure*& currentProcedure, int& resultRegister );
-static DataType readFactor( Procedure*& currentProcedure, int& resultRegister );
-static DataType readName( Procedure*& currentProcedure, int& resultRegister );
+static void readDeclarations( int& currentProcedure );
+static void enterBlock( const TokenKind kind, const int id );
+static void leaveBlock( void );
+static void recover( CompileErrorException& e, const TokenSet syncSet );
+static void skipTo( const TokenSet syncSet );
+static bool skipBlock( const TokenKind blockKind );
+static void readProcedureHeader( int& currentProcedure, const bool isGlobal );
+static IrOperand procedureLabel( const int procedure );
+static void readParameterList( int& currentProcedure );
+static void readParameter( int& currentProcedure );
+static void readProcedureBody( int& currentProcedure );
+static void leaveProcedure( void );
+static void beginTopProcedure( const bool isGlobal );
+static bool reuseTopProcedure( void );
+static void finishTopProcedure( void );
+static void skimTopProcedure( void );
+static void addJobSymbol( ProcedureJob& job, const int symbol );
+static void stitchTopProcedures( void );
+static void moveIndexSlots( vector<IrInstruction>& code, const int offset );
+static unsigned int runtimeCalls( void );
+static void addRuntimeCalls( const unsigned int calls );
+static void generateReturn( const int currentProcedure );
+static bool recoverProcedure( CompileErrorException& e );
+static void readVariableDeclaration( int& currentProcedure, const bool isGlobal, const bool isParameter );
+static void readStatements( int& currentProcedure );
+static ParseStep readStatement( int& currentProcedure );
+static void readProcedureCall( int& currentProcedure );
+static void readArgumentList( int& currentProcedure, int& myProcedure, int& argumentCount, vector<IrInstruction>& returnCode );
+static void readAssignment( int& currentProcedure );
+static void generateAssignment( IrOperand destination, const IrType destinationType, const int resultRegister, const IrType resultType );
+static DataType readDestination( int& currentProcedure, int& myVariable, IrOperand& destination );
+static void readIf( int& currentProcedure, const int myID );
+static void readLoop( int& currentProcedure, const int myID ); // ****
+static void generateBranch( const int resultRegister, const IrLabelKind startLabel, const IrLabelKind endLabel, const int myID );
+static ParseStep readBlockEnd( void );
+static bool recoverBlock( CompileErrorException& e );
+static DataType readExpression( int& currentProcedure, int& resultRegister );
+static DataType readOperation( int& currentProcedure, int& resultRegister, const int minimumPower );
+static void checkOperand( const int power, const DataType operandType );
+static DataType combineOperands( const int power, const int operatorID, const DataType resultType, const DataType leftType, const DataType rightType, int leftRegister, int rightRegister );
+static DataType readFactor( int& currentProcedure, int& resultRegister );
+static DataType readName( int& currentProcedure, int& resultRegister );
+
+// Makes the parser's part of a new context
+ParserState* newParserState( void )
+{
+	return new ParserState();
+}
+
+void deleteParserState( ParserState* state )
+{
+	delete state->job;
+	delete state;
+}
 
 // This function begins parsing of the grammar/syntax with the first grammar rule
-void readProgram( void )
+void readProgram( const int newNestingLimit, ProcedureCache* procedures, ProcedureJobs* jobs )
 {
+	ParserState& parser = *context->parser;
+	
+	startParse( newNestingLimit, procedures, jobs );
+	
+	// CODEGEN: Set up the stack pointer and start with the program setup code
+	irAppend( IR_MOVE, irRegister( 0, IR_INTEGER ), irInteger( MEMORY_SIZE ) );
+	irAppend( IR_JUMP, irNone, irLabel( PROGRAM_SETUP_LABEL, IR_NO_NAME, 0 ) );
+	irBlankLine();
+	
 	try
 	{
 		readProgramHeader(); // First read the program header
 		readProgramBody(); // Next, read the program body
 		
-		// CODEGEN: Output the rest of the program setup code (string literals)
-		if( errorCount == 0 )
+		// CODEGEN: Add the rest of the program setup code (string literals)
+		if( context->errorCount == 0 )
 		{
-			outFile << "\treturn 0;" << endl;
-			outFile << endl;
-			outFile << "\tprogramsetup:" << endl;
-			outFile << "\tR[1].intVal = " << memoryPointer << ";" << endl;
-			outFile << literalStorage;
-			outFile << "\tgoto programbody;" << endl;
-			outFile << endl;
+			irAppend( IR_EXIT, irNone, irNone );
+			irBlankLine();
+			irAppend( IR_LABEL, irNone, irLabel( PROGRAM_SETUP_LABEL, IR_NO_NAME, 0 ) );
+			irAppend( IR_MOVE, irRegister( 1, IR_INTEGER ), irInteger( parser.memoryPointer ) );
+			
+			for( int i = 0; i < parser.literalStorage.size(); i++ )
+			{
+				irAppend( parser.literalStorage[i] );
+			}
 			
-			generateRuntime();
+			irAppend( IR_JUMP, irNone, irLabel( PROGRAM_BODY_LABEL, IR_NO_NAME, 0 ) );
+			irBlankLine();
 		}
 	}
 	catch( CompileErrorException& e )
@@ -95,22 +264,93 @@ void readProgram( void )
 	}
 }
 
+// Reads the top-level procedure of a --jobs worker (see parallel.cpp). Its scanner hands out the procedure's tokens,
+// and its symbol table holds the symbols of the program the procedure can see. The code after the procedure's header,
+// which is what the parse of the program left out, is kept in the job if it compiled the way the skim of it expected.
+void readJobProcedure( ProcedureJob& job, const int newNestingLimit )
+{
+	ParserState& parser = *context->parser;
+	int currentProcedure = NO_SYMBOL;
+	
+	startParse( newNestingLimit, NULL, NULL );
+	parser.memoryPointer = job.memoryStart;
+	parser.arrayIndexPointer = 0;
+	
+	try
+	{
+		parser.currentToken = &lookaheadToken( 0 );
+		parser.nextToken = &lookaheadToken( 1 );
+		
+		readDeclarations( currentProcedure );
+	}
+	catch( CompileErrorException& e )
+	{
+		reportError( e.what() );
+	}
+	
+	job.compiled = context->errorCount == 0 && context->warningCount == 0 && parser.currentToken->kind == END_OF_INPUT_TOKEN &&
+		parser.memoryPointer == job.memoryEnd && parser.topProcedure.literals == job.literals;
+	
+	if( job.compiled )
+	{
+		copyIr( parser.topProcedure.codeStart, job.fragment.code );
+		job.fragment.setupCode.assign( parser.literalStorage.begin() + parser.topProcedure.literalStart, parser.literalStorage.end() );
+		job.fragment.memoryUsed = parser.memoryPointer - job.memoryStart;
+		job.fragment.slotsUsed = parser.arrayIndexPointer;
+		job.fragment.runtimeCalls = runtimeCalls();
+	}
+}
+
+// Starts the parser from the same state as a new context, so a context can be used for one compile after another.
+// The buffers are kept for the next program.
+void startParse( const int newNestingLimit, ProcedureCache* procedures, ProcedureJobs* jobs )
+{
+	ParserState& parser = *context->parser;
+	
+	parser.registerPointer = 2;
+	parser.memoryPointer = 1;
+	parser.localMemoryPointer = 0;
+	parser.isArgument = false;
+	parser.argumentName = 0;
+	parser.argumentOperands = 0;
+	parser.arrayIndexPointer = 6000000;
+	parser.ifID = 0;
+	parser.loopID = 0;
+	parser.labelName = IR_NO_NAME;
+	parser.callID = 0;
+	parser.nestedID = 0;
+	parser.procedures = procedures;
+	parser.procedureCount = 0;
+	parser.jobs = jobs;
+	delete parser.job;
+	parser.job = NULL;
+	parser.getBool = parser.getInteger = parser.getFloat = parser.getString = false;
+	parser.putBool = parser.putInteger = parser.putFloat = parser.putString = false;
+	
+	parser.nestingLimit = newNestingLimit;
+	parser.parseStack.clear();
+	fill( parser.openBlocks, parser.openBlocks + TOKEN_KIND_COUNT, 0 );
+	parser.parenthesisDepth = 0;
+	parser.literalStorage.clear();
+	resetIr();
+}
+
 void readProgramHeader( void )
 {
-	Token* myToken = NULL;
+	ParserState& parser = *context->parser;
+	int myToken = NO_SYMBOL;
 	
 	try
 	{
 		// Start by getting the first token
-		currentToken = getToken();
-		nextToken = getToken();
+		parser.currentToken = &lookaheadToken( 0 );
+		parser.nextToken = &lookaheadToken( 1 );
 		
 		// The first token must be "program"
-		if( currentToken.name.compare( "program" ) == 0 )
+		if( parser.currentToken->kind == PROGRAM_TOKEN )
 		{
 			// Advance token to after "program"
-			currentToken = nextToken;
-			nextToken = getToken();
+			advanceToken();
 		}
 		else
 		{
@@ -118,26 +358,24 @@ void readProgramHeader( void )
 		}
 		
 		// Second token of the header must be an identifier
-		if( currentToken.tokenType == NONE )
+		if( parser.currentToken->tokenType == NONE )
 		{
-			myToken = new Token( RESERVE, currentToken.name, true );
+			myToken = newNameSymbol( RESERVE, parser.currentToken->nameID, true );
 			addSymbolEntry( myToken );
 			
 			// Advance token to after the identifier
-			currentToken = nextToken;
-			nextToken = getToken();
+			advanceToken();
 		}
 		else
 		{
-			throw CompileErrorException( "Illegal program identifier: " + currentToken.name );
+			throw CompileErrorException( "Illegal program identifier: " + parser.currentToken->getName() );
 		}
 		
 		// Third token of the header must be "is"
-		if( currentToken.name.compare( "is" ) == 0 )
+		if( parser.currentToken->kind == IS_TOKEN )
 		{
 			// Advance token to after "is"
-			currentToken = nextToken;
-			nextToken = getToken();
+			advanceToken();
 		}
 		else
 		{
@@ -146,40 +384,33 @@ void readProgramHeader( void )
 	}
 	catch( CompileErrorException& e )
 	{
-		// Display the compiler's error message
-		reportError( e.what() );
-		
 		// Resync to Program Body
-		while( inFile.good() )
-		{
-			if( currentToken.name.compare( "global" ) == 0 || currentToken.name.compare( "procedure" ) == 0 || currentToken.name.compare( "integer" ) == 0 || currentToken.name.compare( "float" ) == 0 || currentToken.name.compare( "bool" ) == 0 || currentToken.name.compare( "string" ) == 0 || currentToken.name.compare( "begin" ) == 0 )
-			{
-				break;
-			}
-			
-			currentToken = nextToken;
-			nextToken = getToken();
-		}
+		recover( e, programBodyFirst );
 	}
 }
 
 void readProgramBody( void )
 {
-	Procedure* currentProcedure = NULL;
+	ParserState& parser = *context->parser;
+	int currentProcedure = NO_SYMBOL;
 	// currentToken is pointing to first declaration or begin
 	
 	// Check if there are any declarations
-	if( currentToken.name.compare( "global" ) == 0 || currentToken.name.compare( "procedure" ) == 0 || currentToken.name.compare( "integer" ) == 0 || currentToken.name.compare( "float" ) == 0 || currentToken.name.compare( "bool" ) == 0 || currentToken.name.compare( "string" ) == 0 )
+	if( parser.currentToken->isIn( declarationFirst ) )
 	{
 		readDeclarations( currentProcedure );
 	}
 	
+	if( parser.jobs != NULL )
+	{
+		stitchTopProcedures();
+	}
+	
 	// Look for "begin"
-	if( currentToken.name.compare( "begin" ) == 0 )
+	if( parser.currentToken->kind == BEGIN_TOKEN )
 	{
 		// Advance Token to after "begin"
-		currentToken = nextToken;
-		nextToken = getToken();
+		advanceToken();
 	}
 	else
 	{
@@ -187,50 +418,56 @@ void readProgramBody( void )
 	}
 	
 	// CODEGEN: Update stack pointer and array declaration code
-	if( errorCount == 0 )
+	if( context->errorCount == 0 )
 	{
-		outFile << "\tprogrambody:" << endl;
-		outFile << "\tR[0].intVal = R[0].intVal - " << localMemoryPointer << ";" << endl;
-		outFile << endl;
+		irAppend( IR_LABEL, irNone, irLabel( PROGRAM_BODY_LABEL, IR_NO_NAME, 0 ) );
+		irAppend( IR_SUBTRACT, irRegister( 0, IR_INTEGER ), irRegister( 0, IR_INTEGER ), irInteger( parser.localMemoryPointer ) );
+		irBlankLine();
 	}
 	
 	// Look for block of statements
-	if( currentToken.tokenType == IDENTIFIER || currentToken.name.compare( "if" ) == 0 || currentToken.name.compare( "for" ) == 0 || currentToken.name.compare( "return" ) == 0 || currentToken.tokenType == NONE )
+	if( parser.currentToken->isIn( statementKeywords ) || parser.currentToken->tokenType == IDENTIFIER || parser.currentToken->tokenType == NONE )
 	{
 		readStatements( currentProcedure );
 	}
 	
-	// Check if there are any declarations in the statement section
-	if( currentToken.name.compare( "global" ) == 0 || currentToken.name.compare( "procedure" ) == 0 || currentToken.name.compare( "integer" ) == 0 || currentToken.name.compare( "float" ) == 0 || currentToken.name.compare( "bool" ) == 0 || currentToken.name.compare( "string" ) == 0 )
+	// The "end" of an if statement, loop or procedure with no block open is reported and skipped, so the statements after it are still checked
+	while( parser.currentToken->kind == END_TOKEN && parser.nextToken->isIn( blockOpeners ) )
 	{
-		reportError( "Incorrect Program Body: Declarations must be before \'begin\'" );
+		reportError( "\'end " + parser.nextToken->getName() + "\' does not close an open block" );
+		
+		// Advance Token to after "end" and the block keyword
+		advanceToken();
+		advanceToken();
 		
-		// resync to "end program" because the parse cannot recover from this position
-		while( inFile.good() )
+		if( parser.currentToken->kind == SEMICOLON_TOKEN )
 		{
-			if( currentToken.name.compare( "end" ) == 0 )
-			{
-				currentToken = nextToken;
-				nextToken = getToken();
-				
-				if( currentToken.name.compare( "program" ) == 0 )
-				{
-					return;
-				}
-			}
-			
-			currentToken = getToken();
+			advanceToken();
+		}
+		
+		if( parser.currentToken->isIn( statementKeywords ) || parser.currentToken->tokenType == IDENTIFIER || parser.currentToken->tokenType == NONE )
+		{
+			readStatements( currentProcedure );
 		}
 	}
 	
+	// Check if there are any declarations in the statement section
+	if( parser.currentToken->isIn( declarationFirst ) )
+	{
+		reportError( "Incorrect Program Body: Declarations must be before \'begin\'" );
+		
+		// resync to after "end program" because the parse cannot recover from this position
+		skipBlock( PROGRAM_TOKEN );
+		return;
+	}
+	
 	// Look for "end program"
-	if( currentToken.name.compare( "end" ) == 0 )
+	if( parser.currentToken->kind == END_TOKEN )
 	{
 		// Advance Token for after "end"
-		currentToken = nextToken;
-		nextToken = getToken();
+		advanceToken();
 		
-		if( currentToken.name.compare( "program" ) != 0 )
+		if( parser.currentToken->kind != PROGRAM_TOKEN )
 		{
 			throw CompileErrorException( "Incorrect end of program body" );
 		}
@@ -241,188 +478,676 @@ void readProgramBody( void )
 	}
 }
 
-void readDeclarations( Procedure*& currentProcedure )
+// Reads the declarations of the program or a procedure.
+// A procedure declaration is read in the same loop: its frame on the parse stack holds the procedure while its own declarations
+// are read, and when they end its body is read and the loop carries on with the declarations after it.
+void readDeclarations( int& currentProcedure )
 {
+	ParserState& parser = *context->parser;
+	const int outerDepth = parser.parseStack.size(); // Frames below this belong to whoever called this function
+	ParseStep step = READ_ITEM;
+	int bodyProcedure; // Procedure whose body is being read
 	bool isGlobal; // Flag to tell whether declaration is global.
 	// currentToken is pointing to the first declaration
 	
-	while( inFile.good() )
+	while( true )
 	{
-		isGlobal = false;
-		
-		// Check if it's a global declaration
-		if( currentToken.name.compare( "global" ) == 0 )
+		try
 		{
-			if( currentScope == 0 )
+			switch( step )
 			{
-				isGlobal = true;
+				case READ_ITEM:
+					if( !moreInput() )
+					{
+						step = END_LIST;
+						break;
+					}
+					
+					isGlobal = false;
+					
+					// Check if it's a global declaration
+					if( parser.currentToken->kind == GLOBAL_TOKEN )
+					{
+						if( context->currentScope == 0 )
+						{
+							isGlobal = true;
+						}
+						else
+						{
+							isGlobal = false;
+							reportWarning( "Variables and functions may only be declared global in the outermost scope. Setting to local." );
+						}
+						
+						// Advance Token for after "global"
+						advanceToken();
+					}
+					
+					// Check if it's a procedure declaration
+					if( parser.currentToken->kind == PROCEDURE_TOKEN )
+					{
+						if( context->currentScope == 0 )
+						{
+							beginTopProcedure( isGlobal );
+						}
+						
+						// create new scope
+						enterScope();
+						enterBlock( PROCEDURE_TOKEN, NO_SYMBOL );
+						
+						readProcedureHeader( parser.parseStack.back().id, isGlobal ); // First read the procedure header
+						
+						// A top-level procedure that hasn't changed since the last compile isn't read any further
+						if( context->currentScope == 1 && reuseTopProcedure() )
+						{
+							step = END_ITEM;
+							break;
+						}
+						
+						// Then read the procedure's declarations, if it has any, before the rest of its body
+						step = parser.currentToken->isIn( declarationFirst ) ? READ_ITEM : END_LIST;
+					}
+					// Check if it's a variable declaration
+					else if( parser.currentToken->isIn( typeMarks ) )
+					{
+						readVariableDeclaration( ( parser.parseStack.size() > outerDepth ) ? parser.parseStack.back().id : currentProcedure, isGlobal, false );
+						step = END_ITEM;
+					}
+					// This block is for invalid syntax in the declaration section
+					else
+					{
+						throw CompileErrorException( "Unrecognized declaration" );
+					}
+					break;
+				
+				case END_ITEM:
+					// Check for a ";" after the declaration
+					if( parser.currentToken->kind == SEMICOLON_TOKEN )
+					{
+						// Advance Token to after the ";"
+						advanceToken();
+					}
+					else
+					{
+						reportError( "Expected ';' before \'" + parser.currentToken->getName() + "\'. Not found" );
+					}
+					
+					// Finished with declarations if we don't see anymore declaration keywords
+					step = parser.currentToken->isIn( declarationFirst ) ? READ_ITEM : END_LIST;
+					break;
+				
+				case END_LIST:
+					if( parser.parseStack.size() == outerDepth )
+					{
+						return;
+					}
+					
+					// The declarations of the innermost procedure have ended, so read the rest of its body.
+					// Its statements push blocks on the parse stack, so the procedure is passed as a copy.
+					bodyProcedure = parser.parseStack.back().id;
+					readProcedureBody( bodyProcedure );
+					leaveProcedure();
+					
+					if( context->currentScope == 0 )
+					{
+						finishTopProcedure();
+					}
+					
+					step = END_ITEM;
+					break;
 			}
-			else
+		}
+		catch( CompileErrorException& e )
+		{
+			if( parser.parseStack.size() == outerDepth )
 			{
-				isGlobal = false;
-				reportWarning( "Variables and functions may only be declared global in the outermost scope. Setting to local." );
+				throw;
 			}
 			
-			// Advance Token for after "global"
-			currentToken = nextToken;
-			nextToken = getToken();
+			// Carry on after the procedure, or finish the enclosing block if recovery stopped at its end
+			step = recoverProcedure( e ) ? END_ITEM : END_LIST;
+			
+			if( context->currentScope == 0 )
+			{
+				finishTopProcedure();
+			}
 		}
+	}
+}
+
+// Puts a block on the parse stack, giving an error if that nests blocks too deeply
+void enterBlock( const TokenKind kind, const int id )
+{
+	ParserState& parser = *context->parser;
+	ParseFrame frame = { kind, id };
+	
+	parser.parseStack.push_back( frame );
+	parser.openBlocks[kind]++;
+	
+	if( parser.parseStack.size() > parser.nestingLimit )
+	{
+		ostringstream convert;
+		convert << parser.nestingLimit;
+		throw CompileErrorException( "Blocks are nested more than " + convert.str() + " deep" );
+	}
+}
+
+// Takes the innermost block off the parse stack
+void leaveBlock( void )
+{
+	ParserState& parser = *context->parser;
+	const TokenKind kind = parser.parseStack.back().kind;
+	
+	parser.openBlocks[( kind == ELSE_TOKEN ) ? IF_TOKEN : kind]--;
+	parser.parseStack.pop_back();
+}
+
+// Takes the innermost procedure off the parse stack and leaves its scope
+void leaveProcedure( void )
+{
+	ParserState& parser = *context->parser;
+	TokenFrame* takenToken;
+	
+	leaveBlock();
+	
+	// Leave the scope, which takes its symbols out of the symbol table.
+	// The records the table referred to stay in the symbol store until the compilation ends.
+	leaveScope();
+	
+	// The parser has already taken the tokens in front of it, and their names were looked up in the scope that was just removed.
+	// Look them up again so that they don't refer to its symbols.
+	for( int i = 0; i < 2; i++ )
+	{
+		takenToken = ( i == 0 ) ? parser.currentToken : parser.nextToken;
 		
-		// Check if it's a procedure declaration
-		if( currentToken.name.compare( "procedure" ) == 0 )
+		if( takenToken->tokenType == NONE || takenToken->symbol != NO_SYMBOL )
 		{
-			readProcedureDeclaration( isGlobal );
+			findSymbolEntry( *takenToken );
 		}
-		// Check if it's a variable declaration
-		else if( currentToken.name.compare( "integer" ) == 0 || currentToken.name.compare( "float" ) == 0 || currentToken.name.compare( "bool" ) == 0 || currentToken.name.compare( "string" ) == 0 )
+	}
+}
+
+// Starts reading a top-level procedure, whose "procedure" is the current token: its labels are named after it,
+// and if there is a cache, what its code depends on is noted so that the code can be kept or taken from the last compile
+void beginTopProcedure( const bool isGlobal )
+{
+	ParserState& parser = *context->parser;
+	TopProcedure& procedure = parser.topProcedure;
+	
+	parser.labelName = parser.nextToken->nameID;
+	parser.ifID = 0;
+	parser.loopID = 0;
+	parser.callID = 0;
+	parser.nestedID = 0;
+	
+	procedure.region = NULL;
+	procedure.memoryStart = parser.memoryPointer;
+	procedure.slotStart = parser.arrayIndexPointer;
+	procedure.literalStart = parser.literalStorage.size();
+	procedure.symbolCount = context->symbolStore.records.size();
+	procedure.warningCount = context->warningCount;
+	procedure.errorCount = context->errorCount;
+	procedure.literals.clear();
+	
+	// Flag only the runtime functions the procedure calls while it is read, then add back the ones before it
+	procedure.runtimeCalls = runtimeCalls();
+	parser.getBool = parser.getInteger = parser.getFloat = parser.getString = false;
+	parser.putBool = parser.putInteger = parser.putFloat = parser.putString = false;
+	
+	// The procedure has to be the one findTopProcedures() found in the same place, and code is only kept from a compile without errors
+	if( parser.procedures != NULL && context->errorCount == 0 && parser.procedureCount < parser.procedures->regions.size() &&
+		parser.procedures->regions[parser.procedureCount].line == parser.currentToken->line )
+	{
+		procedure.region = &parser.procedures->regions[parser.procedureCount];
+		procedure.fingerprint = procedureFingerprint( *procedure.region, isGlobal );
+	}
+	
+	// With --jobs, the tokens of the procedure are kept from here on for a worker, starting with the "global" before it
+	if( parser.jobs != NULL )
+	{
+		delete parser.job;
+		parser.job = new ProcedureJob();
+		parser.job->memoryStart = parser.memoryPointer;
+		parser.job->slotStart = parser.arrayIndexPointer;
+		parser.job->literalStart = parser.literalStorage.size();
+		parser.job->compiled = false;
+		
+		if( isGlobal )
+		{
+			TokenFrame global = *parser.currentToken;
+			
+			global.tokenType = RESERVE;
+			global.kind = GLOBAL_TOKEN;
+			global.nameID = GLOBAL_TOKEN;
+			global.isGlobal = true;
+			global.symbol = NO_SYMBOL;
+			global.numberType = INVALID;
+			global.intValue = 0;
+			parser.job->tokens.push_back( global );
+		}
+	}
+	
+	parser.procedureCount++;
+}
+
+// Takes the code of the top-level procedure whose header was just read from the last compile, if it hasn't changed since,
+// and skips the rest of it. Returns false if the procedure has to be read.
+bool reuseTopProcedure( void )
+{
+	ParserState& parser = *context->parser;
+	TopProcedure& procedure = parser.topProcedure;
+	const ProcedureFragment* kept;
+	ProcedureFragment fragment;
+	int myVariable;
+	
+	procedure.codeStart = irPosition();
+	
+	if( parser.job != NULL )
+	{
+		skimTopProcedure();
+		return true;
+	}
+	
+	if( procedure.region == NULL || context->errorCount != 0 || context->warningCount != procedure.warningCount )
+	{
+		return false;
+	}
+	
+	kept = findFragment( *parser.procedures, procedure.fingerprint );
+	
+	if( kept == NULL )
+	{
+		return false;
+	}
+	
+	fragment = *kept;
+	
+	if( unpackFragment( fragment, *procedure.region, procedure.memoryStart, procedure.slotStart ) == false )
+	{
+		return false;
+	}
+	
+	// CODEGEN: Splice in the procedure's code and string literal storage
+	for( size_t i = 0; i < fragment.code.size(); i++ )
+	{
+		irAppend( fragment.code[i] );
+	}
+	
+	parser.literalStorage.insert( parser.literalStorage.end(), fragment.setupCode.begin(), fragment.setupCode.end() );
+	
+	// Declare the string literals it added, for the procedures and program body after it
+	for( size_t i = 0; i + 1 < fragment.literals.size(); i += 2 )
+	{
+		myVariable = newVariableSymbol( STRING, fragment.literals[i], STRINGT, true, fragment.literals[i + 1], false );
+		addSymbolEntry( myVariable );
+	}
+	
+	parser.memoryPointer = procedure.memoryStart + fragment.memoryUsed;
+	parser.arrayIndexPointer = procedure.slotStart + fragment.slotsUsed;
+	addRuntimeCalls( fragment.runtimeCalls );
+	
+	// Skip the rest of the procedure, which has been checked before
+	skipBlock( PROCEDURE_TOKEN );
+	leaveProcedure();
+	
+	parser.procedures->compiled.push_back( *kept );
+	parser.procedures->reusedCount++;
+	procedure.region = NULL;
+	finishTopProcedure();
+	
+	return true;
+}
+
+// Finishes a top-level procedure that has been read. If there is a cache and the procedure compiled without a diagnostic,
+// its code is kept for the next compile.
+void finishTopProcedure( void )
+{
+	ParserState& parser = *context->parser;
+	TopProcedure& procedure = parser.topProcedure;
+	ProcedureFragment fragment;
+	
+	if( procedure.region != NULL && context->errorCount == 0 && context->warningCount == procedure.warningCount )
+	{
+		fragment.fingerprint = procedure.fingerprint;
+		fragment.memoryUsed = parser.memoryPointer - procedure.memoryStart;
+		fragment.slotsUsed = parser.arrayIndexPointer - procedure.slotStart;
+		fragment.runtimeCalls = runtimeCalls();
+		copyIr( procedure.codeStart, fragment.code );
+		fragment.setupCode.assign( parser.literalStorage.begin() + procedure.literalStart, parser.literalStorage.end() );
+		fragment.literals = procedure.literals;
+		
+		if( packFragment( fragment, *procedure.region, procedure.memoryStart, procedure.slotStart ) )
 		{
-			readVariableDeclaration( currentProcedure, isGlobal, false );
+			parser.procedures->compiled.push_back( fragment );
+			parser.procedures->compiledCount++;
 		}
-		// This block is for invalid syntax in the declaration section
-		else
+	}
+	
+	// A job that wasn't handed out had an error in the procedure's header, which makes the compile fall back to one without workers
+	delete parser.job;
+	parser.job = NULL;
+	
+	procedure.region = NULL;
+	parser.labelName = IR_NO_NAME;
+	parser.ifID = 0;
+	parser.loopID = 0;
+	addRuntimeCalls( procedure.runtimeCalls );
+}
+
+// Skims the rest of the top-level procedure whose header was just read, and hands it to a worker to generate its code.
+// The skim takes the static memory the procedure's arrays take and declares the string literals it adds, the same way reading it would,
+// so the procedures and program body after it are read the same. The worker checks that it read the procedure the same way.
+void skimTopProcedure( void )
+{
+	ParserState& parser = *context->parser;
+	ProcedureJob& job = *parser.job;
+	TokenKind lastKinds[2] = { PROCEDURE_TOKEN, PROCEDURE_TOKEN }; // Kinds of the last token taken and the one before it
+	int depth = 1; // How many procedures the token is inside of
+	int myVariable;
+	
+	while( depth > 0 && moreInput() )
+	{
+		if( parser.currentToken->kind == PROCEDURE_TOKEN )
 		{
-			throw CompileErrorException( "Unrecognized declaration" );
+			depth += ( lastKinds[0] == END_TOKEN ) ? -1 : 1;
 		}
-		
-		// Check for a ";" after the declaration
-		if( currentToken.name.compare( ";" ) == 0 )
+		else if( parser.currentToken->kind == LEFT_BRACKET_TOKEN && lastKinds[0] == NAME_TOKEN && ( ( typeMarks >> lastKinds[1] ) & 1 ) &&
+			parser.nextToken->tokenType == NUMBER )
 		{
-			// Advance Token to after the ";"
-			currentToken = nextToken;
-			nextToken = getToken();
+			if( parser.nextToken->numberType == FLOAT )
+			{
+				parser.memoryPointer += parser.nextToken->floatValue < 2147483648.0f ? static_cast<int>( parser.nextToken->floatValue ) : 2147483647;
+			}
+			else
+			{
+				parser.memoryPointer += parser.nextToken->intValue;
+			}
 		}
-		else
+		else if( parser.currentToken->kind == STRING_LITERAL_TOKEN && lookupGlobalSymbol( parser.currentToken->nameID ) == NO_SYMBOL )
 		{
-			reportError( "Expected ';' before \'" + currentToken.name + "\'. Not found" );
+			myVariable = newVariableSymbol( STRING, parser.currentToken->nameID, STRINGT, true, parser.memoryPointer, false );
+			addSymbolEntry( myVariable );
+			job.literals.push_back( parser.currentToken->nameID );
+			job.literals.push_back( parser.memoryPointer );
+			parser.memoryPointer += ( parser.currentToken->getName().size() - 1 );
 		}
 		
-		// Finished with declarations if we don't see anymore declaration keywords
-		if( currentToken.name.compare( "global" ) != 0 && currentToken.name.compare( "procedure" ) != 0 && currentToken.name.compare( "integer" ) != 0 && currentToken.name.compare( "float" ) != 0 && currentToken.name.compare( "bool" ) != 0 && currentToken.name.compare( "string" ) != 0 )
+		lastKinds[1] = lastKinds[0];
+		lastKinds[0] = parser.currentToken->kind;
+		advanceToken();
+	}
+	
+	// The worker also reads the ";" after the procedure, to know the procedure has ended
+	job.tokens.push_back( *parser.currentToken );
+	parser.job = NULL;
+	leaveProcedure();
+	
+	job.memoryEnd = parser.memoryPointer;
+	job.codeStart = parser.topProcedure.codeStart;
+	
+	// Give the worker the tokens as the scanner gave them, and the symbols outside of the procedure that its names can be found as
+	for( size_t i = 0; i < job.tokens.size(); i++ )
+	{
+		TokenFrame& token = job.tokens[i];
+		
+		if( token.kind == NAME_TOKEN || token.kind == STRING_LITERAL_TOKEN )
 		{
-			break;
+			token.tokenType = ( token.kind == NAME_TOKEN ) ? NONE : STRING;
+			token.isGlobal = false;
+			token.symbol = NO_SYMBOL;
+			
+			if( token.nameID >= static_cast<int>( parser.jobNames.size() ) )
+			{
+				parser.jobNames.resize( token.nameID + 1, 0 );
+			}
+			
+			if( parser.jobNames[token.nameID] != parser.procedureCount )
+			{
+				parser.jobNames[token.nameID] = parser.procedureCount;
+				addJobSymbol( job, lookupGlobalSymbol( token.nameID ) );
+				addJobSymbol( job, lookupLocalSymbol( token.nameID ) );
+			}
 		}
 	}
+	
+	addProcedureJob( parser.jobs, &job );
+	finishTopProcedure();
+}
+
+// Gives a job a copy of a symbol declared before its procedure (not NO_SYMBOL, or one of the procedure's own)
+void addJobSymbol( ProcedureJob& job, const int symbol )
+{
+	if( symbol != NO_SYMBOL && symbol < context->parser->topProcedure.symbolCount )
+	{
+		job.symbols.push_back( SymbolCopy() );
+		copySymbol( symbol, job.symbols.back() );
+	}
 }
 
-void readProcedureDeclaration( const bool isGlobal )
+// Splices in the code the workers generated for the top-level procedures, once the parse of the program has read its declarations.
+// A job that didn't compile is left out, which makes the compile fall back to one without workers.
+void stitchTopProcedures( void )
 {
-	Procedure* currentProcedure = NULL; // Pointer to the symbol table entry for the current procedure being declared
-	SymbolTable::iterator janitor;
-	bool checkName;
-	int nestedCount;
+	ParserState& parser = *context->parser;
+	vector<IrInstruction> literalStorage; // The string literal storage with the procedures' own put in
+	size_t literalsCopied = 0; // How much of the program's literal storage is in it
+	int slotsUsed = 0; // Index slots of the procedures before the job
 	
-	try
+	finishProcedureJobs( parser.jobs );
+	literalStorage.reserve( parser.literalStorage.size() );
+	
+	for( int i = 0; i < procedureJobCount( parser.jobs ); i++ )
 	{
-		// create new scope, its associated symbol table, and associated local variable counter
-		currentScope++;
-		localSymbolTable.push_back( SymbolTable() );
-		localSymbolTable[currentScope].clear();
+		ProcedureJob& job = procedureJob( parser.jobs, i );
 		
-		readProcedureHeader( currentProcedure, isGlobal ); // First read the procedure header
+		if( job.compiled == false )
+		{
+			continue;
+		}
 		
-		readProcedureBody( currentProcedure ); // Second, read the procedure body
+		moveIndexSlots( job.fragment.code, job.slotStart + slotsUsed );
+		moveIndexSlots( job.fragment.setupCode, job.slotStart + slotsUsed );
+		job.compiled = insertIr( job.codeStart, job.fragment.code );
+		
+		literalStorage.insert( literalStorage.end(), parser.literalStorage.begin() + literalsCopied, parser.literalStorage.begin() + job.literalStart );
+		literalStorage.insert( literalStorage.end(), job.fragment.setupCode.begin(), job.fragment.setupCode.end() );
+		literalsCopied = job.literalStart;
+		
+		slotsUsed += job.fragment.slotsUsed;
+		addRuntimeCalls( job.fragment.runtimeCalls );
 	}
-	catch( CompileErrorException& e )
+	
+	literalStorage.insert( literalStorage.end(), parser.literalStorage.begin() + literalsCopied, parser.literalStorage.end() );
+	parser.literalStorage.swap( literalStorage );
+	parser.arrayIndexPointer += slotsUsed;
+}
+
+// Adds offset to the index slots the code uses
+void moveIndexSlots( vector<IrInstruction>& code, const int offset )
+{
+	for( size_t i = 0; i < code.size(); i++ )
 	{
-		// Keep track of nested procedure blocks when resyncing
-		nestedCount = 0;
+		IrOperand* operands[3] = { &code[i].result, &code[i].left, &code[i].right };
 		
-		// Display the compiler's error message
-		reportError( e.what() );
-		reportWarning( "Encountered error in procedure declaration. Remainder of procedure has not been checked." );
-		
-		// Resync to Follow(declaration) which is ";"
-		while( inFile.good() )
+		for( int j = 0; j < 3; j++ )
 		{
-			if( currentToken.name.compare( "procedure" ) == 0 )
-			{
-				nestedCount++;
-			}
-			else if( currentToken.name.compare( "end" ) == 0 )
+			if( operands[j]->relocation == IR_INDEX_SLOT )
 			{
-				currentToken = nextToken;
-				nextToken = getToken();
-				
-				if( currentToken.name.compare( "procedure" ) == 0 )
-				{
-					currentToken = nextToken;
-					nextToken = getToken();
-					
-					// Determine whether this "end procedure" is the end of our block or a nested one
-					if( nestedCount == 0 )
-					{
-						break;
-					}
-					else
-					{
-						nestedCount--;
-						continue;
-					}
-				}
+				operands[j]->value += offset;
 			}
-			
-			currentToken = nextToken;
-			nextToken = getToken();
 		}
 	}
+}
+
+// Returns the runtime functions flagged so far, a bit for each
+unsigned int runtimeCalls( void )
+{
+	ParserState& parser = *context->parser;
+	
+	return parser.getBool | parser.getInteger << 1 | parser.getFloat << 2 | parser.getString << 3 |
+		parser.putBool << 4 | parser.putInteger << 5 | parser.putFloat << 6 | parser.putString << 7;
+}
+
+// Flags the runtime functions in calls, as runtimeCalls() returns them
+void addRuntimeCalls( const unsigned int calls )
+{
+	ParserState& parser = *context->parser;
+	
+	parser.getBool = parser.getBool || ( calls & 1 );
+	parser.getInteger = parser.getInteger || ( calls & 2 );
+	parser.getFloat = parser.getFloat || ( calls & 4 );
+	parser.getString = parser.getString || ( calls & 8 );
+	parser.putBool = parser.putBool || ( calls & 16 );
+	parser.putInteger = parser.putInteger || ( calls & 32 );
+	parser.putFloat = parser.putFloat || ( calls & 64 );
+	parser.putString = parser.putString || ( calls & 128 );
+}
+
+// Reports an error in the innermost procedure declaration, skips the rest of the procedure and leaves it.
+// Returns false if the skip stopped at the end of an enclosing block (or of the input) instead of after "end procedure".
+bool recoverProcedure( CompileErrorException& e )
+{
+	bool skippedProcedure;
+	
+	// Display the compiler's error message
+	reportError( e.what() );
+	reportWarning( "Encountered error in procedure declaration. Remainder of procedure has not been checked." );
+	
+	// Resync to Follow(declaration) which is ";"
+	skippedProcedure = skipBlock( PROCEDURE_TOKEN );
+	
+	leaveProcedure();
+	return skippedProcedure;
+}
+
+// Error recovery.
+// Every resync goes through recover(), skipTo() and skipBlock(). skipTo() stops in front of a token of a synchronization set,
+// which the caller then takes, and skipBlock() takes the rest of a block up to its "end", or stops in front of the end of a block
+// enclosing it, which finishes that block. The parser only ever moves forward through the tokens, and a recovery that takes
+// no tokens is followed by the parser taking a token or finishing a block, so a compile does work in proportion to its tokens
+// however broken the input is.
+
+// Reports the error (unless an inner recovery already has) and skips to a token in the synchronization set
+void recover( CompileErrorException& e, const TokenSet syncSet )
+{
+	const char* message = e.what();
+	
+	// A rethrown exception has already been displayed, and then has no message
+	if( *message != '\0' )
+	{
+		reportError( message );
+	}
+	
+	skipTo( syncSet );
+}
+
+// Skips tokens up to the first one in the synchronization set, leaving that token for the parser
+void skipTo( const TokenSet syncSet )
+{
+	ParserState& parser = *context->parser;
+	
+	while( moreInput() && !parser.currentToken->isIn( syncSet ) )
+	{
+		advanceToken();
+	}
+}
+
+// Skips the rest of the innermost block of the specified kind (PROGRAM_TOKEN for the program body), up to and including its "end".
+// Blocks opened while skipping are skipped with their own "end". The "end" of a block that encloses the one being skipped stops the skip
+// in front of it, so an error in a block never swallows the rest of the procedure or program around it. An if statement or loop
+// is ended by any other "end" of an if statement or loop too (taken as a mistyped "end"), and a procedure or program skips it.
+// Returns true if the block's "end" was found.
+bool skipBlock( const TokenKind blockKind )
+{
+	ParserState& parser = *context->parser;
+	int nestedCount = 0; // Number of blocks opened while skipping that haven't ended yet
+	TokenKind endKind;
 	
-	// Remove the scope and its associated symbol table
-	for( janitor = localSymbolTable[currentScope].begin(); janitor != localSymbolTable[currentScope].end(); ++janitor )
+	while( moreInput() )
 	{
-		// Don't remove the entry for the function whose scope is being deleted so that its containing scope will still be able to refer to it
-		if( currentProcedure->getName().compare( janitor->second->getName() ) != 0 )
+		if( parser.currentToken->kind == END_TOKEN && parser.nextToken->isIn( blockClosers ) )
 		{
-			delete janitor->second;
-			janitor->second = NULL;
+			endKind = parser.nextToken->kind;
+			
+			// Stop at the end of an enclosing block. "end program" always ends the blocks inside it.
+			if( endKind != blockKind && ( endKind == PROGRAM_TOKEN || ( nestedCount == 0 && parser.openBlocks[endKind] > 0 ) ) )
+			{
+				return false;
+			}
+			
+			// Advance Token to after "end" and the kind of block
+			advanceToken();
+			advanceToken();
+			
+			if( nestedCount > 0 )
+			{
+				nestedCount--;
+			}
+			else if( endKind == blockKind || ( blockKind != PROCEDURE_TOKEN && blockKind != PROGRAM_TOKEN && endKind != PROCEDURE_TOKEN ) )
+			{
+				return true;
+			}
+		}
+		else
+		{
+			if( parser.currentToken->isIn( blockOpeners ) )
+			{
+				nestedCount++;
+			}
+			
+			advanceToken();
 		}
 	}
 	
-	localSymbolTable[currentScope].clear();
-	localSymbolTable.pop_back();
-	currentScope--;
+	return false;
 }
 
-void readProcedureHeader( Procedure*& currentProcedure, const bool isGlobal )
+void readProcedureHeader( int& currentProcedure, const bool isGlobal )
 {
-	Token* myToken;
+	ParserState& parser = *context->parser;
 	string myName; // stores the name of the procedure
+	int myNameID; // intern id of the name of the procedure
 	
 	// Advance Token to after "procedure"
-	currentToken = nextToken;
-	nextToken = getToken();
+	advanceToken();
 	
 	// Next token should be an identifier
-	if( currentToken.tokenType == NONE )
+	if( parser.currentToken->tokenType == NONE )
 	{
-		myName = currentToken.name;
-		currentProcedure = new Procedure( IDENTIFIER, currentToken.name, isGlobal );
+		myName = parser.currentToken->getName();
+		myNameID = parser.currentToken->nameID;
+		currentProcedure = newProcedureSymbol( IDENTIFIER, myNameID, isGlobal );
+		
+		// A nested procedure is labeled by its top-level procedure and its number in it, as procedures in different ones may share a name
+		if( context->currentScope > 1 )
+		{
+			nestedNumber( currentProcedure ) = parser.nestedID;
+			parser.nestedID++;
+		}
 		
 		// Add the procedure to its own symbol table
 		addSymbolEntry( currentProcedure );
 		
 		// Advance Token to after IDENTIFIER
-		currentToken = nextToken;
-		nextToken = getToken();
+		advanceToken();
 	}
-	else if( currentToken.tokenType == IDENTIFIER )
+	else if( parser.currentToken->tokenType == IDENTIFIER )
 	{
-		throw CompileErrorException( "Identifier \'" + currentToken.name + "\' has already been declared." );
+		throw CompileErrorException( "Identifier \'" + parser.currentToken->getName() + "\' has already been declared." );
 	}
-	else if( currentToken.tokenType == RESERVE )
+	else if( parser.currentToken->tokenType == RESERVE )
 	{
-		throw CompileErrorException( "Invalid procedure identifier. \'" + currentToken.name + "\' is a reserve word." );
+		throw CompileErrorException( "Invalid procedure identifier. \'" + parser.currentToken->getName() + "\' is a reserve word." );
 	}
 	else
 	{
-		throw CompileErrorException( "Invalid procedure identifier \'" + currentToken.name + "\'" );
+		throw CompileErrorException( "Invalid procedure identifier \'" + parser.currentToken->getName() + "\'" );
 	}
 	
 	// Next token should be "("
-	if( currentToken.name.compare( "(" ) == 0 )
+	if( parser.currentToken->kind == LEFT_PAREN_TOKEN )
 	{
 		// Advance Token to after "("
-		currentToken = nextToken;
-		nextToken = getToken();
+		advanceToken();
 	}
 	else
 	{
@@ -430,114 +1155,121 @@ void readProcedureHeader( Procedure*& currentProcedure, const bool isGlobal )
 	}
 	
 	// CODEGEN: Create jump target to enter procedure
-	if( errorCount == 0 )
+	if( context->errorCount == 0 )
 	{
-		if( currentProcedure == NULL )
+		if( currentProcedure == NO_SYMBOL )
 		{
 			throw CompileErrorException( "Unable to locate procedure \'" + myName + "\'" );
 		}
 		else
 		{
-			outFile << "\t" << currentProcedure->getName() << "_start:" << endl;
+			irAppend( IR_LABEL, irNone, procedureLabel( currentProcedure ) );
 		}
 	}
 	
 	// Read the Parameter List (starts with a type mark if it is not an empty list)
-	if( currentToken.name.compare( "integer" ) == 0 || currentToken.name.compare( "float" ) == 0 || currentToken.name.compare( "bool" ) == 0 || currentToken.name.compare( "string" ) == 0 )
+	if( parser.currentToken->isIn( typeMarks ) )
 	{
 		readParameterList( currentProcedure );
 		
 		// CODEGEN: Load procedure call arguments from registers into parameter locations in the stack
-		if( errorCount == 0 )
+		if( context->errorCount == 0 )
 		{
-			for( int i = 0; i < currentProcedure->getParameterListSize(); i++ )
+			for( int i = 0; i < parameterCount( currentProcedure ); i++ )
 			{
-				if( currentProcedure->getDirection( i ) == true )
+				if( parameterDirection( currentProcedure, i ) == true )
 				{
-					outFile << "\tMM[R[0].intVal + " << i << "] = R[" << 200 + i << "];" << endl;
+					irAppend( IR_MOVE, irMemory( 0, i, IR_FRAME ), irRegister( 200 + i, IR_FRAME ) );
 				}
 			}
 			
-			outFile << endl;
+			irBlankLine();
 		}
 	}
 	
-	if( currentToken.name.compare( ")" ) == 0 )
+	if( parser.currentToken->kind == RIGHT_PAREN_TOKEN )
 	{
 		// Advance Token to after ")"
-		currentToken = nextToken;
-		nextToken = getToken();
+		advanceToken();
 	}
 	else
 	{
-		throw CompileErrorException( "Expected \')\' or \',\' before \'" + currentToken.name + "\'. Not found" );
+		throw CompileErrorException( "Expected \')\' or \',\' before \'" + parser.currentToken->getName() + "\'. Not found" );
 	}
 	
 	// Copy this procedure's symbol table entry to its parent scope
 	if( isGlobal )
 	{
-		globalSymbolTable[myName] = currentProcedure;
+		setGlobalSymbol( myNameID, currentProcedure );
 	}
 	else
 	{
-		localSymbolTable[currentScope - 1][myName] = currentProcedure;
+		setEnclosingSymbol( myNameID, currentProcedure );
 	}
 }
 
-void readParameterList( Procedure*& currentProcedure )
+// Returns the label a procedure starts at. A nested procedure is only seen in its top-level procedure, which is the one being read.
+IrOperand procedureLabel( const int procedure )
 {
+	if( nestedNumber( procedure ) >= 0 )
+	{
+		return irLabel( NESTED_START_LABEL, context->parser->labelName, nestedNumber( procedure ) );
+	}
+	
+	return irLabel( PROCEDURE_START_LABEL, symbolNameID( procedure ), 0 );
+}
+
+void readParameterList( int& currentProcedure )
+{
+	ParserState& parser = *context->parser;
+	
 	readParameter( currentProcedure );
 	
-	if( currentToken.name.compare( "," ) == 0 )
+	while( parser.currentToken->kind == COMMA_TOKEN )
 	{
 		// Advance Token to after ","
-		currentToken = nextToken;
-		nextToken = getToken();
+		advanceToken();
 		
-		readParameterList( currentProcedure );
+		readParameter( currentProcedure );
 	}
 }
 
-void readParameter( Procedure*& currentProcedure )
+void readParameter( int& currentProcedure )
 {
+	ParserState& parser = *context->parser;
+	
 	readVariableDeclaration( currentProcedure, false, true );
 	
-	if( currentToken.name.compare( "in" ) == 0 )
+	if( parser.currentToken->kind == IN_TOKEN )
 	{
-		currentProcedure->addDirection( true );
+		addDirection( currentProcedure, true );
 		
 		// Advance Token to after "in" or "out"
-		currentToken = nextToken;
-		nextToken = getToken();
+		advanceToken();
 	}
-	else if( currentToken.name.compare( "out" ) == 0 )
+	else if( parser.currentToken->kind == OUT_TOKEN )
 	{
-		currentProcedure->addDirection( false );
+		addDirection( currentProcedure, false );
 		
 		// Advance Token to after "in" or "out"
-		currentToken = nextToken;
-		nextToken = getToken();
+		advanceToken();
 	}
 	else
 	{
-		throw CompileErrorException( "Invalid parameter direction: " + currentToken.name );
+		throw CompileErrorException( "Invalid parameter direction: " + parser.currentToken->getName() );
 	}
 }
 
-void readProcedureBody( Procedure*& currentProcedure )
+// Reads the body of a procedure from "begin" on. Its declarations have already been read by readDeclarations().
+void readProcedureBody( int& currentProcedure )
 {
-	// Check if there are any declarations
-	if( currentToken.name.compare( "global" ) == 0 || currentToken.name.compare( "procedure" ) == 0 || currentToken.name.compare( "integer" ) == 0 || currentToken.name.compare( "float" ) == 0 || currentToken.name.compare( "bool" ) == 0 || currentToken.name.compare( "string" ) == 0 )
-	{
-		readDeclarations( currentProcedure );
-	}
+	ParserState& parser = *context->parser;
 	
 	// Look for "begin"
-	if( currentToken.name.compare( "begin" ) == 0 )
+	if( parser.currentToken->kind == BEGIN_TOKEN )
 	{
 		// Advance Token to after "begin"
-		currentToken = nextToken;
-		nextToken = getToken();
+		advanceToken();
 	}
 	else
 	{
@@ -545,96 +1277,51 @@ void readProcedureBody( Procedure*& currentProcedure )
 	}
 	
 	// CODEGEN: Update stack pointer and array declaration code
-	if( errorCount == 0 )
+	if( context->errorCount == 0 )
 	{
-		if( currentProcedure != NULL )
+		if( currentProcedure != NO_SYMBOL )
 		{
-			outFile << "\tR[0].intVal = R[0].intVal - " << currentProcedure->getLocalAddress() << ";" << endl;
-			outFile << endl;
+			irAppend( IR_SUBTRACT, irRegister( 0, IR_INTEGER ), irRegister( 0, IR_INTEGER ), irInteger( localAddress( currentProcedure ) ) );
+			irBlankLine();
 		}
 	}
 	
 	// Look for block of statements
-	if( currentToken.tokenType == IDENTIFIER || currentToken.name.compare( "if" ) == 0 || currentToken.name.compare( "for" ) == 0 || currentToken.name.compare( "return" ) == 0 || currentToken.tokenType == NONE )
+	if( parser.currentToken->isIn( statementKeywords ) || parser.currentToken->tokenType == IDENTIFIER || parser.currentToken->tokenType == NONE )
 	{
 		readStatements( currentProcedure );
 	}
 	
-	if( currentToken.name.compare( "global" ) == 0 || currentToken.name.compare( "procedure" ) == 0 || currentToken.name.compare( "integer" ) == 0 || currentToken.name.compare( "float" ) == 0 || currentToken.name.compare( "bool" ) == 0 || currentToken.name.compare( "string" ) == 0 )
+	if( parser.currentToken->isIn( declarationFirst ) )
 	{
 		reportError( "Incorrect Procedure Body: Declarations must be before \'begin\'" );
 		
-		// resync to "end procedure"
-		while( inFile.good() )
-		{
-			int nestedCount = 0;
-			
-			if( currentToken.name.compare( "procedure" ) == 0 )
-			{
-				nestedCount++;
-			}
-			else if( currentToken.name.compare( "end" ) == 0 )
-			{
-				currentToken = nextToken;
-				nextToken = getToken();
-				
-				if( currentToken.name.compare( "procedure" ) == 0 )
-				{
-					// Determine whether this "end procedure" is the end of our block or a nested one
-					if( nestedCount == 0 )
-					{
-						currentToken = nextToken;
-						nextToken = getToken();
-						return;
-					}
-					else
-					{
-						currentToken = nextToken;
-						nextToken = getToken();
-						nestedCount--;
-						continue;
-					}
-				}
-			}
-			
-			currentToken = nextToken;
-			nextToken = getToken();
-		}
+		// resync to after "end procedure"
+		skipBlock( PROCEDURE_TOKEN );
+		return;
 	}
 	
 	// Look for "end procedure"
-	if( currentToken.name.compare( "end" ) == 0 )
+	if( parser.currentToken->kind == END_TOKEN )
 	{
-		// Advance Token to after end
-		currentToken = nextToken;
-		nextToken = getToken();
-		
-		if( currentToken.name.compare( "procedure" ) == 0 )
+		// Leave the "end" for error recovery if it ends a different block
+		if( parser.nextToken->kind == PROCEDURE_TOKEN )
 		{
+			// Advance Token to after end
+			advanceToken();
+			
 			// CODEGEN: Update stack pointer at end of procedure
 			// CODEGEN: Add return code for end of procedure
-			if( errorCount == 0 )
+			if( context->errorCount == 0 )
 			{
-				if( currentProcedure != NULL )
+				if( currentProcedure != NO_SYMBOL )
 				{
-					outFile << "\tR[0].intVal = R[0].intVal + " << currentProcedure->getLocalAddress() << ";" << endl << endl;
-					
-					for( int i = 0; i < currentProcedure->getParameterListSize(); i++ )
-					{
-						if( currentProcedure->getDirection( i ) == false )
-						{
-							outFile << "\tR[" << 200 + i << "] = MM[R[0].intVal + " << i << "];" << endl;
-						}
-					}
-					
-					outFile << "\tjumpRegister = MM[R[0].intVal + " << currentProcedure->getParameterAddress() << "].jumpTarget;" << endl;
-					outFile << "\tgoto *jumpRegister;" << endl << endl;
+					generateReturn( currentProcedure );
 				}
 			}
 			
 			// Advance Token to after "procedure"
-			currentToken = nextToken;
-			nextToken = getToken();
+			advanceToken();
 		}
 		else
 		{
@@ -647,110 +1334,125 @@ void readProcedureBody( Procedure*& currentProcedure )
 	}
 }
 
-void readVariableDeclaration( Procedure*& currentProcedure, const bool isGlobal, const bool isParameter )
+// Generates the code that returns from the procedure: it frees the procedure's local variables,
+// puts its out parameters in registers for the caller, and goes back to the return address
+void generateReturn( const int currentProcedure )
 {
-	string myName;
+	irAppend( IR_ADD, irRegister( 0, IR_INTEGER ), irRegister( 0, IR_INTEGER ), irInteger( localAddress( currentProcedure ) ) );
+	irBlankLine();
+	
+	for( int i = 0; i < parameterCount( currentProcedure ); i++ )
+	{
+		if( parameterDirection( currentProcedure, i ) == false )
+		{
+			irAppend( IR_MOVE, irRegister( 200 + i, IR_FRAME ), irMemory( 0, i, IR_FRAME ) );
+		}
+	}
+	
+	irAppend( IR_RETURN, irNone, irMemory( 0, parameterAddress( currentProcedure ), IR_ADDRESS ) );
+	irBlankLine();
+}
+
+void readVariableDeclaration( int& currentProcedure, const bool isGlobal, const bool isParameter )
+{
+	ParserState& parser = *context->parser;
+	int myNameID = -1; // intern id of the name of the variable
 	DataType myDataType = INVALID;
-	Token* myToken = NULL;
-	Variable* myVariable = NULL;
-	Array* myArray = NULL;
+	int myVariable = NO_SYMBOL;
+	int myArray = NO_SYMBOL;
 	int myArraySize = 1;
 	
-	stringstream convert;
-	
 	try
 	{
 		// First token should be data type
-		if( currentToken.name.compare( "integer" ) == 0 || currentToken.name.compare( "float" ) == 0 || currentToken.name.compare( "bool" ) == 0 || currentToken.name.compare( "string" ) == 0 )
+		if( parser.currentToken->isIn( typeMarks ) )
 		{
-			if( currentToken.name.compare( "integer" ) == 0 )
+			if( parser.currentToken->kind == INTEGER_TOKEN )
 			{
 				myDataType = INTEGER;
 			}
-			else if( currentToken.name.compare( "float" ) == 0 )
+			else if( parser.currentToken->kind == FLOAT_TOKEN )
 			{
 				myDataType = FLOAT;
 			}
-			else if( currentToken.name.compare( "bool" ) == 0 )
+			else if( parser.currentToken->kind == BOOL_TOKEN )
 			{
 				myDataType = BOOL;
 			}
-			else if( currentToken.name.compare( "string" ) == 0 )
+			else if( parser.currentToken->kind == STRING_TOKEN )
 			{
 				myDataType = STRINGT;
 			}
 			else
 			{
 				myDataType = INVALID;
-				throw CompileErrorException( "Invalid data type: " + currentToken.name );
+				throw CompileErrorException( "Invalid data type: " + parser.currentToken->getName() );
 			}
 			
 			// Advance Token to after the type mark
-			currentToken = nextToken;
-			nextToken = getToken();
+			advanceToken();
 		}
 		else
 		{
-			throw CompileErrorException( "Invalid data type: " + currentToken.name );
+			throw CompileErrorException( "Invalid data type: " + parser.currentToken->getName() );
 		}
 		
 		// Second token is variable name
-		if( currentToken.tokenType == NONE )
+		if( parser.currentToken->tokenType == NONE )
 		{
-			myName = currentToken.name;
+			myNameID = parser.currentToken->nameID;
 			
 			// Advance Token to after IDENTIFIER
-			currentToken = nextToken;
-			nextToken = getToken();
+			advanceToken();
 		}
-		else if( currentToken.tokenType == IDENTIFIER )
+		else if( parser.currentToken->tokenType == IDENTIFIER )
 		{
-			throw CompileErrorException( "Identifier \'" + currentToken.name + "\' has already been declared." );
+			throw CompileErrorException( "Identifier \'" + parser.currentToken->getName() + "\' has already been declared." );
 		}
-		else if( currentToken.tokenType == RESERVE )
+		else if( parser.currentToken->tokenType == RESERVE )
 		{
-			throw CompileErrorException( "Invalid variable identifier. \'" + currentToken.name + "\' is a reserve word." );
+			throw CompileErrorException( "Invalid variable identifier. \'" + parser.currentToken->getName() + "\' is a reserve word." );
 		}
 		else
 		{
-			throw CompileErrorException( "Invalid variable identifier: " + currentToken.name );
+			throw CompileErrorException( "Invalid variable identifier: " + parser.currentToken->getName() );
 		}
 		
 		// Check if there is an array size
-		if( currentToken.name.compare( "[" ) == 0 )
+		if( parser.currentToken->kind == LEFT_BRACKET_TOKEN )
 		{
 			// Advance Token to after "["
-			currentToken = nextToken;
-			nextToken = getToken();
+			advanceToken();
 			
 			// continue to parse array size
-			if( currentToken.tokenType == NUMBER )
+			if( parser.currentToken->tokenType == NUMBER )
 			{
 				// Grammar allows any number for the array size, but throw warning if it's a float
-				if( currentToken.name.find_first_of( '.' ) != string::npos )
+				if( parser.currentToken->numberType == FLOAT )
 				{
 					reportWarning( "Array size is of type \'float\'. Decimal will be truncated." );
+					
+					// Truncate the float (keeping it in the range of an integer)
+					myArraySize = parser.currentToken->floatValue < 2147483648.0f ? static_cast<int>( parser.currentToken->floatValue ) : 2147483647;
+				}
+				else
+				{
+					myArraySize = parser.currentToken->intValue;
 				}
-				
-				// Convert the number token into an integer to store the array size
-				convert.str( currentToken.name );
-				convert >> myArraySize;
 				
 				// Advance Token to after NUMBER
-				currentToken = nextToken;
-				nextToken = getToken();
+				advanceToken();
 			}
 			else
 			{
-				throw CompileErrorException( "Invalid array size: " + currentToken.name );
+				throw CompileErrorException( "Invalid array size: " + parser.currentToken->getName() );
 			}
 			
 			// array closer
-			if( currentToken.name.compare( "]" ) == 0 )
+			if( parser.currentToken->kind == RIGHT_BRACKET_TOKEN )
 			{
 				// Advance Token to after "]"
-				currentToken = nextToken;
-				nextToken = getToken();
+				advanceToken();
 			}
 			else
 			{
@@ -760,38 +1462,37 @@ void readVariableDeclaration( Procedure*& currentProcedure, const bool isGlobal,
 			// Add the array to the parameter list of the current procedure if it's a parameter
 			if( isParameter )
 			{
-				myArray = new Array( IDENTIFIER, myName, myDataType, myArraySize, isGlobal, memoryPointer, true );
-				currentProcedure->addParameter( myArray ); // Add the array to the procedure's parameter list
+				addParameter( currentProcedure, myDataType ); // Add the data type to the procedure's parameter list
 				
-				myArray = new Array( IDENTIFIER, myName, myDataType, myArraySize, isGlobal, memoryPointer, true );
+				myArray = newArraySymbol( IDENTIFIER, myNameID, myDataType, myArraySize, isGlobal, parser.memoryPointer, true );
 				addSymbolEntry( myArray );
 				
-				memoryPointer += myArraySize; // Allocate one unit of memory for each array element
+				parser.memoryPointer += myArraySize; // Allocate one unit of memory for each array element
 			}
 			// Otherwise add it as a regular array
 			else
 			{
 				if( isGlobal )
 				{
-					myArray = new Array( IDENTIFIER, myName, myDataType, myArraySize, isGlobal, memoryPointer, false );
+					myArray = newArraySymbol( IDENTIFIER, myNameID, myDataType, myArraySize, isGlobal, parser.memoryPointer, false );
 					addSymbolEntry( myArray );
-					memoryPointer += myArraySize; // Allocate one unit of memory for each array element
+					parser.memoryPointer += myArraySize; // Allocate one unit of memory for each array element
 				}
 				else
 				{
-					// If we're in the top-level scope, we must not use currentProcedure because it will be NULL.
+					// If we're in the top-level scope, we must not use currentProcedure because there isn't one.
 					// Use the global counter defined in this file
-					if( currentScope == 0 )
+					if( context->currentScope == 0 )
 					{
-						myArray = new Array( IDENTIFIER, myName, myDataType, myArraySize, isGlobal, memoryPointer, false );
+						myArray = newArraySymbol( IDENTIFIER, myNameID, myDataType, myArraySize, isGlobal, parser.memoryPointer, false );
 						addSymbolEntry( myArray );
-						memoryPointer += myArraySize; // One unit of memory for each array element
+						parser.memoryPointer += myArraySize; // One unit of memory for each array element
 					}
-					else if( currentScope > 0 )
+					else if( context->currentScope > 0 )
 					{
-						myArray = new Array( IDENTIFIER, myName, myDataType, myArraySize, isGlobal, memoryPointer, false );
+						myArray = newArraySymbol( IDENTIFIER, myNameID, myDataType, myArraySize, isGlobal, parser.memoryPointer, false );
 						addSymbolEntry( myArray );
-						memoryPointer += myArraySize; // One unit of memory for each array element
+						parser.memoryPointer += myArraySize; // One unit of memory for each array element
 					}
 				}
 			}
@@ -802,38 +1503,37 @@ void readVariableDeclaration( Procedure*& currentProcedure, const bool isGlobal,
 			// Add the variable to the parameter list of the current procedure if it is one.
 			if( isParameter )
 			{
-				myVariable = new Variable( IDENTIFIER, myName, myDataType, isGlobal, currentProcedure->getParameterAddress(), true );
-				currentProcedure->addParameter( myVariable ); // Add the data type to the procedure's parameter list
+				addParameter( currentProcedure, myDataType ); // Add the data type to the procedure's parameter list
 				
-				myVariable = new Variable( IDENTIFIER, myName, myDataType, isGlobal, currentProcedure->getParameterAddress(), true );
+				myVariable = newVariableSymbol( IDENTIFIER, myNameID, myDataType, isGlobal, parameterAddress( currentProcedure ), true );
 				addSymbolEntry( myVariable );
 				
-				currentProcedure->advanceParameterAddress();
+				parameterAddress( currentProcedure )++;
 			}
 			// Otherwise add it as a regular variable
 			else
 			{
 				if( isGlobal )
 				{
-					myVariable = new Variable( IDENTIFIER, myName, myDataType, isGlobal, memoryPointer, false );
+					myVariable = newVariableSymbol( IDENTIFIER, myNameID, myDataType, isGlobal, parser.memoryPointer, false );
 					addSymbolEntry( myVariable );
-					memoryPointer++;
+					parser.memoryPointer++;
 				}
 				else
 				{
-					// If we're in the top-level scope, we must not use currentProcedure because it will be NULL.
+					// If we're in the top-level scope, we must not use currentProcedure because there isn't one.
 					// Use the global counter defined in this file
-					if( currentScope == 0 )
+					if( context->currentScope == 0 )
 					{
-						myVariable = new Variable( IDENTIFIER, myName, myDataType, isGlobal, localMemoryPointer, false );
+						myVariable = newVariableSymbol( IDENTIFIER, myNameID, myDataType, isGlobal, parser.localMemoryPointer, false );
 						addSymbolEntry( myVariable );
-						localMemoryPointer++;
+						parser.localMemoryPointer++;
 					}
-					else if( currentScope > 0 )
+					else if( context->currentScope > 0 )
 					{
-						myVariable = new Variable( IDENTIFIER, myName, myDataType, isGlobal, currentProcedure->getLocalAddress(), false );
+						myVariable = newVariableSymbol( IDENTIFIER, myNameID, myDataType, isGlobal, localAddress( currentProcedure ), false );
 						addSymbolEntry( myVariable );
-						currentProcedure->advanceLocalAddress();
+						localAddress( currentProcedure )++;
 					}
 				}
 			}
@@ -841,284 +1541,325 @@ void readVariableDeclaration( Procedure*& currentProcedure, const bool isGlobal,
 	}
 	catch( CompileErrorException& e )
 	{
-		// Display the compiler's error message
-		reportError( e.what() );
-		
 		if( isParameter )
 		{
 			// Resync to Follow(variable_declaration) in parameter, which is "in" or out"
-			while( inFile.good() )
+			recover( e, parameterSync );
+			
+			if( moreInput() && parser.currentToken->isIn( parameterFollow ) )
 			{
-				if( currentToken.name.compare( "in" ) == 0 || currentToken.name.compare( "out" ) == 0 )
-				{
-					return;
-				}
-				else if( currentToken.name.compare( "," ) == 0 || currentToken.name.compare( ")" ) == 0 )
-				{
-					reportError( "Expected parameter direction before \'" + currentToken.name + "\'. Not found." );
-					return;
-				}
-				
-				currentToken = nextToken;
-				nextToken = getToken();
+				reportError( "Expected parameter direction before \'" + parser.currentToken->getName() + "\'. Not found." );
 			}
 		}
 		else
 		{
 			// Resync to Follow(variable_declaration) which is ";"
-			while( inFile.good() )
+			recover( e, variableDeclarationSync );
+			
+			if( moreInput() && parser.currentToken->isIn( variableDeclarationResync ) )
 			{
-				if( currentToken.name.compare( ";" ) == 0 )
-				{
-					return;
-				}
-				else if( currentToken.name.compare( "global" ) == 0 || currentToken.name.compare( "integer" ) == 0 || currentToken.name.compare( "float" ) == 0 || currentToken.name.compare( "bool" ) == 0 || currentToken.name.compare( "string" ) == 0 || currentToken.name.compare( "begin" ) == 0 )
-				{
-					reportError( "Expected \';\' before \'" + currentToken.name + "\'. Not found." );
-					return;
-				}
-				
-				currentToken = nextToken;
-				nextToken = getToken();
+				reportError( "Expected \';\' before \'" + parser.currentToken->getName() + "\'. Not found." );
 			}
 		}
 	}
 }
 
-void readStatements( Procedure*& currentProcedure )
+// Reads a list of statements.
+// An if statement or loop is read in the same loop: its frame on the parse stack keeps its place while its statements are read,
+// and when they end the loop finishes the block and carries on with the statements after it.
+void readStatements( int& currentProcedure )
 {
-	while( inFile.good() )
+	ParserState& parser = *context->parser;
+	const int outerDepth = parser.parseStack.size(); // Frames below this belong to whoever called this function
+	ParseStep step = READ_ITEM;
+	
+	while( true )
 	{
 		try
 		{
-			// Check if it's an assignment statement or procedure call
-			if( currentToken.tokenType == IDENTIFIER )
-			{
-				// look ahead to determine procedure call or assignment statement
-				
-				// If next token is "(", then this is a procedure call
-				if( nextToken.name.compare( "(" ) == 0 )
-				{
-					readProcedureCall( currentProcedure );
-				}
-				// If next token is ":=" or "[", then this is an assignment statement
-				else if( nextToken.name.compare( ":=" ) == 0 || nextToken.name.compare( "[" ) == 0 )
-				{
-					readAssignment( currentProcedure );
-				}
-				else
-				{
-					throw CompileErrorException( "Unrecognized statement" );
-				}
-			}
-			// Check if it's an if statement
-			else if( currentToken.name.compare( "if" ) == 0 )
-			{
-				// Advance Token to after "if"
-				currentToken = nextToken;
-				nextToken = getToken();
-				
-				readIf( currentProcedure );
-			}
-			// Check if it's a loop statement
-			else if( currentToken.name.compare( "for" ) == 0 )
+			switch( step )
 			{
-				// Advance Token to after "for"
-				currentToken = nextToken;
-				nextToken = getToken();
-				
-				readLoop( currentProcedure );
-			}
-			// Check if it's a return statement
-			else if( currentToken.name.compare( "return" ) == 0 )
-			{
-				// CODEGEN: Generate return code for procedures
-				// CODEGEN: Update stack pointer at end of procedure
-				// CODEGEN: Add return code for end of procedure
-				if( errorCount == 0 )
-				{
-					if( currentScope == 0 )
+				case READ_ITEM:
+					if( !moreInput() )
 					{
-						outFile << "\treturn 0;" << endl << endl;
+						step = END_LIST;
 					}
-					else if( currentScope > 0 )
+					// Check if it's an if statement
+					else if( parser.currentToken->kind == IF_TOKEN )
 					{
-						outFile << "\tR[0].intVal = R[0].intVal + " << currentProcedure->getLocalAddress() << ";" << endl << endl;
-					
-						for( int i = 0; i < currentProcedure->getParameterListSize(); i++ )
+						// Advance Token to after "if"
+						advanceToken();
+						
+						// Grab the next available ID number
+						enterBlock( IF_TOKEN, parser.ifID );
+						parser.ifID++;
+						
+						readIf( currentProcedure, parser.parseStack.back().id );
+						
+						// next is one or more statements
+						parser.registerPointer = 2;
+						step = READ_ITEM;
+					}
+					// Check if it's a loop statement
+					else if( parser.currentToken->kind == FOR_TOKEN )
+					{
+						// Advance Token to after "for"
+						advanceToken();
+						
+						// Grab the next available ID number
+						enterBlock( FOR_TOKEN, parser.loopID );
+						parser.loopID++;
+						
+						readLoop( currentProcedure, parser.parseStack.back().id );
+						
+						// Check if there are any statements inside the loop
+						if( parser.currentToken->isIn( statementKeywords ) || parser.currentToken->tokenType == IDENTIFIER || parser.currentToken->tokenType == NONE )
 						{
-							if( currentProcedure->getDirection( i ) == false )
-							{
-								outFile << "\tR[" << 200 + i << "] = MM[R[0].intVal + " << i << "];" << endl;
-							}
+							parser.registerPointer = 2;
+							step = READ_ITEM;
+						}
+						else
+						{
+							step = END_LIST;
 						}
-						
-						outFile << "\tjumpRegister = MM[R[0].intVal + " << currentProcedure->getParameterAddress() << "].jumpTarget;" << endl;
-						outFile << "\tgoto *jumpRegister;" << endl << endl;
 					}
-				}
+					else
+					{
+						step = readStatement( currentProcedure );
+					}
+					break;
 				
-				// Advance Token to after "return"
-				currentToken = nextToken;
-				nextToken = getToken();
+				case END_ITEM:
+					// Check for ; at end of statement. If it is missing, carry on as if it were there.
+					if( parser.currentToken->kind == SEMICOLON_TOKEN )
+					{
+						// Advance Token to after ";"
+						advanceToken();
+					}
+					else
+					{
+						reportError( "Expected ';' before \'" + parser.currentToken->getName() + "\'. Not found" );
+					}
+					
+					// Finished with statements if we don't see anymore statement keywords
+					if( !parser.currentToken->isIn( statementKeywords ) && parser.currentToken->tokenType != IDENTIFIER && parser.currentToken->tokenType != NONE )
+					{
+						step = END_LIST;
+						break;
+					}
+					
+					// If we're back at the top-level scope, reset procedure call information
+					if( context->currentScope == 0 )
+					{
+						parser.isArgument = false;
+						parser.argumentName = NO_SYMBOL;
+						parser.argumentOperands = 0;
+						parser.arrayIndexPointer = 6000000;
+					}
+					
+					step = READ_ITEM;
+					break;
+				
+				case END_LIST:
+					if( parser.parseStack.size() == outerDepth )
+					{
+						return;
+					}
+					
+					// The statements of the innermost block have ended
+					step = readBlockEnd();
+					break;
+			}
+		}
+		catch( CompileErrorException& e )
+		{
+			if( parser.parseStack.size() == outerDepth )
+			{
+				throw;
+			}
+			
+			// Carry on after the block, or finish the enclosing block if recovery stopped at its end
+			step = recoverBlock( e ) ? END_ITEM : END_LIST;
+		}
+	}
+}
+
+// Reads a statement other than an if statement or a loop.
+// Returns END_ITEM, or END_LIST if error recovery stopped at the end of the block the statement is in.
+ParseStep readStatement( int& currentProcedure )
+{
+	ParserState& parser = *context->parser;
+	
+	try
+	{
+		// Check if it's an assignment statement or procedure call
+		if( parser.currentToken->tokenType == IDENTIFIER )
+		{
+			// look ahead to determine procedure call or assignment statement
+			
+			// If next token is "(", then this is a procedure call
+			if( parser.nextToken->kind == LEFT_PAREN_TOKEN )
+			{
+				readProcedureCall( currentProcedure );
 			}
-			else if( currentToken.tokenType == NONE )
+			// If next token is ":=" or "[", then this is an assignment statement
+			else if( parser.nextToken->isIn( destinationFollow ) )
 			{
-				throw CompileErrorException( "Undeclared identifier \'" + currentToken.name + "\'" );
+				readAssignment( currentProcedure );
 			}
 			else
 			{
-				throw CompileErrorException( "Unrecognized statement" + currentToken.name + nextToken.name );
+				throw CompileErrorException( "Unrecognized statement" );
 			}
 		}
-		catch( CompileErrorException& e )
+		// Check if it's a return statement
+		else if( parser.currentToken->kind == RETURN_TOKEN )
 		{
-			// Display the compiler's error message
-			reportError( e.what() );
-			
-			// Resync to Follow(statement) which is ";"
-			while( inFile.good() )
+			// CODEGEN: Generate return code for procedures
+			// CODEGEN: Update stack pointer at end of procedure
+			// CODEGEN: Add return code for end of procedure
+			if( context->errorCount == 0 )
 			{
-				if( currentToken.name.compare( ";" ) == 0 )
+				if( context->currentScope == 0 )
 				{
-					break;
+					irAppend( IR_EXIT, irNone, irNone );
+					irBlankLine();
+				}
+				else if( context->currentScope > 0 )
+				{
+					generateReturn( currentProcedure );
 				}
-				
-				currentToken = nextToken;
-				nextToken = getToken();
 			}
+			
+			// Advance Token to after "return"
+			advanceToken();
 		}
-		
-		// Check for ; at end of statement
-		if( currentToken.name.compare( ";" ) == 0 )
+		else if( parser.currentToken->tokenType == NONE )
 		{
-			// Advance Token to after ";"
-			currentToken = nextToken;
-			nextToken = getToken();
+			// Only the current scope and the global scope are visible, so say so if the name belongs to an enclosing procedure
+			if( lookupEnclosingSymbol( parser.currentToken->nameID ) != NO_SYMBOL )
+			{
+				throw CompileErrorException( "\'" + parser.currentToken->getName() + "\' belongs to an enclosing procedure and is not visible here" );
+			}
+			
+			throw CompileErrorException( "Undeclared identifier \'" + parser.currentToken->getName() + "\'" );
 		}
 		else
 		{
-			throw CompileErrorException( "Expected ';' before \'" + currentToken.name + "\'. Not found" );
-		}
-		
-		// Finished with statements if we don't see anymore statement keywords
-		if( currentToken.tokenType != IDENTIFIER && currentToken.name.compare( "if" ) != 0 && currentToken.name.compare( "for" ) != 0 && currentToken.name.compare( "return" ) != 0 )
-		{
-			break;
+			throw CompileErrorException( "Unrecognized statement" + parser.currentToken->getName() + parser.nextToken->getName() );
 		}
+	}
+	catch( CompileErrorException& e )
+	{
+		// Resync to Follow(statement) which is ";", or to the end of the block
+		recover( e, statementSync );
 		
-		// If we're back at the top-level scope, reset procedure call information
-		if( currentScope == 0 )
+		if( moreInput() && parser.currentToken->kind != SEMICOLON_TOKEN )
 		{
-			isArgument = false;
-			argumentName = NULL;
-			argumentOperands = 0;
-			arrayIndexPointer = 6000000;
+			return END_LIST;
 		}
 	}
+	
+	return END_ITEM;
 }
 
-void readProcedureCall( Procedure*& currentProcedure )
+void readProcedureCall( int& currentProcedure )
 {
-	TokenFrame calledProcedure = currentToken;
-	Token* apparentProcedure = NULL;
-	Procedure* myProcedure = NULL;
+	ParserState& parser = *context->parser;
+	TokenFrame calledProcedure = *parser.currentToken;
+	int apparentProcedure = NO_SYMBOL;
+	int myProcedure = NO_SYMBOL;
 	int argumentCount = 0;
-	string returnCode;
-	
-	registerPointer = 2;
+	vector<IrInstruction> returnCode; // Code for storing output parameters after returning
+	IrOperand returnLabel;
 	
-	// Locate the symbol table entry for the called procedure
-	findSymbolEntry( calledProcedure );
+	parser.registerPointer = 2;
 	
+	// The symbol table entry for the called procedure was found when the parser took its name
 	// If there is no such entry...
-	if( calledProcedure.tokenType == NONE )
-	{
-		throw CompileErrorException( "Procedure \'" + calledProcedure.name + "\' not found" );
-	}
-	
-	// Retrieve symbol table entry depending on whether it is global or local
-	if( calledProcedure.isGlobal )
-	{
-		apparentProcedure = globalSymbolTable[calledProcedure.name];
-	}
-	else
+	if( calledProcedure.tokenType == NONE )
 	{
-		apparentProcedure = localSymbolTable[currentScope][calledProcedure.name];
+		if( lookupEnclosingSymbol( calledProcedure.nameID ) != NO_SYMBOL )
+		{
+			throw CompileErrorException( "Procedure \'" + calledProcedure.getName() + "\' belongs to an enclosing procedure and is not visible here" );
+		}
+		
+		throw CompileErrorException( "Procedure \'" + calledProcedure.getName() + "\' not found" );
 	}
 	
-	// Check for null pointer
-	if( apparentProcedure == NULL )
+	apparentProcedure = calledProcedure.symbol;
+	
+	// Check for a missing entry
+	if( apparentProcedure == NO_SYMBOL )
 	{
-		throw CompileErrorException( "Unable to locate procedure \'" + calledProcedure.name + "\'" );
+		throw CompileErrorException( "Unable to locate procedure \'" + calledProcedure.getName() + "\'" );
 	}
 	else
 	{
-		if( typeid( *apparentProcedure ) != typeid( Procedure ) )
+		if( symbolKind( apparentProcedure ) != PROCEDURE_SYMBOL )
 		{
-			throw CompileErrorException( "\'" + apparentProcedure->getName() + "\' is not a procedure" );
+			throw CompileErrorException( "\'" + symbolName( apparentProcedure ) + "\' is not a procedure" );
 		}
 		else
 		{
-			myProcedure = dynamic_cast<Procedure*>(apparentProcedure);
+			myProcedure = apparentProcedure;
 		}
 	}
 	
 	// Check if it is a runtime function
-	if( myProcedure->getName().compare( "getBool" ) == 0 )
+	if( symbolName( myProcedure ).compare( "getBool" ) == 0 )
 	{
-		getBool = true;
+		parser.getBool = true;
 	}
-	else if( myProcedure->getName().compare( "getInteger" ) == 0 )
+	else if( symbolName( myProcedure ).compare( "getInteger" ) == 0 )
 	{
-		getInteger = true;
+		parser.getInteger = true;
 	}
-	else if( myProcedure->getName().compare( "getFloat" ) == 0 )
+	else if( symbolName( myProcedure ).compare( "getFloat" ) == 0 )
 	{
-		getFloat = true;
+		parser.getFloat = true;
 	}
-	else if( myProcedure->getName().compare( "getString" ) == 0 )
+	else if( symbolName( myProcedure ).compare( "getString" ) == 0 )
 	{
-		getString = true;
+		parser.getString = true;
 	}
-	else if( myProcedure->getName().compare( "putBool" ) == 0 )
+	else if( symbolName( myProcedure ).compare( "putBool" ) == 0 )
 	{
-		putBool = true;
+		parser.putBool = true;
 	}
-	else if( myProcedure->getName().compare( "putInteger" ) == 0 )
+	else if( symbolName( myProcedure ).compare( "putInteger" ) == 0 )
 	{
-		putInteger = true;
+		parser.putInteger = true;
 	}
-	else if( myProcedure->getName().compare( "putFloat" ) == 0 )
+	else if( symbolName( myProcedure ).compare( "putFloat" ) == 0 )
 	{
-		putFloat = true;
+		parser.putFloat = true;
 	}
-	else if( myProcedure->getName().compare( "putString" ) == 0 )
+	else if( symbolName( myProcedure ).compare( "putString" ) == 0 )
 	{
-		putString = true;
+		parser.putString = true;
 	}
 	
 	// Advance Token to after "("
-	currentToken = getToken();
-	nextToken = getToken();
+	advanceToken();
+	advanceToken();
 	
 	// Check if the argument list contains the start of an expression
-	if( currentToken.name.compare( "(" ) == 0 || currentToken.name.compare( "-" ) == 0 || currentToken.tokenType == IDENTIFIER || currentToken.tokenType == NUMBER || currentToken.tokenType == STRING || currentToken.name.compare( "true" ) == 0 || currentToken.name.compare( "false" ) == 0 )
+	if( parser.currentToken->isIn( expressionFirst ) || parser.currentToken->tokenType == IDENTIFIER )
 	{
-		readArgumentList( currentProcedure, myProcedure, 0, argumentCount, returnCode );
+		readArgumentList( currentProcedure, myProcedure, argumentCount, returnCode );
 		
 		// Check how many arguments were read
-		if( argumentCount < myProcedure->getParameterListSize() )
+		if( argumentCount < parameterCount( myProcedure ) )
 		{
 			reportError( "Too few arguments in procedure call" );
 		}
 	}
 	
-	if( currentToken.name.compare( ")" ) == 0 )
+	if( parser.currentToken->kind == RIGHT_PAREN_TOKEN )
 	{
 		// Advance Token to after ")"
-		currentToken = nextToken;
-		nextToken = getToken();
+		advanceToken();
 	}
 	else
 	{
@@ -1127,141 +1868,133 @@ void readProcedureCall( Procedure*& currentProcedure )
 	
 	// CODEGEN: Move Stack Pointer for and Add stack entry for return address
 	// CODEGEN: Move Stack Pointer for procedure parameters
-	if( errorCount == 0 )
+	if( context->errorCount == 0 )
 	{
-		outFile << "\tR[0].intVal = R[0].intVal - 1;" << endl;
-		outFile << "\tMM[R[0].intVal].jumpTarget = &&" << myProcedure->getName() << "_return" << myProcedure->getReturnAddress() << ";" << endl;
-		outFile << "\tR[0].intVal = R[0].intVal - " << myProcedure->getParameterAddress() << ";" << endl;
-		outFile << "\tgoto " << myProcedure->getName() << "_start;" << endl;
-		outFile << "\t" << myProcedure->getName() << "_return" << myProcedure->getReturnAddress() << ":" << endl;
-		outFile << "\tR[0].intVal = R[0].intVal + " << myProcedure->getParameterAddress() + 1 << ";" << endl;
-		outFile << returnCode;
-		outFile << endl;
+		// A call in the program body is numbered among the calls of the procedure, and one in a procedure among the calls in it
+		if( parser.labelName == IR_NO_NAME )
+		{
+			returnLabel = irLabel( PROCEDURE_RETURN_LABEL, symbolNameID( myProcedure ), returnAddress( myProcedure ) );
+			returnAddress( myProcedure )++;
+		}
+		else
+		{
+			returnLabel = irLabel( CALL_RETURN_LABEL, parser.labelName, parser.callID );
+			parser.callID++;
+		}
+		
+		irAppend( IR_CALL, returnLabel, procedureLabel( myProcedure ), irInteger( parameterAddress( myProcedure ) ) );
+		irAppend( IR_LABEL, irNone, returnLabel );
+		irAppend( IR_ADD, irRegister( 0, IR_INTEGER ), irRegister( 0, IR_INTEGER ), irInteger( parameterAddress( myProcedure ) + 1 ) );
+		
+		for( int i = 0; i < returnCode.size(); i++ )
+		{
+			irAppend( returnCode[i] );
+		}
 		
-		myProcedure->advanceReturnAddress();
+		irBlankLine();
 	}
 }
 
-void readArgumentList( Procedure*& currentProcedure, Procedure*& myProcedure, int parameterNumber, int& argumentCount, string& returnCode )
+void readArgumentList( int& currentProcedure, int& myProcedure, int& argumentCount, vector<IrInstruction>& returnCode )
 {
+	ParserState& parser = *context->parser;
 	int resultRegister = 2;
+	int parameterNumber = 0; // Parameter that the argument being read is matched with
 	stringstream convert;
 	
-	registerPointer = 2;
-	
-	// Check if there's an entry in the parameter list to match this argument
-	if( parameterNumber >= myProcedure->getParameterListSize() )
-	{
-		throw CompileErrorException( "Too many arguments in procedure call" );
-	}
-	
-	isArgument = true;
-	argumentOperands = 0;
-	argumentName = NULL;
-	
-	// Parse the argument and check types
-	if( readExpression( currentProcedure, resultRegister ) != myProcedure->getParameterType( parameterNumber ) )
-	{
-		convert.str( string() );
-		convert << parameterNumber;
-		reportError( "Incompatible data type in argument " + convert.str() );
-	}
-	
-	isArgument = false;
-	
-	// CODEGEN: Store this argument in a register for the called procedure to grab later
-	// CODEGEN: Buffer code for storing output parameters after returning
-	if( errorCount == 0 )
+	while( true )
 	{
-		outFile << "\tR[" << 200 + argumentCount << "] = R[" << resultRegister << "];" << endl;
+		parser.registerPointer = 2;
 		
-		convert.str( string() );
-		if( argumentOperands == 1 && myProcedure->getDirection( argumentCount ) == false && argumentName != NULL )
+		// Check if there's an entry in the parameter list to match this argument
+		if( parameterNumber >= parameterCount( myProcedure ) )
 		{
-			if( typeid( *argumentName ) == typeid( Array ) )
-			{
-				Array* myArray = dynamic_cast<Array*>(argumentName);
-				
-				convert << "\tR[2].intVal = MM[" << arrayIndexPointer << "].intVal;" << endl;
-				convert << "\tMM[R[2].intVal + " << myArray->getAddress() << "] = R[" << 200 + argumentCount << "];" << endl;
-				
-				arrayIndexPointer++;
-			}
-			else
+			throw CompileErrorException( "Too many arguments in procedure call" );
+		}
+		
+		parser.isArgument = true;
+		parser.argumentOperands = 0;
+		parser.argumentName = NO_SYMBOL;
+		
+		// Parse the argument and check types
+		if( readExpression( currentProcedure, resultRegister ) != parameterType( myProcedure, parameterNumber ) )
+		{
+			convert.str( string() );
+			convert << parameterNumber;
+			reportError( "Incompatible data type in argument " + convert.str() );
+		}
+		
+		parser.isArgument = false;
+		
+		// CODEGEN: Store this argument in a register for the called procedure to grab later
+		// CODEGEN: Buffer code for storing output parameters after returning
+		if( context->errorCount == 0 )
+		{
+			irAppend( IR_MOVE, irRegister( 200 + argumentCount, IR_FRAME ), irRegister( resultRegister, IR_FRAME ) );
+			
+			if( parser.argumentOperands == 1 && parameterDirection( myProcedure, argumentCount ) == false && parser.argumentName != NO_SYMBOL )
 			{
-				if( argumentName->getGlobal() )
+				if( symbolKind( parser.argumentName ) == ARRAY_SYMBOL )
 				{
-					convert << "\tMM[" << argumentName->getAddress() << "] = R[" << 200 + argumentCount << "];" << endl;
+					returnCode.push_back( irInstruction( IR_MOVE, irRegister( 2, IR_INTEGER ), irIndexSlot( parser.arrayIndexPointer ) ) );
+					returnCode.push_back( irInstruction( IR_MOVE, irStaticMemory( 2, symbolAddress( parser.argumentName ), IR_FRAME ), irRegister( 200 + argumentCount, IR_FRAME ) ) );
+					
+					parser.arrayIndexPointer++;
 				}
-				else
+				else if( symbolGlobal( parser.argumentName ) )
 				{
-					if( argumentName->getParameter() )
-					{
-						convert << "\tMM[R[0].intVal + " << currentProcedure->getLocalAddress() + argumentName->getAddress() << "];" << endl;
-					}
-					else 
-					{
-						convert << "\tMM[R[0].intVal + " << argumentName->getAddress() << "];" << endl;
-					}
+					returnCode.push_back( irInstruction( IR_MOVE, irStaticMemory( IR_NO_BASE, symbolAddress( parser.argumentName ), IR_FRAME ), irRegister( 200 + argumentCount, IR_FRAME ) ) );
 				}
+				
+				// **** A local variable given as an output argument isn't stored back. (The C had a line for it that stored nothing.)
 			}
-			
-			returnCode += convert.str();
 		}
-	}
-	
-	// Increment the counter after successfully parsing and checking the argument
-	argumentCount++;
-	
-	if( currentToken.name.compare( "," ) == 0 )
-	{
+		
+		// Increment the counter after successfully parsing and checking the argument
+		argumentCount++;
+		
+		// If there's no comma, that was the last argument
+		if( parser.currentToken->kind != COMMA_TOKEN )
+		{
+			break;
+		}
+		
 		// Advance Token to after ","
-		currentToken = nextToken;
-		nextToken = getToken();
+		advanceToken();
 		
-		// If there was a comma, expect another argument
-		readArgumentList( currentProcedure, myProcedure, parameterNumber + 1, argumentCount, returnCode );
+		parameterNumber++;
 	}
 }
-
-void readAssignment( Procedure*& currentProcedure )
+void readAssignment( int& currentProcedure )
 {
+	ParserState& parser = *context->parser;
 	DataType destinationType = INVALID;
 	DataType expressionType = INVALID;
-	Variable* destinationVariable = NULL;
+	int destinationVariable = NO_SYMBOL;
 	int resultRegister = 2;
-	string destinationCode;
+	IrOperand destination = irNone; // Memory the result of the assignment is stored in
 	
-	registerPointer = 2;
+	parser.registerPointer = 2;
 	
 	try
 	{
-		destinationType = readDestination( currentProcedure, destinationVariable, destinationCode );
+		destinationType = readDestination( currentProcedure, destinationVariable, destination );
 	}
 	catch( CompileErrorException& e )
 	{
-		// Display the compiler's error message
-		reportError( e.what() );
+		// Resync to Follow(destination) which is ":=", or give up on the statement at its ";"
+		recover( e, destinationSync );
 		
-		// Resync to Follow(destination) which is ":=" or the ";" at the end of the statement
-		while( inFile.good() )
+		if( parser.currentToken->kind != ASSIGN_TOKEN )
 		{
-			if( currentToken.name.compare( ":=" ) == 0 )
-			{
-				break;
-			}
-			else if( currentToken.name.compare( ";" ) == 0 )
-			{
-				throw;
-			}
+			throw;
 		}
 	}
 	
-	if( currentToken.name.compare( ":=" ) == 0 )
+	if( parser.currentToken->kind == ASSIGN_TOKEN )
 	{
 		// Advance Token to after ":="
-		currentToken = nextToken;
-		nextToken = getToken();
+		advanceToken();
 	}
 	else
 	{
@@ -1276,22 +2009,17 @@ void readAssignment( Procedure*& currentProcedure )
 			switch( expressionType )
 			{
 				case BOOL:
-					if( errorCount == 0 )
+					if( context->errorCount == 0 )
 					{
-						outFile << destinationCode << ".intVal = R[" << resultRegister << "].intVal;" << endl << endl;
+						generateAssignment( destination, IR_INTEGER, resultRegister, IR_INTEGER );
 					}
 					break;
 					
 				case INTEGER:
-					if( errorCount == 0 )
+					if( context->errorCount == 0 )
 					{
-						outFile << "\tif( R[resultRegister] != 0 ) goto secondcheck;" << endl;
-						outFile << "\tgoto endcheck;" << endl;
-						outFile << "\tsecondcheck:" << endl;
-						outFile << "\tif( R[resultRegister] != 1 ) goto runtimeerror;" << endl;
-						outFile << "endcheck:" << endl;
-						
-						outFile << destinationCode << ".intVal = R[" << resultRegister << "].intVal;" << endl << endl;
+						irAppend( IR_CHECK_BOOL, irNone, irRegister( resultRegister, IR_INTEGER ) );
+						generateAssignment( destination, IR_INTEGER, resultRegister, IR_INTEGER );
 					}
 					break;
 					
@@ -1305,16 +2033,16 @@ void readAssignment( Procedure*& currentProcedure )
 			switch( expressionType )
 			{
 				case FLOAT:
-					if( errorCount == 0 )
+					if( context->errorCount == 0 )
 					{
-						outFile << destinationCode << ".floatVal = R[" << resultRegister << "].floatVal;" << endl << endl;
+						generateAssignment( destination, IR_FLOAT, resultRegister, IR_FLOAT );
 					}
 					break;
 					
 				case INTEGER:
-					if( errorCount == 0 )
+					if( context->errorCount == 0 )
 					{
-						outFile << destinationCode << ".floatVal = R[" << resultRegister << "].intVal;" << endl << endl;
+						generateAssignment( destination, IR_FLOAT, resultRegister, IR_INTEGER );
 					}
 					break;
 					
@@ -1328,23 +2056,23 @@ void readAssignment( Procedure*& currentProcedure )
 			switch( expressionType )
 			{
 				case BOOL:
-					if( errorCount == 0 )
+					if( context->errorCount == 0 )
 					{
-						outFile << destinationCode << ".intVal = R[" << resultRegister << "].intVal;" << endl << endl;
+						generateAssignment( destination, IR_INTEGER, resultRegister, IR_INTEGER );
 					}
 					break;
 					
 				case FLOAT:
-					if( errorCount == 0 )
+					if( context->errorCount == 0 )
 					{
-						outFile << destinationCode << ".intVal = R[" << resultRegister << "].floatVal;" << endl << endl;
+						generateAssignment( destination, IR_INTEGER, resultRegister, IR_FLOAT );
 					}
 					break;
 					
 				case INTEGER:
-					if( errorCount == 0 )
+					if( context->errorCount == 0 )
 					{
-						outFile << destinationCode << ".intVal = R[" << resultRegister << "].intVal;" << endl << endl;
+						generateAssignment( destination, IR_INTEGER, resultRegister, IR_INTEGER );
 					}
 					break;
 					
@@ -1360,9 +2088,9 @@ void readAssignment( Procedure*& currentProcedure )
 				reportError( "Incompatible data types in assignment statement" );
 			}
 			
-			if( errorCount == 0 )
+			if( context->errorCount == 0 )
 			{
-				outFile << destinationCode << ".stringPointer = R[" << resultRegister << "].stringPointer;" << endl << endl;
+				generateAssignment( destination, IR_STRING, resultRegister, IR_STRING );
 			}
 			break;
 			
@@ -1372,53 +2100,63 @@ void readAssignment( Procedure*& currentProcedure )
 	}
 }
 
-DataType readDestination( Procedure*& currentProcedure, Variable*& myVariable, string& destinationCode )
+// Generates the code that stores the result of an assignment
+void generateAssignment( IrOperand destination, const IrType destinationType, const int resultRegister, const IrType resultType )
+{
+	destination.type = destinationType;
+	
+	irAppend( IR_MOVE, destination, irRegister( resultRegister, resultType ) );
+	irBlankLine();
+}
+
+DataType readDestination( int& currentProcedure, int& myVariable, IrOperand& destination )
 {
-	Token* myName = NULL;
-	Array* myArray = NULL;
+	ParserState& parser = *context->parser;
+	int myName = NO_SYMBOL;
+	int myArray = NO_SYMBOL;
 	DataType nameType = INVALID;
 	int resultRegister = 2;
-	stringstream convert;
 	
-	// currentToken is the identifier. Get its symbol table entry
-	if( currentToken.isGlobal )
+	// currentToken is the identifier. Its symbol table entry was found when the parser took it.
+	myName = parser.currentToken->symbol;
+	
+	// The loop header reads its assignment without checking for a name first
+	if( parser.currentToken->tokenType == NONE )
 	{
-		myName = globalSymbolTable[currentToken.name];
+		throw CompileErrorException( "Undeclared identifier \'" + parser.currentToken->getName() + "\'" );
 	}
-	else
+	else if( myName == NO_SYMBOL )
 	{
-		myName = localSymbolTable[currentScope][currentToken.name];
+		throw CompileErrorException( "Expected variable name before \'" + parser.currentToken->getName() + "\'" );
 	}
 	
-	if( typeid( *myName ) == typeid( Variable ) )
+	if( isVariableSymbol( myName ) )
 	{
-		myVariable = dynamic_cast<Variable*>(myName);
-		nameType = myVariable->getDataType();
+		myVariable = myName;
+		nameType = symbolDataType( myVariable );
 	}
 	else
 	{
-		reportError( "\'" + myName->getName() + "\' is not a valid variable" );
+		reportError( "\'" + symbolName( myName ) + "\' is not a valid variable" );
 	}
 	
 	// Advance Token to after IDENTIFIER
-	currentToken = nextToken;
-	nextToken = getToken();
+	advanceToken();
 	
 	// Check if there is a "[" for an array element
-	if( currentToken.name.compare( "[" ) == 0 )
+	if( parser.currentToken->kind == LEFT_BRACKET_TOKEN )
 	{
-		if( typeid( *myVariable ) != typeid( Array ) )
+		if( symbolKind( myName ) != ARRAY_SYMBOL )
 		{
-			reportError( "\'" + myVariable->getName() + "\' is not an array" );
+			reportError( "\'" + symbolName( myName ) + "\' is not an array" );
 		}
 		else
 		{
-			myArray = dynamic_cast<Array*>(myVariable);
+			myArray = myVariable;
 		}
 		
 		// Advance Token to after "["
-		currentToken = nextToken;
-		nextToken = getToken();
+		advanceToken();
 		
 		
 		if( readExpression( currentProcedure, resultRegister ) != INTEGER )
@@ -1427,11 +2165,10 @@ DataType readDestination( Procedure*& currentProcedure, Variable*& myVariable, s
 		}
 		
 		// Check for "]" after expression
-		if( currentToken.name.compare( "]" ) == 0 )
+		if( parser.currentToken->kind == RIGHT_BRACKET_TOKEN )
 		{
 			// Advance Token to after "]"
-			currentToken = nextToken;
-			nextToken = getToken();
+			advanceToken();
 		}
 		else
 		{
@@ -1439,803 +2176,549 @@ DataType readDestination( Procedure*& currentProcedure, Variable*& myVariable, s
 		}
 		
 		// CODEGEN: Generate code to store result of assignment into array element (will be output later)
-		if( errorCount == 0 )
+		if( context->errorCount == 0 )
 		{
-			convert << "\tMM[R[" << resultRegister << "].intVal + " << myArray->getAddress() << "]";
-			destinationCode = convert.str();
+			destination = irStaticMemory( resultRegister, symbolAddress( myArray ), IR_FRAME );
 		}
 	}
 	// CODEGEN: Generate code to store result of assignment into variable (will be output later)
-	else if( errorCount == 0 )
+	else if( context->errorCount == 0 )
 	{
-		if( typeid( *myVariable ) == typeid( Array ) )
+		if( symbolKind( myVariable ) == ARRAY_SYMBOL )
 		{
-			reportWarning( string( "No array index specified for " + myVariable->getName() ) );
+			reportWarning( string( "No array index specified for " + symbolName( myVariable ) ) );
 		}
 		
-		if( myVariable->getGlobal() )
+		if( symbolGlobal( myVariable ) )
 		{
-			convert << "\tMM[" << myVariable->getAddress() << "]";
+			destination = irStaticMemory( IR_NO_BASE, symbolAddress( myVariable ), IR_FRAME );
 		}
 		else
 		{
-			if( myVariable->getParameter() )
+			if( symbolParameter( myVariable ) )
 			{
-				convert << "\tMM[R[0].intVal + " << currentProcedure->getLocalAddress() + myVariable->getAddress() << "]";
+				destination = irMemory( 0, localAddress( currentProcedure ) + symbolAddress( myVariable ), IR_FRAME );
 			}
 			else
 			{
-				convert << "\tMM[R[0].intVal + " << myVariable->getAddress() << "]";
+				destination = irMemory( 0, symbolAddress( myVariable ), IR_FRAME );
 			}
 		}
-		
-		destinationCode = convert.str();
 	}
 	
 	return nameType;
 }
 
-void readIf( Procedure*& currentProcedure )
+// Reads the header of an if statement, from the "(" after "if" to "then". readStatements() reads the rest of it.
+void readIf( int& currentProcedure, const int myID )
 {
+	ParserState& parser = *context->parser;
 	int resultRegister = 2;
-	// Grab the next available ID number
-	int myID = ifID;
-	ifID++;
 	
-	registerPointer = 2;
+	parser.registerPointer = 2;
 	
-	try
+	// next token should be "("
+	if( parser.currentToken->kind == LEFT_PAREN_TOKEN )
 	{
-		// next token should be "("
-		if( currentToken.name.compare( "(" ) == 0 )
-		{
-			// Advance Token to after "("
-			currentToken = nextToken;
-			nextToken = getToken();
-		}
-		else
-		{
-			throw CompileErrorException( "\'(\' is required before conditional expression" );
-		}
-		
-		// next is the conditional expression
-		// CODEGEN: Begin the code generation for the if block
-		switch( readExpression( currentProcedure, resultRegister ) )
-		{
-			case BOOL:
-				if( errorCount == 0 )
-				{
-					outFile << "\tif( R[" << resultRegister << "].intVal == 1 ) goto if" << myID << "_start;" << endl;
-					outFile << "\tgoto else" << myID << "_start;" << endl;
-					outFile << "\tif" << myID << "_start:" << endl << endl;
-				}
-				break;
-				
-			case INTEGER:
-				if( errorCount == 0 )
-				{
-					outFile << "\tif( R[resultRegister] != 0 ) goto secondcheck;" << endl;
-					outFile << "\tgoto endcheck;" << endl;
-					outFile << "\tsecondcheck:" << endl;
-					outFile << "\tif( R[resultRegister] != 1 ) goto runtimeerror;" << endl;
-					outFile << "endcheck:" << endl;
-					
-					outFile << "\tif( R[" << resultRegister << "].intVal == 1 ) goto if" << myID << "_start;" << endl;
-					outFile << "\tgoto else" << myID << "_start;" << endl;
-					outFile << "\tif" << myID << "_start:" << endl << endl;
-				}
-				break;
-				
-			default:
-				reportError( "Conditional expression must evaluate to boolean data type" );
-				break;
-		}
-		
-		// next is the ")"
-		if( currentToken.name.compare( ")" ) == 0 )
-		{
-			// Advance Token to after ")"
-			currentToken = nextToken;
-			nextToken = getToken();
-		}
-		else
-		{
-			throw CompileErrorException( "\')\' is required after conditional expression" );
-		}
-		
-		// next is "then"
-		if( currentToken.name.compare( "then" ) == 0 )
-		{
-			// Advance Token to after "then"
-			currentToken = nextToken;
-			nextToken = getToken();
-		}
-		else
-		{
-			throw CompileErrorException( "keyword \'then\' is required after \')\' of conditional expression" );
-		}
-		
-		// next is one or more statements
-		registerPointer = 2;
-		readStatements( currentProcedure );
-		
-		// CODEGEN: Begin the else block
-		if( errorCount == 0 )
-		{
-			outFile << "\tgoto endif" << myID << ";" << endl;
-			outFile << "\telse" << myID << "_start:" << endl << endl;
-		}
-		
-		// check if there is an "else" section
-		if( currentToken.name.compare( "else" ) == 0 )
-		{
-			// Advance Token to after "else"
-			currentToken = nextToken;
-			nextToken = getToken();
-			
-			// next is one or more statements
-			readStatements( currentProcedure );
-		}
-		
-		// finally, look for "end if"
-		if( currentToken.name.compare( "end" ) == 0 )
-		{
-			// Advance Token to after "end"
-			currentToken = nextToken;
-			nextToken = getToken();
-			
-			if( currentToken.name.compare( "if" ) == 0 )
-			{
-				// CODEGEN: End the entire if block
-				if( errorCount == 0 )
-				{
-					outFile << "\tendif" << myID << ":" << endl << endl;
-				}
-				
-				currentToken = nextToken;
-				nextToken = getToken();
-			}
-			else
-			{
-				throw CompileErrorException( "Incorrect end of if statement" );
-			}
-		}
-		else
-		{
-			throw CompileErrorException( "Incorrect end of if statement" );
-		}
+		// Advance Token to after "("
+		advanceToken();
 	}
-	catch( CompileErrorException& e )
+	else
 	{
-		// Display the compiler's error message
-		reportError( e.what() );
-		
-		// Keep track of nested blocks while resyncing
-		int nestedCount = 0;
-		
-		while( inFile.good() )
-		{
-			// Resync to Follow(if_statement) which is ";" while accounting for nested ifs
-			if( currentToken.name.compare( "if" ) == 0 )
+		throw CompileErrorException( "\'(\' is required before conditional expression" );
+	}
+	
+	// next is the conditional expression
+	// CODEGEN: Begin the code generation for the if block
+	switch( readExpression( currentProcedure, resultRegister ) )
+	{
+		case BOOL:
+			if( context->errorCount == 0 )
 			{
-				nestedCount++;
+				generateBranch( resultRegister, IF_START_LABEL, ELSE_START_LABEL, myID );
 			}
-			else if( currentToken.name.compare( "end" ) == 0 )
+			break;
+			
+		case INTEGER:
+			if( context->errorCount == 0 )
 			{
-				currentToken = nextToken;
-				nextToken = getToken();
-				
-				if( currentToken.name.compare( "if" ) == 0 )
-				{
-					currentToken = nextToken;
-					nextToken = getToken();
-					
-					// Determine wehther this "end if" is the end of ours or a nested one
-					if( nestedCount == 0 )
-					{
-						break;
-					}
-					else
-					{
-						nestedCount--;
-						continue;
-					}
-				}
-				
+				irAppend( IR_CHECK_BOOL, irNone, irRegister( resultRegister, IR_INTEGER ) );
+				generateBranch( resultRegister, IF_START_LABEL, ELSE_START_LABEL, myID );
 			}
+			break;
 			
-			currentToken = nextToken;
-			nextToken = getToken();
-		}
+		default:
+			reportError( "Conditional expression must evaluate to boolean data type" );
+			break;
+	}
+	
+	// next is the ")"
+	if( parser.currentToken->kind == RIGHT_PAREN_TOKEN )
+	{
+		// Advance Token to after ")"
+		advanceToken();
+	}
+	else
+	{
+		throw CompileErrorException( "\')\' is required after conditional expression" );
+	}
+	
+	// next is "then"
+	if( parser.currentToken->kind == THEN_TOKEN )
+	{
+		// Advance Token to after "then"
+		advanceToken();
+	}
+	else
+	{
+		throw CompileErrorException( "keyword \'then\' is required after \')\' of conditional expression" );
 	}
 }
 
-void readLoop( Procedure*& currentProcedure )
+// Reads the header of a loop, from the "(" after "for" to the ")" after the conditional expression. readStatements() reads the rest of it.
+void readLoop( int& currentProcedure, const int myID )
 {
+	ParserState& parser = *context->parser;
 	int resultRegister = 2;
-	// Grab the next available ID number
-	int myID = loopID;
-	loopID++;
 	
-	registerPointer = 2;
+	parser.registerPointer = 2;
+	
+	// next token should be "("
+	if( parser.currentToken->kind == LEFT_PAREN_TOKEN )
+	{
+		// Advance Token to after "("
+		advanceToken();
+	}
+	else
+	{
+		throw CompileErrorException( "\'(\' is required before assignment statement" );
+	}
 	
+	// next is an assignment statement
 	try
 	{
-		// next token should be "("
-		if( currentToken.name.compare( "(" ) == 0 )
-		{
-			// Advance Token to after "("
-			currentToken = nextToken;
-			nextToken = getToken();
-		}
-		else
-		{
-			throw CompileErrorException( "\'(\' is required before assignment statement" );
-		}
-		
-		// next is an assignment statement
-		try
-		{
-			readAssignment( currentProcedure );
-		}
-		catch( CompileErrorException& e )
-		{
-			// Display the compiler's error message
-			reportError( e.what() );
+		readAssignment( currentProcedure );
+	}
+	catch( CompileErrorException& e )
+	{
+		// Resync to Follow(assignment_statement) which is ";"
+		recover( e, statementSync );
+	}
+	
+	// followed by a ";"
+	if( parser.currentToken->kind == SEMICOLON_TOKEN )
+	{
+		// Advance Token to after ";"
+		advanceToken();
+	}
+	else
+	{
+		throw CompileErrorException( "Missing \';\' after assignment statement" );
+	}
+	
+	// next is the conditional expression
+	// CODEGEN: Begin the code generation for the loop block
+	if( context->errorCount == 0 )
+	{
+		irAppend( IR_LABEL, irNone, irLabel( LOOP_CHECK_LABEL, parser.labelName, myID ) );
+		irBlankLine();
+	}
+	switch( readExpression( currentProcedure, resultRegister ) )
+	{
+		case BOOL:
+			if( context->errorCount == 0 )
+			{
+				generateBranch( resultRegister, LOOP_START_LABEL, END_LOOP_LABEL, myID );
+			}
+			break;
 			
-			// Resync to Follow(assignment_statement) which is ";"
-			while( inFile.good() )
+		case INTEGER:
+			if( context->errorCount == 0 )
 			{
-				if( currentToken.name.compare( ";" ) == 0 )
-				{
-					break;
-				}
-				
-				currentToken = nextToken;
-				nextToken = getToken();
+				irAppend( IR_CHECK_BOOL, irNone, irRegister( resultRegister, IR_INTEGER ) );
+				generateBranch( resultRegister, LOOP_START_LABEL, END_LOOP_LABEL, myID );
 			}
-		}
-		
-		// followed by a ";"
-		if( currentToken.name.compare( ";" ) == 0 )
-		{
-			// Advance Token to after ";"
-			currentToken = nextToken;
-			nextToken = getToken();
-		}
-		else
-		{
-			throw CompileErrorException( "Missing \';\' after assignment statement" );
-		}
-		
-		// next is the conditional expression
-		// CODEGEN: Begin the code generation for the loop block
-		if( errorCount == 0 )
-		{
-			outFile << "\tloop" << myID << "_check:" << endl << endl;
-		}
-		switch( readExpression( currentProcedure, resultRegister ) )
-		{
-			case BOOL:
-				if( errorCount == 0 )
-				{
-					outFile << "\tif( R[" << resultRegister << "].intVal == 1 ) goto loop" << myID << "_start;" << endl;
-					outFile << "\tgoto endloop" << myID << ";" << endl;
-					outFile << "\tloop" << myID << "_start:" << endl << endl;
-				}
-				break;
-				
-			case INTEGER:
-				if( errorCount == 0 )
-				{
-					outFile << "\tif( R[resultRegister] != 0 ) goto secondcheck;" << endl;
-					outFile << "\tgoto endcheck;" << endl;
-					outFile << "\tsecondcheck:" << endl;
-					outFile << "\tif( R[resultRegister] != 1 ) goto runtimeerror;" << endl;
-					outFile << "endcheck:" << endl;
-					
-					outFile << "\tif( R[" << resultRegister << "].intVal == 1 ) goto loop" << myID << "_start;" << endl;
-					outFile << "\tgoto endloop" << myID << ";" << endl;
-					outFile << "\tloop" << myID << "_start:" << endl << endl;
-				}
-				break;
-				
-			default:
-				reportError( "Conditional expression must evaluate to boolean data type" );
-				break;
-		}
-		
-		// next is the ")"
-		if( currentToken.name.compare( ")" ) == 0 )
-		{
-			// Advance Token to after ")"
-			currentToken = nextToken;
-			nextToken = getToken();
-		}
-		else
+			break;
+			
+		default:
+			reportError( "Conditional expression must evaluate to boolean data type" );
+			break;
+	}
+	
+	// next is the ")"
+	if( parser.currentToken->kind == RIGHT_PAREN_TOKEN )
+	{
+		// Advance Token to after ")"
+		advanceToken();
+	}
+	else
+	{
+		throw CompileErrorException( "Missing \')\' after conditional expression" );
+	}
+}
+
+// Generates the code that starts the statements of an if block or loop if the condition in the register is true,
+// and otherwise goes to the else block or the end of the loop
+void generateBranch( const int resultRegister, const IrLabelKind startLabel, const IrLabelKind endLabel, const int myID )
+{
+	ParserState& parser = *context->parser;
+	
+	irAppend( IR_BRANCH, irLabel( endLabel, parser.labelName, myID ), irRegister( resultRegister, IR_INTEGER ), irLabel( startLabel, parser.labelName, myID ) );
+	irAppend( IR_LABEL, irNone, irLabel( startLabel, parser.labelName, myID ) );
+	irBlankLine();
+}
+
+// Reads what comes after the statements of the innermost if statement or loop: an "else" and its statements, or the end of the block.
+// Returns READ_ITEM if the statements of an "else" come next, and END_ITEM once the block has ended and been taken off the parse stack.
+ParseStep readBlockEnd( void )
+{
+	ParserState& parser = *context->parser;
+	ParseFrame& block = parser.parseStack.back();
+	const int myID = block.id;
+	
+	if( block.kind == IF_TOKEN )
+	{
+		// CODEGEN: Begin the else block
+		if( context->errorCount == 0 )
 		{
-			throw CompileErrorException( "Missing \')\' after conditional expression" );
+			irAppend( IR_JUMP, irNone, irLabel( END_IF_LABEL, parser.labelName, myID ) );
+			irAppend( IR_LABEL, irNone, irLabel( ELSE_START_LABEL, parser.labelName, myID ) );
+			irBlankLine();
 		}
 		
-		// Check if there are any statements inside the loop
-		if( currentToken.tokenType == IDENTIFIER || currentToken.name.compare( "if" ) == 0 || currentToken.name.compare( "for" ) == 0 || currentToken.name.compare( "return" ) == 0 )
+		// check if there is an "else" section
+		if( parser.currentToken->kind == ELSE_TOKEN )
 		{
-			registerPointer = 2;
-			readStatements( currentProcedure );
+			// Advance Token to after "else"
+			advanceToken();
+			
+			// next is one or more statements
+			block.kind = ELSE_TOKEN;
+			return READ_ITEM;
 		}
-		
-		// finally, look for "end for"
-		if( currentToken.name.compare( "end" ) == 0 )
+	}
+	
+	// finally, look for "end for" or "end if". An "end" that ends a different block is left for error recovery.
+	if( block.kind == FOR_TOKEN )
+	{
+		if( parser.currentToken->kind == END_TOKEN && parser.nextToken->kind == FOR_TOKEN )
 		{
 			// Advance Token to after "end"
-			currentToken = nextToken;
-			nextToken = getToken();
+			advanceToken();
 			
-			if( currentToken.name.compare( "for" ) == 0 )
-			{
-				// CODEGEN: End the entire loop block
-				if( errorCount == 0 )
-				{
-					outFile << "\tgoto loop" << myID << "_check;" << endl;
-					outFile << "\tendloop" << myID << ":" << endl << endl;
-				}
-				currentToken = nextToken;
-				nextToken = getToken();
-			}
-			else
+			// CODEGEN: End the entire loop block
+			if( context->errorCount == 0 )
 			{
-				throw CompileErrorException( "Incorrect end of for loop" );
+				irAppend( IR_JUMP, irNone, irLabel( LOOP_CHECK_LABEL, parser.labelName, myID ) );
+				irAppend( IR_LABEL, irNone, irLabel( END_LOOP_LABEL, parser.labelName, myID ) );
+				irBlankLine();
 			}
+			advanceToken();
 		}
 		else
 		{
 			throw CompileErrorException( "Incorrect end of for loop" );
 		}
 	}
-	catch( CompileErrorException& e )
+	else
 	{
-		// Display the compiler's error message
-		reportError( e.what() );
-		
-		// Keep track of nested blocks while resyncing
-		int nestedCount = 0;
-		
-		while( inFile.good() )
+		if( parser.currentToken->kind == END_TOKEN && parser.nextToken->kind == IF_TOKEN )
 		{
-			// Resync to Follow(loop_statement) which is ";" while accounting for nested loops
-			if( currentToken.name.compare( "for" ) == 0 )
-			{
-				nestedCount++;
-			}
-			else if( currentToken.name.compare( "end" ) == 0 )
+			// Advance Token to after "end"
+			advanceToken();
+			
+			// CODEGEN: End the entire if block
+			if( context->errorCount == 0 )
 			{
-				currentToken = nextToken;
-				nextToken = getToken();
-				
-				if( currentToken.name.compare( "for" ) == 0 )
-				{
-					currentToken = nextToken;
-					nextToken = getToken();
-					
-					// Determine wehther this "end for" is the end of ours or a nested one
-					if( nestedCount == 0 )
-					{
-						break;
-					}
-					else
-					{
-						nestedCount--;
-						continue;
-					}
-				}
-				
+				irAppend( IR_LABEL, irNone, irLabel( END_IF_LABEL, parser.labelName, myID ) );
+				irBlankLine();
 			}
 			
-			currentToken = getToken();
+			advanceToken();
+		}
+		else
+		{
+			throw CompileErrorException( "Incorrect end of if statement" );
 		}
 	}
+	
+	leaveBlock();
+	return END_ITEM;
 }
 
-DataType readExpression( Procedure*& currentProcedure, int& resultRegister )
+// Reports an error in the innermost if statement or loop, skips the rest of the block and takes it off the parse stack.
+// Returns false if the skip stopped at the end of an enclosing block (or of the input) instead of after the block's own "end".
+bool recoverBlock( CompileErrorException& e )
 {
-	DataType myType1 = INVALID; // Data type for an operand
-	DataType myType2 = INVALID; // Data type for another operand
-	int myRegister1 = 2; // Keeps track of the register of one of the operands
-	int myRegister2 = 2; // Keeps track of the register of one of the operands
-	DataType expressionType = INVALID; // Data type for the whole expression
-	bool restricted = false; // flags whether there was a & or | operator in the expression
-	int operandCount = 0; // Counts number of operands
-	string operation; // Stores the selected operation
+	ParserState& parser = *context->parser;
+	
+	// The kind of block to skip to the end of ("else" is part of an if statement)
+	const TokenKind blockKind = ( parser.parseStack.back().kind == FOR_TOKEN ) ? FOR_TOKEN : IF_TOKEN;
+	bool skippedBlock;
+	
+	// Display the compiler's error message
+	reportError( e.what() );
 	
-	// flag to check when we've reached the end of the expression
-	bool terminate = false;
+	// Resync to Follow(if_statement) or Follow(loop_statement) which is ";" while accounting for nested blocks
+	skippedBlock = skipBlock( blockKind );
+	
+	leaveBlock();
+	return skippedBlock;
+}
+
+DataType readExpression( int& currentProcedure, int& resultRegister )
+{
+	ParserState& parser = *context->parser;
+	DataType expressionType = INVALID; // Data type for the whole expression
 	
 	// Check if there is a "not"
-	if( currentToken.name.compare( "not" ) == 0 )
+	if( parser.currentToken->kind == NOT_TOKEN )
 	{
-		terminate = true;
-		
 		// Advance Token to after "not"
-		currentToken = nextToken;
-		nextToken = getToken();
+		advanceToken();
 		
-		expressionType = readArithOp( currentProcedure, myRegister1 );
+		// The operand of "not" is an ArithOp, and the grammar rule specifies no "&" or "|" afterwards
+		expressionType = readOperation( currentProcedure, resultRegister, ADDING_POWER );
 		
 		switch( expressionType )
 		{
 			case BOOL:
 			case INTEGER:
 				break;
-				
+			
 			default:
 				reportError( "Operand of \'not\' must be a boolean or integer" );
 				break;
 		}
 		
 		// CODEGEN: Generate code for "not" operator
-		if( errorCount == 0 )
+		if( context->errorCount == 0 )
 		{
-			outFile << "\tR[" << myRegister1 << "].intVal = !R[" << myRegister1 << "];" << endl;
+			irAppend( IR_NOT, irRegister( resultRegister, IR_INTEGER ), irRegister( resultRegister, IR_FRAME ) );
 		}
-		
-		// if there was a "not", grammar rule specifies no operator afterwards
 	}
 	else
 	{
-		do
-		{
-			myType2 = myType1;
-			myRegister2 = myRegister1;
-			myType1 = readArithOp( currentProcedure, myRegister1 );
-			operandCount++;
-			
-			// Update the data type of the expression
-			if( operandCount == 1 )
-			{
-				expressionType = myType1;
-			}
-			else if( operandCount > 1 )
-			{
-				expressionType = myType1;
-				
-				// CODEGEN: Generate code for bitwise/logical operators
-				if( errorCount == 0 )
-				{
-					outFile << "\tR[" << myRegister1 << "].intVal = R[" << myRegister1 << "].intVal " << operation << " R[" << myRegister2 << "].intVal;" << endl;
-				}
-			}
-			else
-			{
-				expressionType = INVALID;
-			}
-			
-			// check if there is a "&" or "|" next
-			if( currentToken.name.compare( "&" ) == 0 || currentToken.name.compare( "|" ) == 0 )
-			{
-				restricted = true;
-				operation = currentToken.name;
-				
-				// Advance Token to after "&" or "|"
-				currentToken = nextToken;
-				nextToken = getToken();
-			}
-			else
-			{
-				terminate = true;
-			}
-			
-			// Check the data type of the operand
-			if( restricted )
-			{
-				switch( myType1 )
-				{
-					case BOOL:
-					case INTEGER:
-						break;
-						
-					default:
-						reportError( "Operand of logical expression must be a boolean or integer" );
-						break;
-				}
-			}
-		} while( terminate == false );
+		expressionType = readOperation( currentProcedure, resultRegister, LOGICAL_POWER );
 	}
 	
-	resultRegister = myRegister1;
 	return expressionType;
 }
 
-DataType readArithOp( Procedure*& currentProcedure, int& resultRegister )
+// Reads a factor and the operations after it whose operators have at least the specified binding power, by precedence climbing.
+// Each operand is read once, and the operators that follow it decide which of the grammar's levels (Expression, ArithOp,
+// Relation and Term) it belongs to, so a lone operand costs no more than reading the factor.
+// resultRegister is set to the register holding the result, which is the register of the last operand.
+DataType readOperation( int& currentProcedure, int& resultRegister, const int minimumPower )
 {
-	DataType myType1 = INVALID; // Data type for an operand
-	DataType myType2 = INVALID; // Data type for another operand
-	int myRegister1 = 2; // Keeps track of the register of one of the operands
-	int myRegister2 = 2; // Keeps track of the register of one of the operands
-	DataType arithType = INVALID; // Data type for the whole ArithOp
-	bool restricted = false; // flags whether there was a + or - in the ArithOp
-	int operandCount = 0; // Counts number of operands
-	string operation; // Stores the selected operation
+	ParserState& parser = *context->parser;
+	DataType resultType = INVALID; // Data type of the operations read so far
+	DataType leftType = INVALID; // Data type of the operand before the operator
+	DataType rightType = INVALID; // Data type of the operand after the operator
+	int leftRegister = 2; // Keeps track of the register of the operand before the operator
+	int rightRegister = 2; // Keeps track of the register of the operand after the operator
+	int power; // Binding power of the operators being read
+	int operatorID; // Intern id of the selected operator
 	
-	// flag to check when we've  reached the end of the ArithOp
-	bool terminate = false;
+	resultType = readFactor( currentProcedure, rightRegister );
 	
-	do
+	// Each pass reads the operators of one binding power, the operands between them being read by recursion because they bind tighter.
+	// When an operator with less power follows, the operations read so far are its left operand.
+	while( bindingPowers[parser.currentToken->kind] >= minimumPower )
 	{
-		myType2 = myType1;
-		myRegister2 = myRegister1;
-		myType1 = readRelation( currentProcedure, myRegister1 );
-		operandCount++;
+		power = bindingPowers[parser.currentToken->kind];
+		rightType = resultType;
 		
-		// Update the data type of the ArithOp
-		if( operandCount == 1 )
-		{
-			arithType = myType1;
-		}
-		else if( operandCount > 1 )
+		while( bindingPowers[parser.currentToken->kind] == power )
 		{
-			if( arithType < myType1 )
+			operatorID = parser.currentToken->nameID;
+			
+			// Advance Token to after the operator
+			advanceToken();
+			
+			checkOperand( power, rightType );
+			
+			leftType = rightType;
+			leftRegister = rightRegister;
+			
+			if( power == MULTIPLYING_POWER )
 			{
-				arithType = myType1;
+				rightType = readFactor( currentProcedure, rightRegister );
 			}
-			
-			// CODEGEN: Generate lines for computing addition or subtraction
-			if( errorCount == 0 )
+			else
 			{
-				switch( arithType )
-				{
-					case FLOAT:
-						if( myType1 == FLOAT && myType2 == INTEGER )
-						{
-							outFile << "\tR[" << myRegister1 << "].floatVal = R[" << myRegister1 << "].floatVal " << operation << " R[" << myRegister2 << "].intVal;" << endl;
-						}
-						else if( myType1 == INTEGER && myType2 == FLOAT )
-						{
-							outFile << "\tR[" << myRegister1 << "].floatVal = R[" << myRegister1 << "].intVal " << operation << " R[" << myRegister2 << "].floatVal;" << endl;
-						}
-						break;
-						
-					case INTEGER:
-						outFile << "\tR[" << myRegister1 << "].intVal = R[" << myRegister1 << "].intVal " << operation << " R[" << myRegister2 << "].intVal;" << endl;
-						break;
-						
-					default:
-						break;
-				}
+				rightType = readOperation( currentProcedure, rightRegister, power + 1 );
 			}
-		}
-		else
-		{
-			arithType = INVALID;
-		}
-		
-		// check if there is a "+" or "-" next
-		if( currentToken.name.compare( "+" ) == 0 || currentToken.name.compare( "-" ) == 0 )
-		{
-			restricted = true;
-			operation = currentToken.name;
 			
-			// Advance Token to after "+" or "-"
-			currentToken = nextToken;
-			nextToken = getToken();
-		}
-		else
-		{
-			terminate = true;
+			resultType = combineOperands( power, operatorID, resultType, leftType, rightType, leftRegister, rightRegister );
 		}
 		
-		// Check the data type of the operand
-		if( restricted )
-		{
-			switch( myType1 )
-			{
-				case FLOAT:
-				case INTEGER:
-					break;
-					
-				default:
-					reportError( "Operand of arithmetic expression must be an integer or a float" );
-					break;
-			}
-		}
-	} while( terminate == false );
+		// Check the data type of the last operand
+		checkOperand( power, rightType );
+	}
 	
-	resultRegister = myRegister1;
-	return arithType;
+	resultRegister = rightRegister;
+	return resultType;
 }
 
-DataType readRelation( Procedure*& currentProcedure, int& resultRegister )
+// Reports an error if an operand of an operator with the specified binding power has a data type the operator doesn't take
+void checkOperand( const int power, const DataType operandType )
 {
-	DataType myType1 = INVALID; // Data type for an operand
-	DataType myType2 = INVALID; // Data type for another operand
-	int myRegister1 = 2; // Keeps track of the register of one of the operands
-	int myRegister2 = 2; // Keeps track of the register of one of the operands
-	DataType relationType = INVALID; // Data type for the whole relation
-	bool restricted = false; // flags whether there was a relational operator
-	int operandCount = 0; // Counts number of operands
-	string operation; // Stores the selected operation
-	
-	// flag to check when we've  reached the end of the Relation
-	bool terminate = false;
-	
-	do
+	switch( power )
 	{
-		myType2 = myType1;
-		myRegister2 = myRegister1;
-		myType1 = readTerm( currentProcedure, myRegister1 );
-		operandCount++;
+		case LOGICAL_POWER:
+			if( operandType != BOOL && operandType != INTEGER )
+			{
+				reportError( "Operand of logical expression must be a boolean or integer" );
+			}
+			break;
 		
-		// Update the data type of the ArithOp
-		if( operandCount == 1 )
-		{
-			relationType = myType1;
-		}
-		else if( operandCount > 1 )
-		{
-			relationType = BOOL;
-			
-			// CODEGEN: Generate lines for computing multiplication or division
-			// **** Add code for data conversion check for integers in boolean expression
-			if( errorCount == 0 )
+		case ADDING_POWER:
+			if( operandType != FLOAT && operandType != INTEGER )
 			{
-				outFile << "\tR[" << myRegister1 << "].intVal = R[" << myRegister1 << "].intVal " << operation << " R[" << myRegister2 << "].intVal;" << endl;
+				reportError( "Operand of arithmetic expression must be an integer or a float" );
 			}
-		}
-		else
-		{
-			relationType = INVALID;
-		}
+			break;
 		
-		// check if there is a relational operator next
-		if( currentToken.name.compare( "<" ) == 0 || currentToken.name.compare( ">=" ) == 0 || currentToken.name.compare( "<=" ) == 0 || currentToken.name.compare( ">" ) == 0 || currentToken.name.compare( "==" ) == 0 || currentToken.name.compare( "!=" ) == 0 )
-		{
-			restricted = true;
-			operation = currentToken.name;
-			
-			// Advance Token to after the relational operator
-			currentToken = nextToken;
-			nextToken = getToken();
-		}
-		else
-		{
-			terminate = true;
-		}
+		case RELATIONAL_POWER:
+			if( operandType != BOOL && operandType != INTEGER )
+			{
+				reportError( "Operand of relational expression must be a boolean or an integer" );
+			}
+			break;
 		
-		// Check the data type of the operand
-		if( restricted )
-		{
-			switch( myType1 )
+		case MULTIPLYING_POWER:
+			if( operandType != FLOAT && operandType != INTEGER )
 			{
-				case BOOL:
-				case INTEGER:
-					break;
-					
-				default:
-					reportError( "Operand of relational expression must be a boolean or an integer" );
-					break;
+				reportError( "Operand of arithmetic expression must be a float or an integer" );
 			}
-		}
-	} while( terminate == false );
-	
-	resultRegister = myRegister1;
-	return relationType;
+			break;
+	}
 }
 
-DataType readTerm( Procedure*& currentProcedure, int& resultRegister )
+// Works out the data type of an operation and generates its code. This is where the type conversions of every binary operator are.
+// resultType is the type of the operations of the same binding power before this one (or of the first operand),
+// and leftType is the type of the operand right before the operator. The result goes in the register of the operand after the operator.
+DataType combineOperands( const int power, const int operatorID, const DataType resultType, const DataType leftType, const DataType rightType, int leftRegister, int rightRegister )
 {
-	DataType myType1 = INVALID; // Data type for an operand
-	DataType myType2 = INVALID; // Data type for another operand
-	DataType termType = INVALID; // Data type for the whole term
-	bool restricted = false; // flags whether there was a * or / in the term
-	int operandCount = 0; // Counts number of operands
-	string operation; // Stores the selected operation (multiplication or division)
+	ParserState& parser = *context->parser;
+	DataType combinedType;
+	IrOpcode operation;
 	
-	// flag to check when we've  reached the end of the Term
-	bool terminate = false;
-	
-	do
+	switch( power )
 	{
-		myType2 = myType1;
-		myType1 = readFactor( currentProcedure, resultRegister );
-		operandCount++;
+		case LOGICAL_POWER: // "&" and "|" take the type of their last operand
+			combinedType = rightType;
+			break;
 		
-		// Update the data type of the expression
-		if( operandCount == 1 )
-		{
-			termType = myType1;
-		}
-		else if( operandCount > 1 )
+		case RELATIONAL_POWER: // Comparisons give a boolean
+			combinedType = BOOL;
+			break;
+		
+		default: // Arithmetic on an integer and a float gives a float
+			combinedType = ( resultType < rightType ) ? rightType : resultType;
+			break;
+	}
+	
+	// CODEGEN: Generate lines for computing the operation
+	if( context->errorCount == 0 )
+	{
+		// Operator kinds are numbered like the intern ids of their spellings
+		switch( operatorID )
 		{
-			if( termType < myType1 )
-			{
-				termType = myType1;
-			}
-			
-			// CODEGEN: Generate lines for computing multiplication or division
-			if( errorCount == 0 )
-			{
-				switch( termType )
-				{
-					case FLOAT:
-						if( myType1 == FLOAT && myType2 == INTEGER )
-						{
-							outFile << "\tR[" << registerPointer - 1 << "].floatVal = R[" << registerPointer - 1 << "].floatVal " << operation << " R[" << registerPointer - 2 << "].intVal;" << endl;
-						}
-						else if( myType1 == INTEGER && myType2 == FLOAT )
-						{
-							outFile << "\tR[" << registerPointer - 1 << "].floatVal = R[" << registerPointer - 1 << "].intVal " << operation << " R[" << registerPointer - 2 << "].floatVal;" << endl;
-						}
-						break;
-						
-					case INTEGER:
-						outFile << "\tR[" << registerPointer - 1 << "].intVal = R[" << registerPointer - 1 << "].intVal " << operation << " R[" << registerPointer - 2 << "].intVal;" << endl;
-						break;
-						
-					default:
-						break;
-				}
-			}
+			case PLUS_TOKEN: operation = IR_ADD; break;
+			case MINUS_TOKEN: operation = IR_SUBTRACT; break;
+			case MULTIPLY_TOKEN: operation = IR_MULTIPLY; break;
+			case DIVIDE_TOKEN: operation = IR_DIVIDE; break;
+			case AND_OPERATOR_TOKEN: operation = IR_AND; break;
+			case OR_OPERATOR_TOKEN: operation = IR_OR; break;
+			case LESS_TOKEN: operation = IR_LESS; break;
+			case LESS_EQUAL_TOKEN: operation = IR_LESS_EQUAL; break;
+			case GREATER_TOKEN: operation = IR_GREATER; break;
+			case GREATER_EQUAL_TOKEN: operation = IR_GREATER_EQUAL; break;
+			default: operation = IR_NOT_EQUAL; break;
 		}
-		else
+		
+		// Multiplication and division work on the last two registers used
+		if( power == MULTIPLYING_POWER )
 		{
-			termType = INVALID;
+			rightRegister = parser.registerPointer - 1;
+			leftRegister = parser.registerPointer - 2;
 		}
 		
-		// check if there is a "*" or "/" next
-		if( currentToken.name.compare( "*" ) == 0 || currentToken.name.compare( "/" ) == 0 )
+		if( power == LOGICAL_POWER || power == RELATIONAL_POWER )
 		{
-			restricted = true;
-			operation = currentToken.name;
-			
-			// Advance Token to after the "*"
-			currentToken = nextToken;
-			nextToken = getToken();
+			// **** Add code for data conversion check for integers in boolean expression
+			irAppend( operation, irRegister( rightRegister, IR_INTEGER ), irRegister( rightRegister, IR_INTEGER ), irRegister( leftRegister, IR_INTEGER ) );
 		}
 		else
 		{
-			terminate = true;
-		}
-		
-		// Check the data type of the operand
-		if( restricted )
-		{
-			switch( myType1 )
+			switch( combinedType )
 			{
 				case FLOAT:
+					if( rightType == FLOAT && leftType == INTEGER )
+					{
+						irAppend( operation, irRegister( rightRegister, IR_FLOAT ), irRegister( rightRegister, IR_FLOAT ), irRegister( leftRegister, IR_INTEGER ) );
+					}
+					else if( rightType == INTEGER && leftType == FLOAT )
+					{
+						irAppend( operation, irRegister( rightRegister, IR_FLOAT ), irRegister( rightRegister, IR_INTEGER ), irRegister( leftRegister, IR_FLOAT ) );
+					}
+					break;
+				
 				case INTEGER:
+					irAppend( operation, irRegister( rightRegister, IR_INTEGER ), irRegister( rightRegister, IR_INTEGER ), irRegister( leftRegister, IR_INTEGER ) );
 					break;
-					
+				
 				default:
-					reportError( "Operand of arithmetic expression must be a float or an integer" );
 					break;
 			}
 		}
-	} while( terminate == false );
+	}
 	
-	// resultRegister got set by readFactor
-	return termType;
+	return combinedType;
 }
 
-DataType readFactor( Procedure*& currentProcedure, int& resultRegister )
+DataType readFactor( int& currentProcedure, int& resultRegister )
 {
-	Token* myToken = NULL;
-	Variable* myVariable = NULL;
+	ParserState& parser = *context->parser;
+	int myToken = NO_SYMBOL;
+	int myVariable = NO_SYMBOL;
 	DataType factorType = INVALID;
 	
 	// Check for parenthetical expression
-	if( currentToken.name.compare( "(" ) == 0 )
+	if( parser.currentToken->kind == LEFT_PAREN_TOKEN )
 	{
 		// Advance Token to after "("
-		currentToken = nextToken;
-		nextToken = getToken();
+		advanceToken();
+		
+		// Parentheses are read by recursion, so limit their nesting before it uses up the native stack
+		if( parser.parenthesisDepth >= PARENTHESIS_LIMIT )
+		{
+			ostringstream convert;
+			convert << PARENTHESIS_LIMIT;
+			throw CompileErrorException( "Parentheses are nested more than " + convert.str() + " deep" );
+		}
+		
+		parser.parenthesisDepth++;
+		
+		try
+		{
+			factorType = readExpression( currentProcedure, resultRegister );
+		}
+		catch( CompileErrorException& e )
+		{
+			parser.parenthesisDepth--;
+			throw;
+		}
 		
-		factorType = readExpression( currentProcedure, resultRegister );
+		parser.parenthesisDepth--;
 		
 		// Check for ")" after expression
-		if( currentToken.name.compare( ")" ) == 0 )
+		if( parser.currentToken->kind == RIGHT_PAREN_TOKEN )
 		{
 			// Advance Token to after ")"
-			currentToken = nextToken;
-			nextToken = getToken();
+			advanceToken();
 		}
 		else
 		{
@@ -2243,31 +2726,30 @@ DataType readFactor( Procedure*& currentProcedure, int& resultRegister )
 		}
 	}
 	// Check for negation
-	else if( currentToken.name.compare( "-" ) == 0 )
+	else if( parser.currentToken->kind == MINUS_TOKEN )
 	{
 		// Advance Token to after "-"
-		currentToken = nextToken;
-		nextToken = getToken();
+		advanceToken();
 		
-		if( currentToken.tokenType == IDENTIFIER )
+		if( parser.currentToken->tokenType == IDENTIFIER )
 		{
 			factorType = readName( currentProcedure, resultRegister );
 			
 			// CODEGEN: Negate the variable value in the register
-			if( errorCount == 0 )
+			if( context->errorCount == 0 )
 			{
 				switch( factorType )
 				{
 					case BOOL:
-						outFile << "\tR[" << resultRegister  << "].intVal = !R[" << resultRegister << "].intVal;" << endl;
+						irAppend( IR_NOT, irRegister( resultRegister, IR_INTEGER ), irRegister( resultRegister, IR_INTEGER ) );
 						break;
 						
 					case INTEGER:
-						outFile << "\tR[" << resultRegister  << "].intVal = -1 * R[" << resultRegister << "].intVal;" << endl;
+						irAppend( IR_NEGATE, irRegister( resultRegister, IR_INTEGER ), irRegister( resultRegister, IR_INTEGER ) );
 						break;
 						
 					case FLOAT:
-						outFile << "\tR[" << resultRegister  << "].floatVal = -1 * R[" << resultRegister << "].floatVal;" << endl;
+						irAppend( IR_NEGATE, irRegister( resultRegister, IR_FLOAT ), irRegister( resultRegister, IR_FLOAT ) );
 						break;
 						
 					default:
@@ -2276,19 +2758,19 @@ DataType readFactor( Procedure*& currentProcedure, int& resultRegister )
 				}
 			}
 		}
-		else if( currentToken.tokenType == NUMBER )
+		else if( parser.currentToken->tokenType == NUMBER )
 		{
-			// If there is a decimal point in the number, this is a float
-			if( currentToken.name.find_first_of( '.' ) != string::npos )
+			// The scanner has already worked out whether the number is a float
+			if( parser.currentToken->numberType == FLOAT )
 			{
 				factorType = FLOAT;
 				
 				// CODEGEN: Put the negated number in a register
-				if( errorCount == 0 )
+				if( context->errorCount == 0 )
 				{
-					outFile << "\tR[" << registerPointer << "].floatVal = -1 * " << currentToken.name << ";" << endl;
-					resultRegister = registerPointer;
-					registerPointer++;
+					irAppend( IR_NEGATE, irRegister( parser.registerPointer, IR_FLOAT ), irFloat( parser.currentToken->floatValue ) );
+					resultRegister = parser.registerPointer;
+					parser.registerPointer++;
 				}
 			}
 			else // Otherwise it's an integer
@@ -2296,40 +2778,39 @@ DataType readFactor( Procedure*& currentProcedure, int& resultRegister )
 				factorType = INTEGER;
 				
 				// CODEGEN: Put the negated number in a register
-				if( errorCount == 0 )
+				if( context->errorCount == 0 )
 				{
-					outFile << "\tR[" << registerPointer << "].intVal = -1 * " << currentToken.name << ";" << endl;
-					resultRegister = registerPointer;
-					registerPointer++;
+					irAppend( IR_NEGATE, irRegister( parser.registerPointer, IR_INTEGER ), irInteger( parser.currentToken->intValue ) );
+					resultRegister = parser.registerPointer;
+					parser.registerPointer++;
 				}
 			}
 			
 			// Advance Token to after NUMBER
-			currentToken = nextToken;
-			nextToken = getToken();
+			advanceToken();
 		}
 		else
 		{
-			throw CompileErrorException( "Invalid operand for \'-\': " + currentToken.name );
+			throw CompileErrorException( "Invalid operand for \'-\': " + parser.currentToken->getName() );
 		}
 	}
-	else if( currentToken.tokenType == IDENTIFIER )
+	else if( parser.currentToken->tokenType == IDENTIFIER )
 	{
 		factorType = readName( currentProcedure, resultRegister );
 	}
-	else if( currentToken.tokenType == NUMBER )
+	else if( parser.currentToken->tokenType == NUMBER )
 	{
-		// If there is a decimal point in the number, this is a float
-		if( currentToken.name.find_first_of( '.' ) != string::npos )
+		// The scanner has already worked out whether the number is a float
+		if( parser.currentToken->numberType == FLOAT )
 		{
 			factorType = FLOAT;
 			
 			// CODEGEN: Put the number in a register
-			if( errorCount == 0 )
+			if( context->errorCount == 0 )
 			{
-				outFile << "\tR[" << registerPointer << "].floatVal = " << currentToken.name << ";" << endl;
-				resultRegister = registerPointer;
-				registerPointer++;
+				irAppend( IR_MOVE, irRegister( parser.registerPointer, IR_FLOAT ), irFloat( parser.currentToken->floatValue ) );
+				resultRegister = parser.registerPointer;
+				parser.registerPointer++;
 			}
 		}
 		else // Otherwise it's an integer
@@ -2337,209 +2818,185 @@ DataType readFactor( Procedure*& currentProcedure, int& resultRegister )
 			factorType = INTEGER;
 			
 			// CODEGEN: Put the number in a register
-			if( errorCount == 0 )
+			if( context->errorCount == 0 )
 			{
-				outFile << "\tR[" << registerPointer << "].intVal = " << currentToken.name << ";" << endl;
-				resultRegister = registerPointer;
-				registerPointer++;
+				irAppend( IR_MOVE, irRegister( parser.registerPointer, IR_INTEGER ), irInteger( parser.currentToken->intValue ) );
+				resultRegister = parser.registerPointer;
+				parser.registerPointer++;
 			}
 		}
 		
 		// Advance Token to after NUMBER
-		currentToken = nextToken;
-		nextToken = getToken();
+		advanceToken();
 	}
-	else if( currentToken.tokenType == STRING )
+	else if( parser.currentToken->tokenType == STRING )
 	{
 		factorType = STRINGT;
 		
 		// Check if the string literal is already in the symbol table
-		findSymbolEntry( currentToken );
+		findSymbolEntry( *parser.currentToken );
 		
-		if( currentToken.tokenType == NONE )
+		if( parser.currentToken->tokenType == NONE )
 		{
-			myVariable = new Variable( STRING, currentToken.name, STRINGT, true, memoryPointer, false );
+			myVariable = newVariableSymbol( STRING, parser.currentToken->nameID, STRINGT, true, parser.memoryPointer, false );
 			addSymbolEntry( myVariable );
 			
+			// Note it for the code kept of a top-level procedure, which has to declare it again when the code is reused
+			if( parser.labelName != IR_NO_NAME )
+			{
+				parser.topProcedure.literals.push_back( parser.currentToken->nameID );
+				parser.topProcedure.literals.push_back( parser.memoryPointer );
+			}
+			
 			// CODEGEN: Generate code to put literal strings in memory. (hold for output later)
-			if( errorCount == 0 )
+			if( context->errorCount == 0 )
 			{
-				ostringstream convert;
-				
-				for( int i = 1; i < currentToken.name.size() - 1; i++ )
+				// Store each character between the quotes, and then the terminating '\0'
+				for( int i = 1; i < parser.currentToken->getName().size(); i++ )
 				{
-					switch( currentToken.name[i] )
-					{
-						case '\'':
-							convert << "\tR[2].charVal = \'\\\'\';" << endl;
-							break;
-							
-						case '\"':
-							convert << "\tR[2].charVal = \'\\\"\';" << endl;
-							break;
-							
-						default:
-							convert << "\tR[2].charVal = \'" << currentToken.name[i] << ";" << endl;
-							break;
-					}
+					const char character = ( i < parser.currentToken->getName().size() - 1 ) ? parser.currentToken->getName()[i] : '\0';
 					
-					convert << "\tMM[" << memoryPointer + i - 1 << "] = R[2];" << endl;
+					parser.literalStorage.push_back( irInstruction( IR_MOVE, irRegister( 2, IR_CHARACTER ), irCharacter( character ) ) );
+					parser.literalStorage.push_back( irInstruction( IR_MOVE, irStaticMemory( IR_NO_BASE, parser.memoryPointer + i - 1, IR_FRAME ), irRegister( 2, IR_FRAME ) ) );
 				}
-				
-				convert << "\tR[2].charVal = \'\\0\';" << endl;
-				convert << "\tMM[" << memoryPointer + currentToken.name.size() - 2 << "] = R[2];" << endl;
-				
-				literalStorage += convert.str();
 			}
 			
-			memoryPointer += ( currentToken.name.size() - 1 );
+			parser.memoryPointer += ( parser.currentToken->getName().size() - 1 );
 		}
-		else if( currentToken.tokenType == STRING )
+		else if( parser.currentToken->tokenType == STRING )
 		{
-			myToken = globalSymbolTable[currentToken.name];
-			if( typeid( *myToken ) == typeid( Variable ) )
+			myToken = parser.currentToken->symbol;
+			if( symbolKind( myToken ) == VARIABLE_SYMBOL )
 			{
-				myVariable = dynamic_cast<Variable*>(myToken);
+				myVariable = myToken;
 			}
 			
 			// CODEGEN: Load the address of the string literal into a register
-			if( errorCount == 0 )
+			if( context->errorCount == 0 )
 			{
-				outFile << "\tR[" << registerPointer << "].stringPointer = " << myVariable->getAddress() << ";" << endl;
-				resultRegister = registerPointer;
-				registerPointer++;
+				irAppend( IR_MOVE, irRegister( parser.registerPointer, IR_STRING ), irStaticAddress( symbolAddress( myVariable ) ) );
+				resultRegister = parser.registerPointer;
+				parser.registerPointer++;
 			}
 		}
 		
 		// Advance Token to after STRING
-		currentToken = nextToken;
-		nextToken = getToken();
+		advanceToken();
 	}
-	else if( currentToken.name.compare( "true" ) == 0 )
+	else if( parser.currentToken->kind == TRUE_TOKEN )
 	{
 		factorType = BOOL;
 		
 		// CODEGEN: Put "true" in a register as 1
-		if( errorCount == 0 )
+		if( context->errorCount == 0 )
 		{
-			outFile << "\tR[" << registerPointer << "].intVal = 1;" << endl;
-			resultRegister = registerPointer;
-			registerPointer++;
+			irAppend( IR_MOVE, irRegister( parser.registerPointer, IR_INTEGER ), irInteger( 1 ) );
+			resultRegister = parser.registerPointer;
+			parser.registerPointer++;
 		}
 		
 		// Advance Token to after "true" or "false"
-		currentToken = nextToken;
-		nextToken = getToken();
+		advanceToken();
 	}
-	else if( currentToken.name.compare( "false" ) == 0 )
+	else if( parser.currentToken->kind == FALSE_TOKEN )
 	{
 		factorType = BOOL;
 		
 		// CODEGEN: Put "false" in a register as 0
-		if( errorCount == 0 )
+		if( context->errorCount == 0 )
 		{
-			outFile << "\tR[" << registerPointer << "].intVal = 0;" << endl;
-			resultRegister = registerPointer;
-			registerPointer++;
+			irAppend( IR_MOVE, irRegister( parser.registerPointer, IR_INTEGER ), irInteger( 0 ) );
+			resultRegister = parser.registerPointer;
+			parser.registerPointer++;
 		}
 		
 		// Advance Token to after "true" or "false"
-		currentToken = nextToken;
-		nextToken = getToken();
+		advanceToken();
 	}
 	else
 	{
-		throw CompileErrorException( "Invalid factor: " + currentToken.name );
+		throw CompileErrorException( "Invalid factor: " + parser.currentToken->getName() );
 	}
 	
-	if( isArgument )
+	if( parser.isArgument )
 	{
-		argumentOperands++;
+		parser.argumentOperands++;
 	}
 	
 	return factorType;
 }
 
-DataType readName( Procedure*& currentProcedure, int& resultRegister )
+DataType readName( int& currentProcedure, int& resultRegister )
 {
-	Token* myName = NULL;
-	Variable* myVariable = NULL;
-	Array* myArray = NULL;
+	ParserState& parser = *context->parser;
+	int myName = NO_SYMBOL;
+	int myVariable = NO_SYMBOL;
+	int myArray = NO_SYMBOL;
 	DataType nameType = INVALID;
 	int tempArgumentOperands = 0;
 	
-	// currentToken is the identifier. Get its symbol table entry
-	if( currentToken.isGlobal )
-	{
-		myName = globalSymbolTable[currentToken.name];
-	}
-	else
-	{
-		myName = localSymbolTable[currentScope][currentToken.name];
-	}
+	// currentToken is the identifier. Its symbol table entry was found when the parser took it.
+	myName = parser.currentToken->symbol;
 	
-	if( typeid( *myName ) == typeid( Variable ) )
+	if( isVariableSymbol( myName ) )
 	{
-		myVariable = dynamic_cast<Variable*>(myName);
-		nameType = myVariable->getDataType();
+		myVariable = myName;
+		nameType = symbolDataType( myVariable );
 	}
 	else
 	{
-		reportError( "\'" + myName->getName() + "\' is not a valid variable" );
+		reportError( "\'" + symbolName( myName ) + "\' is not a valid variable" );
 	}
 	
-	if( isArgument )
+	if( parser.isArgument )
 	{
-		argumentName = myVariable;
+		parser.argumentName = myVariable;
 	}
 	
 	// Advance Token to after IDENTIFIER
-	currentToken = nextToken;
-	nextToken = getToken();
+	advanceToken();
 	
 	// Check if there is a "[" for an array element
-	if( currentToken.name.compare( "[" ) == 0 )
+	if( parser.currentToken->kind == LEFT_BRACKET_TOKEN )
 	{
-		if( typeid( *myVariable ) != typeid( Array ) )
+		if( symbolKind( myName ) != ARRAY_SYMBOL )
 		{
-			reportError( "\'" + myVariable->getName() + "\' is not an array" );
+			reportError( "\'" + symbolName( myName ) + "\' is not an array" );
 		}
 		else
 		{
-			myArray = dynamic_cast<Array*>(myVariable);
+			myArray = myVariable;
 		}
 		
 		// Advance Token to after "["
-		currentToken = nextToken;
-		nextToken = getToken();
+		advanceToken();
 		
-		tempArgumentOperands = argumentOperands;
+		tempArgumentOperands = parser.argumentOperands;
 		if( readExpression( currentProcedure, resultRegister ) != INTEGER )
 		{
 			reportError( "Array index must evaluate to an integer" );
 		}
-		argumentOperands = tempArgumentOperands;
+		parser.argumentOperands = tempArgumentOperands;
 		
 		// CODEGEN: Load the array element into a register
-		if( errorCount == 0 )
+		if( context->errorCount == 0 )
 		{
-			outFile << "\tR[" << registerPointer << "] = MM[R[" << resultRegister << "].intVal + " << myArray->getAddress() << "];" << endl;
+			irAppend( IR_MOVE, irRegister( parser.registerPointer, IR_FRAME ), irStaticMemory( resultRegister, symbolAddress( myArray ), IR_FRAME ) );
 			
-			if( isArgument )
+			if( parser.isArgument )
 			{
-				outFile << "\tMM[" << arrayIndexPointer << "].intVal = R[" << resultRegister << "].intVal;" << endl;
+				irAppend( IR_MOVE, irIndexSlot( parser.arrayIndexPointer ), irRegister( resultRegister, IR_INTEGER ) );
 			}
 			
-			resultRegister = registerPointer;
-			registerPointer++;
+			resultRegister = parser.registerPointer;
+			parser.registerPointer++;
 		}
 		
 		// Check for "]" after expression
-		if( currentToken.name.compare( "]" ) == 0 )
+		if( parser.currentToken->kind == RIGHT_BRACKET_TOKEN )
 		{
 			// Advance Token to after "]"
-			currentToken = nextToken;
-			nextToken = getToken();
+			advanceToken();
 		}
 		else
 		{
@@ -2547,85 +3004,48 @@ DataType readName( Procedure*& currentProcedure, int& resultRegister )
 		}
 	}
 	// CODEGEN: Load the variable into a register
-	else if( errorCount == 0 )
+	else if( context->errorCount == 0 )
 	{
-		if( typeid( *myVariable ) == typeid( Array ) )
+		if( symbolKind( myVariable ) == ARRAY_SYMBOL )
 		{
-			reportWarning( "No array index specified for " + myVariable->getName() );
+			reportWarning( "No array index specified for " + symbolName( myVariable ) );
 		}
 		
-		if( myVariable->getGlobal() )
+		if( symbolGlobal( myVariable ) )
 		{
-			outFile << "\tR[" << registerPointer << "] = MM[" << myVariable->getAddress() << "];" << endl;
+			irAppend( IR_MOVE, irRegister( parser.registerPointer, IR_FRAME ), irStaticMemory( IR_NO_BASE, symbolAddress( myVariable ), IR_FRAME ) );
 		}
 		else
 		{
-			if( myVariable->getParameter() )
+			if( symbolParameter( myVariable ) )
 			{
-				outFile << "\tR[" << registerPointer << "] = MM[R[0].intVal + " << currentProcedure->getLocalAddress() + myVariable->getAddress() << "];" << endl;
+				irAppend( IR_MOVE, irRegister( parser.registerPointer, IR_FRAME ), irMemory( 0, localAddress( currentProcedure ) + symbolAddress( myVariable ), IR_FRAME ) );
 			}
 			else
 			{
-				outFile << "\tR[" << registerPointer << "] = MM[R[0].intVal + " << myVariable->getAddress() << "];" << endl;
+				irAppend( IR_MOVE, irRegister( parser.registerPointer, IR_FRAME ), irMemory( 0, symbolAddress( myVariable ), IR_FRAME ) );
 			}
 		}
 		
-		resultRegister = registerPointer;
-		registerPointer++;
+		resultRegister = parser.registerPointer;
+		parser.registerPointer++;
 	}
 	
 	return nameType;
 }
 
-// This function runs after the parse has successfully completed without errors
-// It adds code for the input code to call the runtime functions.
-void generateRuntime( void )
+// Moves currentToken and nextToken one token along in the lookahead ring.
+// Nothing is copied: they just point at the ring's slots.
+void advanceToken( void )
 {
-	outFile << "\tgetBool_start:" << endl;
-	outFile << "\tMM[R[0].intVal].intVal = getBool();" << endl;
-	outFile << "\tjumpRegister = MM[R[0].intVal + 1].jumpTarget;" << endl;
-	outFile << "\tgoto *jumpRegister;" << endl << endl;
-	
-	outFile << "\tgetInteger_start:" << endl;
-	outFile << "\tMM[R[0].intVal].intVal = getInteger();" << endl;
-	outFile << "\tjumpRegister = MM[R[0].intVal + 1].jumpTarget;" << endl;
-	outFile << "\tgoto *jumpRegister;" << endl << endl;
-	
-	outFile << "\tgetFloat_start:" << endl;
-	outFile << "\tMM[R[0].intVal].floatVal = getFloat();" << endl;
-	outFile << "\tjumpRegister = MM[R[0].intVal + 1].jumpTarget;" << endl;
-	outFile << "\tgoto *jumpRegister;" << endl << endl;
-	
-	outFile << "\tgetString_start:" << endl;
-	outFile << "\tMM[R[0].intVal].stringPointer = getString();" << endl;
-	outFile << "\tjumpRegister = MM[R[0].intVal + 1].jumpTarget;" << endl;
-	outFile << "\tgoto *jumpRegister;" << endl << endl;
-	
-	outFile << "\tputBool_start:" << endl;
-	outFile << "\tputBool( MM[R[0].intVal].intVal );" << endl;
-	outFile << "\tjumpRegister = MM[R[0].intVal + 1].jumpTarget;" << endl;
-	outFile << "\tgoto *jumpRegister;" << endl << endl;
-	
-	outFile << "\tputInteger_start:" << endl;
-	outFile << "\tputInteger( MM[R[0].intVal].intVal );" << endl;
-	outFile << "\tjumpRegister = MM[R[0].intVal + 1].jumpTarget;" << endl;
-	outFile << "\tgoto *jumpRegister;" << endl << endl;
-	
-	outFile << "\tputFloat_start:" << endl;
-	outFile << "\tputFloat( MM[R[0].intVal].floatVal );" << endl;
-	outFile << "\tjumpRegister = MM[R[0].intVal + 1].jumpTarget;" << endl;
-	outFile << "\tgoto *jumpRegister;" << endl << endl;
-	
-	outFile << "\tputString_start:" << endl;
-	outFile << "\tputString( MM[R[0].intVal].stringPointer );" << endl;
-	outFile << "\tjumpRegister = MM[R[0].intVal + 1].jumpTarget;" << endl;
-	outFile << "\tgoto *jumpRegister;" << endl << endl;
-	
-	outFile << "\truntimeerror:" << endl;
-	outFile << "\tputString( 0 );" << endl;
-	
-	outFile << "}" << endl << endl;
-	
-	outFile << "#include \"runtime.c\"" << endl;
-	outFile << endl;	
+	ParserState& parser = *context->parser;
+	
+	if( parser.job != NULL )
+	{
+		parser.job->tokens.push_back( *parser.currentToken );
+	}
+	
+	consumeToken();
+	parser.currentToken = &lookaheadToken( 0 );
+	parser.nextToken = &lookaheadToken( 1 );
 }
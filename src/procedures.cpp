@@ -0,0 +1,316 @@
+// Filename: procedures.cpp
+// Author: Himanshu Narayana
+// This file is the part of the compile cache that works procedure by procedure. When a program that was compiled before is compiled again,
+// a top-level procedure that hasn't changed isn't parsed again: its code is taken from the last compile and spliced in (see the parser's
+// reuseTopProcedure()). The procedures are found with the scanner before the parse, and each one gets a fingerprint of its tokens
+// and of what the names in it stand for outside of it, which is everything its code depends on.
+
+#include "compiler.h"
+
+using namespace std;
+
+static void addSignature( vector<long long>& material, const int symbol );
+static int findNameIndex( const vector<pair<int, int> >& nameIndexes, const int nameID );
+static void packOperand( IrOperand& operand, const vector<pair<int, int> >& nameIndexes, const int memoryStart, const int slotStart, bool& packed );
+static void unpackOperand( IrOperand& operand, const ProcedureRegion& region, const int memoryStart, const int slotStart, bool& unpacked );
+
+// Finds the top-level procedures of the program in the length bytes at source, and hashes their tokens.
+// A top-level procedure runs from a "procedure" that isn't inside another one to the "end procedure" that closes it,
+// and they all come before the program's "begin". The spellings are interned, so call this after the scanner is initialized.
+void findTopProcedures( const char* source, const size_t length, vector<ProcedureRegion>& regions )
+{
+	ScannedBuffer buffer;
+	BufferEntry entry;
+	ProcedureRegion region;
+	string spellings; // Spellings of the tokens of the procedure being read, each after its length
+	vector<int> lastRegion; // Number of the last procedure each intern id was seen in, plus one
+	TokenKind lastKind = END_OF_INPUT_TOKEN;
+	int depth = 0; // How many procedures the token is inside of
+	int spellingLength;
+	bool closesProcedure;
+	
+	regions.clear();
+	scanBuffer( buffer, string( source, length ) );
+	
+	for( int i = 0; i < bufferEntryCount( buffer ); i++ )
+	{
+		entry = bufferEntry( buffer, i );
+		
+		if( entry.warning != NULL )
+		{
+			continue;
+		}
+		
+		// Only declarations come before the program's "begin"
+		if( entry.token.kind == END_OF_INPUT_TOKEN || ( depth == 0 && entry.token.kind == BEGIN_TOKEN ) )
+		{
+			break;
+		}
+		
+		// "procedure" opens a procedure, and "end procedure" closes the innermost one
+		closesProcedure = entry.token.kind == PROCEDURE_TOKEN && lastKind == END_TOKEN;
+		lastKind = entry.token.kind;
+		
+		if( entry.token.kind == PROCEDURE_TOKEN && closesProcedure == false )
+		{
+			if( depth == 0 )
+			{
+				region.line = entry.token.line;
+				region.names.clear();
+				spellings.clear();
+			}
+			
+			depth++;
+		}
+		
+		if( depth == 0 )
+		{
+			continue;
+		}
+		
+		spellingLength = entry.token.getName().size();
+		spellings.append( reinterpret_cast<const char*>( &spellingLength ), sizeof( spellingLength ) );
+		spellings.append( entry.token.getName() );
+		
+		if( entry.token.kind == NAME_TOKEN || entry.token.kind == STRING_LITERAL_TOKEN )
+		{
+			if( entry.token.nameID >= static_cast<int>( lastRegion.size() ) )
+			{
+				lastRegion.resize( entry.token.nameID + 1, 0 );
+			}
+			
+			if( lastRegion[entry.token.nameID] != static_cast<int>( regions.size() ) + 1 )
+			{
+				lastRegion[entry.token.nameID] = regions.size() + 1;
+				region.names.push_back( entry.token.nameID );
+			}
+		}
+		
+		if( closesProcedure )
+		{
+			depth--;
+			
+			if( depth == 0 )
+			{
+				region.tokens = hashBytes( spellings.data(), spellings.size(), 0 );
+				regions.push_back( region );
+			}
+		}
+	}
+}
+
+// Returns the fingerprint of a top-level procedure that is about to be parsed: the hash of its tokens, of whether it is global,
+// and of the signature of every symbol its names and string literals could be found as when it starts (a global symbol, or one declared
+// in the program's own scope). Those are the only symbols declared outside the procedure that the parse of it can see, so two procedures
+// with the same fingerprint compile to the same code.
+CacheKey procedureFingerprint( const ProcedureRegion& region, const bool isGlobal )
+{
+	vector<long long> material;
+	
+	material.reserve( region.names.size() * 8 + 3 );
+	material.push_back( isGlobal ? 1 : 0 );
+	material.push_back( region.tokens.hash[0] );
+	material.push_back( region.tokens.hash[1] );
+	
+	for( size_t i = 0; i < region.names.size(); i++ )
+	{
+		addSignature( material, lookupGlobalSymbol( region.names[i] ) );
+		addSignature( material, lookupLocalSymbol( region.names[i] ) );
+	}
+	
+	return hashBytes( reinterpret_cast<const char*>( material.data() ), material.size() * sizeof( long long ), CACHE_FORMAT_VERSION );
+}
+
+// Adds everything code generation can use about a symbol (or NO_SYMBOL) to the material of a fingerprint
+void addSignature( vector<long long>& material, const int symbol )
+{
+	if( symbol == NO_SYMBOL )
+	{
+		material.push_back( -1 );
+		return;
+	}
+	
+	material.push_back( symbolKind( symbol ) );
+	material.push_back( context->symbolStore.records[symbol].tokenType );
+	material.push_back( symbolGlobal( symbol ) );
+	material.push_back( symbolParameter( symbol ) );
+	
+	if( symbolKind( symbol ) == PROCEDURE_SYMBOL )
+	{
+		material.push_back( parameterCount( symbol ) );
+		material.push_back( parameterAddress( symbol ) );
+		
+		for( int i = 0; i < parameterCount( symbol ); i++ )
+		{
+			material.push_back( parameterType( symbol, i ) );
+			material.push_back( parameterDirection( symbol, i ) );
+		}
+	}
+	else if( isVariableSymbol( symbol ) )
+	{
+		material.push_back( symbolDataType( symbol ) );
+		material.push_back( symbolAddress( symbol ) );
+		material.push_back( context->symbolStore.arraySizes[symbol] );
+	}
+}
+
+// Returns the fragment with the specified fingerprint kept from the last compile, or NULL if there isn't one
+const ProcedureFragment* findFragment( const ProcedureCache& cache, const CacheKey& fingerprint )
+{
+	size_t low = 0;
+	size_t high = cache.fragments.size();
+	size_t middle;
+	
+	while( low < high )
+	{
+		middle = ( low + high ) / 2;
+		
+		if( cache.fragments[middle].fingerprint.hash[0] < fingerprint.hash[0] ||
+			( cache.fragments[middle].fingerprint.hash[0] == fingerprint.hash[0] && cache.fragments[middle].fingerprint.hash[1] < fingerprint.hash[1] ) )
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+	
+	if( low < cache.fragments.size() && cache.fragments[low].fingerprint.hash[0] == fingerprint.hash[0] && cache.fragments[low].fingerprint.hash[1] == fingerprint.hash[1] )
+	{
+		return &cache.fragments[low];
+	}
+	
+	return NULL;
+}
+
+// Makes the code and string literals of a procedure, as the parser generated them, independent of where they were generated:
+// names become indexes into the region's names, and static addresses and index slots from the procedure's own start on
+// become offsets from it. Returns false if the code names something that isn't in the procedure (then it can't be kept).
+bool packFragment( ProcedureFragment& fragment, const ProcedureRegion& region, const int memoryStart, const int slotStart )
+{
+	vector<pair<int, int> > nameIndexes; // Intern id and index of each name, in order of intern id
+	bool packed = true;
+	
+	for( size_t i = 0; i < region.names.size(); i++ )
+	{
+		nameIndexes.push_back( make_pair( region.names[i], static_cast<int>( i ) ) );
+	}
+	
+	sort( nameIndexes.begin(), nameIndexes.end() );
+	
+	for( size_t i = 0; i < fragment.code.size(); i++ )
+	{
+		packOperand( fragment.code[i].result, nameIndexes, memoryStart, slotStart, packed );
+		packOperand( fragment.code[i].left, nameIndexes, memoryStart, slotStart, packed );
+		packOperand( fragment.code[i].right, nameIndexes, memoryStart, slotStart, packed );
+		fragment.code[i].next = NULL;
+	}
+	
+	for( size_t i = 0; i < fragment.setupCode.size(); i++ )
+	{
+		packOperand( fragment.setupCode[i].result, nameIndexes, memoryStart, slotStart, packed );
+		packOperand( fragment.setupCode[i].left, nameIndexes, memoryStart, slotStart, packed );
+		packOperand( fragment.setupCode[i].right, nameIndexes, memoryStart, slotStart, packed );
+		fragment.setupCode[i].next = NULL;
+	}
+	
+	for( size_t i = 0; i + 1 < fragment.literals.size(); i += 2 )
+	{
+		fragment.literals[i] = findNameIndex( nameIndexes, fragment.literals[i] );
+		fragment.literals[i + 1] -= memoryStart;
+		packed = packed && fragment.literals[i] >= 0;
+	}
+	
+	return packed;
+}
+
+// Does the opposite of packFragment(), for splicing the code into a compile where the procedure starts at memoryStart and slotStart.
+// Returns false if the fragment doesn't fit the region (then it can't be used).
+bool unpackFragment( ProcedureFragment& fragment, const ProcedureRegion& region, const int memoryStart, const int slotStart )
+{
+	bool unpacked = true;
+	
+	for( size_t i = 0; i < fragment.code.size(); i++ )
+	{
+		unpackOperand( fragment.code[i].result, region, memoryStart, slotStart, unpacked );
+		unpackOperand( fragment.code[i].left, region, memoryStart, slotStart, unpacked );
+		unpackOperand( fragment.code[i].right, region, memoryStart, slotStart, unpacked );
+	}
+	
+	for( size_t i = 0; i < fragment.setupCode.size(); i++ )
+	{
+		unpackOperand( fragment.setupCode[i].result, region, memoryStart, slotStart, unpacked );
+		unpackOperand( fragment.setupCode[i].left, region, memoryStart, slotStart, unpacked );
+		unpackOperand( fragment.setupCode[i].right, region, memoryStart, slotStart, unpacked );
+	}
+	
+	for( size_t i = 0; i + 1 < fragment.literals.size() && unpacked; i += 2 )
+	{
+		unpacked = fragment.literals[i] >= 0 && fragment.literals[i] < static_cast<int>( region.names.size() );
+		
+		if( unpacked )
+		{
+			fragment.literals[i] = region.names[fragment.literals[i]];
+			fragment.literals[i + 1] += memoryStart;
+		}
+	}
+	
+	return unpacked;
+}
+
+// Returns the index that goes with an intern id in the sorted pairs, or -1 if it isn't there
+int findNameIndex( const vector<pair<int, int> >& nameIndexes, const int nameID )
+{
+	vector<pair<int, int> >::const_iterator found = lower_bound( nameIndexes.begin(), nameIndexes.end(), make_pair( nameID, -1 ) );
+	
+	return ( found != nameIndexes.end() && found->first == nameID ) ? found->second : -1;
+}
+
+void packOperand( IrOperand& operand, const vector<pair<int, int> >& nameIndexes, const int memoryStart, const int slotStart, bool& packed )
+{
+	if( operand.kind == IR_LABEL_OPERAND && operand.base != IR_NO_NAME )
+	{
+		operand.base = findNameIndex( nameIndexes, operand.base );
+		packed = packed && operand.base >= 0;
+	}
+	else if( operand.relocation == IR_STATIC_ADDRESS )
+	{
+		// Addresses from before the procedure are of the globals it uses, which the fingerprint holds, so they stay as they are
+		if( operand.value >= memoryStart )
+		{
+			operand.value -= memoryStart;
+		}
+		else
+		{
+			operand.relocation = IR_FIXED;
+		}
+	}
+	else if( operand.relocation == IR_INDEX_SLOT )
+	{
+		operand.value -= slotStart;
+	}
+}
+
+void unpackOperand( IrOperand& operand, const ProcedureRegion& region, const int memoryStart, const int slotStart, bool& unpacked )
+{
+	if( operand.kind == IR_LABEL_OPERAND && operand.base != IR_NO_NAME )
+	{
+		if( operand.base >= 0 && operand.base < static_cast<int>( region.names.size() ) )
+		{
+			operand.base = region.names[operand.base];
+		}
+		else
+		{
+			unpacked = false;
+		}
+	}
+	else if( operand.relocation == IR_STATIC_ADDRESS )
+	{
+		operand.value += memoryStart;
+	}
+	else if( operand.relocation == IR_INDEX_SLOT )
+	{
+		operand.value += slotStart;
+	}
+}
@@ -0,0 +1,247 @@
+// Filename: scanbench.cpp
+// Author: Himanshu Narayana
+// This file is the scanner benchmark (make scanbench). It takes every token of a file with getToken(), once with the file
+// mapped into memory and once with it read through a pipe from standard input, and prints how many megabytes a second each way manages.
+// With --pipeline it times taking the tokens the way the parser does instead, first scanning them in the same thread and then
+// with a second thread scanning ahead and handing them over through the pipeline queue, as narcomp --pipeline does.
+// With --tokens it writes out the tokens and warnings instead, for comparing the scanner with --scalar and without (make check-scalar).
+
+#include "compiler.h"
+
+#include <chrono>
+#include <thread>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Ways of taking the tokens the benchmark times: with getToken(), or as the parser does (with lookaheadToken() and consumeToken()),
+// either scanning them itself or taking them from the pipeline's thread
+enum ScanWay { SCANNER_ONLY, PARSER_SCANS, PIPELINE_SCANS };
+static const char* const wayNames[] = { "", ", taken by the parser", ", taken by the parser from --pipeline" };
+
+static double timeInput( const char* filename, const bool piped, const ScanWay way, const int runs, long long& tokenCount );
+static double timeScan( const char* inputFile, const ScanWay way, long long& tokenCount );
+static void writeToPipe( const char* filename, const int pipeDescriptor );
+static void writeTokens( const char* inputFile );
+
+int main( int argc, char** argv )
+{
+	bool forceScalar = false; // Set by --scalar to time the plain scalar scanner
+	bool pipeline = false; // Set by --pipeline to scan in a second thread ahead of the one taking the tokens
+	int runs = 3; // Set by --runs to the number of times each way is timed (the best time counts)
+	bool tokens = false; // Set by --tokens to write out the tokens rather than time the scanner
+	CompilerContext benchmarkContext;
+	ostream discarded( NULL );
+	struct stat inputStatus;
+	ostringstream rates;
+	long long tokenCount = 0;
+	int argument = 1;
+	
+	context = &benchmarkContext;
+	benchmarkContext.diagnostics = &discarded;
+	
+	// Read the command line options in front of the filename
+	while( argument < argc && strncmp( argv[argument], "--", 2 ) == 0 )
+	{
+		if( strcmp( argv[argument], "--scalar" ) == 0 )
+		{
+			forceScalar = true;
+		}
+		else if( strcmp( argv[argument], "--pipeline" ) == 0 )
+		{
+			pipeline = true;
+		}
+		else if( strcmp( argv[argument], "--tokens" ) == 0 )
+		{
+			tokens = true;
+		}
+		else if( strncmp( argv[argument], "--runs=", 7 ) == 0 && atoi( argv[argument] + 7 ) > 0 )
+		{
+			runs = atoi( argv[argument] + 7 );
+		}
+		else
+		{
+			cerr << "Unknown option: " << argv[argument] << endl;
+			argument = argc;
+			break;
+		}
+		
+		argument++;
+	}
+	
+	if( argument + 1 != argc || ( tokens == false && stat( argv[argument], &inputStatus ) != 0 ) )
+	{
+		cerr << "Usage: " << argv[0] << " [--scalar] [--pipeline] [--runs=count] filename" << endl;
+		cerr << "       " << argv[0] << " --tokens [--scalar] [filename | -]" << endl;
+		return 1;
+	}
+	
+	selectScanKernels( forceScalar );
+	
+	if( tokens )
+	{
+		writeTokens( argv[argument] );
+		return 0;
+	}
+	
+	// With --pipeline, the tokens are taken the way the parser takes them, with the parser's thread scanning them and then with the pipeline
+	for( int way = ( pipeline ? PARSER_SCANS : SCANNER_ONLY ); way <= ( pipeline ? PIPELINE_SCANS : SCANNER_ONLY ); way++ )
+	{
+		const double mappedSeconds = timeInput( argv[argument], false, static_cast<ScanWay>( way ), runs, tokenCount );
+		const double pipeSeconds = timeInput( argv[argument], true, static_cast<ScanWay>( way ), runs, tokenCount );
+		
+		rates << "Mapped file" << wayNames[way] << ": " << inputStatus.st_size / 1048576.0 / mappedSeconds << " MB/s" << endl;
+		rates << "Pipe" << wayNames[way] << ": " << inputStatus.st_size / 1048576.0 / pipeSeconds << " MB/s" << endl;
+	}
+	
+	cout << argv[argument] << ": " << inputStatus.st_size / 1048576.0 << " MB, " << tokenCount << " tokens" << ( forceScalar ? ", scalar kernels" : "" ) << endl;
+	cout << rates.str();
+	
+	return 0;
+}
+
+// Returns the best time of runs scans of the file, mapped into memory or piped into standard input by a thread of its own
+double timeInput( const char* filename, const bool piped, const ScanWay way, const int runs, long long& tokenCount )
+{
+	double bestSeconds = 0;
+	
+	for( int run = 0; run < runs; run++ )
+	{
+		int descriptors[2];
+		int savedInput = -1;
+		thread writer;
+		double seconds;
+		
+		// Standard input becomes the read end of a pipe, with a thread writing the file into the other end
+		if( piped )
+		{
+			if( pipe( descriptors ) != 0 )
+			{
+				cerr << "Error making a pipe." << endl;
+				exit( 1 );
+			}
+			
+			savedInput = dup( STDIN_FILENO );
+			dup2( descriptors[0], STDIN_FILENO );
+			close( descriptors[0] );
+			writer = thread( writeToPipe, filename, descriptors[1] );
+		}
+		
+		seconds = timeScan( piped ? "-" : filename, way, tokenCount );
+		
+		if( piped )
+		{
+			writer.join();
+			dup2( savedInput, STDIN_FILENO );
+			close( savedInput );
+		}
+		
+		bestSeconds = ( run == 0 ) ? seconds : min( bestSeconds, seconds );
+	}
+	
+	return bestSeconds;
+}
+
+// Scans the input to the end the specified way, and returns how long it took. Counts its tokens in tokenCount.
+double timeScan( const char* inputFile, const ScanWay way, long long& tokenCount )
+{
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	double seconds;
+	
+	if( initializeScanner( inputFile ) == false )
+	{
+		cerr << "Error opening input file." << endl;
+		exit( 1 );
+	}
+	
+	if( way == PIPELINE_SCANS )
+	{
+		startPipeline();
+	}
+	
+	tokenCount = 0;
+	
+	if( way == SCANNER_ONLY )
+	{
+		while( getToken().kind != END_OF_INPUT_TOKEN )
+		{
+			tokenCount++;
+		}
+	}
+	else
+	{
+		while( lookaheadToken( 0 ).kind != END_OF_INPUT_TOKEN )
+		{
+			consumeToken();
+			tokenCount++;
+		}
+	}
+	
+	seconds = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+	closeScanner();
+	
+	return seconds;
+}
+
+// Body of the thread that feeds the pipe. Writes the whole file into it, then closes it.
+void writeToPipe( const char* filename, const int pipeDescriptor )
+{
+	char block[65536];
+	int input = open( filename, O_RDONLY );
+	bool writing = input >= 0;
+	ssize_t length;
+	
+	while( writing && ( length = read( input, block, sizeof( block ) ) ) > 0 )
+	{
+		for( ssize_t written = 0, part = 0; writing && written < length; written += part )
+		{
+			part = write( pipeDescriptor, block + written, length - written );
+			writing = part >= 0;
+		}
+	}
+	
+	if( input >= 0 )
+	{
+		close( input );
+	}
+	
+	close( pipeDescriptor );
+}
+
+// Writes out each token of the input with its line, kind and spelling (and value, for a number), the scanner's warnings
+// where they come up, and the line count at the end
+void writeTokens( const char* inputFile )
+{
+	TokenFrame token;
+	
+	context->diagnostics = &cout;
+	
+	if( initializeScanner( inputFile ) == false )
+	{
+		cerr << "Error opening input file." << endl;
+		exit( 1 );
+	}
+	
+	do
+	{
+		token = getToken();
+		cout << token.line << " " << token.kind << " " << token.getName();
+		
+		if( token.numberType == INTEGER )
+		{
+			cout << " = " << token.intValue;
+		}
+		else if( token.numberType == FLOAT )
+		{
+			cout << " = " << token.floatValue;
+		}
+		
+		cout << endl;
+	}
+	while( token.kind != END_OF_INPUT_TOKEN );
+	
+	cout << "Lines: " << token.line << ", warnings: " << context->warningCount << endl;
+	closeScanner();
+}
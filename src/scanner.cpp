@@ -6,492 +6,1801 @@
 
 #include "compiler.h"
 
+#include <atomic>
+#include <cerrno>
+#include <cfloat>
+#include <climits>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
 using namespace std;
 
-// This function initializes global counters and sets up file I/O for the scanner
-void initializeScanner( const char* inputFile )
+// Intern pool
+// Every spelling the scanner produces is stored once in the pool, and tokens refer to it by id.
+// The spellings live in fixed-size segments that never move, and the intern pool's table of segments is never resized,
+// so the parser can read spellings while the scanner thread (with --pipeline) adds new ones.
+static const int nameSegmentSize = 4096;
+static const int nameSegmentCount = 65536; // Room for 268 million distinct spellings in the intern pool
+
+// A pool of spellings. Besides the intern pool, each chunk scanned with --parallel has one of its own.
+struct NamePool
 {
-	Token* myToken = NULL;
-	Variable* myVariable = NULL;
-	Procedure* myProcedure = NULL;
-	lineNumber = 1;
-	warningCount = 0;
-	errorCount = 0;
-	currentScope = 0;
-	
-	inFile.open( inputFile, ios::in );
-	
-	// Make sure the global symbol table starts out empty
-	globalSymbolTable.clear();
-	
-	// Make sure the vector of local symbol tables starts with one element and empty it.
-	localSymbolTable.clear();
-	localSymbolTable.push_back( SymbolTable() );
-	localSymbolTable[currentScope].clear();
-	
-	// Populate the symbol table with the reserve words and operators
-	myToken = new Token( RESERVE, "and", true );
-	addSymbolEntry( myToken );
-	
-	myToken = new Token( RESERVE, "begin", true );
-	addSymbolEntry( myToken );
-	
-	myToken = new Token( RESERVE, "bool", true );
-	addSymbolEntry( myToken );
-	
-	myToken = new Token( RESERVE, "case", true );
-	addSymbolEntry( myToken );
-	
-	myToken = new Token( RESERVE, "else", true );
-	addSymbolEntry( myToken );
-	
-	myToken = new Token( RESERVE, "end", true );
-	addSymbolEntry( myToken );
+	vector<unique_ptr<string[]>> segments;
+	int count; // Number of spellings in the pool
+	vector<unsigned int> hashes; // Hash of each spelling, kept so the table can grow without hashing again
+	vector<int> slots; // Open-addressing hash table of ids (-1 for an empty slot)
+};
+
+// Scanner position
+// Everything that changes as the scanner moves through the input is kept in a cursor, so that several scanners
+// can work on the same mapped input at once (see Parallel scanning below). getToken() scans with mainCursor.
+struct ScanChunk;
+
+struct ScanCursor
+{
+	const char* bufferPointer; // Next byte to be scanned
+	const char* bufferEnd; // One past the last byte of the buffered input
+	const char* tokenStart; // First byte of the token being scanned. The window keeps everything from here on when it slides.
+	bool endOfInput; // Set once the scanner tries to look past the last byte of the input
+	int scanLine; // Line the scanner is on. lineNumber only catches up with it as the parser takes tokens.
+	string literalSpelling; // Reused to build the spellings of numbers and string literals before they are interned
+	ScanChunk* chunk; // Chunk that collects the tokens, warnings and spellings of a parallel scanner (NULL for mainCursor)
+};
+
+// Warnings the scanner can give
+enum ScanWarning
+{
+	ILLEGAL_CHARACTER_WARNING, ILLEGAL_BANG_WARNING, STRING_NEWLINE_WARNING, STRING_ILLEGAL_WARNING,
+	INTEGER_RANGE_WARNING, FLOAT_OVERFLOW_WARNING, FLOAT_UNDERFLOW_WARNING, FLOAT_PRECISION_WARNING
+};
+
+static const char* scanWarningMessages[] =
+{
+	"Illegal character found. Assuming whitespace.",
+	"Illegal character: \'!\'. Assuming whitespace.",
+	"Unexpected end of line in string literal. Assuming end of string literal.",
+	"Encountered illegal character in string literal. Assuming end of string literal.",
+	"Integer literal is too large for an integer. Assuming 2147483647.",
+	"Float literal is too large for a float. Assuming the largest float.",
+	"Float literal is too small for a float. Assuming 0.",
+	"Float literal has more digits than a float can hold. Rounding to the nearest float."
+};
+
+// Scanning ahead
+// With --pipeline or --parallel, tokens are scanned before the parser asks for them. Scanner warnings are kept in order with the tokens,
+// so they are reported (with the line they were found on) when the parser reaches them, the same as when the parser scans its own tokens.
+struct ScanEntry
+{
+	TokenFrame token; // For a warning only token.line is used
+	bool inputEnded; // endOfInput right after the token was scanned
+	signed char warning; // ScanWarning being passed along, or -1 for a token
+};
+
+// Parallel scanning
+// With --parallel, a mapped input is scanned a round at a time. Each round is cut into chunks that end at newlines,
+// and every chunk is scanned by its own thread as if it started between tokens and on line 0.
+// Only a string literal skipping white space carries the scanner across a newline, so the guess is almost always right.
+// The chunks are then stitched together in order: a chunk's tokens are kept from the first one that ends where the scanner of the chunks
+// before it stopped, since from there on both scanners are in the same place and state. If none of them does, the chunk is scanned again from there.
+// A chunk's spellings are kept in the chunk while it is scanned, and only go into the intern pool as the chunk is stitched.
+// The parser takes the tokens straight from the chunks, and their lines and spelling ids are corrected as it takes them.
+struct ScanChunk
+{
+	const char* start; // First byte of the chunk
+	const char* end; // First byte of the next chunk. The last token scanned goes up to here or beyond.
+	int firstLine; // Line the chunk's scanner started counting from
+	vector<ScanEntry> entries; // Tokens and warnings in the order they were found. Tokens refer to the chunk's spellings with ids -1, -2, and so on.
+	vector<const char*> entryEnds; // Where the scanner stood after each entry
+	NamePool names;
+	vector<int> globalIDs; // Intern pool id of each of the chunk's spellings, filled in when the chunk is stitched
+};
+
+// Entries of a chunk that belong to the token stream, from first to the end of the chunk
+struct ChunkSlice
+{
+	ScanChunk* chunk;
+	size_t first;
+	int lineOffset; // Difference between the real lines and the ones the chunk's scanner counted
+};
+
+// Define data structure for everything the scanner keeps track of during a compile (its part of the CompilerContext)
+struct ScannerState
+{
+	// Input buffer for the scanner
+	// Regular files are memory-mapped so the whole file is one contiguous buffer, and so is a source given to compile().
+	// Pipes and standard input are read INPUT_BLOCK_SIZE bytes at a time into a sliding window.
+	int inputDescriptor; // File descriptor for the input file
+	bool inputMapped; // Tells whether the buffer holds the whole input (a memory mapping of the input file, or a source in memory)
+	bool ownMapping; // Tells whether the buffer is a memory mapping the scanner has to unmap
+	size_t mappedLength; // Length of the whole input
+	vector<char> inputWindow; // Storage for the sliding window when the input can't be mapped
+	const char* bufferStart; // First byte of the buffered input
+	bool visibleEndOfInput; // endOfInput as it was right after scanning the last token the parser took. moreInput() reports this.
 	
-	myToken = new Token( RESERVE, "false", true );
-	addSymbolEntry( myToken );
+	NamePool internPool;
+	const NamePool* namePool; // Pool internedName() reads: the intern pool, or the one of the compile a --jobs worker is helping
+	int operatorIDs[256][2]; // Id of each operator by its first character and length. Every two-character operator ends in '='.
 	
-	myToken = new Token( RESERVE, "float", true );
-	addSymbolEntry( myToken );
+	ScanCursor mainCursor;
 	
-	myToken = new Token( RESERVE, "for", true );
-	addSymbolEntry( myToken );
+	// Lookahead ring
+	// The parser reads its tokens from here. ringHead is the slot of the current token,
+	// and ringCount is the number of tokens from there on that have already been scanned.
+	TokenFrame tokenRing[LOOKAHEAD_SIZE];
+	int ringHead;
+	int ringCount;
 	
-	myToken = new Token( RESERVE, "global", true );
-	addSymbolEntry( myToken );
+	bool scanFinished; // Set once the parser has taken the end-of-input token
+	TokenFrame finalToken; // The end-of-input token, handed out again if the parser asks for more
 	
-	myToken = new Token( RESERVE, "if", true );
-	addSymbolEntry( myToken );
+	// Scanner pipeline
+	// With --pipeline, a second thread runs getToken() ahead of the parser and hands the entries over through pipelineQueue,
+	// a bounded single-producer/single-consumer ring of PIPELINE_QUEUE_SIZE entries.
+	vector<ScanEntry> pipelineQueue;
+	atomic<unsigned int> queueHead; // Next entry the parser will take. Only the parser's thread writes it.
+	atomic<unsigned int> queueTail; // Next entry the scanner thread will fill. Only the scanner thread writes it.
+	unsigned int cachedHead; // Scanner thread's last look at queueHead
+	unsigned int cachedTail; // Parser's last look at queueTail
+	atomic<bool> stopPipeline; // Tells the scanner thread to quit early
+	thread scannerThread;
+	bool pipelineRunning;
 	
-	myToken = new Token( RESERVE, "in", true );
-	addSymbolEntry( myToken );
+	// Parallel scanning
+	bool parallelRunning;
+	int parallelThreads;
+	vector<ScanChunk> scanChunks; // One chunk for each thread, reused every round
+	vector<ScanChunk> rescannedChunks; // Tokens scanned again where the chunk with the same index guessed wrong
+	vector<ChunkSlice> roundSlices; // The current round's tokens and warnings, in order
+	size_t currentSlice; // Slice the parser is taking entries from
+	size_t sliceEntry; // Next entry of the current slice
+	bool roundsFinished; // Set once the end-of-input token has been stitched in
 	
-	myToken = new Token( RESERVE, "integer", true );
-	addSymbolEntry( myToken );
+	// Scanned buffers
+	// editBuffer() scans again from the end of the last token that ends before the edit. The scanner looks one byte past a token to find its end,
+	// so a token that ends right at the edit can change too. It stops at the first new token past the inserted text that ends where an old one did:
+	// from there on the scanner is in the same state over the same bytes as before, so the rest of the old entries are kept.
+	ScanChunk editChunk; // Collects the warnings and spellings of the tokens being scanned again
+	vector<BufferEntry> rescannedEntries;
 	
-	myToken = new Token( RESERVE, "is", true );
-	addSymbolEntry( myToken );
+	// Given tokens
+	// A --jobs worker's scanner doesn't scan anything. It hands out tokens the compile it is helping has scanned, and then finalToken.
+	const vector<TokenFrame>* givenTokens; // NULL when the scanner scans its input
+	size_t nextGivenToken;
 	
-	myToken = new Token( RESERVE, "not", true );
-	addSymbolEntry( myToken );
+	ScannerState( void ) : inputDescriptor( -1 ), inputMapped( false ), ownMapping( false ), mappedLength( 0 ), bufferStart( NULL ), visibleEndOfInput( false ),
+		namePool( &internPool ), ringHead( 0 ), ringCount( 0 ), scanFinished( false ), queueHead( 0 ), queueTail( 0 ), cachedHead( 0 ), cachedTail( 0 ), stopPipeline( false ),
+		pipelineRunning( false ), parallelRunning( false ), parallelThreads( 1 ), currentSlice( 0 ), sliceEntry( 0 ), roundsFinished( false ),
+		givenTokens( NULL ), nextGivenToken( 0 )
+	{
+	}
+};
+
+// Scanner DFA
+// Character classes are the columns of the transition table. Each byte of input belongs to exactly one class.
+enum ScanClass
+{
+	LETTER_CLASS, // a-z A-Z
+	DIGIT_CLASS, // 0-9
+	UNDERSCORE_CLASS, // _
+	DOT_CLASS, // .
+	SLASH_CLASS, // /
+	RELATION_CLASS, // < >
+	COLON_CLASS, // :
+	BANG_CLASS, // !
+	EQUAL_CLASS, // =
+	QUOTE_CLASS, // "
+	APOSTROPHE_CLASS, // '
+	SEPARATOR_CLASS, // , ;
+	OPERATOR_CLASS, // + - * ( ) { } & | [ ]
+	BLANK_CLASS, // space
+	SPACE_CLASS, // tab, vertical tab, form feed, carriage return
+	NEWLINE_CLASS, // \n
+	ILLEGAL_CLASS, // everything else
+	END_CLASS, // end of the input (not a byte)
+	CLASS_COUNT
+};
+
+// States are the rows of the transition table.
+// Values from FIRST_ACTION on are actions that end the DFA run: the character that led to them has not been consumed.
+enum ScanState
+{
+	START_STATE, // between tokens
+	IDENTIFIER_STATE,
+	NUMBER_STATE,
+	FRACTION_STATE, // digits after the decimal point
+	SLASH_STATE, // after a '/', which is either division or the start of a comment
+	RELATION_STATE, // after '<', '>' or ':', which may be followed by '='
+	BANG_STATE, // after '!', which must be followed by '='
+	COMMENT_STATE,
+	STRING_STATE, // inside a string literal
+	STRING_SPACE_STATE, // after a space in a string literal. The string skips all white space, then takes whatever character comes next.
+	STATE_COUNT,
 	
-	myToken = new Token( RESERVE, "or", true );
-	addSymbolEntry( myToken );
+	FIRST_ACTION = STATE_COUNT,
+	ACCEPT_WORD = FIRST_ACTION, // identifier or reserved word
+	ACCEPT_NUMBER,
+	ACCEPT_OPERATOR, // operator made of the characters read so far
+	ACCEPT_OPERATOR_WITH_NEXT, // operator finished by the next character
+	ACCEPT_STRING, // string literal finished by the next character (a double quote)
+	STRING_AT_NEWLINE, // string literal cut off by a newline
+	STRING_AT_ILLEGAL, // string literal cut off by an illegal character
+	STRING_AT_END, // string literal cut off by the end of the input
+	SKIP_COMMENT,
+	SKIP_BANG,
+	SKIP_ILLEGAL,
+	END_OF_TOKENS
+};
+
+// Returns the class of byte c. Used to build characterClassTable at compile time.
+static constexpr unsigned char classifyCharacter( const int c )
+{
+	return ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' ) ? LETTER_CLASS :
+		( c >= '0' && c <= '9' ) ? DIGIT_CLASS :
+		c == '_' ? UNDERSCORE_CLASS :
+		c == '.' ? DOT_CLASS :
+		c == '/' ? SLASH_CLASS :
+		c == '<' || c == '>' ? RELATION_CLASS :
+		c == ':' ? COLON_CLASS :
+		c == '!' ? BANG_CLASS :
+		c == '=' ? EQUAL_CLASS :
+		c == '\"' ? QUOTE_CLASS :
+		c == '\'' ? APOSTROPHE_CLASS :
+		c == ',' || c == ';' ? SEPARATOR_CLASS :
+		c == '+' || c == '-' || c == '*' || c == '(' || c == ')' || c == '{' || c == '}' || c == '&' || c == '|' || c == '[' || c == ']' ? OPERATOR_CLASS :
+		c == ' ' ? BLANK_CLASS :
+		c == '\t' || c == '\v' || c == '\f' || c == '\r' ? SPACE_CLASS :
+		c == '\n' ? NEWLINE_CLASS :
+		ILLEGAL_CLASS;
+}
+
+#define CLASSIFY_4( c ) classifyCharacter( c ), classifyCharacter( c + 1 ), classifyCharacter( c + 2 ), classifyCharacter( c + 3 )
+#define CLASSIFY_16( c ) CLASSIFY_4( c ), CLASSIFY_4( c + 4 ), CLASSIFY_4( c + 8 ), CLASSIFY_4( c + 12 )
+#define CLASSIFY_64( c ) CLASSIFY_16( c ), CLASSIFY_16( c + 16 ), CLASSIFY_16( c + 32 ), CLASSIFY_16( c + 48 )
+
+// Class of every byte value
+static constexpr unsigned char characterClassTable[256] = { CLASSIFY_64( 0 ), CLASSIFY_64( 64 ), CLASSIFY_64( 128 ), CLASSIFY_64( 192 ) };
+
+#undef CLASSIFY_4
+#undef CLASSIFY_16
+#undef CLASSIFY_64
+
+// The general character class (as reported by getCharacterClass()) that goes with each scanner class
+static constexpr CharacterClass generalClassTable[CLASS_COUNT] =
+{
+	LETTER, DIGIT, ILLEGAL, ILLEGAL, PUNCTUATION, PUNCTUATION, PUNCTUATION, PUNCTUATION, PUNCTUATION,
+	PUNCTUATION, ILLEGAL, PUNCTUATION, PUNCTUATION, ILLEGAL, ILLEGAL, ILLEGAL, ILLEGAL, ILLEGAL
+};
+
+// Next state (or action) for each state and character class
+static constexpr unsigned char scanTransitions[STATE_COUNT][CLASS_COUNT] =
+{
+	// LETTER, DIGIT, UNDERSCORE, DOT, SLASH, RELATION, COLON, BANG, EQUAL, QUOTE, APOSTROPHE, SEPARATOR, OPERATOR, BLANK, SPACE, NEWLINE, ILLEGAL, END
 	
-	myToken = new Token( RESERVE, "out", true );
-	addSymbolEntry( myToken );
+	// START_STATE
+	{ IDENTIFIER_STATE, NUMBER_STATE, SKIP_ILLEGAL, SKIP_ILLEGAL, SLASH_STATE, RELATION_STATE, RELATION_STATE, BANG_STATE, ACCEPT_OPERATOR_WITH_NEXT, STRING_STATE, SKIP_ILLEGAL, ACCEPT_OPERATOR_WITH_NEXT, ACCEPT_OPERATOR_WITH_NEXT, START_STATE, START_STATE, START_STATE, SKIP_ILLEGAL, END_OF_TOKENS },
 	
-	myToken = new Token( RESERVE, "procedure", true );
-	addSymbolEntry( myToken );
+	// IDENTIFIER_STATE
+	{ IDENTIFIER_STATE, IDENTIFIER_STATE, IDENTIFIER_STATE, ACCEPT_WORD, ACCEPT_WORD, ACCEPT_WORD, ACCEPT_WORD, ACCEPT_WORD, ACCEPT_WORD, ACCEPT_WORD, ACCEPT_WORD, ACCEPT_WORD, ACCEPT_WORD, ACCEPT_WORD, ACCEPT_WORD, ACCEPT_WORD, ACCEPT_WORD, ACCEPT_WORD },
 	
-	myToken = new Token( RESERVE, "program", true );
-	addSymbolEntry( myToken );
+	// NUMBER_STATE
+	{ ACCEPT_NUMBER, NUMBER_STATE, NUMBER_STATE, FRACTION_STATE, ACCEPT_NUMBER, ACCEPT_NUMBER, ACCEPT_NUMBER, ACCEPT_NUMBER, ACCEPT_NUMBER, ACCEPT_NUMBER, ACCEPT_NUMBER, ACCEPT_NUMBER, ACCEPT_NUMBER, ACCEPT_NUMBER, ACCEPT_NUMBER, ACCEPT_NUMBER, ACCEPT_NUMBER, ACCEPT_NUMBER },
 	
-	myToken = new Token( RESERVE, "return", true );
-	addSymbolEntry( myToken );
+	// FRACTION_STATE
+	{ ACCEPT_NUMBER, FRACTION_STATE, FRACTION_STATE, ACCEPT_NUMBER, ACCEPT_NUMBER, ACCEPT_NUMBER, ACCEPT_NUMBER, ACCEPT_NUMBER, ACCEPT_NUMBER, ACCEPT_NUMBER, ACCEPT_NUMBER, ACCEPT_NUMBER, ACCEPT_NUMBER, ACCEPT_NUMBER, ACCEPT_NUMBER, ACCEPT_NUMBER, ACCEPT_NUMBER, ACCEPT_NUMBER },
 	
-	myToken = new Token( RESERVE, "string", true );
-	addSymbolEntry( myToken );
+	// SLASH_STATE
+	{ ACCEPT_OPERATOR, ACCEPT_OPERATOR, ACCEPT_OPERATOR, ACCEPT_OPERATOR, COMMENT_STATE, ACCEPT_OPERATOR, ACCEPT_OPERATOR, ACCEPT_OPERATOR, ACCEPT_OPERATOR, ACCEPT_OPERATOR, ACCEPT_OPERATOR, ACCEPT_OPERATOR, ACCEPT_OPERATOR, ACCEPT_OPERATOR, ACCEPT_OPERATOR, ACCEPT_OPERATOR, ACCEPT_OPERATOR, ACCEPT_OPERATOR },
 	
-	myToken = new Token( RESERVE, "then", true );
-	addSymbolEntry( myToken );
+	// RELATION_STATE
+	{ ACCEPT_OPERATOR, ACCEPT_OPERATOR, ACCEPT_OPERATOR, ACCEPT_OPERATOR, ACCEPT_OPERATOR, ACCEPT_OPERATOR, ACCEPT_OPERATOR, ACCEPT_OPERATOR, ACCEPT_OPERATOR_WITH_NEXT, ACCEPT_OPERATOR, ACCEPT_OPERATOR, ACCEPT_OPERATOR, ACCEPT_OPERATOR, ACCEPT_OPERATOR, ACCEPT_OPERATOR, ACCEPT_OPERATOR, ACCEPT_OPERATOR, ACCEPT_OPERATOR },
 	
-	myToken = new Token( RESERVE, "true", true );
-	addSymbolEntry( myToken );
+	// BANG_STATE
+	{ SKIP_BANG, SKIP_BANG, SKIP_BANG, SKIP_BANG, SKIP_BANG, SKIP_BANG, SKIP_BANG, SKIP_BANG, ACCEPT_OPERATOR_WITH_NEXT, SKIP_BANG, SKIP_BANG, SKIP_BANG, SKIP_BANG, SKIP_BANG, SKIP_BANG, SKIP_BANG, SKIP_BANG, SKIP_BANG },
 	
-	myToken = new Token( OPERATOR, ":", true );
-	addSymbolEntry( myToken );
+	// COMMENT_STATE
+	{ COMMENT_STATE, COMMENT_STATE, COMMENT_STATE, COMMENT_STATE, COMMENT_STATE, COMMENT_STATE, COMMENT_STATE, COMMENT_STATE, COMMENT_STATE, COMMENT_STATE, COMMENT_STATE, COMMENT_STATE, COMMENT_STATE, COMMENT_STATE, COMMENT_STATE, SKIP_COMMENT, COMMENT_STATE, SKIP_COMMENT },
 	
-	myToken = new Token( OPERATOR, ";", true );
-	addSymbolEntry( myToken );
+	// STRING_STATE
+	{ STRING_STATE, STRING_STATE, STRING_STATE, STRING_STATE, STRING_AT_ILLEGAL, STRING_AT_ILLEGAL, STRING_STATE, STRING_AT_ILLEGAL, STRING_AT_ILLEGAL, ACCEPT_STRING, STRING_STATE, STRING_STATE, STRING_AT_ILLEGAL, STRING_SPACE_STATE, STRING_AT_ILLEGAL, STRING_AT_NEWLINE, STRING_AT_ILLEGAL, STRING_AT_ILLEGAL },
 	
-	myToken = new Token( OPERATOR, ",", true );
-	addSymbolEntry( myToken );
+	// STRING_SPACE_STATE
+	{ STRING_STATE, STRING_STATE, STRING_STATE, STRING_STATE, STRING_STATE, STRING_STATE, STRING_STATE, STRING_STATE, STRING_STATE, STRING_STATE, STRING_STATE, STRING_STATE, STRING_STATE, STRING_SPACE_STATE, STRING_SPACE_STATE, STRING_SPACE_STATE, STRING_STATE, STRING_AT_END }
+};
+
+// Reserved Words
+// Reserved words are recognized with a perfect hash instead of being looked up in the symbol table.
+// reservedSlots is built at compile time from reservedWords, and the static_assert below fails the build if two words share a slot.
+static constexpr const char* reservedWords[] =
+{
+	"and", "begin", "bool", "case", "else", "end", "false", "float", "for", "global", "if", "in",
+	"integer", "is", "not", "or", "out", "procedure", "program", "return", "string", "then", "true"
+};
+
+static constexpr int reservedWordCount = sizeof( reservedWords ) / sizeof( reservedWords[0] );
+static constexpr int reservedSlotCount = 64; // Must be a power of two
+static constexpr int emptyNameID = reservedWordCount; // The empty spelling (of the end-of-input token) is interned right after the reserved words
+
+// Operators, interned right after the empty spelling
+static constexpr const char* operators[] = { ":", ";", ",", "+", "-", "*", "/", "(", ")", "<", "<=", ">", ">=", "!=", "=", ":=", "{", "}", "&", "|", "[", "]" };
+static constexpr int operatorCount = sizeof( operators ) / sizeof( operators[0] );
+
+// Returns the length of a reserved word
+static constexpr int wordLength( const char* word )
+{
+	return *word == '\0' ? 0 : 1 + wordLength( word + 1 );
+}
+
+// Returns the slot for a word of the specified length (at least two characters). Only the length and the first two characters are used.
+static constexpr unsigned int reservedHash( const char* word, const int length )
+{
+	return ( 3 * length + 6 * static_cast<unsigned char>( word[0] ) + static_cast<unsigned char>( word[1] ) ) & ( reservedSlotCount - 1 );
+}
+
+// Returns the index of the reserved word (starting the search at word) that hashes to slot, or -1 if there is none
+static constexpr int findReservedSlot( const unsigned int slot, const int word )
+{
+	return word == reservedWordCount ? -1 :
+		reservedHash( reservedWords[word], wordLength( reservedWords[word] ) ) == slot ? word : findReservedSlot( slot, word + 1 );
+}
+
+// Tells whether every reserved word from word on has a slot to itself
+static constexpr bool reservedHashIsPerfect( const int word )
+{
+	return word == reservedWordCount ||
+		( findReservedSlot( reservedHash( reservedWords[word], wordLength( reservedWords[word] ) ), 0 ) == word && reservedHashIsPerfect( word + 1 ) );
+}
+
+static_assert( reservedHashIsPerfect( 0 ), "Two reserved words hash to the same slot. Change the multipliers in reservedHash()." );
+
+#define RESERVE_4( s ) findReservedSlot( s, 0 ), findReservedSlot( s + 1, 0 ), findReservedSlot( s + 2, 0 ), findReservedSlot( s + 3, 0 )
+#define RESERVE_16( s ) RESERVE_4( s ), RESERVE_4( s + 4 ), RESERVE_4( s + 8 ), RESERVE_4( s + 12 )
+
+// Index into reservedWords for each slot, or -1 for an empty slot
+static constexpr signed char reservedSlots[reservedSlotCount] = { RESERVE_16( 0 ), RESERVE_16( 16 ), RESERVE_16( 32 ), RESERVE_16( 48 ) };
+
+#undef RESERVE_4
+#undef RESERVE_16
+
+// Tells whether two spellings are the same
+static constexpr bool sameSpelling( const char* a, const char* b )
+{
+	return *a == *b && ( *a == '\0' || sameSpelling( a + 1, b + 1 ) );
+}
+
+// The kind of a reserved word or operator is the intern id of its spelling, so TokenKind has to list them in the same order as the tables above
+static_assert( emptyNameID == END_OF_INPUT_TOKEN && END_OF_INPUT_TOKEN + 1 + operatorCount == NAME_TOKEN, "TokenKind doesn't have a kind for every reserved word and operator" );
+static_assert( sameSpelling( reservedWords[AND_TOKEN], "and" ) && sameSpelling( reservedWords[PROCEDURE_TOKEN], "procedure" ) && sameSpelling( reservedWords[TRUE_TOKEN], "true" ), "TokenKind lists the reserved words out of order" );
+static_assert( sameSpelling( operators[0], ":" ) && sameSpelling( operators[ASSIGN_TOKEN - COLON_TOKEN], ":=" ) && sameSpelling( operators[RIGHT_BRACKET_TOKEN - COLON_TOKEN], "]" ), "TokenKind lists the operators out of order" );
+
+static void beginInput( void );
+static void finishInitializing( void );
+static int findReservedWord( const char* word, const int length );
+static void resetInternPool( void );
+static void resetNamePool( NamePool& pool, const int segmentCount );
+static int internName( const char* spelling, const int length );
+static int addName( NamePool& pool, const char* spelling, const int length, const unsigned int hash );
+static const string& poolName( const NamePool& pool, const int id );
+static unsigned int hashSpelling( const char* spelling, const int length );
+static void scanToken( ScanCursor& cursor, TokenFrame& newToken );
+static int scanName( ScanCursor& cursor, const char* spelling, const int length );
+static void scanWarning( ScanCursor& cursor, const ScanWarning warning );
+static void convertNumber( ScanCursor& cursor, TokenFrame& newToken );
+static void pullToken( TokenFrame& newToken );
+static void takeScanEntry( ScanEntry& entry );
+static void runPipeline( CompilerContext* owner );
+static bool pushPipelineEntry( const ScanEntry& entry );
+static void popPipelineEntry( ScanEntry& entry );
+static void scanRound( void );
+static void scanChunk( CompilerContext* owner, ScanChunk* chunk, const int line );
+static bool stitchChunk( ScanChunk& chunk, ScanChunk& rescannedChunk, const char*& position, int& line );
+static bool addChunkSlice( ScanChunk& chunk, const size_t first, const int lineOffset, const char*& position, int& line );
+static void moveBufferGap( ScannedBuffer& buffer, const int index );
+static int peekCharacter( ScanCursor& cursor );
+static bool refillBuffer( ScanCursor& cursor );
+
+// Makes the scanner's part of a new context
+ScannerState* newScannerState( void )
+{
+	return new ScannerState();
+}
+
+void deleteScannerState( ScannerState* state )
+{
+	delete state;
+}
+
+// This function initializes global counters and sets up file I/O for the scanner
+// Returns false if the input file could not be opened
+bool initializeScanner( const char* inputFile )
+{
+	ScannerState& scanner = *context->scanner;
 	
-	myToken = new Token( OPERATOR, "+", true );
-	addSymbolEntry( myToken );
+	// Open the input file ("-" means standard input) and choose how to buffer it
+	beginInput();
 	
-	myToken = new Token( OPERATOR, "-", true );
-	addSymbolEntry( myToken );
+	if( strcmp( inputFile, "-" ) == 0 )
+	{
+		scanner.inputDescriptor = STDIN_FILENO;
+	}
+	else
+	{
+		scanner.inputDescriptor = open( inputFile, O_RDONLY );
+		
+		if( scanner.inputDescriptor < 0 )
+		{
+			return false;
+		}
+	}
 	
-	myToken = new Token( OPERATOR, "*", true );
-	addSymbolEntry( myToken );
+#ifndef _WIN32
+	struct stat inputStatus;
 	
-	myToken = new Token( OPERATOR, "/", true );
-	addSymbolEntry( myToken );
+	// Regular files get mapped into memory in one piece
+	if( fstat( scanner.inputDescriptor, &inputStatus ) == 0 && S_ISREG( inputStatus.st_mode ) && inputStatus.st_size > 0 )
+	{
+		void* mapping = mmap( NULL, inputStatus.st_size, PROT_READ, MAP_PRIVATE, scanner.inputDescriptor, 0 );
+		
+		if( mapping != MAP_FAILED )
+		{
+			madvise( mapping, inputStatus.st_size, MADV_SEQUENTIAL );
+			
+			scanner.inputMapped = true;
+			scanner.ownMapping = true;
+			scanner.mappedLength = inputStatus.st_size;
+			scanner.bufferStart = static_cast<const char*>( mapping );
+			scanner.mainCursor.bufferEnd = scanner.bufferStart + scanner.mappedLength;
+		}
+	}
+#endif
 	
-	myToken = new Token( OPERATOR, "(", true );
-	addSymbolEntry( myToken );
+	// Anything else (pipes, terminals, or a failed mapping) is read in blocks
+	if( scanner.inputMapped == false )
+	{
+		scanner.inputWindow.resize( INPUT_BLOCK_SIZE );
+		scanner.bufferStart = &scanner.inputWindow[0];
+		scanner.mainCursor.bufferEnd = scanner.bufferStart;
+	}
 	
-	myToken = new Token( OPERATOR, ")", true );
-	addSymbolEntry( myToken );
+	finishInitializing();
+	return true;
+}
+
+// Sets up the scanner to read a program already in memory (the length bytes at source) instead of a file, for compile().
+// The source is read where it is, as a mapped file would be, so it has to stay put until closeScanner() is called.
+void initializeScannerSource( const char* source, const size_t length )
+{
+	ScannerState& scanner = *context->scanner;
 	
-	myToken = new Token( OPERATOR, "<", true );
-	addSymbolEntry( myToken );
+	beginInput();
 	
-	myToken = new Token( OPERATOR, "<=", true );
-	addSymbolEntry( myToken );
+	scanner.inputMapped = true;
+	scanner.mappedLength = length;
+	scanner.bufferStart = source != NULL ? source : "";
+	scanner.mainCursor.bufferEnd = scanner.bufferStart + scanner.mappedLength;
 	
-	myToken = new Token( OPERATOR, ">", true );
-	addSymbolEntry( myToken );
+	finishInitializing();
+}
+
+// Sets up the scanner to hand out the tokens of a --jobs worker's procedure, which the compile in owner scanned.
+// Their spellings are read from the owner's intern pool, and the symbol table starts out empty for the worker to fill in.
+void initializeScannerTokens( const vector<TokenFrame>& tokens, const CompilerContext& owner )
+{
+	ScannerState& scanner = *context->scanner;
 	
-	myToken = new Token( OPERATOR, ">=", true );
-	addSymbolEntry( myToken );
+	beginInput();
 	
-	myToken = new Token( OPERATOR, "!=", true );
-	addSymbolEntry( myToken );
+	scanner.givenTokens = &tokens;
+	scanner.nextGivenToken = 0;
+	scanner.namePool = &owner.scanner->internPool;
+	scanner.ringHead = 0;
+	scanner.ringCount = 0;
 	
-	myToken = new Token( OPERATOR, "=", true );
-	addSymbolEntry( myToken );
+	// The end-of-input token, as scanToken() makes it
+	scanner.finalToken.tokenType = UNKNOWN;
+	scanner.finalToken.kind = END_OF_INPUT_TOKEN;
+	scanner.finalToken.nameID = emptyNameID;
+	scanner.finalToken.line = tokens.empty() ? 1 : tokens.back().line;
+	scanner.finalToken.isGlobal = false;
+	scanner.finalToken.symbol = NO_SYMBOL;
+	scanner.finalToken.numberType = INVALID;
+	scanner.finalToken.intValue = 0;
 	
-	myToken = new Token( OPERATOR, ":=", true );
-	addSymbolEntry( myToken );
+	resetSymbolStore();
+}
+
+// Tells whether the whole input is in memory, so it can be scanned again
+bool mappedInput( void )
+{
+	ScannerState& scanner = *context->scanner;
 	
-	myToken = new Token( OPERATOR, "{", true );
-	addSymbolEntry( myToken );
+	return scanner.inputMapped;
+}
+
+// Resets the counters and closes the last input, for initializeScanner(), initializeScannerSource() and initializeScannerTokens()
+void beginInput( void )
+{
+	ScannerState& scanner = *context->scanner;
 	
-	myToken = new Token( OPERATOR, "}", true );
-	addSymbolEntry( myToken );
+	context->lineNumber = 1;
+	context->warningCount = 0;
+	context->errorCount = 0;
+	context->currentScope = 0;
 	
-	myToken = new Token( OPERATOR, "&", true );
-	addSymbolEntry( myToken );
+	closeScanner();
+	scanner.givenTokens = NULL;
+	scanner.namePool = &scanner.internPool;
+	scanner.mainCursor.endOfInput = false;
+	scanner.mainCursor.scanLine = 1;
+	scanner.mainCursor.chunk = NULL;
+	scanner.visibleEndOfInput = false;
+}
+
+// Starts scanning at the beginning of the input, and fills the symbol table with the runtime functions
+void finishInitializing( void )
+{
+	ScannerState& scanner = *context->scanner;
+	int myProcedure;
 	
-	myToken = new Token( OPERATOR, "|", true );
-	addSymbolEntry( myToken );
+	scanner.mainCursor.bufferPointer = scanner.bufferStart;
+	scanner.mainCursor.tokenStart = scanner.bufferStart;
 	
-	myToken = new Token( OPERATOR, "[", true );
-	addSymbolEntry( myToken );
+	// Start with an empty lookahead ring and an intern pool holding only the fixed spellings
+	scanner.ringHead = 0;
+	scanner.ringCount = 0;
+	resetInternPool();
 	
-	myToken = new Token( OPERATOR, "]", true );
-	addSymbolEntry( myToken );
+	// Make sure the symbol store and the symbol table start out empty
+	resetSymbolStore();
 	
 	// Put runtime functions in the global symbol table
-	myProcedure = new Procedure( IDENTIFIER, "getBool", true );
-	myVariable = new Variable( IDENTIFIER, "newBool", BOOL, false, myProcedure->getParameterAddress(), true );
-	myProcedure->advanceParameterAddress();
-	myProcedure->addParameter( myVariable );
-	myProcedure->addDirection( false );
+	myProcedure = newProcedureSymbol( IDENTIFIER, internName( "getBool", wordLength( "getBool" ) ), true );
+	parameterAddress( myProcedure )++;
+	addParameter( myProcedure, BOOL );
+	addDirection( myProcedure, false );
 	addSymbolEntry( myProcedure );
 	
-	myProcedure = new Procedure( IDENTIFIER, "getInteger", true );
-	myVariable = new Variable( IDENTIFIER, "newInteger", INTEGER, false, myProcedure->getParameterAddress(), true );
-	myProcedure->advanceParameterAddress();
-	myProcedure->addParameter( myVariable );
-	myProcedure->addDirection( false );
+	myProcedure = newProcedureSymbol( IDENTIFIER, internName( "getInteger", wordLength( "getInteger" ) ), true );
+	parameterAddress( myProcedure )++;
+	addParameter( myProcedure, INTEGER );
+	addDirection( myProcedure, false );
 	addSymbolEntry( myProcedure );
 	
-	myProcedure = new Procedure( IDENTIFIER, "getFloat", true );
-	myVariable = new Variable( IDENTIFIER, "newFloat", FLOAT, false, myProcedure->getParameterAddress(), true );
-	myProcedure->advanceParameterAddress();
-	myProcedure->addParameter( myVariable );
-	myProcedure->addDirection( false );
+	myProcedure = newProcedureSymbol( IDENTIFIER, internName( "getFloat", wordLength( "getFloat" ) ), true );
+	parameterAddress( myProcedure )++;
+	addParameter( myProcedure, FLOAT );
+	addDirection( myProcedure, false );
 	addSymbolEntry( myProcedure );
 	
-	myProcedure = new Procedure( IDENTIFIER, "getString", true );
-	myVariable = new Variable( IDENTIFIER, "newString", STRINGT, false, myProcedure->getParameterAddress(), true );
-	myProcedure->advanceParameterAddress();
-	myProcedure->addParameter( myVariable );
-	myProcedure->addDirection( false );
+	myProcedure = newProcedureSymbol( IDENTIFIER, internName( "getString", wordLength( "getString" ) ), true );
+	parameterAddress( myProcedure )++;
+	addParameter( myProcedure, STRINGT );
+	addDirection( myProcedure, false );
 	addSymbolEntry( myProcedure );
 	
-	myProcedure = new Procedure( IDENTIFIER, "putBool", true );
-	myVariable = new Variable( IDENTIFIER, "oldBool", BOOL, false, myProcedure->getParameterAddress(), true );
-	myProcedure->advanceParameterAddress();
-	myProcedure->addParameter( myVariable );
-	myProcedure->addDirection( true );
+	myProcedure = newProcedureSymbol( IDENTIFIER, internName( "putBool", wordLength( "putBool" ) ), true );
+	parameterAddress( myProcedure )++;
+	addParameter( myProcedure, BOOL );
+	addDirection( myProcedure, true );
 	addSymbolEntry( myProcedure );
 	
-	myProcedure = new Procedure( IDENTIFIER, "putInteger", true );
-	myVariable = new Variable( IDENTIFIER, "oldInteger", INTEGER, false, myProcedure->getParameterAddress(), true );
-	myProcedure->advanceParameterAddress();
-	myProcedure->addParameter( myVariable );
-	myProcedure->addDirection( true );
+	myProcedure = newProcedureSymbol( IDENTIFIER, internName( "putInteger", wordLength( "putInteger" ) ), true );
+	parameterAddress( myProcedure )++;
+	addParameter( myProcedure, INTEGER );
+	addDirection( myProcedure, true );
 	addSymbolEntry( myProcedure );
 	
-	myProcedure = new Procedure( IDENTIFIER, "putFloat", true );
-	myVariable = new Variable( IDENTIFIER, "oldFloat", FLOAT, false, myProcedure->getParameterAddress(), true );
-	myProcedure->advanceParameterAddress();
-	myProcedure->addParameter( myVariable );
-	myProcedure->addDirection( true );
+	myProcedure = newProcedureSymbol( IDENTIFIER, internName( "putFloat", wordLength( "putFloat" ) ), true );
+	parameterAddress( myProcedure )++;
+	addParameter( myProcedure, FLOAT );
+	addDirection( myProcedure, true );
 	addSymbolEntry( myProcedure );
 	
-	myProcedure = new Procedure( IDENTIFIER, "putString", true );
-	myVariable = new Variable( IDENTIFIER, "oldString", STRINGT, false, myProcedure->getParameterAddress(), true );
-	myProcedure->advanceParameterAddress();
-	myProcedure->addParameter( myVariable );
-	myProcedure->addDirection( true );
+	myProcedure = newProcedureSymbol( IDENTIFIER, internName( "putString", wordLength( "putString" ) ), true );
+	parameterAddress( myProcedure )++;
+	addParameter( myProcedure, STRINGT );
+	addDirection( myProcedure, true );
 	addSymbolEntry( myProcedure );
 }
 
 // This function retrieves the next token from the input file ( already open by initializeScanner() ) and returns it to the calling function
+// Names that aren't reserved words come back with type NONE. They are looked up in the symbol table when the parser takes them.
 TokenFrame getToken( void )
 {
-	char currentCharacter;
-	char nextCharacter;
-	
+	ScannerState& scanner = *context->scanner;
 	TokenFrame newToken;
 	
+	scanToken( scanner.mainCursor, newToken );
+	newToken.line = scanner.mainCursor.scanLine;
+	
+	return newToken;
+}
+
+// Starts a second thread that scans ahead of the parser. Called after initializeScanner() for --pipeline.
+void startPipeline( void )
+{
+	ScannerState& scanner = *context->scanner;
+	
+	scanner.queueHead = 0;
+	scanner.queueTail = 0;
+	scanner.cachedHead = 0;
+	scanner.cachedTail = 0;
+	scanner.stopPipeline = false;
+	scanner.scanFinished = false;
+	scanner.pipelineRunning = true;
+	scanner.pipelineQueue.resize( PIPELINE_QUEUE_SIZE );
+	
+	scanner.scannerThread = thread( runPipeline, context );
+}
+
+// Scans the rest of the input in chunks, in parallel, with the specified number of threads (0 for one per core).
+// Called after initializeScanner() for --parallel. Returns false, leaving the scanner as it was, if the input isn't memory-mapped.
+bool startParallelScan( const int threads )
+{
+	ScannerState& scanner = *context->scanner;
+	
+	if( scanner.inputMapped == false )
+	{
+		return false;
+	}
+	
+	scanner.parallelThreads = threads > 0 ? threads : thread::hardware_concurrency();
+	
+	if( scanner.parallelThreads < 1 )
+	{
+		scanner.parallelThreads = 1;
+	}
+	
+	scanner.scanChunks.resize( scanner.parallelThreads );
+	scanner.rescannedChunks.resize( scanner.parallelThreads );
+	scanner.roundSlices.clear();
+	scanner.currentSlice = 0;
+	scanner.sliceEntry = 0;
+	scanner.roundsFinished = false;
+	scanner.scanFinished = false;
+	scanner.parallelRunning = true;
+	
+	return true;
+}
+
+// Returns the token distance tokens ahead of the parser's current token (distance 0 is the current token itself).
+// Tokens are taken only when first asked for, so lineNumber and moreInput() never run ahead of what the parser has looked at.
+TokenFrame& lookaheadToken( const int distance )
+{
+	ScannerState& scanner = *context->scanner;
+	
+	while( scanner.ringCount <= distance )
+	{
+		pullToken( scanner.tokenRing[( scanner.ringHead + scanner.ringCount ) % LOOKAHEAD_SIZE] );
+		scanner.ringCount++;
+	}
+	
+	return scanner.tokenRing[( scanner.ringHead + distance ) % LOOKAHEAD_SIZE];
+}
+
+// Moves the parser on to the next token in the lookahead ring
+void consumeToken( void )
+{
+	ScannerState& scanner = *context->scanner;
+	
+	// Make sure the token being consumed has been scanned, so consuming always moves the scanner forward
+	lookaheadToken( 0 );
+	
+	scanner.ringHead = ( scanner.ringHead + 1 ) % LOOKAHEAD_SIZE;
+	scanner.ringCount--;
+}
+
+// Scans the next token from the input into newToken, moving the cursor past it
+void scanToken( ScanCursor& cursor, TokenFrame& newToken )
+{
+	ScannerState& scanner = *context->scanner;
+	char nextCharacter;
+	unsigned char characterClass;
+	unsigned char state;
+	unsigned char transition;
+	int reservedIndex;
+	
 	while( true )
 	{
 		// Initialize the container for the new token to retrieve
 		newToken.tokenType = UNKNOWN;
-		newToken.name.clear();
+		newToken.kind = END_OF_INPUT_TOKEN;
+		newToken.nameID = emptyNameID;
 		newToken.isGlobal = false;
+		newToken.symbol = NO_SYMBOL;
+		newToken.numberType = INVALID;
+		newToken.intValue = 0;
+		cursor.literalSpelling.clear();
+		
+		state = START_STATE;
 		
-		// This block of code skips through white space until a real character is detected
-		while( inFile.good() )
+		while( true )
 		{
-			nextCharacter = inFile.peek(); // Check what the next character is
-			if( isspace( nextCharacter ) ) // Check if it's white space
+			// Runs of characters that keep the DFA in the same state are skipped by the scanning kernels
+			switch( state )
 			{
-				if( nextCharacter == '\n' ) // Check if the whitespace is a newline in order to keep track of line number
-				{
-					lineNumber++;
-				}
-				
-				inFile.ignore(); // Pull the white space character out of the stream
+				case START_STATE: // The kernel counts the newlines it skips to keep track of line number
+					cursor.bufferPointer = skipWhitespace( cursor.bufferPointer, cursor.bufferEnd, cursor.scanLine );
+					cursor.tokenStart = cursor.bufferPointer;
+					break;
+					
+				case IDENTIFIER_STATE:
+					cursor.bufferPointer = scanIdentifier( cursor.bufferPointer, cursor.bufferEnd );
+					break;
+					
+				case NUMBER_STATE:
+				case FRACTION_STATE:
+					cursor.bufferPointer = scanDigits( cursor.bufferPointer, cursor.bufferEnd );
+					break;
+					
+				case COMMENT_STATE:
+					cursor.bufferPointer = findNewline( cursor.bufferPointer, cursor.bufferEnd );
+					break;
 			}
-			else // If it's not white space
+			
+			// Look at the next character (reading more input if the buffer ran out) and find the transition for it
+			nextCharacter = peekCharacter( cursor );
+			characterClass = cursor.endOfInput ? END_CLASS : characterClassTable[static_cast<unsigned char>( nextCharacter )];
+			transition = scanTransitions[state][characterClass];
+			
+			if( transition >= FIRST_ACTION )
 			{
 				break;
 			}
+			
+			// Move past the character. String literals collect their characters as they go because white space in them is dropped.
+			cursor.bufferPointer++;
+			
+			if( transition == STRING_STATE )
+			{
+				cursor.literalSpelling += nextCharacter;
+			}
+			else if( transition == START_STATE )
+			{
+				if( characterClass == NEWLINE_CLASS )
+				{
+					cursor.scanLine++;
+				}
+				
+				cursor.tokenStart = cursor.bufferPointer;
+			}
+			
+			state = transition;
 		}
 		
-		// Determine what kind of character is next.
-		switch( getCharacterClass( nextCharacter ) )
+		// Carry out the action the DFA stopped on
+		switch( transition )
 		{
-			case LETTER: // Only identifiers and reserved words start with a letter.
-				// Get the token value
-				do
+			case ACCEPT_WORD: // Identifiers and reserved words
+				reservedIndex = findReservedWord( cursor.tokenStart, cursor.bufferPointer - cursor.tokenStart );
+				
+				// Determine whether it's a reserved word. Reserved words are interned in the same order as reservedWords.
+				// If not, the parser's side searches for the token in the symbol table when it takes it
+				if( reservedIndex >= 0 )
 				{
-					// Read the next character in
-					inFile >> currentCharacter;
-					newToken.name += currentCharacter;
-					
-					// Look at what the next character is
-					nextCharacter = inFile.peek();
-				} while( inFile.good() && ( isalnum( nextCharacter ) || nextCharacter == '_' ) );
+					newToken.tokenType = RESERVE;
+					newToken.kind = static_cast<TokenKind>( reservedIndex );
+					newToken.nameID = reservedIndex;
+					newToken.isGlobal = true;
+				}
+				else
+				{
+					newToken.tokenType = NONE;
+					newToken.kind = NAME_TOKEN;
+					newToken.nameID = scanName( cursor, cursor.tokenStart, cursor.bufferPointer - cursor.tokenStart );
+				}
 				
-				// Search for the token in the symbol table
-				// Determine whether it's a reserved word
-				findSymbolEntry( newToken );
-				return newToken;
-				break;
+				return;
 				
-			case DIGIT: // Only numbers start with a digit
+			case ACCEPT_NUMBER: // Cut the number out of the buffer, leaving out the underscores
 				newToken.tokenType = NUMBER;
+				newToken.kind = NUMBER_TOKEN;
 				
-				// Get the token value
-				do
+				for( const char* digit = cursor.tokenStart; digit < cursor.bufferPointer; digit++ )
 				{
-					if( nextCharacter != '_' )
+					if( *digit != '_' )
 					{
-						// Read the next character in and add it to the token value
-						inFile >> currentCharacter;
-						newToken.name += currentCharacter;
+						cursor.literalSpelling += *digit;
 					}
-					else
-					{
-						inFile.ignore( 1 );
-					}
-					
-					// Look at what the next character is
-					nextCharacter = inFile.peek();
-				} while( inFile.good() && ( isdigit( nextCharacter ) || nextCharacter == '_' ) ); // keep going as long as there are digits or underscores
+				}
+				
+				newToken.nameID = scanName( cursor, cursor.literalSpelling.data(), cursor.literalSpelling.size() );
+				convertNumber( cursor, newToken );
+				
+				return;
+				
+			case ACCEPT_OPERATOR_WITH_NEXT: // The next character finishes the operator
+				cursor.bufferPointer++;
+				// fall through
+				
+			case ACCEPT_OPERATOR:
+				newToken.tokenType = OPERATOR;
+				newToken.nameID = scanner.operatorIDs[static_cast<unsigned char>( *cursor.tokenStart )][cursor.bufferPointer - cursor.tokenStart - 1];
+				newToken.kind = static_cast<TokenKind>( newToken.nameID );
+				
+				return;
+				
+			case ACCEPT_STRING: // Closing double quote
+				cursor.bufferPointer++;
+				
+				newToken.tokenType = STRING;
+				newToken.kind = STRING_LITERAL_TOKEN;
+				cursor.literalSpelling += '\"';
+				newToken.nameID = scanName( cursor, cursor.literalSpelling.data(), cursor.literalSpelling.size() );
+				
+				return;
 				
-				// Check if there's a decimal point next
-				if( nextCharacter == '.' )
+			case STRING_AT_NEWLINE: // Unexpected inside a string literal
+				scanWarning( cursor, STRING_NEWLINE_WARNING );
+				
+				cursor.bufferPointer++;
+				cursor.scanLine++;
+				
+				newToken.tokenType = STRING;
+				newToken.kind = STRING_LITERAL_TOKEN;
+				cursor.literalSpelling += '\"';
+				newToken.nameID = scanName( cursor, cursor.literalSpelling.data(), cursor.literalSpelling.size() );
+				
+				return;
+				
+			case STRING_AT_END: // The input ended while skipping white space, so the last character got read again
+				cursor.literalSpelling += cursor.literalSpelling[cursor.literalSpelling.size() - 1];
+				// fall through
+				
+			case STRING_AT_ILLEGAL:
+				scanWarning( cursor, STRING_ILLEGAL_WARNING );
+				
+				newToken.tokenType = STRING;
+				newToken.kind = STRING_LITERAL_TOKEN;
+				cursor.literalSpelling += '\"';
+				newToken.nameID = scanName( cursor, cursor.literalSpelling.data(), cursor.literalSpelling.size() );
+				
+				return;
+				
+			case SKIP_COMMENT: // Skip the newline at the end of the comment. Start over looking for a token because we haven't found one yet.
+				if( cursor.endOfInput == false )
 				{
-					do
-					{
-						if( nextCharacter != '_' )
-						{
-							// Read the next character in and add it to the token value
-							inFile >> currentCharacter;
-							newToken.name += currentCharacter;
-						}
-						else
-						{
-							inFile.ignore( 1 );
-						}
-						
-						// Look at what the next character is
-						nextCharacter = inFile.peek();
-					} while( inFile.good() && ( isdigit( nextCharacter ) || nextCharacter == '_' ) ); // keep going as long as there are digits or underscores
+					cursor.bufferPointer++;
 				}
 				
-				return newToken;
+				cursor.scanLine++;
 				break;
 				
-			case PUNCTUATION:
-				switch( nextCharacter )
-				{
-					case '/': // This is either a division symbol or part of a comment marker
-						inFile >> currentCharacter;
-						nextCharacter = inFile.peek();
-						
-						if( nextCharacter == '/' ) // This is a comment marker. Skip to the next line
-						{
-							inFile.ignore( numeric_limits<streamsize>::max(), '\n' ); // skip the rest of the line
-							
-							lineNumber++;
-							continue; // Start over looking for a token because we haven't found one yet, just a comment.
-						}
-						else // It's just a division operator
-						{
-							newToken.tokenType = OPERATOR;
-							newToken.name = '/';
-							
-							return newToken;
-						}
-						break;
-						
-					case '<': // These can be one-character or two-character operators. Check which one
-					case '>':
-					case '!':
-					case ':':
-						inFile >> currentCharacter;
-						nextCharacter = inFile.peek();
-						
-						newToken.tokenType = OPERATOR;
-						newToken.name += currentCharacter;
-						
-						if( nextCharacter == '=' ) // This is a two-character operator
-						{
-							inFile >> currentCharacter;
-							newToken.name += currentCharacter;
-							
-							return newToken;
-						}
-						else // It's just a one-character operator
-						{
-							if( currentCharacter == '!' )
-							{
-								reportWarning( "Illegal character: \'!\'. Assuming whitespace." );
-								continue; // Start over looking for a token because we haven't gotten one yet.
-							}
-							else
-							{
-								return newToken;
-							}
-						}
-						break;
-						
-					case '\"': // Double quotes means the beginning of a string literal
-						newToken.tokenType = STRING;
-						
-						// Start retrieving the string literal
-						do
-						{
-							inFile >> currentCharacter;
-							nextCharacter = inFile.peek();
-							
-							newToken.name += currentCharacter;
-							if( isalnum( nextCharacter ) ) // Check if we are continuing to get valid string characters
-							{
-								continue;
-							}
-							switch( nextCharacter )
-							{
-								// These are also valid string characters
-								case ' ':
-								case '_':
-								case ',':
-								case ';':
-								case ':':
-								case '.':
-								case '\'':
-									continue;
-									
-								case '\"':
-									inFile >> currentCharacter;
-									newToken.name += currentCharacter;
-									
-									return newToken;
-									
-								case '\n': // Unexpected inside a string literal
-									reportWarning( "Unexpected end of line in string literal. Assuming end of string literal." );
-									
-									inFile.ignore();
-									lineNumber++;
-									
-									newToken.name += '\"';
-									
-									return newToken;
-									
-								default:
-									reportWarning( "Encountered illegal character in string literal. Assuming end of string literal." );
-									
-									newToken.name += '\"';
-									
-									return newToken;
-							}
-						} while( inFile.good() );
-						break;
-						
-					default: // This will cover all other legal punctuation
-						inFile >> currentCharacter;
-						
-						newToken.tokenType = OPERATOR;
-						newToken.name = currentCharacter;
-						
-						return newToken;
-				}
+			case SKIP_BANG: // A '!' that isn't part of "!="
+				scanWarning( cursor, ILLEGAL_BANG_WARNING );
 				break;
 				
-			default: // Illegal character
-				if( nextCharacter == char_traits<char>::eof() )
-				{
-					throw EOFException();
-				}
-				else
-				{
-					inFile >> currentCharacter;
-					
-					reportWarning( "Illegal character found. Assuming whitespace." );
-				}
+			case SKIP_ILLEGAL:
+				cursor.bufferPointer++;
+				
+				scanWarning( cursor, ILLEGAL_CHARACTER_WARNING );
 				break;
+				
+			default: // There are no tokens left once the end of the input has been reached
+				return;
 		}
 	}
 }
 
-// This function determines the character class of the specified character
-CharacterClass getCharacterClass( const char& ch )
+// Converts the number in the cursor's literal spelling (digits with at most one decimal point) into the token's value.
+// Numbers with a decimal point are floats and the rest are integers. Values that don't fit get a warning.
+void convertNumber( ScanCursor& cursor, TokenFrame& newToken )
 {
-	if( isalpha( ch ) != 0 )
-		return LETTER;
-	else if( isdigit( ch ) != 0 )
-		return DIGIT;
-	else if( ispunct( ch ) != 0 )
+	const string& spelling = cursor.literalSpelling;
+	long long integer = 0;
+	double exact;
+	int significantDigits = 0;
+	int trailingZeros = 0;
+	
+	if( spelling.find( '.' ) == string::npos )
 	{
-		switch( ch )
+		newToken.numberType = INTEGER;
+		
+		// Stop adding digits once the number is too large, so the running total can't overflow
+		for( int i = 0; i < static_cast<int>( spelling.size() ) && integer <= INT_MAX; i++ )
 		{
-			case ':':
-			case ';':
-			case ',':
-			case '+':
-			case '-':
-			case '*':
-			case '/':
-			case '(':
-			case ')':
-			case '<':
-			case '>':
-			case '!':
-			case '=':
-			case '{':
-			case '}':
-			case '\"':
-			case '&':
-			case '|':
-			case '[':
-			case ']':
-				return PUNCTUATION;
-				break;
-				
-			default:
-				return ILLEGAL;
-				break;
+			integer = integer * 10 + ( spelling[i] - '0' );
+		}
+		
+		if( integer > INT_MAX )
+		{
+			scanWarning( cursor, INTEGER_RANGE_WARNING );
+			integer = INT_MAX;
+		}
+		
+		newToken.intValue = integer;
+		return;
+	}
+	
+	newToken.numberType = FLOAT;
+	newToken.floatValue = strtof( spelling.c_str(), NULL );
+	exact = strtod( spelling.c_str(), NULL );
+	
+	// Count the digits from the first nonzero one to the last nonzero one
+	for( int i = 0; i < static_cast<int>( spelling.size() ); i++ )
+	{
+		if( spelling[i] != '.' && ( significantDigits > 0 || spelling[i] != '0' ) )
+		{
+			significantDigits++;
+			trailingZeros = spelling[i] == '0' ? trailingZeros + 1 : 0;
 		}
 	}
+	
+	significantDigits -= trailingZeros;
+	
+	if( newToken.floatValue > FLT_MAX )
+	{
+		scanWarning( cursor, FLOAT_OVERFLOW_WARNING );
+		newToken.floatValue = FLT_MAX;
+	}
+	else if( newToken.floatValue == 0 && exact != 0 )
+	{
+		scanWarning( cursor, FLOAT_UNDERFLOW_WARNING );
+	}
+	else if( significantDigits > FLT_DIG && static_cast<double>( newToken.floatValue ) != exact )
+	{
+		scanWarning( cursor, FLOAT_PRECISION_WARNING );
+	}
+}
+
+// This function tells whether the scanner has not yet run into the end of the input file
+// (as of the last token the parser has taken)
+bool moreInput( void )
+{
+	ScannerState& scanner = *context->scanner;
+	
+	return scanner.visibleEndOfInput == false;
+}
+
+// This function stops the scanner thread, releases the input buffer and closes the input file
+void closeScanner( void )
+{
+	ScannerState& scanner = *context->scanner;
+	
+	if( scanner.pipelineRunning )
+	{
+		scanner.stopPipeline = true;
+		scanner.scannerThread.join();
+		scanner.pipelineRunning = false;
+	}
+	
+	scanner.parallelRunning = false;
+	scanner.roundSlices.clear();
+	
+#ifndef _WIN32
+	if( scanner.ownMapping )
+	{
+		munmap( const_cast<char*>( scanner.bufferStart ), scanner.mappedLength );
+	}
+#endif
+	
+	if( scanner.inputDescriptor > STDIN_FILENO )
+	{
+		close( scanner.inputDescriptor );
+	}
+	
+	scanner.inputDescriptor = -1;
+	scanner.inputMapped = false;
+	scanner.ownMapping = false;
+	scanner.mappedLength = 0;
+	scanner.inputWindow.clear();
+	scanner.bufferStart = scanner.mainCursor.bufferPointer = scanner.mainCursor.bufferEnd = scanner.mainCursor.tokenStart = NULL;
+}
+
+// Interns the spelling of the token being scanned and returns its id.
+// A parallel scanner keeps the spelling in its chunk instead, and returns the negative id the chunk knows it by.
+int scanName( ScanCursor& cursor, const char* spelling, const int length )
+{
+	if( cursor.chunk == NULL )
+	{
+		return internName( spelling, length );
+	}
+	
+	return -1 - addName( cursor.chunk->names, spelling, length, hashSpelling( spelling, length ) );
+}
+
+// Reports a warning found while scanning. With the pipeline running it is queued, and a parallel scanner keeps it in its chunk,
+// to be reported when the parser reaches it.
+void scanWarning( ScanCursor& cursor, const ScanWarning warning )
+{
+	ScannerState& scanner = *context->scanner;
+	ScanEntry entry = ScanEntry();
+	
+	entry.token.line = cursor.scanLine;
+	entry.warning = warning;
+	
+	if( cursor.chunk != NULL )
+	{
+		cursor.chunk->entries.push_back( entry );
+		cursor.chunk->entryEnds.push_back( cursor.bufferPointer );
+	}
+	else if( scanner.pipelineRunning )
+	{
+		pushPipelineEntry( entry );
+	}
+	else
+	{
+		context->lineNumber = cursor.scanLine;
+		reportWarning( scanWarningMessages[warning] );
+	}
+}
+
+// Gives the parser its next token, either by scanning it or by taking it from the tokens scanned ahead.
+// Then it brings lineNumber and moreInput() up to date, and looks names up in the symbol table.
+void pullToken( TokenFrame& newToken )
+{
+	ScannerState& scanner = *context->scanner;
+	ScanEntry entry;
+	
+	if( scanner.givenTokens != NULL )
+	{
+		newToken = ( scanner.nextGivenToken < scanner.givenTokens->size() ) ? ( *scanner.givenTokens )[scanner.nextGivenToken++] : scanner.finalToken;
+		scanner.visibleEndOfInput = newToken.kind == END_OF_INPUT_TOKEN;
+	}
+	else if( scanner.pipelineRunning == false && scanner.parallelRunning == false )
+	{
+		newToken = getToken();
+		scanner.visibleEndOfInput = scanner.mainCursor.endOfInput;
+	}
+	else if( scanner.scanFinished )
+	{
+		newToken = scanner.finalToken;
+	}
+	else
+	{
+		takeScanEntry( entry );
+		
+		// Report the warnings the scanner ran into on the way to this token
+		while( entry.warning >= 0 )
+		{
+			context->lineNumber = entry.token.line;
+			reportWarning( scanWarningMessages[entry.warning] );
+			
+			takeScanEntry( entry );
+		}
+		
+		newToken = entry.token;
+		scanner.visibleEndOfInput = entry.inputEnded;
+		
+		if( newToken.tokenType == UNKNOWN )
+		{
+			scanner.scanFinished = true;
+			scanner.finalToken = newToken;
+		}
+	}
+	
+	context->lineNumber = newToken.line;
+	
+	// The symbol table belongs to the parser, so names are looked up as the parser takes them rather than as they are scanned
+	if( newToken.tokenType == NONE )
+	{
+		findSymbolEntry( newToken );
+	}
+}
+
+// Takes the next token or warning scanned ahead of the parser, from the scanner thread or from the stitched chunks
+void takeScanEntry( ScanEntry& entry )
+{
+	ScannerState& scanner = *context->scanner;
+	ChunkSlice* slice;
+	
+	if( scanner.parallelRunning )
+	{
+		// Move past slices that have run out, scanning the next round after the last one
+		while( scanner.currentSlice == scanner.roundSlices.size() || scanner.sliceEntry == scanner.roundSlices[scanner.currentSlice].chunk->entries.size() )
+		{
+			if( scanner.currentSlice == scanner.roundSlices.size() )
+			{
+				scanRound();
+			}
+			else if( ++scanner.currentSlice < scanner.roundSlices.size() )
+			{
+				scanner.sliceEntry = scanner.roundSlices[scanner.currentSlice].first;
+			}
+		}
+		
+		slice = &scanner.roundSlices[scanner.currentSlice];
+		entry = slice->chunk->entries[scanner.sliceEntry++];
+		entry.token.line += slice->lineOffset;
+		
+		if( entry.warning < 0 && entry.token.nameID < 0 )
+		{
+			entry.token.nameID = slice->chunk->globalIDs[-1 - entry.token.nameID];
+		}
+	}
+	else
+	{
+		popPipelineEntry( entry );
+	}
+}
+
+// Body of the scanner thread. Scans tokens up to the end of the input and passes them on to the parser.
+// The thread works on the context of the compile that started it.
+void runPipeline( CompilerContext* owner )
+{
+	context = owner;
+	
+	ScannerState& scanner = *context->scanner;
+	ScanEntry entry = ScanEntry();
+	
+	entry.warning = -1;
+	
+	do
+	{
+		entry.token = getToken();
+		entry.inputEnded = scanner.mainCursor.endOfInput;
+	}
+	while( pushPipelineEntry( entry ) && entry.token.tokenType != UNKNOWN );
+}
+
+// Adds an entry to the pipeline queue, waiting for room if it is full.
+// Returns false if the parser stopped the pipeline while waiting.
+bool pushPipelineEntry( const ScanEntry& entry )
+{
+	ScannerState& scanner = *context->scanner;
+	unsigned int tail = scanner.queueTail.load( memory_order_relaxed );
+	
+	while( tail - scanner.cachedHead == PIPELINE_QUEUE_SIZE )
+	{
+		scanner.cachedHead = scanner.queueHead.load( memory_order_acquire );
+		
+		if( tail - scanner.cachedHead == PIPELINE_QUEUE_SIZE )
+		{
+			if( scanner.stopPipeline.load( memory_order_relaxed ) )
+			{
+				return false;
+			}
+			
+			this_thread::yield();
+		}
+	}
+	
+	scanner.pipelineQueue[tail % PIPELINE_QUEUE_SIZE] = entry;
+	scanner.queueTail.store( tail + 1, memory_order_release );
+	
+	return true;
+}
+
+// Takes the next entry from the pipeline queue, waiting for the scanner thread if it is empty
+void popPipelineEntry( ScanEntry& entry )
+{
+	ScannerState& scanner = *context->scanner;
+	unsigned int head = scanner.queueHead.load( memory_order_relaxed );
+	
+	while( head == scanner.cachedTail )
+	{
+		scanner.cachedTail = scanner.queueTail.load( memory_order_acquire );
+		
+		if( head == scanner.cachedTail )
+		{
+			this_thread::yield();
+		}
+	}
+	
+	entry = scanner.pipelineQueue[head % PIPELINE_QUEUE_SIZE];
+	scanner.queueHead.store( head + 1, memory_order_release );
+}
+
+// Scans the next round of chunks in parallel and stitches their tokens together into roundSlices.
+// mainCursor keeps track of where the stitched tokens have taken the scanner.
+void scanRound( void )
+{
+	ScannerState& scanner = *context->scanner;
+	const char* inputEnd = scanner.bufferStart + scanner.mappedLength;
+	const char* start = scanner.mainCursor.bufferPointer;
+	const char* position = scanner.mainCursor.bufferPointer;
+	const char* newline;
+	int line = scanner.mainCursor.scanLine;
+	int chunkCount = 0;
+	vector<thread> workers;
+	
+	// Cut the round into chunks of at least SCAN_CHUNK_SIZE bytes (except at the end of the input), each ending just after a newline
+	do
+	{
+		newline = NULL;
+		
+		if( inputEnd - start > SCAN_CHUNK_SIZE )
+		{
+			newline = static_cast<const char*>( memchr( start + SCAN_CHUNK_SIZE, '\n', inputEnd - start - SCAN_CHUNK_SIZE ) );
+		}
+		
+		scanner.scanChunks[chunkCount].start = start;
+		scanner.scanChunks[chunkCount].end = newline != NULL ? newline + 1 : inputEnd;
+		start = scanner.scanChunks[chunkCount].end;
+		chunkCount++;
+	}
+	while( chunkCount < scanner.parallelThreads && start < inputEnd );
+	
+	// The first chunk starts where the scanner really is, so it is scanned on this thread without guessing
+	for( int i = 1; i < chunkCount; i++ )
+	{
+		workers.push_back( thread( scanChunk, context, &scanner.scanChunks[i], 0 ) );
+	}
+	
+	scanChunk( context, &scanner.scanChunks[0], scanner.mainCursor.scanLine );
+	
+	for( int i = 0; i < static_cast<int>( workers.size() ); i++ )
+	{
+		workers[i].join();
+	}
+	
+	scanner.roundSlices.clear();
+	
+	for( int i = 0; i < chunkCount && scanner.roundsFinished == false; i++ )
+	{
+		scanner.roundsFinished = stitchChunk( scanner.scanChunks[i], scanner.rescannedChunks[i], position, line ) == false;
+	}
+	
+	scanner.currentSlice = 0;
+	scanner.sliceEntry = scanner.roundSlices[0].first;
+	
+	scanner.mainCursor.bufferPointer = position;
+	scanner.mainCursor.scanLine = line;
+}
+
+// Body of a parallel scanner thread. Scans the chunk from its start, counting lines from line,
+// up to the first token that ends at or after the end of the chunk. The thread works on the context of the compile that started it.
+void scanChunk( CompilerContext* owner, ScanChunk* chunk, const int line )
+{
+	context = owner;
+	
+	ScannerState& scanner = *context->scanner;
+	ScanCursor cursor;
+	ScanEntry entry = ScanEntry();
+	
+	cursor.bufferPointer = chunk->start;
+	cursor.bufferEnd = scanner.bufferStart + scanner.mappedLength;
+	cursor.tokenStart = chunk->start;
+	cursor.endOfInput = false;
+	cursor.scanLine = line;
+	cursor.chunk = chunk;
+	
+	// A chunk can't have more spellings than the bytes it is made of, plus the token that runs past its end
+	chunk->firstLine = line;
+	chunk->entries.clear();
+	chunk->entryEnds.clear();
+	resetNamePool( chunk->names, ( chunk->end - chunk->start ) / nameSegmentSize + 2 );
+	
+	entry.warning = -1;
+	
+	do
+	{
+		scanToken( cursor, entry.token );
+		entry.token.line = cursor.scanLine;
+		entry.inputEnded = cursor.endOfInput;
+		
+		chunk->entries.push_back( entry );
+		chunk->entryEnds.push_back( cursor.bufferPointer );
+	}
+	while( cursor.bufferPointer < chunk->end && entry.token.tokenType != UNKNOWN );
+}
+
+// Adds the tokens of the chunk that come after position (where the scanner stands after the chunks before it, on the specified line)
+// to roundSlices, scanning again into rescannedChunk if needed, and moves position and line past them.
+// Returns false once the end-of-input token has been added.
+bool stitchChunk( ScanChunk& chunk, ScanChunk& rescannedChunk, const char*& position, int& line )
+{
+	ScannerState& scanner = *context->scanner;
+	ScanCursor cursor;
+	ScanEntry entry = ScanEntry();
+	size_t first = 0; // First of the chunk's entries to keep
+	int lineOffset = line - chunk.firstLine;
+	
+	if( position == chunk.start )
+	{
+		return addChunkSlice( chunk, 0, lineOffset, position, line );
+	}
+	
+	// Find a token of the chunk that ends where the scanner stands. If there is none, scan on from there until one of the
+	// scanned tokens ends where one of the chunk's tokens does, or the scan reaches the end of the chunk.
+	cursor.bufferPointer = position;
+	cursor.bufferEnd = scanner.bufferStart + scanner.mappedLength;
+	cursor.tokenStart = position;
+	cursor.endOfInput = false;
+	cursor.scanLine = line;
+	cursor.chunk = &rescannedChunk;
+	
+	rescannedChunk.firstLine = line;
+	rescannedChunk.entries.clear();
+	rescannedChunk.entryEnds.clear();
+	resetNamePool( rescannedChunk.names, ( chunk.end - chunk.start ) / nameSegmentSize + 2 );
+	
+	entry.warning = -1;
+	
+	while( true )
+	{
+		while( first < chunk.entries.size() && ( chunk.entries[first].warning >= 0 || chunk.entryEnds[first] < cursor.bufferPointer ) )
+		{
+			first++;
+		}
+		
+		if( first < chunk.entries.size() && chunk.entryEnds[first] == cursor.bufferPointer )
+		{
+			lineOffset = cursor.scanLine - chunk.entries[first].token.line;
+			first++;
+			break;
+		}
+		
+		if( cursor.bufferPointer >= chunk.end || entry.token.tokenType == UNKNOWN )
+		{
+			first = chunk.entries.size();
+			break;
+		}
+		
+		scanToken( cursor, entry.token );
+		entry.token.line = cursor.scanLine;
+		entry.inputEnded = cursor.endOfInput;
+		
+		rescannedChunk.entries.push_back( entry );
+		rescannedChunk.entryEnds.push_back( cursor.bufferPointer );
+	}
+	
+	return addChunkSlice( rescannedChunk, 0, 0, position, line ) && addChunkSlice( chunk, first, lineOffset, position, line );
+}
+
+// Adds the chunk's entries from first on to roundSlices, and puts the chunk's spellings in the intern pool.
+// Moves position and line past the last token added. Returns false if that is the end-of-input token.
+bool addChunkSlice( ScanChunk& chunk, const size_t first, const int lineOffset, const char*& position, int& line )
+{
+	ScannerState& scanner = *context->scanner;
+	ChunkSlice slice;
+	
+	if( first == chunk.entries.size() )
+	{
+		return true;
+	}
+	
+	slice.chunk = &chunk;
+	slice.first = first;
+	slice.lineOffset = lineOffset;
+	scanner.roundSlices.push_back( slice );
+	
+	chunk.globalIDs.resize( chunk.names.count );
+	
+	for( int i = 0; i < chunk.names.count; i++ )
+	{
+		chunk.globalIDs[i] = addName( scanner.internPool, poolName( chunk.names, i ).data(), poolName( chunk.names, i ).size(), chunk.names.hashes[i] );
+	}
+	
+	// A chunk's scanner always stops right after a token
+	position = chunk.entryEnds.back();
+	line = chunk.entries.back().token.line + lineOffset;
+	
+	return chunk.entries.back().token.tokenType != UNKNOWN;
+}
+
+// Scans text into the buffer, replacing whatever the buffer held.
+// Spellings of the tokens are interned, so they stay valid until the scanner is initialized again.
+void scanBuffer( ScannedBuffer& buffer, const string& text )
+{
+	buffer.text.clear();
+	buffer.entries.clear();
+	buffer.gapStart = 0;
+	buffer.gapEnd = 0;
+	buffer.lastLine = 1;
+	
+	editBuffer( buffer, 0, 0, text );
+}
+
+// Replaces removedLength bytes of the buffer's text at offset with insertedText, and scans again only the tokens the edit can have changed.
+// Returns the number of entries that were scanned again, or -1 (leaving the buffer alone) if the edit doesn't fit in the text.
+int editBuffer( ScannedBuffer& buffer, const int offset, const int removedLength, const string& insertedText )
+{
+	ScannerState& scanner = *context->scanner;
+	ScanCursor cursor;
+	BufferEntry entry;
+	BufferEntry warningEntry;
+	const int oldSize = buffer.text.size();
+	const int oldLastLine = buffer.lastLine;
+	const int sizeChange = insertedText.size() - removedLength;
+	const int insertedEnd = offset + insertedText.size();
+	int low = 0;
+	int high = bufferEntryCount( buffer );
+	int middle;
+	int kept; // First of the old entries after the gap that is kept
+	int lineChange = 0;
+	int growth;
+	bool synchronized = false;
+	
+	if( offset < 0 || removedLength < 0 || offset + removedLength > oldSize )
+	{
+		return -1;
+	}
+	
+	// The fixed spellings have to be in the intern pool before anything is scanned
+	if( scanner.internPool.count == 0 )
+	{
+		resetInternPool();
+	}
+	
+	// Find the first entry that ends at or after the edit (entries are in order of their ends), then back up over the warnings before it
+	while( low < high )
+	{
+		middle = ( low + high ) / 2;
+		
+		if( bufferEntry( buffer, middle ).end < offset )
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+	
+	while( low > 0 && bufferEntry( buffer, low - 1 ).warning != NULL )
+	{
+		low--;
+	}
+	
+	// Move the entries from there on after the gap, before the text changes under them
+	moveBufferGap( buffer, low );
+	buffer.text.replace( offset, removedLength, insertedText );
+	
+	cursor.bufferPointer = buffer.text.data() + ( low > 0 ? buffer.entries[low - 1].end : 0 );
+	cursor.bufferEnd = buffer.text.data() + buffer.text.size();
+	cursor.tokenStart = cursor.bufferPointer;
+	cursor.endOfInput = false;
+	cursor.scanLine = low > 0 ? buffer.entries[low - 1].token.line : 1;
+	cursor.chunk = &scanner.editChunk;
+	
+	scanner.editChunk.entries.clear();
+	scanner.editChunk.entryEnds.clear();
+	resetNamePool( scanner.editChunk.names, buffer.text.size() / nameSegmentSize + 2 );
+	scanner.rescannedEntries.clear();
+	kept = buffer.gapEnd;
+	
+	do
+	{
+		scanToken( cursor, entry.token );
+		entry.token.line = cursor.scanLine;
+		entry.start = cursor.tokenStart - buffer.text.data();
+		entry.end = cursor.bufferPointer - buffer.text.data();
+		entry.warning = NULL;
+		
+		// The warnings found on the way to the token come before it
+		for( int i = 0; i < static_cast<int>( scanner.editChunk.entries.size() ); i++ )
+		{
+			warningEntry.token.tokenType = UNKNOWN;
+			warningEntry.token.kind = END_OF_INPUT_TOKEN;
+			warningEntry.token.nameID = emptyNameID;
+			warningEntry.token.line = scanner.editChunk.entries[i].token.line;
+			warningEntry.token.isGlobal = false;
+			warningEntry.token.symbol = NO_SYMBOL;
+			warningEntry.token.numberType = INVALID;
+			warningEntry.token.intValue = 0;
+			warningEntry.start = scanner.editChunk.entryEnds[i] - buffer.text.data();
+			warningEntry.end = warningEntry.start;
+			warningEntry.warning = scanWarningMessages[scanner.editChunk.entries[i].warning];
+			
+			scanner.rescannedEntries.push_back( warningEntry );
+		}
+		
+		scanner.editChunk.entries.clear();
+		scanner.editChunk.entryEnds.clear();
+		scanner.rescannedEntries.push_back( entry );
+		
+		// Past the inserted text, look for an old token that ended at the same byte. The end-of-input token ends where
+		// the token before it does, so it can't be matched up with another token: the new scanner has to get there on its own.
+		if( entry.end >= insertedEnd && entry.token.tokenType != UNKNOWN )
+		{
+			while( kept < static_cast<int>( buffer.entries.size() ) && ( buffer.entries[kept].warning != NULL || buffer.entries[kept].end + oldSize < entry.end - sizeChange ) )
+			{
+				kept++;
+			}
+			
+			if( kept < static_cast<int>( buffer.entries.size() ) && buffer.entries[kept].end + oldSize == entry.end - sizeChange && buffer.entries[kept].token.tokenType != UNKNOWN )
+			{
+				lineChange = entry.token.line - ( buffer.entries[kept].token.line + oldLastLine );
+				synchronized = true;
+				kept++;
+			}
+		}
+	}
+	while( synchronized == false && entry.token.tokenType != UNKNOWN );
+	
+	if( synchronized == false )
+	{
+		kept = buffer.entries.size();
+	}
+	
+	// Give the new spellings their intern pool ids
+	scanner.editChunk.globalIDs.resize( scanner.editChunk.names.count );
+	
+	for( int i = 0; i < scanner.editChunk.names.count; i++ )
+	{
+		scanner.editChunk.globalIDs[i] = addName( scanner.internPool, poolName( scanner.editChunk.names, i ).data(), poolName( scanner.editChunk.names, i ).size(), scanner.editChunk.names.hashes[i] );
+	}
+	
+	// Drop the old entries that were scanned again, and put the new ones in the gap, making it bigger if they don't fit
+	buffer.gapEnd = kept;
+	
+	if( buffer.gapEnd - buffer.gapStart < static_cast<int>( scanner.rescannedEntries.size() ) )
+	{
+		growth = scanner.rescannedEntries.size() - ( buffer.gapEnd - buffer.gapStart ) + ( buffer.entries.size() + scanner.rescannedEntries.size() ) / 8 + 1024;
+		buffer.entries.insert( buffer.entries.begin() + buffer.gapEnd, growth, BufferEntry() );
+		buffer.gapEnd += growth;
+	}
+	
+	for( int i = 0; i < static_cast<int>( scanner.rescannedEntries.size() ); i++ )
+	{
+		if( scanner.rescannedEntries[i].warning == NULL && scanner.rescannedEntries[i].token.nameID < 0 )
+		{
+			scanner.rescannedEntries[i].token.nameID = scanner.editChunk.globalIDs[-1 - scanner.rescannedEntries[i].token.nameID];
+		}
+		
+		buffer.entries[buffer.gapStart++] = scanner.rescannedEntries[i];
+	}
+	
+	buffer.lastLine = synchronized ? oldLastLine + lineChange : entry.token.line;
+	
+	return scanner.rescannedEntries.size();
+}
+
+// Returns the number of entries (tokens and warnings, ending with the end-of-input token) in the buffer
+int bufferEntryCount( const ScannedBuffer& buffer )
+{
+	return buffer.gapStart + buffer.entries.size() - buffer.gapEnd;
+}
+
+// Returns the entry with the specified index in the buffer, with its real offsets and line
+BufferEntry bufferEntry( const ScannedBuffer& buffer, const int index )
+{
+	BufferEntry entry;
+	
+	if( index < buffer.gapStart )
+	{
+		return buffer.entries[index];
+	}
+	
+	entry = buffer.entries[index - buffer.gapStart + buffer.gapEnd];
+	entry.start += buffer.text.size();
+	entry.end += buffer.text.size();
+	entry.token.line += buffer.lastLine;
+	
+	return entry;
+}
+
+// Moves the gap of the buffer so that the specified number of entries come before it.
+// Entries that cross the gap switch between real offsets and lines and ones counted from the end.
+void moveBufferGap( ScannedBuffer& buffer, const int index )
+{
+	const int size = buffer.text.size();
+	
+	while( buffer.gapStart > index )
+	{
+		buffer.gapStart--;
+		buffer.gapEnd--;
+		buffer.entries[buffer.gapEnd] = buffer.entries[buffer.gapStart];
+		buffer.entries[buffer.gapEnd].start -= size;
+		buffer.entries[buffer.gapEnd].end -= size;
+		buffer.entries[buffer.gapEnd].token.line -= buffer.lastLine;
+	}
+	
+	while( buffer.gapStart < index )
+	{
+		buffer.entries[buffer.gapStart] = buffer.entries[buffer.gapEnd];
+		buffer.entries[buffer.gapStart].start += size;
+		buffer.entries[buffer.gapStart].end += size;
+		buffer.entries[buffer.gapStart].token.line += buffer.lastLine;
+		buffer.gapStart++;
+		buffer.gapEnd++;
+	}
+}
+
+// Returns the index in reservedWords of the reserved word spelled by the length characters starting at word, or -1 if they don't spell one
+int findReservedWord( const char* word, const int length )
+{
+	int index;
+	
+	// Every reserved word has at least two characters, which the hash needs
+	if( length < 2 )
+	{
+		return -1;
+	}
+	
+	index = reservedSlots[reservedHash( word, length )];
+	
+	if( index >= 0 && strncmp( reservedWords[index], word, length ) == 0 && reservedWords[index][length] == '\0' )
+	{
+		return index;
+	}
+	
+	return -1;
+}
+
+// Empties the intern pool and interns the fixed spellings: the reserved words (so a reserved word's id is its index in reservedWords),
+// the empty spelling, and the operators (so the scanner can find their ids without hashing)
+void resetInternPool( void )
+{
+	ScannerState& scanner = *context->scanner;
+	int length;
+	
+	resetNamePool( scanner.internPool, nameSegmentCount );
+	
+	for( int i = 0; i < reservedWordCount; i++ )
+	{
+		internName( reservedWords[i], wordLength( reservedWords[i] ) );
+	}
+	
+	internName( "", 0 );
+	
+	for( int i = 0; i < operatorCount; i++ )
+	{
+		length = strlen( operators[i] );
+		scanner.operatorIDs[static_cast<unsigned char>( operators[i][0] )][length - 1] = internName( operators[i], length );
+	}
+}
+
+// Empties a pool of spellings, making sure its table has room for at least segmentCount segments.
+// Segments already allocated are kept for the next spellings.
+void resetNamePool( NamePool& pool, const int segmentCount )
+{
+	if( static_cast<int>( pool.segments.size() ) < segmentCount )
+	{
+		pool.segments.resize( segmentCount );
+	}
+	
+	pool.count = 0;
+	pool.hashes.clear();
+	pool.slots.assign( 1024, -1 );
+}
+
+// Adds a spelling to the intern pool (if it isn't there already) and returns its id
+int internName( const char* spelling, const int length )
+{
+	ScannerState& scanner = *context->scanner;
+	
+	return addName( scanner.internPool, spelling, length, hashSpelling( spelling, length ) );
+}
+
+// Adds a spelling with the specified hash to the pool (if it isn't there already) and returns its id in the pool
+int addName( NamePool& pool, const char* spelling, const int length, const unsigned int hash )
+{
+	unsigned int mask = pool.slots.size() - 1;
+	unsigned int slot = hash & mask;
+	int id;
+	
+	// Probe until the spelling or an empty slot is found
+	while( pool.slots[slot] >= 0 )
+	{
+		id = pool.slots[slot];
+		
+		if( pool.hashes[id] == hash && poolName( pool, id ).size() == static_cast<size_t>( length ) && memcmp( poolName( pool, id ).data(), spelling, length ) == 0 )
+		{
+			return id;
+		}
+		
+		slot = ( slot + 1 ) & mask;
+	}
+	
+	id = pool.count;
+	
+	if( pool.segments[id / nameSegmentSize] == NULL )
+	{
+		pool.segments[id / nameSegmentSize].reset( new string[nameSegmentSize] );
+	}
+	
+	pool.segments[id / nameSegmentSize][id % nameSegmentSize].assign( spelling, length );
+	pool.hashes.push_back( hash );
+	pool.slots[slot] = id;
+	pool.count++;
+	
+	// Keep the table at most half full. Doubling it means putting every id back in its new slot.
+	if( pool.count * 2 > static_cast<int>( pool.slots.size() ) )
+	{
+		pool.slots.assign( pool.slots.size() * 2, -1 );
+		mask = pool.slots.size() - 1;
+		
+		for( int i = 0; i < pool.count; i++ )
+		{
+			slot = pool.hashes[i] & mask;
+			
+			while( pool.slots[slot] >= 0 )
+			{
+				slot = ( slot + 1 ) & mask;
+			}
+			
+			pool.slots[slot] = i;
+		}
+	}
+	
+	return id;
+}
+
+// Returns the spelling of an interned identifier, literal or operator
+const string& internedName( const int id )
+{
+	ScannerState& scanner = *context->scanner;
+	
+	return poolName( *scanner.namePool, id );
+}
+
+// Returns the spelling with the specified id in the pool
+const string& poolName( const NamePool& pool, const int id )
+{
+	return pool.segments[id / nameSegmentSize][id % nameSegmentSize];
+}
+
+// FNV-1a hash of a spelling
+unsigned int hashSpelling( const char* spelling, const int length )
+{
+	unsigned int hash = 2166136261u;
+	
+	for( int i = 0; i < length; i++ )
+	{
+		hash = ( hash ^ static_cast<unsigned char>( spelling[i] ) ) * 16777619u;
+	}
+	
+	return hash;
+}
+
+// Returns the next byte of input without consuming it, or EOF if the input has ended
+int peekCharacter( ScanCursor& cursor )
+{
+	if( cursor.bufferPointer == cursor.bufferEnd )
+	{
+		if( cursor.endOfInput || refillBuffer( cursor ) == false )
+		{
+			cursor.endOfInput = true;
+			return char_traits<char>::eof();
+		}
+	}
+	
+	return static_cast<unsigned char>( *cursor.bufferPointer );
+}
+
+// Slides the bytes of the token being scanned to the front of the input window and reads the next block of input behind them.
+// Returns false if the input is memory-mapped or there is no more input to read, or if the cursor isn't mainCursor (only it reads the input file).
+bool refillBuffer( ScanCursor& cursor )
+{
+	ScannerState& scanner = *context->scanner;
+	size_t keepOffset;
+	size_t keepLength;
+	ssize_t bytesRead;
+	
+	if( scanner.inputMapped || scanner.inputDescriptor < 0 || cursor.chunk != NULL )
+	{
+		return false;
+	}
+	
+	// Everything before the current token has already been scanned and can be dropped
+	keepOffset = cursor.tokenStart - scanner.bufferStart;
+	keepLength = cursor.bufferEnd - cursor.tokenStart;
+	
+	if( keepOffset > 0 )
+	{
+		memmove( &scanner.inputWindow[0], &scanner.inputWindow[keepOffset], keepLength );
+	}
+	
+	// Make room for a whole block even if the current token is very long
+	if( scanner.inputWindow.size() - keepLength < INPUT_BLOCK_SIZE )
+	{
+		scanner.inputWindow.resize( keepLength + INPUT_BLOCK_SIZE );
+	}
+	
+	do
+	{
+		bytesRead = read( scanner.inputDescriptor, &scanner.inputWindow[keepLength], scanner.inputWindow.size() - keepLength );
+	} while( bytesRead < 0 && errno == EINTR );
+	
+	// Point back into the window now that its contents have moved
+	cursor.bufferPointer = &scanner.inputWindow[0] + ( cursor.bufferPointer - cursor.tokenStart );
+	scanner.bufferStart = &scanner.inputWindow[0];
+	cursor.tokenStart = scanner.bufferStart;
+	cursor.bufferEnd = scanner.bufferStart + keepLength + ( bytesRead > 0 ? bytesRead : 0 );
+	
+	return bytesRead > 0;
+}
+
+// This function determines the character class of the specified character
+CharacterClass getCharacterClass( const char& ch )
+{
+	return generalClassTable[characterClassTable[static_cast<unsigned char>( ch )]];
 }
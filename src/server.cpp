@@ -0,0 +1,310 @@
+// Filename: server.cpp
+// Author: Himanshu Narayana
+// This file is the compile server (--server). It listens on a Unix domain socket and compiles the programs clients send it,
+// so a client pays for none of the compiler's start-up: not the process, not the iostreams, and not the tables the scanner seeds.
+// Each worker thread keeps a context of its own from one request to the next, with its buffers and tables already made,
+// and every request starts from a clean state in it (see compile()).
+//
+// A client sends a ServerRequestHeader and the source, and gets back a ServerReplyHeader, the C, the IR and the diagnostics.
+// It can send any number of requests over one connection, one after the other. A request has to arrive, and its reply has to be taken,
+// within SERVER_TIMEOUT_SECONDS of the worker being ready for it; otherwise the connection is closed, so a client that is idle or slow
+// can't keep a worker from the other connections.
+
+#include "compiler.h"
+
+#include <chrono>
+#include <thread>
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#ifndef _WIN32
+static void serveConnections( const int listener );
+static void serveConnection( const int connection, CompilerContext& workerContext );
+static bool receiveAll( const int connection, char* data, size_t length, const chrono::steady_clock::time_point deadline );
+static bool receiveSource( const int connection, string& source, const size_t length, const chrono::steady_clock::time_point deadline );
+static bool sendReply( const int connection, const CompileResult& result );
+static bool waitForConnection( const int connection, const short events, const chrono::steady_clock::time_point deadline );
+static void stopServer( int signalNumber );
+
+static char serverSocketPath[sizeof( sockaddr_un().sun_path )]; // Kept where the signal handler can reach it without allocating
+#endif
+
+int runServer( const char* socketPath, const int threads )
+{
+#ifndef _WIN32
+	sockaddr_un address = sockaddr_un();
+	vector<thread> workers;
+	int threadCount = max( 1, threads > 0 ? threads : static_cast<int>( thread::hardware_concurrency() ) );
+	int listener;
+	int probe;
+	
+	if( strlen( socketPath ) >= sizeof( address.sun_path ) )
+	{
+		cerr << "Socket path is too long: " << socketPath << endl;
+		return 1;
+	}
+	
+	address.sun_family = AF_UNIX;
+	strcpy( address.sun_path, socketPath );
+	
+	// Take over the path from a server that is gone, but not from one that is still listening
+	probe = socket( AF_UNIX, SOCK_STREAM, 0 );
+	
+	if( probe >= 0 && connect( probe, reinterpret_cast<sockaddr*>( &address ), sizeof( address ) ) == 0 )
+	{
+		close( probe );
+		cerr << "A server is already listening on " << socketPath << endl;
+		return 1;
+	}
+	
+	if( probe >= 0 )
+	{
+		close( probe );
+	}
+	
+	unlink( socketPath );
+	listener = socket( AF_UNIX, SOCK_STREAM, 0 );
+	
+	if( listener < 0 || bind( listener, reinterpret_cast<sockaddr*>( &address ), sizeof( address ) ) != 0 || listen( listener, SERVER_BACKLOG ) != 0 )
+	{
+		cerr << "Error opening socket " << socketPath << ": " << strerror( errno ) << endl;
+		return 1;
+	}
+	
+	// A client that goes away shouldn't take the server with it, and stopping the server removes the socket
+	strcpy( serverSocketPath, socketPath );
+	signal( SIGPIPE, SIG_IGN );
+	signal( SIGINT, stopServer );
+	signal( SIGTERM, stopServer );
+	
+	cerr << "Serving compile requests on " << socketPath << " with " << threadCount << " threads" << endl;
+	
+	for( int i = 0; i < threadCount; i++ )
+	{
+		workers.push_back( thread( serveConnections, listener ) );
+	}
+	
+	for( int i = 0; i < threadCount; i++ )
+	{
+		workers[i].join();
+	}
+	
+	return 0;
+#else
+	cerr << "The compile server needs Unix domain sockets, which this system doesn't have." << endl;
+	return 1;
+#endif
+}
+
+#ifndef _WIN32
+// Body of a worker thread. Takes connections one at a time and answers their requests, always in the same context.
+void serveConnections( const int listener )
+{
+	CompilerContext workerContext;
+	int connection;
+	
+	while( true )
+	{
+		connection = accept( listener, NULL, NULL );
+		
+		if( connection < 0 )
+		{
+			if( errno == EINTR || errno == ECONNABORTED )
+			{
+				continue;
+			}
+			
+			cerr << "Error accepting connection: " << strerror( errno ) << endl;
+			return;
+		}
+		
+		serveConnection( connection, workerContext );
+		close( connection );
+	}
+}
+
+// Answers the requests on a connection until the client closes it. A request that doesn't make sense closes the connection.
+void serveConnection( const int connection, CompilerContext& workerContext )
+{
+	ServerRequestHeader request;
+	CompileOptions options;
+	CompileResult result;
+	string source;
+	chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::seconds( SERVER_TIMEOUT_SECONDS );
+	
+	while( receiveAll( connection, reinterpret_cast<char*>( &request ), sizeof( request ), deadline ) )
+	{
+		if( request.magic != SERVER_REQUEST_MAGIC || request.sourceLength > SERVER_SOURCE_LIMIT || request.nestingLimit <= 0 )
+		{
+			return;
+		}
+		
+		if( receiveSource( connection, source, request.sourceLength, deadline ) == false )
+		{
+			return;
+		}
+		
+		options.nestingLimit = request.nestingLimit;
+		options.emitIr = request.emitIr != 0;
+		result = compile( workerContext, source.data(), source.size(), options );
+		
+		if( sendReply( connection, result ) == false )
+		{
+			return;
+		}
+		
+		deadline = chrono::steady_clock::now() + chrono::seconds( SERVER_TIMEOUT_SECONDS );
+	}
+}
+
+// Reads exactly length bytes from the connection. Returns false if it closed or failed first, or the deadline passed.
+bool receiveAll( const int connection, char* data, size_t length, const chrono::steady_clock::time_point deadline )
+{
+	ssize_t receivedLength;
+	
+	while( length > 0 )
+	{
+		if( waitForConnection( connection, POLLIN, deadline ) == false )
+		{
+			return false;
+		}
+		
+		receivedLength = read( connection, data, length );
+		
+		if( receivedLength < 0 && errno == EINTR )
+		{
+			continue;
+		}
+		
+		if( receivedLength <= 0 )
+		{
+			return false;
+		}
+		
+		data += receivedLength;
+		length -= receivedLength;
+	}
+	
+	return true;
+}
+
+// Reads a source of length bytes from the connection into source. The source grows as its bytes come in,
+// so a header claiming a large source costs no memory until the source is actually sent.
+bool receiveSource( const int connection, string& source, const size_t length, const chrono::steady_clock::time_point deadline )
+{
+	size_t received = 0;
+	
+	source.clear();
+	
+	while( received < length )
+	{
+		source.resize( min( length, max( received * 2, received + SERVER_RECEIVE_BLOCK ) ) );
+		
+		if( receiveAll( connection, &source[received], source.size() - received, deadline ) == false )
+		{
+			return false;
+		}
+		
+		received = source.size();
+	}
+	
+	return true;
+}
+
+// Sends the reply header and the three texts after it, in as few system calls as the socket takes them in.
+// Returns false if the connection failed, or the client didn't take the reply within SERVER_TIMEOUT_SECONDS.
+bool sendReply( const int connection, const CompileResult& result )
+{
+	chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::seconds( SERVER_TIMEOUT_SECONDS );
+	ServerReplyHeader reply = ServerReplyHeader();
+	struct iovec vectors[4];
+	int first = 0;
+	ssize_t sentLength;
+	
+	reply.magic = SERVER_REPLY_MAGIC;
+	reply.succeeded = result.succeeded ? 1 : 0;
+	reply.lineCount = result.lineCount;
+	reply.warningCount = result.warningCount;
+	reply.errorCount = result.errorCount;
+	reply.codeLength = result.code.size();
+	reply.irLength = result.ir.size();
+	reply.diagnosticsLength = result.diagnostics.size();
+	
+	vectors[0].iov_base = &reply;
+	vectors[0].iov_len = sizeof( reply );
+	vectors[1].iov_base = const_cast<char*>( result.code.data() );
+	vectors[1].iov_len = result.code.size();
+	vectors[2].iov_base = const_cast<char*>( result.ir.data() );
+	vectors[2].iov_len = result.ir.size();
+	vectors[3].iov_base = const_cast<char*>( result.diagnostics.data() );
+	vectors[3].iov_len = result.diagnostics.size();
+	
+	while( first < 4 )
+	{
+		if( waitForConnection( connection, POLLOUT, deadline ) == false )
+		{
+			return false;
+		}
+		
+		sentLength = writev( connection, vectors + first, 4 - first );
+		
+		if( sentLength < 0 )
+		{
+			if( errno == EINTR )
+			{
+				continue;
+			}
+			
+			return false;
+		}
+		
+		// Move past what was sent
+		while( first < 4 && static_cast<size_t>( sentLength ) >= vectors[first].iov_len )
+		{
+			sentLength -= vectors[first].iov_len;
+			first++;
+		}
+		
+		if( first < 4 )
+		{
+			vectors[first].iov_base = static_cast<char*>( vectors[first].iov_base ) + sentLength;
+			vectors[first].iov_len -= sentLength;
+		}
+	}
+	
+	return true;
+}
+
+// Waits until the connection can be read from (POLLIN) or written to (POLLOUT). Returns false if the deadline passes first.
+bool waitForConnection( const int connection, const short events, const chrono::steady_clock::time_point deadline )
+{
+	struct pollfd waited = { connection, events, 0 };
+	long long milliseconds;
+	int ready;
+	
+	do
+	{
+		milliseconds = chrono::duration_cast<chrono::milliseconds>( deadline - chrono::steady_clock::now() ).count();
+		ready = poll( &waited, 1, static_cast<int>( max( 0LL, milliseconds ) ) );
+	}
+	while( ready < 0 && errno == EINTR );
+	
+	return ready > 0;
+}
+
+// Removes the socket and stops the server, on SIGINT or SIGTERM
+void stopServer( int signalNumber )
+{
+	unlink( serverSocketPath );
+	_exit( 0 );
+}
+#endif
@@ -0,0 +1,154 @@
+// Filename: symbench.cpp
+// Author: Himanshu Narayana
+// This file is the symbol table benchmark (make symbol-benchmark). It interns a million distinct names by scanning them,
+// declares them all as globals, and looks them up in random order, once in the symbol table keyed by intern id and once
+// in a map keyed by spelling, the way the symbol tables used to be. It prints the time per operation and the memory each takes.
+
+#include "compiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <malloc.h>
+#include <map>
+#include <random>
+
+using namespace std;
+
+static double secondsSince( const chrono::steady_clock::time_point start );
+static size_t heapInUse( void );
+
+int main( int argc, char** argv )
+{
+	int names = 1000000; // Set by --names to the number of distinct names declared
+	CompilerContext benchmarkContext;
+	ostream discarded( NULL );
+	string source;
+	vector<int> nameIDs; // Intern ids of the declared names, then of as many names that aren't declared
+	vector<int> order;
+	map<string, int> spellings;
+	chrono::steady_clock::time_point start;
+	double tableInsert, tableLookup, tableMiss;
+	double mapInsert, mapLookup, mapMiss;
+	size_t tableMemory, mapMemory, heapBefore;
+	long long found = 0;
+	
+	context = &benchmarkContext;
+	benchmarkContext.diagnostics = &discarded;
+	
+	if( argc == 2 && strncmp( argv[1], "--names=", 8 ) == 0 && atoi( argv[1] + 8 ) > 0 )
+	{
+		names = atoi( argv[1] + 8 );
+	}
+	else if( argc != 1 )
+	{
+		cerr << "Usage: " << argv[0] << " [--names=count]" << endl;
+		return 1;
+	}
+	
+	// Intern the names by scanning them. The second half is looked up without being declared.
+	for( int i = 0; i < names * 2; i++ )
+	{
+		source += "ident_" + to_string( i ) + " ";
+	}
+	
+	initializeScannerSource( source.c_str(), source.size() );
+	
+	for( TokenFrame token = getToken(); token.kind != END_OF_INPUT_TOKEN; token = getToken() )
+	{
+		nameIDs.push_back( token.nameID );
+	}
+	
+	order.resize( names );
+	
+	for( int i = 0; i < names; i++ )
+	{
+		order[i] = i;
+	}
+	
+	shuffle( order.begin(), order.end(), mt19937( 1 ) );
+	
+	// The symbol table keyed by intern id. It starts out holding the runtime functions.
+	heapBefore = heapInUse();
+	start = chrono::steady_clock::now();
+	
+	for( int i = 0; i < names; i++ )
+	{
+		setGlobalSymbol( nameIDs[order[i]], i );
+	}
+	
+	tableInsert = secondsSince( start );
+	tableMemory = heapInUse() - heapBefore;
+	start = chrono::steady_clock::now();
+	
+	for( int i = 0; i < names; i++ )
+	{
+		found += lookupGlobalSymbol( nameIDs[order[i]] ) != NO_SYMBOL;
+	}
+	
+	tableLookup = secondsSince( start );
+	start = chrono::steady_clock::now();
+	
+	for( int i = 0; i < names; i++ )
+	{
+		found += lookupGlobalSymbol( nameIDs[names + order[i]] ) != NO_SYMBOL;
+	}
+	
+	tableMiss = secondsSince( start );
+	
+	// The map keyed by spelling
+	heapBefore = heapInUse();
+	start = chrono::steady_clock::now();
+	
+	for( int i = 0; i < names; i++ )
+	{
+		spellings[internedName( nameIDs[order[i]] )] = i;
+	}
+	
+	mapInsert = secondsSince( start );
+	mapMemory = heapInUse() - heapBefore;
+	start = chrono::steady_clock::now();
+	
+	for( int i = 0; i < names; i++ )
+	{
+		found += spellings.find( internedName( nameIDs[order[i]] ) ) != spellings.end();
+	}
+	
+	mapLookup = secondsSince( start );
+	start = chrono::steady_clock::now();
+	
+	for( int i = 0; i < names; i++ )
+	{
+		found += spellings.find( internedName( nameIDs[names + order[i]] ) ) != spellings.end();
+	}
+	
+	mapMiss = secondsSince( start );
+	closeScanner();
+	
+	if( found != names * 2 )
+	{
+		cerr << "Found " << found << " names rather than " << names * 2 << "." << endl;
+		return 1;
+	}
+	
+	cout << names << " names, ns per insert / lookup / miss, and memory:" << endl;
+	cout << "SymbolTable:      " << tableInsert * 1e9 / names << " / " << tableLookup * 1e9 / names << " / " << tableMiss * 1e9 / names;
+	cout << ", " << tableMemory / 1048576.0 << " MB (" << context->symbolTable.slots.size() << " slots of " << sizeof( SymbolSlot ) << " bytes)" << endl;
+	cout << "map<string, int>: " << mapInsert * 1e9 / names << " / " << mapLookup * 1e9 / names << " / " << mapMiss * 1e9 / names;
+	cout << ", " << mapMemory / 1048576.0 << " MB" << endl;
+	
+	return 0;
+}
+
+// Returns the number of seconds since start
+double secondsSince( const chrono::steady_clock::time_point start )
+{
+	return chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+}
+
+// Returns the number of bytes allocated with malloc and still in use
+size_t heapInUse( void )
+{
+	struct mallinfo2 heap = mallinfo2();
+	
+	return heap.uordblks + heap.hblkhd; // Blocks from the heap and the big ones mapped on their own
+}